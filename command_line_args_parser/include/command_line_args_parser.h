@@ -4,6 +4,7 @@
 #include <boost/noncopyable.hpp>
 #include <boost/python.hpp>
 #include <string>
+#include <vector>
 
 class CommandLineArgsParser {
 public:
@@ -15,13 +16,14 @@ public:
     CommandLineArgsParser& operator=(CommandLineArgsParser&& other) = delete;
 
     bool parsePythonArgs(boost::python::list args);
-    std::string getConfigFileName() const { return m_configFileName; }
+    std::string getConfigFileName() const;
+    boost::python::list getConfigFileNames() const;
 
 private:
     bool parse(int argc, char* argv[]);
 
 private:
-    std::string m_configFileName;
+    std::vector<std::string> m_configFileNames;
 };
 
 BOOST_PYTHON_MODULE(command_line_args_parser) {
@@ -43,6 +45,9 @@ BOOST_PYTHON_MODULE(command_line_args_parser) {
                 >()
             )
         )
+        .def(
+            "getConfigFileNames", &CommandLineArgsParser::getConfigFileNames
+        )
     ;
 }
 
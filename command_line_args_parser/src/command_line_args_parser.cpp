@@ -144,13 +144,13 @@ bool CommandLineArgsParser::parsePythonArgs(boost::python::list pythonArgs) {
 }
 
 bool CommandLineArgsParser::parse(int argc, char* argv[]) {
-    if (!m_configFileName.empty()) {
-        std::cerr << "{CommandLineArgsParser::parse}; configuration file name is already set" << std::endl;
+    if (!m_configFileNames.empty()) {
+        std::cerr << "{CommandLineArgsParser::parse}; configuration file names are already set" << std::endl;
         return false;
     }
 
     try {
-        std::string configFileName;
+        std::vector<std::string> configFileNames;
         boost::program_options::options_description description;
         description.add_options()
             (
@@ -158,9 +158,9 @@ bool CommandLineArgsParser::parse(int argc, char* argv[]) {
             )
             (
                 "config,c",
-                boost::program_options::value<std::string>(
-                    &configFileName
-                )->required(), "Path to configuration file"
+                boost::program_options::value<std::vector<std::string>>(
+                    &configFileNames
+                )->multitoken()->required(), "Path to configuration file; one file per video stream"
             );
 
         boost::program_options::variables_map variables;
@@ -180,13 +180,15 @@ bool CommandLineArgsParser::parse(int argc, char* argv[]) {
         }
         boost::program_options::notify(variables);
 
-        if (!CommonFunctions::fileExists(configFileName)) {
-            return false;
-        }
-        if (!CommonFunctions::isRegularFile(configFileName)) {
-            return false;
+        for (const auto& configFileName : configFileNames) {
+            if (!CommonFunctions::fileExists(configFileName)) {
+                return false;
+            }
+            if (!CommonFunctions::isRegularFile(configFileName)) {
+                return false;
+            }
         }
-        m_configFileName = std::move(configFileName);
+        m_configFileNames = std::move(configFileNames);
     } catch (const boost::program_options::error& exception) {
         std::cerr << "{CommandLineArgsParser::parse}; "
             "exception 'boost::program_options::error' was successfully caught while "
@@ -202,3 +204,18 @@ bool CommandLineArgsParser::parse(int argc, char* argv[]) {
     }
     return true;
 }
+
+std::string CommandLineArgsParser::getConfigFileName() const {
+    if (m_configFileNames.empty()) {
+        return std::string();
+    }
+    return m_configFileNames.front();
+}
+
+boost::python::list CommandLineArgsParser::getConfigFileNames() const {
+    boost::python::list configFileNames;
+    for (const auto& configFileName : m_configFileNames) {
+        configFileNames.append(configFileName);
+    }
+    return configFileNames;
+}
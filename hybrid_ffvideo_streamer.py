@@ -3,6 +3,7 @@
 
 import os
 import sys
+import threading
 
 def module_exists(library_path, module_name):
     if not library_path:
@@ -52,8 +53,9 @@ if __name__ == "__main__":
         parser = command_line_args_parser.CommandLineArgsParser()
         if not parser.parse(sys.argv):
             sys.exit()
-        config_file_name = parser.getConfigFileName()
-        print(f"[main]; config file name: '{config_file_name}'")
+        config_file_names = list(parser.getConfigFileNames())
+        for config_file_name in config_file_names:
+            print(f"[main]; config file name: '{config_file_name}'")
 
         if not module_exists(library_path, "version_printer"):
             sys.exit()
@@ -63,11 +65,36 @@ if __name__ == "__main__":
         if not module_exists(library_path, "video_streamer"):
             sys.exit()
         import video_streamer
-        streamer = video_streamer.VideoStreamer()
-        if not streamer.setup(config_file_name):
-            sys.exit()
-        if not streamer.process():
-            sys.exit()
+        if 1 == len(config_file_names):
+            streamer = video_streamer.VideoStreamer()
+            if not streamer.setup(config_file_names[0]):
+                sys.exit()
+            if not streamer.process():
+                sys.exit()
+        else:
+            # all streamers share one process; 'process' releases the GIL
+            streamers = []
+            for config_file_name in config_file_names:
+                streamer = video_streamer.VideoStreamer()
+                if not streamer.setup(config_file_name):
+                    sys.exit()
+                streamers.append(streamer)
+
+            def run_streamer(streamer, config_file_name):
+                if not streamer.process():
+                    print(
+                        f"[run_streamer]; streamer for config file '{config_file_name}' has failed",
+                        file=sys.stderr
+                    )
+
+            threads = [
+                threading.Thread(target=run_streamer, args=(streamer, config_file_name))
+                for streamer, config_file_name in zip(streamers, config_file_names)
+            ]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
     except Exception as exception:
         print(
             f"[main]; exception '{exception}' was caught",
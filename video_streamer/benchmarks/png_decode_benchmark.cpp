@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "lodepng.h"
+
+/* Decode time of a PNG overlay: lodepng_decode, which inflates the whole
+ * image before it unfilters it, against lodepng_decode_into, which
+ * unfilters every scanline as soon as it was inflated and writes it into
+ * a strided buffer like the watermark frame.
+ *
+ * usage: png_decode_benchmark [runs] [file.png]; without a file a
+ * 1920x1080 RGBA overlay is generated. */
+namespace {
+    constexpr unsigned int g_defaultWidth = 1920;
+    constexpr unsigned int g_defaultHeight = 1080;
+    constexpr std::size_t g_defaultRuns = 50;
+    /* rows of AVFrames are padded for SIMD */
+    constexpr std::size_t g_rowAlignment = 64;
+
+    /* a soft gradient with a noisy band and transparent areas, which
+     * gives every filter type of the encoder something to pick */
+    std::vector<unsigned char> generateImage(unsigned int width, unsigned int height) {
+        std::vector<unsigned char> image(static_cast<std::size_t>(width) * height * 4);
+        std::uint32_t seed = 12345;
+        for (unsigned int y = 0; y < height; ++y) {
+            for (unsigned int x = 0; x < width; ++x) {
+                auto* pixel = &image[(static_cast<std::size_t>(y) * width + x) * 4];
+                seed = seed * 1664525u + 1013904223u;
+                auto noise = (y > height / 3) && (y < height / 2) ? (seed >> 28) : 0u;
+                pixel[0] = static_cast<unsigned char>((x * 255 / width + noise) & 0xFF);
+                pixel[1] = static_cast<unsigned char>((y * 255 / height) & 0xFF);
+                pixel[2] = static_cast<unsigned char>(((x + y) / 8) & 0xFF);
+                pixel[3] = ((x / 64 + y / 64) % 3) ? 255 : 0;
+            }
+        }
+        return image;
+    }
+
+    std::int64_t getMedian(std::vector<std::int64_t> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto nRuns = (argc > 1) ? static_cast<std::size_t>(std::strtoul(argv[1], nullptr, 10)) : g_defaultRuns;
+    nRuns = std::max<std::size_t>(nRuns, 1);
+
+    std::vector<unsigned char> png;
+    if (argc > 2) {
+        std::ifstream file(argv[2], std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "{main}; unable to open file '" << argv[2] << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+        png.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } else {
+        auto image = generateImage(g_defaultWidth, g_defaultHeight);
+        unsigned char* encoded = nullptr;
+        std::size_t encodedSize = 0;
+        auto error = lodepng_encode32(&encoded, &encodedSize, image.data(), g_defaultWidth, g_defaultHeight);
+        if (error) {
+            std::cerr << "{main}; unable to encode image; error: '" << lodepng_error_text(error) << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+        png.assign(encoded, encoded + encodedSize);
+        std::free(encoded);
+    }
+    unsigned int width = 0;
+    unsigned int height = 0;
+    {
+        LodePNGState state;
+        lodepng_state_init(&state);
+        auto error = lodepng_inspect(&width, &height, &state, png.data(), png.size());
+        lodepng_state_cleanup(&state);
+        if (error) {
+            std::cerr << "{main}; unable to read header; error: '" << lodepng_error_text(error) << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    auto stride = (static_cast<std::size_t>(width) * 4 + g_rowAlignment - 1) / g_rowAlignment * g_rowAlignment;
+    std::vector<unsigned char> frame(stride * height);
+
+    std::vector<std::int64_t> wholeTimes;
+    std::vector<std::int64_t> intoTimes;
+    for (std::size_t i = 0; i < nRuns; ++i) {
+        {
+            LodePNGState state;
+            lodepng_state_init(&state);
+            unsigned char* image = nullptr;
+            unsigned int imageWidth = 0;
+            unsigned int imageHeight = 0;
+            auto beginTime = std::chrono::steady_clock::now();
+            auto error = lodepng_decode(&image, &imageWidth, &imageHeight, &state, png.data(), png.size());
+            /* the watermark frame has its own stride, so the image is copied into it */
+            for (unsigned int y = 0; !error && (y < height); ++y) {
+                std::copy_n(&image[static_cast<std::size_t>(y) * width * 4], static_cast<std::size_t>(width) * 4, &frame[stride * y]);
+            }
+            wholeTimes.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - beginTime
+            ).count());
+            std::free(image);
+            lodepng_state_cleanup(&state);
+            if (error) {
+                std::cerr << "{main}; unable to decode image; error: '" << lodepng_error_text(error) << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        {
+            LodePNGState state;
+            lodepng_state_init(&state);
+            auto beginTime = std::chrono::steady_clock::now();
+            auto error = lodepng_decode_into(frame.data(), stride, width, height, &state, png.data(), png.size());
+            intoTimes.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - beginTime
+            ).count());
+            lodepng_state_cleanup(&state);
+            if (error) {
+                std::cerr << "{main}; unable to decode image; error: '" << lodepng_error_text(error) << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    std::cout << "{main}; image: '" << width << "x" << height << "'; "
+        "PNG size: '" << png.size() << " bytes'; "
+        "runs: '" << nRuns << "'" << std::endl;
+    std::cout << "{main}; lodepng_decode and copy; "
+        "median: '" << getMedian(wholeTimes) << " us'; "
+        "minimum: '" << *std::min_element(wholeTimes.cbegin(), wholeTimes.cend()) << " us'" << std::endl;
+    std::cout << "{main}; lodepng_decode_into; "
+        "median: '" << getMedian(intoTimes) << " us'; "
+        "minimum: '" << *std::min_element(intoTimes.cbegin(), intoTimes.cend()) << " us'" << std::endl;
+    return EXIT_SUCCESS;
+}
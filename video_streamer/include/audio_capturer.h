@@ -0,0 +1,101 @@
+#ifndef AUDIO_CAPTURER_H
+#define AUDIO_CAPTURER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "capture_clock.h"
+#include "packet_writer.h"
+#include "stream_metrics.h"
+
+extern "C" {
+    struct AVAudioFifo;
+    struct AVCodecContext;
+    struct AVFormatContext;
+    struct AVFrame;
+    struct AVPacket;
+    struct SwrContext;
+}
+
+/* Second input of a streamer: an ALSA or PulseAudio device, resampled to
+ * the format of the AAC encoder and encoded on its own thread. The audio
+ * stream is added to the output context of the video, and its packets go to
+ * the same packet writer, which interleaves them in the muxer; nothing of
+ * the audio runs on the capture or encode thread of the video. Timestamps
+ * come from the shared capture clock: the first frame after the origin was
+ * set is placed by its capture time, the following ones by counting
+ * samples, and when the two drift apart by more than a frame the stream is
+ * placed anew. */
+class AudioCapturer {
+public:
+    struct Settings {
+        /* "alsa" or "pulse" */
+        std::string format;
+        std::string device;
+        int sampleRate = 0;
+        int nChannels = 0;
+        /* bits per second */
+        std::int64_t bitRate = 0;
+    };
+
+    AudioCapturer() = default;
+    AudioCapturer(const AudioCapturer& other) = delete;
+    AudioCapturer& operator=(const AudioCapturer& other) = delete;
+    ~AudioCapturer();
+    AudioCapturer(AudioCapturer&& other) = delete;
+    AudioCapturer& operator=(AudioCapturer&& other) = delete;
+
+    /* opens the device and the encoder and adds the audio stream; before the header is written */
+    bool setup(
+        const Settings& settings, AVFormatContext* outputContext,
+        std::shared_ptr<CaptureClock> captureClock, StreamMetrics* metrics
+    );
+    /* after the header is written; the writer has to write on a thread of its own */
+    bool start(PacketWriter* packetWriter);
+    /* encodes the samples that are still buffered and waits for the thread */
+    void stop();
+    void close();
+    bool isRunning() const { return m_thread.joinable(); }
+
+private:
+    static int onProxyInterrupt(void* capturerPtr);
+    bool openInput();
+    bool openEncoder(const AVFormatContext* outputContext);
+    bool receiveFrames();
+    bool pushFrame(const AVFrame* frame);
+    bool encodeFifo(bool isFlushing);
+    bool encode(AVFrame* frame);
+    void run();
+
+private:
+    Settings m_settings;
+    std::shared_ptr<CaptureClock> m_captureClock{ nullptr };
+    StreamMetrics* m_metrics = nullptr;
+    PacketWriter* m_packetWriter = nullptr;
+    AVFormatContext* m_outputContext = nullptr;
+    int m_outputStreamIndex = -1;
+
+    AVFormatContext* m_inputContext = nullptr;
+    int m_inputStreamIndex = -1;
+    AVCodecContext* m_decoderContext = nullptr;
+    AVCodecContext* m_encoderContext = nullptr;
+    SwrContext* m_resamplerContext = nullptr;
+    AVAudioFifo* m_fifo = nullptr;
+    AVPacket* m_inputPacket = nullptr;
+    AVPacket* m_encoderPacket = nullptr;
+    AVFrame* m_decodedFrame = nullptr;
+    AVFrame* m_resampledFrame = nullptr;
+    AVFrame* m_encoderFrame = nullptr;
+
+    /* pts of the first sample in the FIFO, in samples; NOT placed until the capture clock is set */
+    std::int64_t m_nextPts = 0;
+    bool m_isPlaced = false;
+
+    std::thread m_thread;
+    std::atomic<bool> m_isStopRequested{ false };
+};
+
+#endif /* AUDIO_CAPTURER_H */
@@ -0,0 +1,19 @@
+#ifndef BITMAP_FONT_H
+#define BITMAP_FONT_H
+
+#include <cstdint>
+
+/* 8x8 bitmap glyphs of printable ASCII, for text burned into the video.
+ * One byte per glyph row; bit 0 is the leftmost pixel. */
+class BitmapFont {
+public:
+    static constexpr int s_glyphSize = 8;
+
+    /* characters outside of printable ASCII are drawn as '?' */
+    static const std::uint8_t* getGlyph(char character);
+
+private:
+    BitmapFont() = delete;
+};
+
+#endif /* BITMAP_FONT_H */
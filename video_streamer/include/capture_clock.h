@@ -0,0 +1,38 @@
+#ifndef CAPTURE_CLOCK_H
+#define CAPTURE_CLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+/* Shared timeline of the streams of one output. Camera frames and audio
+ * samples are both stamped with the wall clock time they were captured at
+ * (microseconds since the epoch); the first encoded video frame ties that
+ * clock to its pts, and every other stream maps its capture times through
+ * the same origin, so a sound and the picture it belongs to get the same
+ * output timestamp. Set by the encode thread, read by the audio thread. */
+class CaptureClock {
+public:
+    CaptureClock() = default;
+    CaptureClock(const CaptureClock& other) = delete;
+    CaptureClock& operator=(const CaptureClock& other) = delete;
+    ~CaptureClock() = default;
+    CaptureClock(CaptureClock&& other) = delete;
+    CaptureClock& operator=(CaptureClock&& other) = delete;
+
+    /* the first call wins; pts in microseconds */
+    void setOrigin(std::int64_t captureTime, std::int64_t pts);
+    void reset();
+    bool isSet() const { return m_isSet.load(std::memory_order_acquire); }
+
+    /* microseconds on the output timeline; NOT set until the first video frame */
+    std::optional<std::int64_t> getPts(std::int64_t captureTime) const;
+
+private:
+    std::atomic<bool> m_isSet{ false };
+    std::atomic<bool> m_isSetting{ false };
+    std::int64_t m_originCaptureTime = 0;
+    std::int64_t m_originPts = 0;
+};
+
+#endif /* CAPTURE_CLOCK_H */
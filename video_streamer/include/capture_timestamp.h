@@ -0,0 +1,29 @@
+#ifndef CAPTURE_TIMESTAMP_H
+#define CAPTURE_TIMESTAMP_H
+
+#include <cstdint>
+#include <optional>
+
+extern "C" {
+    struct AVBufferPool;
+    struct AVFrame;
+    struct AVPacket;
+}
+
+/* The wall clock time at which a packet was read from the camera and its
+ * pts travel with it as its opaque reference. Decoder and encoder are
+ * opened with AV_CODEC_FLAG_COPY_OPAQUE, filters copy the reference with
+ * the frame properties, so both arrive at the muxer with the encoded
+ * packet, whatever time bases the pts went through on the way. */
+namespace CaptureTimestamp {
+    AVBufferPool* createBufferPool();
+    /* the pts of the packet is kept as its capture pts */
+    bool attach(AVBufferPool* bufferPool, AVPacket* packet, std::int64_t captureTime);
+    std::optional<std::int64_t> get(const AVFrame* frame);
+    std::optional<std::int64_t> get(const AVPacket* packet);
+    /* pts of the camera packet the frame or packet was made from; the flow id of traces */
+    std::optional<std::int64_t> getPts(const AVFrame* frame);
+    std::optional<std::int64_t> getPts(const AVPacket* packet);
+}
+
+#endif /* CAPTURE_TIMESTAMP_H */
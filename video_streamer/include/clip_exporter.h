@@ -0,0 +1,62 @@
+#ifndef CLIP_EXPORTER_H
+#define CLIP_EXPORTER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stream_metrics.h"
+
+extern "C" {
+    struct AVCodecParameters;
+    struct AVPacket;
+}
+
+extern "C" {
+    #include <libavutil/rational.h>
+}
+
+/* Remuxes ranges of encoded packets into MP4 files on a background thread.
+ * Nothing is decoded or encoded, so exports do NOT compete with the live encoder. */
+class ClipExporter {
+public:
+    ClipExporter() = default;
+    ClipExporter(const ClipExporter& other) = delete;
+    ClipExporter& operator=(const ClipExporter& other) = delete;
+    ~ClipExporter();
+    ClipExporter(ClipExporter&& other) = delete;
+    ClipExporter& operator=(ClipExporter&& other) = delete;
+
+    bool setup(const AVCodecParameters* codecParameters, AVRational timeBase, StreamMetrics* metrics);
+    /* exports that were already requested are completed first */
+    void stop();
+
+    /* takes over the packets, also on failure */
+    bool exportClip(std::vector<AVPacket*>& packets, const std::string& fileName);
+
+private:
+    struct Job {
+        std::vector<AVPacket*> packets;
+        std::string fileName;
+    };
+
+    bool writeClip(Job& job) const;
+    static void freePackets(std::vector<AVPacket*>& packets);
+    void run();
+
+private:
+    AVCodecParameters* m_codecParameters = nullptr;
+    AVRational m_timeBase{ 0, 1 };
+    StreamMetrics* m_metrics = nullptr;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Job> m_jobs;
+    bool m_isStopRequested = false;
+};
+
+#endif /* CLIP_EXPORTER_H */
@@ -9,8 +9,11 @@ namespace CommonFunctions {
     bool fileExists(const std::string& fileName);
     bool isRegularFile(const std::string& fileName);
     bool isCharacterFile(const std::string& fileName);
+    bool isDirectory(const std::string& directoryName);
     bool getFileContents(const std::string& fileName, std::string& fileContents);
     std::int64_t getCurTimeSinceEpoch();
+    /* microseconds of a clock that does NOT step with the wall clock, for deadlines */
+    std::int64_t getSteadyTime();
     std::optional<std::int64_t> getDiffTime(std::int64_t beginTime, std::int64_t endTime);
 
     std::optional<std::string> extractHostNameFromRtmpUrl(const std::string& rtmpUrl);
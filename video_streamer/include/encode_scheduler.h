@@ -0,0 +1,121 @@
+#ifndef ENCODE_SCHEDULER_H
+#define ENCODE_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "thread_placement.h"
+
+/* Process-wide pool that runs the filtering and encoding work of all
+ * streamers which opted in. Jobs of one stream run strictly in order and
+ * never concurrently; across streams, the job with the earliest deadline
+ * runs first. Every worker owns a run queue and idle workers steal the
+ * most urgent entry of another worker, so a stream normally stays on the
+ * worker that is its affinity hint. */
+class EncodeScheduler {
+public:
+    using StreamId = std::size_t;
+    using Job = std::function< bool(void) >;
+
+    static EncodeScheduler& getInstance() {
+        static EncodeScheduler scheduler;
+        return scheduler;
+    }
+
+    /* every worker is pinned to one CPU of the placement, round-robin;
+     * scheduling policy and nice level apply to all workers */
+    bool start(std::size_t nWorkers, const ThreadPlacement::Settings& placement);
+    void stop();
+    bool isRunning() const { return m_isRunning.load(std::memory_order_acquire); }
+
+    std::optional<StreamId> registerStream(std::size_t queueCapacity);
+    void unregisterStream(StreamId streamId);
+
+    /* deadline is a time point of CommonFunctions::getSteadyTime();
+     * blocks while the stream already has 'queueCapacity' pending jobs */
+    bool submit(StreamId streamId, std::int64_t deadline, Job job);
+    bool waitIdle(StreamId streamId);
+    bool isStreamFailed(StreamId streamId);
+
+    std::uint64_t getDeadlineMisses() const { return m_nDeadlineMisses.load(std::memory_order_relaxed); }
+
+private:
+    struct Stream;
+
+    struct Entry {
+        std::int64_t deadline = 0;
+        std::shared_ptr<Stream> stream{ nullptr };
+
+        bool operator>(const Entry& other) const { return (deadline > other.deadline); }
+    };
+
+    struct Stream {
+        struct PendingJob {
+            std::int64_t deadline = 0;
+            Job job;
+        };
+
+        StreamId id = 0;
+        std::size_t preferredWorker = 0;
+        std::size_t queueCapacity = 0;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<PendingJob> pendingJobs;
+        bool isScheduled = false;
+        bool isRunning = false;
+        bool isFailed = false;
+        bool isUnregistered = false;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> runQueue;
+        std::thread thread;
+    };
+
+    EncodeScheduler() = default;
+    EncodeScheduler(const EncodeScheduler& other) = delete;
+    EncodeScheduler& operator=(const EncodeScheduler& other) = delete;
+    ~EncodeScheduler();
+    EncodeScheduler(EncodeScheduler&& other) = delete;
+    EncodeScheduler& operator=(EncodeScheduler&& other) = delete;
+
+    std::shared_ptr<Stream> findStream(StreamId streamId);
+    void enqueue(std::size_t workerIndex, Entry entry);
+    bool dequeue(std::size_t workerIndex, Entry& entry);
+    void runWorker(std::size_t workerIndex, ThreadPlacement::Settings placement);
+    void runEntry(const Entry& entry);
+
+private:
+    std::mutex m_controlMutex;
+    std::atomic<bool> m_isRunning{ false };
+    std::atomic<bool> m_isStopRequested{ false };
+    /* the list itself only changes in start/stop, which hold it exclusively */
+    std::shared_mutex m_workersMutex;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
+    std::atomic<std::size_t> m_nQueuedEntries{ 0 };
+
+    std::mutex m_streamsMutex;
+    std::unordered_map<StreamId, std::shared_ptr<Stream>> m_streams;
+    StreamId m_nextStreamId = 0;
+
+    std::atomic<std::uint64_t> m_nDeadlineMisses{ 0 };
+};
+
+#endif /* ENCODE_SCHEDULER_H */
@@ -0,0 +1,40 @@
+#ifndef ENCODER_OPTIONS_H
+#define ENCODER_OPTIONS_H
+
+#include <cstdint>
+#include <optional>
+
+extern "C" {
+    struct AVCodecContext;
+}
+
+/* GOP structure of an encoder: keyframe interval, scene cut detection and
+ * periodic intra refresh. The interval is a field of every encoder; the
+ * other two are private options of libx264 and are skipped with a notice
+ * when the encoder has none of them. A frame that is sent to the encoder as
+ * an I frame becomes an IDR frame, so a requested keyframe is one a player
+ * can join on. A maximum rate enables the VBV: every frame has to fit into
+ * what the output drains during the VBV buffer duration. With intra refresh
+ * the buffer defaults to one frame interval, so no frame is much larger
+ * than the average and the output carries no keyframe bursts. Applied after
+ * the time base was set and before avcodec_open2. */
+class EncoderOptions {
+public:
+    struct Settings {
+        /* microseconds between keyframes; zero keeps the default of the encoder */
+        std::int64_t gopDuration = 0;
+        /* zero disables scene cut detection, so keyframes come at the GOP interval only */
+        std::optional<int> sceneCutThreshold{ std::nullopt };
+        /* a column of intra blocks sweeps the picture once per GOP instead of whole keyframes */
+        bool isIntraRefreshEnabled = false;
+        /* bits per second; zero keeps the rate control of the encoder */
+        std::int64_t bitRate = 0;
+        std::int64_t maxRate = 0;
+        /* microseconds; zero picks one frame interval with intra refresh and one second otherwise */
+        std::int64_t vbvBufferDuration = 0;
+    };
+
+    static bool apply(const Settings& settings, AVCodecContext* encoderContext);
+};
+
+#endif /* ENCODER_OPTIONS_H */
@@ -0,0 +1,43 @@
+#ifndef ENCODER_THREAD_BUDGET_H
+#define ENCODER_THREAD_BUDGET_H
+
+#include <cstddef>
+#include <mutex>
+
+/* Shared by all streamers of the process, so that N encoders do NOT
+ * start N unbounded thread groups. The thread count of an encoder is
+ * fixed once it is opened, so encoders that take 'as many as possible'
+ * get a fair share of what is left up front: the remaining threads
+ * divided by the encoders that are still expected, or, when that number
+ * is NOT known, by the encoders that hold threads plus this one. */
+class EncoderThreadBudget {
+public:
+    static EncoderThreadBudget& getInstance() {
+        static EncoderThreadBudget budget;
+        return budget;
+    }
+
+    /* zero expected encoders means unknown */
+    bool setTotalThreads(std::size_t nTotalThreads, std::size_t nExpectedEncoders = 0);
+    std::size_t getTotalThreads() const;
+
+    std::size_t acquire(std::size_t nRequestedThreads);
+    void release(std::size_t nThreads);
+
+private:
+    EncoderThreadBudget();
+    EncoderThreadBudget(const EncoderThreadBudget& other) = delete;
+    EncoderThreadBudget& operator=(const EncoderThreadBudget& other) = delete;
+    ~EncoderThreadBudget() = default;
+    EncoderThreadBudget(EncoderThreadBudget&& other) = delete;
+    EncoderThreadBudget& operator=(EncoderThreadBudget&& other) = delete;
+
+private:
+    mutable std::mutex m_mutex;
+    std::size_t m_nTotalThreads = 0;
+    std::size_t m_nAcquiredThreads = 0;
+    std::size_t m_nExpectedEncoders = 0;
+    std::size_t m_nEncoders = 0;
+};
+
+#endif /* ENCODER_THREAD_BUDGET_H */
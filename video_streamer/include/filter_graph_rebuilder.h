@@ -0,0 +1,84 @@
+#ifndef FILTER_GRAPH_REBUILDER_H
+#define FILTER_GRAPH_REBUILDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    struct AVFilterContext;
+    struct AVFilterGraph;
+    struct AVFrame;
+}
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+/* Builds replacement filter graphs on a background thread, so that
+ * the streaming thread only has to exchange pointers at a frame boundary.
+ * Graphs that are swapped out are freed on the same background thread. */
+class FilterGraphRebuilder {
+public:
+    struct Graph {
+        AVFilterGraph* filterGraph = nullptr;
+        AVFilterContext* bufferSrcContext = nullptr;
+        AVFilterContext* bufferSinkContext = nullptr;
+        /* the graph draws a watermark */
+        bool hasWatermark = false;
+    };
+
+    struct Params {
+        std::string bufferSrcArgs;
+        AVPixelFormat sinkPixelFormat = AV_PIX_FMT_NONE;
+        std::string filterDescription;
+        int nThreads = 0;
+        /* fed once into the 'wm' input of the description, then the input is closed */
+        std::shared_ptr<AVFrame> overlayFrame{ nullptr };
+    };
+
+    FilterGraphRebuilder() = default;
+    FilterGraphRebuilder(const FilterGraphRebuilder& other) = delete;
+    FilterGraphRebuilder& operator=(const FilterGraphRebuilder& other) = delete;
+    ~FilterGraphRebuilder();
+    FilterGraphRebuilder(FilterGraphRebuilder&& other) = delete;
+    FilterGraphRebuilder& operator=(FilterGraphRebuilder&& other) = delete;
+
+    static bool buildGraph(const Params& params, Graph& graph);
+    static void freeGraph(Graph& graph);
+
+private:
+    static bool addOverlaySource(AVFilterGraph* filterGraph, const AVFrame* overlayFrame, AVFilterContext*& overlaySrcContext);
+    static bool feedOverlaySource(AVFilterContext* overlaySrcContext, AVFrame* overlayFrame);
+
+public:
+
+    bool setup();
+    void stop();
+
+    bool requestRebuild(const Params& params);
+    bool takeReadyGraph(Graph& graph);
+    void retireGraph(Graph& graph);
+
+private:
+    void run();
+
+private:
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_isStopRequested = false;
+
+    std::optional<Params> m_pendingParams{ std::nullopt };
+    std::vector<Graph> m_retiredGraphs;
+
+    Graph m_readyGraph;
+    std::atomic<bool> m_isGraphReady{ false };
+};
+
+#endif /* FILTER_GRAPH_REBUILDER_H */
@@ -0,0 +1,46 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Distribution of latencies in microseconds with log-linear buckets: values
+ * below 16 have a bucket of their own, above that every power of two is
+ * split into 16 buckets, so a percentile is off by less than 1/16. Samples
+ * are recorded by the output thread without locking and read from Python. */
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram& other) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram& other) = delete;
+    ~LatencyHistogram() = default;
+    LatencyHistogram(LatencyHistogram&& other) = delete;
+    LatencyHistogram& operator=(LatencyHistogram&& other) = delete;
+
+    void record(std::int64_t latency);
+    void reset();
+
+    std::uint64_t getCount() const { return m_count.load(std::memory_order_relaxed); }
+    std::uint64_t getMax() const { return m_max.load(std::memory_order_relaxed); }
+    /* upper bound of the bucket that holds the given fraction of the samples; zero without samples */
+    std::uint64_t getPercentile(double fraction) const;
+
+private:
+    static constexpr int s_subBucketBits = 4;
+    static constexpr int s_nSubBuckets = 1 << s_subBucketBits;
+    /* latencies are clamped to 2^36 microseconds (about 19 hours) */
+    static constexpr int s_maxExponent = 35;
+    static constexpr std::size_t s_nBuckets = (s_maxExponent - s_subBucketBits + 2) * s_nSubBuckets;
+
+    static std::size_t getBucketIndex(std::uint64_t value);
+    static std::uint64_t getBucketLowerBound(std::size_t index);
+
+private:
+    std::array<std::atomic<std::uint64_t>, s_nBuckets> m_buckets{};
+    std::atomic<std::uint64_t> m_count{ 0 };
+    std::atomic<std::uint64_t> m_max{ 0 };
+};
+
+#endif /* LATENCY_HISTOGRAM_H */
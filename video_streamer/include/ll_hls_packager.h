@@ -0,0 +1,104 @@
+#ifndef LL_HLS_PACKAGER_H
+#define LL_HLS_PACKAGER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "segment_store.h"
+#include "stream_metrics.h"
+
+extern "C" {
+    struct AVCodecParameters;
+    struct AVFormatContext;
+    struct AVIOContext;
+    struct AVPacket;
+}
+
+extern "C" {
+    #include <libavutil/rational.h>
+}
+
+/* Cuts the already encoded packets of a stream into CMAF chunks for
+ * Low-Latency HLS on its own thread. One fragmented MP4 muxer runs for
+ * the whole session and writes into memory; every fragment it flushes is
+ * a partial segment, and a segment is begun at the first keyframe after
+ * the segment duration. Parts and segments go to the segment store, which
+ * the HTTP server reads; nothing touches the disk. Like the recorder, the
+ * live path never waits: when the queue is full packets are dropped until
+ * the next keyframe, which then begins a new segment after a
+ * discontinuity. */
+class LlHlsPackager {
+public:
+    struct Settings {
+        /* microseconds */
+        std::int64_t segmentDuration = 0;
+        std::int64_t partDuration = 0;
+        std::size_t queueCapacity = 0;
+    };
+
+    LlHlsPackager() = default;
+    LlHlsPackager(const LlHlsPackager& other) = delete;
+    LlHlsPackager& operator=(const LlHlsPackager& other) = delete;
+    ~LlHlsPackager();
+    LlHlsPackager(LlHlsPackager&& other) = delete;
+    LlHlsPackager& operator=(LlHlsPackager&& other) = delete;
+
+    bool setup(
+        const Settings& settings, const AVCodecParameters* codecParameters,
+        AVRational timeBase, std::shared_ptr<SegmentStore> segmentStore, StreamMetrics* metrics
+    );
+    /* packages the packets that are still queued and ends the playlist */
+    void stop();
+    bool isRunning() const { return m_thread.joinable(); }
+
+    /* never blocks; the packet is referenced, NOT consumed */
+    void push(const AVPacket* packet);
+
+private:
+    struct QueuedPacket {
+        AVPacket* packet = nullptr;
+        bool isDiscontinuity = false;
+    };
+
+    static int onProxyWrite(void* packagerPtr, const std::uint8_t* buffer, int size);
+    bool openMuxer();
+    void closeMuxer();
+    bool writePacket(AVPacket* packet, bool isDiscontinuity);
+    bool flushPart();
+    void endSegment();
+    void run();
+
+private:
+    Settings m_settings;
+    AVCodecParameters* m_codecParameters = nullptr;
+    AVRational m_timeBase{ 0, 1 };
+    std::shared_ptr<SegmentStore> m_segmentStore{ nullptr };
+    StreamMetrics* m_metrics = nullptr;
+
+    /* used by the packager thread only */
+    AVFormatContext* m_muxerContext = nullptr;
+    AVIOContext* m_muxerIoContext = nullptr;
+    /* what the muxer wrote since the last part was cut */
+    std::string m_pendingBytes;
+    bool m_isSegmentOpen = false;
+    std::int64_t m_segmentStartTimestamp = 0;
+    std::int64_t m_partStartTimestamp = 0;
+    std::int64_t m_partEndTimestamp = 0;
+    std::size_t m_nPartPackets = 0;
+    bool m_isPartIndependent = false;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<QueuedPacket> m_queuedPackets;
+    bool m_isWaitingForKeyframe = true;
+    bool m_isStopRequested = false;
+};
+
+#endif /* LL_HLS_PACKAGER_H */
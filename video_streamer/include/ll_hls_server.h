@@ -0,0 +1,50 @@
+#ifndef LL_HLS_SERVER_H
+#define LL_HLS_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "segment_store.h"
+#include "stream_metrics.h"
+
+namespace Poco {
+    class ThreadPool;
+    namespace Net {
+        class HTTPServer;
+    }
+}
+
+/* Embedded HTTP server that hands out the playlist, init segment, parts
+ * and segments of one segment store. The playlist supports blocking
+ * reload (_HLS_msn, _HLS_part) and the part of the preload hint is
+ * answered as soon as it was cut, so a waiting request occupies one
+ * server thread; the thread pool is sized for that. */
+class LlHlsServer {
+public:
+    struct Settings {
+        std::string address;
+        std::uint16_t port = 0;
+        std::size_t maxThreads = 0;
+    };
+
+    /* defined where the Poco types are complete */
+    LlHlsServer();
+    LlHlsServer(const LlHlsServer& other) = delete;
+    LlHlsServer& operator=(const LlHlsServer& other) = delete;
+    ~LlHlsServer();
+    LlHlsServer(LlHlsServer&& other) = delete;
+    LlHlsServer& operator=(LlHlsServer&& other) = delete;
+
+    bool start(const Settings& settings, std::shared_ptr<SegmentStore> segmentStore, StreamMetrics* metrics);
+    /* the segment store must be closed first, so blocked requests return */
+    void stop();
+    bool isRunning() const { return (nullptr != m_server); }
+
+private:
+    std::unique_ptr<Poco::ThreadPool> m_threadPool{ nullptr };
+    std::unique_ptr<Poco::Net::HTTPServer> m_server{ nullptr };
+};
+
+#endif /* LL_HLS_SERVER_H */
@@ -885,6 +885,19 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize);
 
+/*
+Same as lodepng_decode, but decodes into a buffer of the caller, in the color type of state->info_raw,
+with 'stride' bytes per row. w and h must be the size of the image (e.g. from lodepng_inspect), the
+buffer must hold h rows, and the raw color type must have whole bytes per pixel. Scanlines of
+non-interlaced images are unfiltered and color converted as soon as the inflater has completed them,
+while they are still in the cache, and without an intermediate unfiltered image; the filtered scanlines
+are kept until the end, as the inflater copies its back references from them. A custom zlib or inflate
+function hands its output on when it is done. Interlaced images are decoded as a whole and copied.
+*/
+unsigned lodepng_decode_into(unsigned char* out, size_t stride, unsigned w, unsigned h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize);
+
 /*
 Read the PNG header, but not the actual data. This returns only the information
 that is in the IHDR chunk of the PNG, such as width, height and color type. The
@@ -0,0 +1,40 @@
+#ifndef LOG_DISPATCHER_H
+#define LOG_DISPATCHER_H
+
+#include <cstdarg>
+#include <map>
+#include <mutex>
+
+/* FFmpeg log level and log callback are process-wide, so they are owned
+ * here instead of by every streamer; the most verbose level requested by
+ * any registered streamer wins. */
+class LogDispatcher {
+public:
+    static LogDispatcher& getInstance() {
+        static LogDispatcher dispatcher;
+        return dispatcher;
+    }
+
+    bool registerLogLevel(int logLevel);
+    void unregisterLogLevel(int logLevel);
+
+private:
+    LogDispatcher() = default;
+    LogDispatcher(const LogDispatcher& other) = delete;
+    LogDispatcher& operator=(const LogDispatcher& other) = delete;
+    ~LogDispatcher() = default;
+    LogDispatcher(LogDispatcher&& other) = delete;
+    LogDispatcher& operator=(LogDispatcher&& other) = delete;
+
+    bool applyLogLevel();
+    static void log(void* ptr, int level, const char* format, va_list args);
+
+private:
+    std::mutex m_mutex;
+    std::map<int, std::size_t> m_logLevels;
+    bool m_isCallbackSet = false;
+
+    static inline std::mutex s_outputMutex;
+};
+
+#endif /* LOG_DISPATCHER_H */
@@ -0,0 +1,89 @@
+#ifndef MOTION_ANALYZER_H
+#define MOTION_ANALYZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+    struct AVFrame;
+}
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+/* Compares the luma of decoded frames with a reference frame. Luma is
+ * downsampled 2x2 first, which also suppresses most sensor noise; the
+ * difference is then summed per block of 8x8 downsampled pixels, so one
+ * block covers one 16x16 macroblock of the source frame. The reference is
+ * only replaced by commitReference(), i.e. by frames that were encoded. */
+class MotionAnalyzer {
+public:
+    static constexpr int s_blockSize = 16;
+
+    /* bounding box of connected changed blocks, in pixels of the source frame */
+    struct Region {
+        int left = 0;
+        int top = 0;
+        int right = 0;
+        int bottom = 0;
+        std::size_t nBlocks = 0;
+    };
+
+    MotionAnalyzer() = default;
+    MotionAnalyzer(const MotionAnalyzer& other) = delete;
+    MotionAnalyzer& operator=(const MotionAnalyzer& other) = delete;
+    ~MotionAnalyzer() = default;
+    MotionAnalyzer(MotionAnalyzer&& other) = delete;
+    MotionAnalyzer& operator=(MotionAnalyzer&& other) = delete;
+
+    static bool isPixelFormatSupported(AVPixelFormat pixelFormat);
+
+    /* threshold is the mean absolute luma difference per pixel above which a block has changed */
+    bool setup(int width, int height, AVPixelFormat pixelFormat, unsigned int threshold);
+    bool isSet() const { return !m_currentLuma.empty(); }
+    void clear();
+
+    /* returns the number of changed blocks; every block is changed while there is no reference */
+    std::size_t analyze(const AVFrame* frame);
+    void commitReference();
+
+    int getBlocksWide() const { return m_blocksWide; }
+    int getBlocksHigh() const { return m_blocksHigh; }
+    bool isBlockChanged(int blockX, int blockY) const;
+    /* regions of fewer than 'minBlocks' blocks are ignored; the largest 'maxRegions' are kept */
+    void getChangedRegions(std::size_t minBlocks, std::size_t maxRegions, std::vector<Region>& regions);
+
+private:
+    bool downsampleLuma(const AVFrame* frame);
+    const std::uint8_t* getLumaRow(const AVFrame* frame, int y, std::uint8_t* rowBuffer) const;
+    void computeBlockSads();
+    void computeBlockSads(int firstRow, int lastRow);
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    AVPixelFormat m_pixelFormat = AV_PIX_FMT_NONE;
+    std::uint32_t m_blockSadThreshold = 0;
+
+    /* downsampled luma; stride is a multiple of 16, padding stays zero */
+    int m_lumaWidth = 0;
+    int m_lumaHeight = 0;
+    std::size_t m_lumaStride = 0;
+    std::vector<std::uint8_t> m_currentLuma;
+    std::vector<std::uint8_t> m_referenceLuma;
+    bool m_hasReference = false;
+
+    /* full resolution luma of two rows, for packed pixel formats */
+    std::vector<std::uint8_t> m_rowBuffers;
+
+    int m_blocksWide = 0;
+    int m_blocksHigh = 0;
+    std::size_t m_blockPitch = 0;
+    std::vector<std::uint32_t> m_blockSads;
+    std::vector<int> m_blockStack;
+    std::vector<std::uint8_t> m_visitedBlocks;
+};
+
+#endif /* MOTION_ANALYZER_H */
@@ -0,0 +1,102 @@
+#ifndef MULTI_SCALER_H
+#define MULTI_SCALER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "row_band_pool.h"
+
+extern "C" {
+    struct AVBufferPool;
+    struct AVFrame;
+}
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+/* Downscales one YUV420P frame into several smaller ones in a single pass:
+ * the source is walked in blocks of rows that fit into the cache, and every
+ * output row whose footprint starts in the block is produced right away, so
+ * the source is read from memory once however many outputs there are.
+ * Every output pixel is the area average of the source pixels it covers.
+ * When both factors of a plane are integers, the pixels of the box are
+ * summed and divided, which gives the exact rounded box average; other
+ * factors use 12-bit weights per direction. Output frames come from a
+ * buffer pool per size. */
+class MultiScaler {
+public:
+    struct Size {
+        int width = 0;
+        int height = 0;
+    };
+
+    MultiScaler() = default;
+    MultiScaler(const MultiScaler& other) = delete;
+    MultiScaler& operator=(const MultiScaler& other) = delete;
+    ~MultiScaler();
+    MultiScaler(MultiScaler&& other) = delete;
+    MultiScaler& operator=(MultiScaler&& other) = delete;
+
+    static bool isPixelFormatSupported(AVPixelFormat pixelFormat);
+
+    /* output sizes are even and NOT larger than the source */
+    bool setup(int width, int height, AVPixelFormat pixelFormat, const std::vector<Size>& outputs);
+    bool isSet() const { return !m_outputs.empty(); }
+    void clear();
+
+    /* one target per output, in the order of setup; every target is
+     * unreferenced and gets a pooled buffer and the properties of the source */
+    bool scale(const AVFrame* sourceFrame, const std::vector<AVFrame*>& targetFrames);
+
+private:
+    /* 'nTaps' weights per output sample, starting at source sample 'first' */
+    struct Filter {
+        int nTaps = 0;
+        std::vector<int> first;
+        std::vector<std::uint16_t> weights;
+    };
+
+    struct Plane {
+        int sourceWidth = 0;
+        int width = 0;
+        int height = 0;
+        Filter horizontal;
+        Filter vertical;
+        /* pixels of a box for integer factors, whose filters then have unit weights; zero otherwise */
+        std::uint32_t boxArea = 0;
+        /* 2^32 / boxArea rounded up, so a division is a multiplication */
+        std::uint64_t boxReciprocal = 0;
+    };
+
+    struct Output {
+        Size size;
+        Plane planes[ 3 ];
+        AVBufferPool* bufferPool = nullptr;
+    };
+
+    static bool computeFilter(int sourceSize, int size, Filter& filter);
+    static void computeBoxFilter(int factor, int size, Filter& filter);
+    bool allocateBuffer(Output& output, AVFrame* targetFrame) const;
+    /* zero taps means the number of taps of the filter */
+    template<int nTaps>
+    static void filterColumns(const std::uint32_t* rowBuffer, const Filter& filter, int width, std::uint8_t* targetRow);
+    template<int nTaps>
+    static void averageColumns(const std::uint32_t* rowBuffer, const Plane& plane, std::uint8_t* targetRow);
+    /* produces the output rows whose footprint starts in the source rows [firstRow, lastRow) */
+    void scaleRows(
+        const AVFrame* sourceFrame, const std::vector<AVFrame*>& targetFrames,
+        int firstRow, int lastRow, std::uint32_t* rowBuffer
+    ) const;
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    AVPixelFormat m_pixelFormat = AV_PIX_FMT_NONE;
+    std::vector<Output> m_outputs;
+    /* one vertical sum of a source row per band */
+    std::vector<std::uint32_t> m_rowBuffers;
+};
+
+#endif /* MULTI_SCALER_H */
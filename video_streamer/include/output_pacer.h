@@ -0,0 +1,73 @@
+#ifndef OUTPUT_PACER_H
+#define OUTPUT_PACER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "latency_histogram.h"
+#include "stream_metrics.h"
+#include "timeout_checker.h"
+
+extern "C" {
+    struct AVFormatContext;
+    struct AVIOContext;
+}
+
+/* Token bucket between the muxer and the output. The bytestream context of
+ * the output is replaced by one of our own with a buffer of one chunk, so
+ * whatever the muxer writes, a whole keyframe included, reaches the output
+ * in chunks that are released at the pacing rate instead of in one burst.
+ * Interleaving of the muxer is NOT affected, the pacer only sees the bytes
+ * it produced. Waits are absolute sleeps on the monotonic clock that end in
+ * a short spin, and the deadline of the timeout checker is restarted after
+ * every wait, so only the time spent in the output counts towards it. The
+ * lateness of every released chunk is recorded as pacing accuracy. */
+class OutputPacer {
+public:
+    struct Settings {
+        /* bits per second */
+        std::int64_t rate = 0;
+        /* bytes that may be released at once after an idle period */
+        std::size_t burstSize = 0;
+        std::size_t chunkSize = 0;
+    };
+
+    OutputPacer() = default;
+    OutputPacer(const OutputPacer& other) = delete;
+    OutputPacer& operator=(const OutputPacer& other) = delete;
+    ~OutputPacer();
+    OutputPacer(OutputPacer&& other) = delete;
+    OutputPacer& operator=(OutputPacer&& other) = delete;
+
+    /* the bytestream context of the output context has to be open */
+    bool setup(
+        const Settings& settings, AVFormatContext* outputContext, std::shared_ptr<TimeoutChecker> timeoutChecker,
+        StreamMetrics* metrics, LatencyHistogram* errorHistogram
+    );
+    /* releases what is still buffered and puts the bytestream context of the output back */
+    void close();
+    bool isSet() const { return (nullptr != m_ioContext); }
+
+    static int onProxyWrite(void* pacerPtr, const std::uint8_t* data, int size);
+
+private:
+    bool write(const std::uint8_t* data, std::size_t size);
+    void waitUntil(std::int64_t time);
+
+private:
+    Settings m_settings;
+    AVFormatContext* m_outputContext = nullptr;
+    /* the bytestream context of the output */
+    AVIOContext* m_targetContext = nullptr;
+    AVIOContext* m_ioContext = nullptr;
+    std::shared_ptr<TimeoutChecker> m_timeoutChecker{ nullptr };
+    StreamMetrics* m_metrics = nullptr;
+    LatencyHistogram* m_errorHistogram = nullptr;
+
+    /* nanoseconds on the monotonic clock; the bucket is full when this lies a burst in the past */
+    std::int64_t m_releaseTime = 0;
+    std::int64_t m_burstDuration = 0;
+};
+
+#endif /* OUTPUT_PACER_H */
@@ -0,0 +1,76 @@
+#ifndef OUTPUT_PROTOCOL_H
+#define OUTPUT_PROTOCOL_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "timeout_checker.h"
+
+extern "C" {
+    struct AVDictionary;
+    struct AVFormatContext;
+    struct AVIOInterruptCB;
+}
+
+/* Container, protocol whitelist and protocol options of an output, chosen
+ * by the scheme of its URL. RTMP and raw TCP carry FLV; UDP (unicast or
+ * multicast) and SRT carry MPEG-TS in datagrams of 7 TS packets. The
+ * protocols also differ in what a write that runs into the timeout means:
+ * an FLV stream can NOT resync after a lost tag, so the output fails, while
+ * an MPEG-TS receiver resyncs on the next TS packet, so the data is dropped
+ * and streaming goes on. */
+class OutputProtocol {
+public:
+    enum class Type {
+        Rtmp,
+        Tcp,
+        Udp,
+        Srt
+    };
+
+    enum class Backpressure {
+        Fail,
+        Drop
+    };
+
+    struct Settings {
+        /* timeout of a single write in microseconds */
+        std::int64_t timeout = TimeoutChecker::s_defaultTimeout;
+        /* UDP and SRT: payload of a datagram; zero keeps the default of the protocol */
+        int packetSize = 0;
+        /* UDP: multicast time to live; zero keeps the default */
+        int ttl = 0;
+        /* UDP: socket send buffer in bytes; zero keeps the default */
+        int sendBufferSize = 0;
+        /* UDP: local address, i.e. the interface multicast is sent from */
+        std::string localAddress;
+        /* SRT: receiver latency window in microseconds; zero keeps the default */
+        std::int64_t latency = 0;
+        std::string passphrase;
+        std::string streamId;
+        /* SRT: bytes per second; zero keeps the default */
+        std::int64_t maxBandwidth = 0;
+    };
+
+    static std::optional<Type> getType(const std::string& url);
+    static const char* getName(Type type);
+    static const char* getFormatName(Type type);
+    static Backpressure getBackpressure(Type type);
+    static Settings getDefaultSettings(Type type);
+
+    /* fills the protocol whitelist and the options of the protocol for avio_open2 */
+    static bool fillOptions(Type type, const Settings& settings, AVDictionary** options);
+
+    /* validates the host of the URL and opens the bytestream context of the output
+     * with the options above and 'extraOptions'; all of them have to be consumed */
+    static bool openOutput(
+        AVFormatContext* outputContext, const std::string& url, Type type, const Settings& settings,
+        const AVIOInterruptCB& interruptCallback,
+        const std::vector<std::pair<const char*, std::string>>& extraOptions = {}
+    );
+};
+
+#endif /* OUTPUT_PROTOCOL_H */
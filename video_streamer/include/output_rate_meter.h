@@ -0,0 +1,51 @@
+#ifndef OUTPUT_RATE_METER_H
+#define OUTPUT_RATE_METER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/* Output rate over short windows (one frame interval) and over a period
+ * of many windows. The peak is the busiest window of the last complete
+ * period, so a keyframe that is written within one frame interval shows
+ * up as a peak many times the average, while a stream of even frames has
+ * a ratio close to one. Bytes are added by the writing thread only; the
+ * rates of the last period are read from Python. */
+class OutputRateMeter {
+public:
+    OutputRateMeter() = default;
+    OutputRateMeter(const OutputRateMeter& other) = delete;
+    OutputRateMeter& operator=(const OutputRateMeter& other) = delete;
+    ~OutputRateMeter() = default;
+    OutputRateMeter(OutputRateMeter&& other) = delete;
+    OutputRateMeter& operator=(OutputRateMeter&& other) = delete;
+
+    /* microseconds; the period is rounded to whole windows */
+    bool setup(std::int64_t window, std::int64_t period);
+    void add(std::uint64_t nBytes, std::int64_t time);
+
+    /* bits per second; zero until the first period was completed */
+    std::uint64_t getPeakRate() const { return m_peakRate.load(std::memory_order_relaxed); }
+    std::uint64_t getAverageRate() const { return m_averageRate.load(std::memory_order_relaxed); }
+    double getPeakToAverageRatio() const;
+
+private:
+    void closeWindow();
+
+private:
+    std::int64_t m_window = 0;
+    std::size_t m_nPeriodWindows = 0;
+
+    /* used by the writing thread only */
+    std::optional<std::int64_t> m_windowStartTime{ std::nullopt };
+    std::uint64_t m_windowBytes = 0;
+    std::uint64_t m_periodBytes = 0;
+    std::uint64_t m_periodPeakBytes = 0;
+    std::size_t m_nClosedWindows = 0;
+
+    std::atomic<std::uint64_t> m_peakRate{ 0 };
+    std::atomic<std::uint64_t> m_averageRate{ 0 };
+};
+
+#endif /* OUTPUT_RATE_METER_H */
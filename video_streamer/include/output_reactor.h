@@ -0,0 +1,96 @@
+#ifndef OUTPUT_REACTOR_H
+#define OUTPUT_REACTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "thread_placement.h"
+
+extern "C" {
+    struct AVIOInterruptCB;
+}
+
+/* Process-wide writer for the outputs of all streamers. The writing
+ * thread copies its data into buffers of a fixed pool and returns; one
+ * reactor thread per ring sends them. With io_uring, every ring has a
+ * submission queue of its own with the pool registered as fixed buffers;
+ * where io_uring is NOT available (old kernel, seccomp), the reactor waits
+ * for sockets with epoll and writes files itself. A target has at most one
+ * write in flight, so its data stays in order, and the writer only waits
+ * when the target already holds 's_maxBuffersPerTarget' buffers or the
+ * pool of its ring is empty. Without a running reactor, outputs write on
+ * their own thread as before. */
+class OutputReactor {
+public:
+    enum class Backend {
+        IoUring,
+        Epoll
+    };
+
+    struct Stats {
+        /* bytes that were written to the target, but NOT passed to the kernel yet */
+        std::uint64_t nQueuedBytes = 0;
+        std::uint64_t nSubmissions = 0;
+        std::uint64_t nWrittenBytes = 0;
+    };
+
+    class Target;
+
+    /* multiple of the O_DIRECT alignment */
+    static constexpr std::size_t s_bufferSize = 256 * 1024;
+    static constexpr std::size_t s_buffersPerRing = 64;
+    static constexpr std::size_t s_maxBuffersPerTarget = 4;
+
+    static OutputReactor& getInstance() {
+        static OutputReactor reactor;
+        return reactor;
+    }
+
+    /* every ring is served by one thread, pinned to one CPU of the placement, round-robin */
+    bool start(std::size_t nRings, const ThreadPlacement::Settings& placement);
+    void stop();
+    bool isRunning() const { return m_isRunning.load(std::memory_order_acquire); }
+    std::optional<Backend> getBackend() const;
+
+    /* a socket is written at its current position, a file from offset zero on;
+     * the descriptor must stay open until the target is unregistered */
+    std::shared_ptr<Target> registerTarget(int fileDescriptor, bool isSocket);
+    /* drops data that was NOT written yet and waits for the write in flight */
+    void unregisterTarget(const std::shared_ptr<Target>& target);
+
+    /* only one thread may write to a target; the interrupt callback may be NULL */
+    bool write(Target& target, const std::uint8_t* data, std::size_t size, const AVIOInterruptCB* interruptCallback);
+    /* passes the partly filled buffer to the reactor;
+     * for files, 'isSync' synchronizes the data written so far */
+    bool flush(Target& target, bool isSync);
+    /* flushes and waits until all data was written */
+    bool drain(Target& target, const AVIOInterruptCB* interruptCallback);
+
+    /* may be called from any thread */
+    static Stats getStats(const Target& target);
+
+private:
+    struct Ring;
+
+    OutputReactor() = default;
+    OutputReactor(const OutputReactor& other) = delete;
+    OutputReactor& operator=(const OutputReactor& other) = delete;
+    ~OutputReactor();
+    OutputReactor(OutputReactor&& other) = delete;
+    OutputReactor& operator=(OutputReactor&& other) = delete;
+
+    static bool isInterrupted(const AVIOInterruptCB* interruptCallback);
+    static void runRing(std::shared_ptr<Ring> ring, std::size_t ringIndex, ThreadPlacement::Settings placement);
+
+private:
+    std::mutex m_controlMutex;
+    std::atomic<bool> m_isRunning{ false };
+    std::vector<std::shared_ptr<Ring>> m_rings;
+};
+
+#endif /* OUTPUT_REACTOR_H */
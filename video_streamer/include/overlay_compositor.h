@@ -0,0 +1,152 @@
+#ifndef OVERLAY_COMPOSITOR_H
+#define OVERLAY_COMPOSITOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "stream_metrics.h"
+
+extern "C" {
+    struct AVFrame;
+}
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+/* Blends layers of text, a clock, a timestamp code and rotating images into
+ * the frames that are sent to the encoder. Every layer keeps a straight YUVA canvas and,
+ * per tile of 16x16 pixels, a premultiplied copy with the inverse alpha;
+ * only tiles whose canvas changed are premultiplied again, so a clock
+ * costs a few tiles once per second. Blending reads the premultiplied
+ * tiles only, copies opaque tiles and skips transparent ones. */
+class OverlayCompositor {
+public:
+    static constexpr int s_tileSize = 16;
+
+    enum class LayerType {
+        Text,
+        Clock,
+        Images,
+        /* the time of the frame as a row of black and white cells that a receiver can decode */
+        Timestamp
+    };
+
+    struct LayerSettings {
+        LayerType type = LayerType::Text;
+        /* text layers are addressed by name */
+        std::string name;
+        /* negative coordinates are measured from the right and bottom edges */
+        int x = 0;
+        int y = 0;
+        /* text: initial text; clock: strftime format */
+        std::string text;
+        std::size_t maxLength = 0;
+        int scale = 1;
+        double opacity = 1.0;
+        double backgroundOpacity = 0.0;
+        std::vector<std::string> fileNames;
+        /* in microseconds */
+        std::int64_t imageInterval = 0;
+    };
+
+    OverlayCompositor() = default;
+    OverlayCompositor(const OverlayCompositor& other) = delete;
+    OverlayCompositor& operator=(const OverlayCompositor& other) = delete;
+    ~OverlayCompositor() = default;
+    OverlayCompositor(OverlayCompositor&& other) = delete;
+    OverlayCompositor& operator=(OverlayCompositor&& other) = delete;
+
+    static bool isPixelFormatSupported(AVPixelFormat pixelFormat);
+
+    bool setup(
+        int width, int height, AVPixelFormat pixelFormat,
+        const std::vector<LayerSettings>& layers, StreamMetrics* metrics
+    );
+    bool isSet() const { return !m_layers.empty(); }
+    void clear();
+
+    /* may be called from any thread; the text is drawn with the next frame */
+    bool setText(const std::string& layerName, const std::string& text);
+
+    /* time is the wall clock time of the frame in microseconds */
+    bool blend(AVFrame* frame, std::int64_t time);
+
+    /* the two halves of blend() for callers that produce the frame in bands
+     * themselves: prepare() updates the layers once per frame, blendRows()
+     * blends the rows [firstRow, lastRow) of a writable frame; both are even */
+    bool prepare(const AVFrame* frame, std::int64_t time);
+    void blendRows(AVFrame* frame, int firstRow, int lastRow) const;
+
+private:
+    enum class Coverage : std::uint8_t {
+        Transparent,
+        Opaque,
+        Translucent
+    };
+
+    struct Layer {
+        LayerSettings settings;
+        int x = 0;
+        int y = 0;
+        int tilesWide = 0;
+        int tilesHigh = 0;
+        /* luma and alpha are at full resolution, chroma at half */
+        std::size_t stride = 0;
+        std::size_t chromaStride = 0;
+
+        std::vector<std::uint8_t> canvasY;
+        std::vector<std::uint8_t> canvasA;
+        std::vector<std::uint8_t> canvasU;
+        std::vector<std::uint8_t> canvasV;
+
+        std::vector<std::uint8_t> premultipliedY;
+        std::vector<std::uint8_t> inverseAlpha;
+        std::vector<std::uint8_t> premultipliedU;
+        std::vector<std::uint8_t> premultipliedV;
+        std::vector<std::uint8_t> inverseChromaAlpha;
+        std::vector<Coverage> tileCoverage;
+        std::vector<std::uint8_t> dirtyTiles;
+        bool hasDirtyTiles = false;
+
+        std::string drawnText;
+        std::optional<std::int64_t> clockSecond{ std::nullopt };
+        std::optional<std::uint64_t> drawnTimestamp{ std::nullopt };
+        std::vector<std::shared_ptr<AVFrame>> images;
+        std::optional<std::size_t> imageIndex{ std::nullopt };
+    };
+
+    bool setupLayer(const LayerSettings& settings, Layer& layer);
+    void drawText(Layer& layer, const std::string& text);
+    void drawImage(Layer& layer, const AVFrame* image);
+    void drawTimestamp(Layer& layer, std::uint64_t timestamp);
+    void markDirty(Layer& layer, int left, int top, int right, int bottom);
+    void updateLayer(Layer& layer, std::int64_t time);
+    std::size_t rasterizeDirtyTiles(Layer& layer);
+    /* blends the rows [firstRow, lastRow) of the frame; both are even */
+    void blendLayer(const Layer& layer, AVFrame* frame, int firstRow, int lastRow) const;
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    AVPixelFormat m_pixelFormat = AV_PIX_FMT_NONE;
+    std::uint8_t m_blackLuma = 0;
+    std::uint8_t m_whiteLuma = 0;
+    std::vector<Layer> m_layers;
+    StreamMetrics* m_metrics = nullptr;
+
+    std::mutex m_textMutex;
+    std::set<std::string> m_textLayerNames;
+    std::map<std::string, std::string> m_pendingTexts;
+    std::atomic<bool> m_hasPendingTexts{ false };
+};
+
+#endif /* OVERLAY_COMPOSITOR_H */
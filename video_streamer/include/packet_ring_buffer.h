@@ -0,0 +1,73 @@
+#ifndef PACKET_RING_BUFFER_H
+#define PACKET_RING_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+    struct AVPacket;
+}
+
+extern "C" {
+    #include <libavutil/rational.h>
+}
+
+/* Memory-bounded history of the encoded packets of a stream. Packets are kept
+ * as references, so the live path does NOT copy payloads. Whole GOPs are
+ * evicted from the oldest end, so the history always starts at a keyframe,
+ * and a keyframe index allows GOP-aligned lookups by time. */
+class PacketRingBuffer {
+public:
+    PacketRingBuffer() = default;
+    PacketRingBuffer(const PacketRingBuffer& other) = delete;
+    PacketRingBuffer& operator=(const PacketRingBuffer& other) = delete;
+    ~PacketRingBuffer();
+    PacketRingBuffer(PacketRingBuffer&& other) = delete;
+    PacketRingBuffer& operator=(PacketRingBuffer&& other) = delete;
+
+    /* max duration is in microseconds; 0 bounds the history by memory only */
+    bool setup(std::size_t maxBytes, std::int64_t maxDuration, AVRational timeBase);
+    void clear();
+    bool isSet() const;
+
+    /* the packet is referenced, NOT consumed */
+    void push(const AVPacket* packet);
+
+    /* start and duration are in microseconds; a negative start is relative to the
+     * newest packet, otherwise it is a stream time. The range is extended backwards
+     * to the preceding keyframe. Caller owns the returned packets. */
+    bool copyRange(std::int64_t start, std::int64_t duration, std::vector<AVPacket*>& packets) const;
+
+    std::size_t getBufferedBytes() const;
+    std::int64_t getBufferedDuration() const;
+
+private:
+    struct Entry {
+        AVPacket* packet = nullptr;
+        std::int64_t timestamp = 0;
+    };
+
+    struct Keyframe {
+        std::int64_t timestamp = 0;
+        std::uint64_t sequenceNumber = 0;
+    };
+
+    void evict();
+
+private:
+    mutable std::mutex m_mutex;
+    std::size_t m_maxBytes = 0;
+    std::int64_t m_maxDuration = 0;
+    AVRational m_timeBase{ 0, 1 };
+
+    std::deque<Entry> m_entries;
+    std::deque<Keyframe> m_keyframes;
+    /* sequence number of the first entry; entries are numbered consecutively */
+    std::uint64_t m_firstSequenceNumber = 0;
+    std::size_t m_bufferedBytes = 0;
+};
+
+#endif /* PACKET_RING_BUFFER_H */
@@ -0,0 +1,91 @@
+#ifndef PACKET_WRITER_H
+#define PACKET_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "latency_histogram.h"
+#include "output_rate_meter.h"
+#include "stream_metrics.h"
+#include "thread_placement.h"
+#include "timeout_checker.h"
+
+extern "C" {
+    struct AVFormatContext;
+    struct AVPacket;
+}
+
+/* Muxes encoded packets into the output context. By default packets are
+ * written on the calling thread; with a dedicated output thread a burst in
+ * av_interleaved_write_frame only fills the queue and does not stall encoding.
+ * The queue is bounded, a full queue blocks the encoder (packets of a
+ * compressed stream can NOT be dropped one by one). */
+class PacketWriter {
+public:
+    struct Settings {
+        bool isThreaded = false;
+        std::optional<ThreadPlacement::Settings> placement{ std::nullopt };
+        std::size_t queueCapacity = 0;
+        /* a packet that reaches the output later than this after being queued counts as a scheduling miss */
+        std::int64_t maxLatency = 0;
+        /* receives the time from capture to the completed write of every packet that carries a capture timestamp */
+        LatencyHistogram* latencyHistogram = nullptr;
+        /* receives the size of every written packet */
+        OutputRateMeter* rateMeter = nullptr;
+        std::uint32_t traceStreamId = 0;
+        /* a write that runs into the timeout drops its data instead of failing the writer (MPEG-TS outputs) */
+        bool isDropOnTimeout = false;
+        /* called on the writing thread after a packet was dropped, the receiver needs a keyframe to resync */
+        std::function<void()> onPacketDropped;
+    };
+
+    PacketWriter() = default;
+    PacketWriter(const PacketWriter& other) = delete;
+    PacketWriter& operator=(const PacketWriter& other) = delete;
+    ~PacketWriter();
+    PacketWriter(PacketWriter&& other) = delete;
+    PacketWriter& operator=(PacketWriter&& other) = delete;
+
+    bool setup(
+        AVFormatContext* outputContext, std::shared_ptr<TimeoutChecker> timeoutChecker,
+        StreamMetrics* metrics, const Settings& settings
+    );
+    void stop();
+
+    /* takes over the reference of the packet; the packet is left blank */
+    bool write(AVPacket* packet);
+    /* waits until every queued packet was written */
+    bool flush();
+
+private:
+    struct QueuedPacket {
+        AVPacket* packet = nullptr;
+        std::int64_t queuedTime = 0;
+    };
+
+    bool writePacket(AVPacket* packet, std::int64_t queuedTime);
+    void run();
+
+private:
+    AVFormatContext* m_outputContext = nullptr;
+    std::shared_ptr<TimeoutChecker> m_timeoutChecker{ nullptr };
+    StreamMetrics* m_metrics = nullptr;
+    Settings m_settings;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<QueuedPacket> m_queuedPackets;
+    bool m_isWriting = false;
+    bool m_isFailed = false;
+    bool m_isStopRequested = false;
+};
+
+#endif /* PACKET_WRITER_H */
@@ -0,0 +1,89 @@
+#ifndef PIXEL_CONVERTER_H
+#define PIXEL_CONVERTER_H
+
+#include <cstdint>
+
+extern "C" {
+    struct AVBufferPool;
+    struct AVFrame;
+}
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+class OverlayCompositor;
+
+/* Converts the frames of the camera into the planar format of the encoder
+ * before they enter the filter graph, so the graph does not need a scale
+ * filter. Packed YUYV/UYVY and semi-planar NV12/NV21 are converted to
+ * YUV420P in bands of rows; the layers of an overlay compositor are blended
+ * into each band right after it is converted, while its rows are still in
+ * the cache, so the frame is read and written only once. Chroma of two
+ * rows is averaged like the unscaled converter of swscale on the same
+ * platform: rounded up on x86, where it uses PAVGB, and truncated by its
+ * C converter elsewhere (see compareWithScaler). The kernels use AVX2 when
+ * the CPU supports it, otherwise SSE2 or plain C. */
+class PixelConverter {
+public:
+    enum class InstructionSet {
+        C = 0,
+        Sse2,
+        Avx2
+    };
+
+public:
+    PixelConverter() = default;
+    PixelConverter(const PixelConverter& other) = delete;
+    PixelConverter& operator=(const PixelConverter& other) = delete;
+    ~PixelConverter();
+    PixelConverter(PixelConverter&& other) = delete;
+    PixelConverter& operator=(PixelConverter&& other) = delete;
+
+    static bool isConversionSupported(AVPixelFormat sourceFormat, AVPixelFormat targetFormat);
+
+    /* the compositor may be NULL; otherwise it has to be set up for the target format */
+    bool setup(
+        int width, int height, AVPixelFormat sourceFormat, AVPixelFormat targetFormat,
+        OverlayCompositor* compositor
+    );
+    bool isSet() const { return nullptr != m_bufferPool; }
+    void clear();
+    AVPixelFormat getTargetFormat() const { return m_targetFormat; }
+    InstructionSet getInstructionSet() const { return m_instructionSet; }
+    /* layers drawn by the filter graph, i.e. a watermark, have to stay below the
+     * overlay layers, so fusing is turned off while the graph draws one */
+    void setBlendingFused(bool isFused) { m_isBlendingFused = isFused && (nullptr != m_compositor); }
+    bool isBlendingFused() const { return m_isBlendingFused; }
+
+    /* 'targetFrame' is unreferenced and gets a buffer from the pool and the
+     * properties of 'sourceFrame'; time is the wall clock time of the frame
+     * in microseconds, used by the overlay layers */
+    bool convert(const AVFrame* sourceFrame, AVFrame* targetFrame, std::int64_t time);
+
+    /* converts the frame with swscale as well, as the auto-inserted scale
+     * filter would, and with every kernel the CPU supports, and reports the
+     * median time of each and the bytes in which the kernels differ from
+     * swscale; overlay layers are NOT blended */
+    bool compareWithScaler(const AVFrame* sourceFrame);
+
+private:
+    using Kernel = void (*)(const AVFrame* source, AVFrame* target, int width, int firstRow, int lastRow);
+
+    static Kernel getKernel(AVPixelFormat sourceFormat, InstructionSet instructionSet);
+    static InstructionSet detectInstructionSet();
+    bool allocateBuffer(AVFrame* targetFrame);
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    AVPixelFormat m_sourceFormat = AV_PIX_FMT_NONE;
+    AVPixelFormat m_targetFormat = AV_PIX_FMT_NONE;
+    InstructionSet m_instructionSet = InstructionSet::C;
+    Kernel m_kernel = nullptr;
+    AVBufferPool* m_bufferPool = nullptr;
+    OverlayCompositor* m_compositor = nullptr;
+    bool m_isBlendingFused = false;
+};
+
+#endif /* PIXEL_CONVERTER_H */
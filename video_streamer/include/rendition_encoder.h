@@ -0,0 +1,73 @@
+#ifndef RENDITION_ENCODER_H
+#define RENDITION_ENCODER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "encoder_options.h"
+#include "output_protocol.h"
+#include "packet_writer.h"
+#include "stream_metrics.h"
+#include "timeout_checker.h"
+
+extern "C" {
+    struct AVCodecContext;
+    struct AVFormatContext;
+    struct AVFrame;
+    struct AVPacket;
+}
+
+/* Encoder and output of one downscaled copy of the stream. It is set up
+ * after the main encoder and takes over its codec, pixel format and time
+ * base; frames are scaled by the streamer and passed in with the time base
+ * of the filter graph. Every rendition has its own packet writer and
+ * timeout checker, so a stalled output does NOT block the others; the
+ * protocol of its URL decides the container, like for the main output. */
+class RenditionEncoder {
+public:
+    struct Settings {
+        std::string url;
+        OutputProtocol::Type protocol = OutputProtocol::Type::Rtmp;
+        int width = 0;
+        int height = 0;
+        std::size_t nThreads = 1;
+        /* the GOP of the main encoder, so keyframes of all renditions line up */
+        EncoderOptions::Settings encoderOptions;
+    };
+
+    RenditionEncoder() = default;
+    RenditionEncoder(const RenditionEncoder& other) = delete;
+    RenditionEncoder& operator=(const RenditionEncoder& other) = delete;
+    ~RenditionEncoder();
+    RenditionEncoder(RenditionEncoder&& other) = delete;
+    RenditionEncoder& operator=(RenditionEncoder&& other) = delete;
+
+    bool setup(
+        const Settings& settings, const AVCodecContext* mainEncoderContext,
+        const OutputProtocol::Settings& protocolSettings, const PacketWriter::Settings& writerSettings,
+        StreamMetrics* metrics
+    );
+    /* NULL flushes the encoder */
+    bool encode(AVFrame* frame);
+    /* flushes the encoder and the writer and writes the trailer */
+    bool finish();
+    void close();
+
+    const Settings& getSettings() const { return m_settings; }
+
+private:
+    bool openOutput();
+
+private:
+    Settings m_settings;
+    OutputProtocol::Settings m_protocolSettings;
+    AVCodecContext* m_encoderContext = nullptr;
+    AVFormatContext* m_outputContext = nullptr;
+    AVPacket* m_packet = nullptr;
+    std::size_t m_nEncoderThreads = 0;
+    std::shared_ptr<TimeoutChecker> m_timeoutChecker{ nullptr };
+    PacketWriter m_packetWriter;
+};
+
+#endif /* RENDITION_ENCODER_H */
@@ -0,0 +1,77 @@
+#ifndef ROW_BAND_POOL_H
+#define ROW_BAND_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_placement.h"
+
+/* Process-wide pool for the pixel work of all streamers: a frame
+ * operation is split into bands of whole rows, the bands are taken by the
+ * workers and by the calling thread itself, and the caller returns once
+ * every band is done. Operations of several streams are queued and the
+ * workers serve them in order. Without a running pool, or for small
+ * frames, the operation runs as a single band on the calling thread. */
+class RowBandPool {
+public:
+    static constexpr std::size_t s_maxBands = 16;
+
+    /* band index in [0, s_maxBands), first and last row (exclusive) */
+    using Task = std::function< void(std::size_t, int, int) >;
+
+    static RowBandPool& getInstance() {
+        static RowBandPool pool;
+        return pool;
+    }
+
+    /* every worker is pinned to one CPU of the placement, round-robin */
+    bool start(std::size_t nWorkers, const ThreadPlacement::Settings& placement);
+    void stop();
+    bool isRunning() const { return m_isRunning.load(std::memory_order_acquire); }
+    std::size_t getWorkers() const { return m_nWorkers.load(std::memory_order_acquire); }
+
+    /* rows are units of the caller (pixel rows, tile rows, ...);
+     * a band holds at least 'minRowsPerBand' of them */
+    void run(int nRows, int minRowsPerBand, const Task& task);
+
+private:
+    struct Job {
+        const Task* task = nullptr;
+        int nRows = 0;
+        std::size_t nBands = 0;
+        std::atomic<std::size_t> nextBand{ 0 };
+        std::atomic<std::size_t> nDoneBands{ 0 };
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    RowBandPool() = default;
+    RowBandPool(const RowBandPool& other) = delete;
+    RowBandPool& operator=(const RowBandPool& other) = delete;
+    ~RowBandPool();
+    RowBandPool(RowBandPool&& other) = delete;
+    RowBandPool& operator=(RowBandPool&& other) = delete;
+
+    static void runBands(Job& job);
+    void runWorker(std::size_t workerIndex, ThreadPlacement::Settings placement);
+
+private:
+    std::mutex m_controlMutex;
+    std::atomic<bool> m_isRunning{ false };
+    std::atomic<std::size_t> m_nWorkers{ 0 };
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_isStopRequested = false;
+    std::deque<std::shared_ptr<Job>> m_jobs;
+};
+
+#endif /* ROW_BAND_POOL_H */
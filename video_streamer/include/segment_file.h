@@ -0,0 +1,62 @@
+#ifndef SEGMENT_FILE_H
+#define SEGMENT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "output_reactor.h"
+
+/* Write-only file that collects small muxer writes into large batches.
+ * The sync mode decides how a batch reaches the disk: left to the page
+ * cache, followed by fdatasync, or written with O_DIRECT from an aligned
+ * buffer (the unaligned tail is written through the page cache on close).
+ * While the output reactor is running, batches are handed to it and the
+ * writing thread does NOT wait for the disk. */
+class SegmentFile {
+public:
+    enum class SyncMode {
+        None,
+        Fdatasync,
+        Direct
+    };
+
+    SegmentFile() = default;
+    SegmentFile(const SegmentFile& other) = delete;
+    SegmentFile& operator=(const SegmentFile& other) = delete;
+    ~SegmentFile();
+    SegmentFile(SegmentFile&& other) = delete;
+    SegmentFile& operator=(SegmentFile&& other) = delete;
+
+    static std::optional<SyncMode> getSyncMode(const std::string& syncModeName);
+
+    /* batch size is rounded up to the alignment required by O_DIRECT */
+    bool open(const std::string& fileName, SyncMode syncMode, std::size_t batchSize);
+    bool write(const std::uint8_t* data, std::size_t size);
+    bool close();
+    bool isOpen() const { return (-1 != m_fileDescriptor); }
+
+    /* write callback of AVIOContext */
+    static int onProxyWrite(void* filePtr, const std::uint8_t* data, int size);
+
+private:
+    bool writeBatch(std::size_t size);
+    /* waits for the batches that were handed to the output reactor */
+    bool waitForBatches();
+    void freeBuffer();
+
+private:
+    std::string m_fileName;
+    int m_fileDescriptor = -1;
+    SyncMode m_syncMode = SyncMode::None;
+    bool m_isDirect = false;
+    std::shared_ptr<OutputReactor::Target> m_reactorTarget{ nullptr };
+
+    std::uint8_t* m_buffer = nullptr;
+    std::size_t m_batchSize = 0;
+    std::size_t m_bufferedSize = 0;
+};
+
+#endif /* SEGMENT_FILE_H */
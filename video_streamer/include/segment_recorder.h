@@ -0,0 +1,115 @@
+#ifndef SEGMENT_RECORDER_H
+#define SEGMENT_RECORDER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "segment_file.h"
+#include "stream_metrics.h"
+
+extern "C" {
+    struct AVCodecParameters;
+    struct AVFormatContext;
+    struct AVIOContext;
+    struct AVPacket;
+}
+
+extern "C" {
+    #include <libavutil/rational.h>
+}
+
+/* Records the already encoded packets of a stream into rolling segment files
+ * on its own thread. Segments start at keyframes; every segment is a complete
+ * file (fragmented MP4, or MPEG-TS listed in an HLS playlist). The live path
+ * never waits for the disk: when the queue is full packets are dropped until
+ * the next keyframe, which then starts a new segment. */
+class SegmentRecorder {
+public:
+    enum class Format {
+        Fmp4,
+        Hls
+    };
+
+    struct Settings {
+        std::string directory;
+        Format format = Format::Fmp4;
+        /* microseconds; a segment is cut at the first keyframe after it */
+        std::int64_t segmentDuration = 0;
+        /* 0 keeps every segment */
+        std::size_t nRetainedSegments = 0;
+        SegmentFile::SyncMode syncMode = SegmentFile::SyncMode::None;
+        std::size_t queueCapacity = 0;
+    };
+
+    SegmentRecorder() = default;
+    SegmentRecorder(const SegmentRecorder& other) = delete;
+    SegmentRecorder& operator=(const SegmentRecorder& other) = delete;
+    ~SegmentRecorder();
+    SegmentRecorder(SegmentRecorder&& other) = delete;
+    SegmentRecorder& operator=(SegmentRecorder&& other) = delete;
+
+    static std::optional<Format> getFormat(const std::string& formatName);
+
+    bool setup(
+        const Settings& settings, const AVCodecParameters* codecParameters,
+        AVRational timeBase, StreamMetrics* metrics
+    );
+    /* writes the packets that are still queued and closes the current segment */
+    void stop();
+    bool isRunning() const { return m_thread.joinable(); }
+
+    /* never blocks; the packet is referenced, NOT consumed */
+    void record(const AVPacket* packet);
+
+private:
+    struct QueuedPacket {
+        AVPacket* packet = nullptr;
+        bool isDiscontinuity = false;
+    };
+
+    struct RecordedSegment {
+        std::uint64_t index = 0;
+        std::string fileName;
+        double duration = 0.0;
+    };
+
+    bool openSegment(std::int64_t startTimestamp);
+    bool closeSegment();
+    void freeSegment();
+    bool writePacket(AVPacket* packet, bool isDiscontinuity);
+    bool writePlaylist(bool isEnded) const;
+    void removeExpiredSegments();
+    std::string getSegmentFileName(std::uint64_t segmentIndex) const;
+    void run();
+
+private:
+    Settings m_settings;
+    AVCodecParameters* m_codecParameters = nullptr;
+    AVRational m_timeBase{ 0, 1 };
+    StreamMetrics* m_metrics = nullptr;
+    std::int64_t m_sessionId = 0;
+
+    /* used by the recorder thread only */
+    AVFormatContext* m_segmentContext = nullptr;
+    AVIOContext* m_segmentIoContext = nullptr;
+    SegmentFile m_segmentFile;
+    std::uint64_t m_segmentIndex = 0;
+    std::int64_t m_segmentStartTimestamp = 0;
+    std::int64_t m_segmentEndTimestamp = 0;
+    std::deque<RecordedSegment> m_recordedSegments;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<QueuedPacket> m_queuedPackets;
+    bool m_isWaitingForKeyframe = true;
+    bool m_isStopRequested = false;
+};
+
+#endif /* SEGMENT_RECORDER_H */
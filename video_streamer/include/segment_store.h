@@ -0,0 +1,117 @@
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/* In-memory media of one Low-Latency HLS stream: the CMAF init segment and
+ * a sliding window of segments, each made of the partial segments the
+ * packager cut from it. It is written by the packager thread and read by
+ * the threads of the HTTP server; readers get shared references to the
+ * bytes, so a part that slides out of the window stays valid while it is
+ * being sent. A request for the part or playlist that is about to be
+ * published blocks until it is there (blocking playlist reload), at most
+ * three target durations. */
+class SegmentStore {
+public:
+    using Data = std::shared_ptr<const std::string>;
+
+    enum class Status {
+        Ok,
+        NotFound,
+        BadRequest,
+        Unavailable
+    };
+
+    struct Settings {
+        /* microseconds */
+        std::int64_t segmentDuration = 0;
+        std::int64_t partDuration = 0;
+        /* complete segments listed in the playlist */
+        std::size_t nSegments = 0;
+    };
+
+    static constexpr const char* s_playlistName = "playlist.m3u8";
+    static constexpr const char* s_initSegmentName = "init.mp4";
+
+    SegmentStore() = default;
+    SegmentStore(const SegmentStore& other) = delete;
+    SegmentStore& operator=(const SegmentStore& other) = delete;
+    ~SegmentStore() = default;
+    SegmentStore(SegmentStore&& other) = delete;
+    SegmentStore& operator=(SegmentStore&& other) = delete;
+
+    /* drops everything that was stored */
+    bool setup(const Settings& settings);
+    /* wakes every waiting reader; the playlist is ended */
+    void close();
+
+    /* writer */
+    void setInitSegment(std::string data);
+    void beginSegment(bool isDiscontinuity);
+    /* the duration is in microseconds */
+    void addPart(std::string data, std::int64_t duration, bool isIndependent);
+    void endSegment();
+
+    /* readers */
+    Status getPlaylist(std::optional<std::uint64_t> sequence, std::optional<std::size_t> partIndex, std::string& playlist);
+    /* init segment, part or segment by the name it has in the playlist */
+    Status getFile(const std::string& name, Data& data);
+    Status getInitSegment(Data& data) const;
+    Status getPart(std::uint64_t sequence, std::size_t partIndex, Data& data);
+    Status getSegment(std::uint64_t sequence, Data& data) const;
+
+    std::size_t getStoredBytes() const;
+
+private:
+    struct Part {
+        Data data{ nullptr };
+        std::int64_t duration = 0;
+        bool isIndependent = false;
+    };
+
+    struct Segment {
+        std::uint64_t sequence = 0;
+        std::vector<Part> parts;
+        /* concatenation of the parts, set when the segment is complete */
+        Data data{ nullptr };
+        std::int64_t duration = 0;
+        bool isDiscontinuity = false;
+        bool isComplete = false;
+    };
+
+    const Segment* findSegment(std::uint64_t sequence) const;
+    bool isPartPublished(std::uint64_t sequence, std::size_t partIndex) const;
+    bool isSegmentPublished(std::uint64_t sequence) const;
+    /* the segment left the playlist window, so it was published before */
+    bool isSegmentRemoved(std::uint64_t sequence) const;
+    std::uint64_t getFirstSequence() const;
+    bool isNextPart(std::uint64_t sequence, std::size_t partIndex) const;
+    /* three target durations from now */
+    std::chrono::steady_clock::time_point getWaitDeadline() const;
+    std::int64_t getTargetDuration() const;
+    std::string buildPlaylist() const;
+    static std::string getPartName(std::uint64_t sequence, std::size_t partIndex);
+    static std::string getSegmentName(std::uint64_t sequence);
+
+private:
+    Settings m_settings;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    Data m_initSegment{ nullptr };
+    std::deque<Segment> m_segments;
+    std::uint64_t m_nextSequence = 0;
+    std::uint64_t m_discontinuitySequence = 0;
+    std::size_t m_storedBytes = 0;
+    bool m_isClosed = false;
+};
+
+#endif /* SEGMENT_STORE_H */
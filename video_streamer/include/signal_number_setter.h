@@ -1,6 +1,7 @@
 #ifndef SIGNAL_NUMBER_SETTER_H
 #define SIGNAL_NUMBER_SETTER_H
 
+#include <atomic>
 #include <csignal>
 
 class SignalNumberSetter {
@@ -10,7 +11,7 @@ public:
         return setter;
     }
 
-    bool isSet() const { return (SIGINT == m_signalNumber); }
+    bool isSet() const { return (SIGINT == m_signalNumber.load(std::memory_order_relaxed)); }
 
 private:
     SignalNumberSetter();
@@ -23,7 +24,9 @@ private:
     static void setSignalNumber(int signalNumber);
 
 private:
-    volatile std::sig_atomic_t m_signalNumber = 0;
+    /* polled by every streamer thread, written from the signal handler */
+    static_assert(std::atomic<int>::is_always_lock_free);
+    std::atomic<int> m_signalNumber{ 0 };
 };
 
 #endif /* SIGNAL_NUMBER_SETTER_H */
@@ -0,0 +1,97 @@
+#ifndef SOCKET_OUTPUT_H
+#define SOCKET_OUTPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "output_reactor.h"
+
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+/* TCP connection behind a custom AVIOContext, for "tcp://host:port"
+ * outputs. The socket is non-blocking: what the kernel does NOT take
+ * right away is kept in a backlog and sent together with the next write
+ * in one sendmsg(); the muxer only waits when the backlog is full, and
+ * then NOT longer than the interrupt callback allows. Socket options that
+ * FFmpeg's tcp protocol does NOT expose are set before connecting, and
+ * TCP_INFO is sampled on the writing thread. While the output reactor is
+ * running, the reactor sends the data and takes the place of the backlog. */
+class SocketOutput {
+public:
+    struct Settings {
+        /* I/O buffer of the muxer, i.e. the largest single write */
+        std::size_t bufferSize = 0;
+        bool isNoDelay = false;
+        /* zero keeps the kernel default */
+        int sendBufferSize = 0;
+        int notSentLowat = 0;
+        /* bytes per second; zero disables pacing */
+        std::uint64_t maxPacingRate = 0;
+    };
+
+    /* reported through the metrics only; the encoder bit rate is fixed by
+     * the configuration and NOT adapted to the connection */
+    struct Stats {
+        /* smoothed round trip time in microseconds */
+        std::int64_t rtt = 0;
+        /* bytes in the backlog and in the socket that were NOT sent yet */
+        std::uint64_t nUnsentBytes = 0;
+        std::uint64_t nSendCalls = 0;
+        std::uint64_t nSentBytes = 0;
+    };
+
+    SocketOutput() = default;
+    SocketOutput(const SocketOutput& other) = delete;
+    SocketOutput& operator=(const SocketOutput& other) = delete;
+    ~SocketOutput();
+    SocketOutput(SocketOutput&& other) = delete;
+    SocketOutput& operator=(SocketOutput&& other) = delete;
+
+    static bool isUrlSupported(const std::string& url);
+
+    bool open(const std::string& url, const Settings& settings, const AVIOInterruptCB& interruptCallback);
+    bool isOpen() const { return (-1 != m_socket); }
+    bool write(const std::uint8_t* data, std::size_t size);
+    /* waits until the backlog was sent */
+    bool flush();
+    void close();
+
+    /* may be called from any thread */
+    Stats getStats() const;
+
+    /* write callback of AVIOContext */
+    static int onProxyWrite(void* outputPtr, const std::uint8_t* data, int size);
+
+private:
+    bool connect(const std::string& hostName, const std::string& port);
+    bool applySocketOptions();
+    /* sends as much of the backlog and then of the data as the socket takes */
+    bool send(const std::uint8_t* data, std::size_t size, std::size_t& nSentDataBytes);
+    bool waitWritable();
+    void updateTcpInfo();
+    void updateReactorStats();
+
+private:
+    int m_socket = -1;
+    Settings m_settings;
+    AVIOInterruptCB m_interruptCallback{ nullptr, nullptr };
+
+    std::shared_ptr<OutputReactor::Target> m_reactorTarget{ nullptr };
+    std::vector<std::uint8_t> m_backlog;
+    std::size_t m_backlogOffset = 0;
+    std::int64_t m_lastTcpInfoTime = 0;
+
+    std::atomic<std::int64_t> m_rtt{ 0 };
+    std::atomic<std::uint64_t> m_nBacklogBytes{ 0 };
+    std::atomic<std::uint64_t> m_nKernelUnsentBytes{ 0 };
+    std::atomic<std::uint64_t> m_nSendCalls{ 0 };
+    std::atomic<std::uint64_t> m_nSentBytes{ 0 };
+};
+
+#endif /* SOCKET_OUTPUT_H */
@@ -0,0 +1,77 @@
+#ifndef STREAM_METRICS_H
+#define STREAM_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/* Counters and gauges of one streamer. They are updated by the capture,
+ * encode and output threads without locking and are read from Python. */
+class StreamMetrics {
+public:
+    enum class Metric : std::size_t {
+        CapturedFrames = 0,
+        CaptureSchedulingMisses,
+        EncodeSchedulingMisses,
+        OutputSchedulingMisses,
+        WrittenPackets,
+        WrittenBytes,
+        OutputQueueDepth,
+        RecordedPackets,
+        RecordedSegments,
+        RecorderDroppedPackets,
+        ExportedClips,
+        EncodedFrames,
+        EncodeTime,
+        StaticFramesDropped,
+        OverlayTilesRasterized,
+        ConversionTime,
+        RenditionScaleTime,
+        OutputDroppedPackets,
+        LlHlsParts,
+        LlHlsSegments,
+        LlHlsDroppedPackets,
+        LlHlsRequests,
+        ForcedKeyframes,
+        PacedChunks,
+        PacingWaitTime,
+        AudioPackets,
+        AudioDroppedFrames,
+        AudioResyncs,
+        TimestampFilledFrames,
+        TimestampSkippedFrames,
+        TimestampGapFrames,
+        TimestampClockSteps,
+        EncodedDeltaPackets,
+        EncodedDeltaBytes,
+        Count
+    };
+
+    StreamMetrics() = default;
+    StreamMetrics(const StreamMetrics& other) = delete;
+    StreamMetrics& operator=(const StreamMetrics& other) = delete;
+    ~StreamMetrics() = default;
+    StreamMetrics(StreamMetrics&& other) = delete;
+    StreamMetrics& operator=(StreamMetrics&& other) = delete;
+
+    void add(Metric metric, std::uint64_t value = 1) {
+        m_values[static_cast<std::size_t>(metric)].fetch_add(value, std::memory_order_relaxed);
+    }
+    void set(Metric metric, std::uint64_t value) {
+        m_values[static_cast<std::size_t>(metric)].store(value, std::memory_order_relaxed);
+    }
+    std::uint64_t get(Metric metric) const {
+        return m_values[static_cast<std::size_t>(metric)].load(std::memory_order_relaxed);
+    }
+
+    void reset();
+    std::map<std::string, double> getSnapshot() const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Metric::Count)> m_values{};
+};
+
+#endif /* STREAM_METRICS_H */
@@ -0,0 +1,42 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/* CPU affinity, scheduling policy and nice level of the calling thread.
+ * Threads created afterwards by the calling thread inherit all three,
+ * which is how encoder threads of libx264 are placed. */
+class ThreadPlacement {
+public:
+    struct Settings {
+        std::vector<int> cpus;
+        std::optional<int> policy{ std::nullopt };
+        int priority = 0;
+        std::optional<int> niceLevel{ std::nullopt };
+    };
+
+    ThreadPlacement() = default;
+    ThreadPlacement(const ThreadPlacement& other) = delete;
+    ThreadPlacement& operator=(const ThreadPlacement& other) = delete;
+    ~ThreadPlacement() = default;
+    ThreadPlacement(ThreadPlacement&& other) = delete;
+    ThreadPlacement& operator=(ThreadPlacement&& other) = delete;
+
+    static std::optional<int> getPolicy(const std::string& policyName);
+    static bool isEmpty(const Settings& settings);
+
+    /* remembers current placement of the calling thread, so that it can be restored */
+    bool save();
+    bool restore();
+
+    static bool apply(const std::string& threadName, const Settings& settings);
+    static void report(const std::string& threadName);
+    static bool lockMemory();
+
+private:
+    std::optional<Settings> m_savedSettings{ std::nullopt };
+};
+
+#endif /* THREAD_PLACEMENT_H */
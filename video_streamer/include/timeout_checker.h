@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 class TimeoutChecker : public std::enable_shared_from_this<TimeoutChecker> {
@@ -10,19 +11,24 @@ public:
     TimeoutChecker() = default;
     TimeoutChecker(const TimeoutChecker& other) = delete;
     TimeoutChecker& operator=(const TimeoutChecker& other) = delete;
-    ~TimeoutChecker() = default;
+    ~TimeoutChecker();
     TimeoutChecker(TimeoutChecker&& other) = delete;
     TimeoutChecker& operator=(TimeoutChecker&& other) = delete;
 
     using CheckerRawPtr = TimeoutChecker*;
     using CheckerWeakPtr = std::weak_ptr<TimeoutChecker>;
 
-    bool setup();
+    /* timeout in microseconds */
+    static constexpr std::int64_t s_defaultTimeout = 50000;
+
+    bool setup(std::int64_t timeout = s_defaultTimeout);
 
     static int onProxyReadyToCheckTimeout(void* checkerPtr);
 
     void setBeginTime();
     void resetBeginTime();
+    /* a running deadline starts over, e.g. after the writer waited on purpose */
+    void restartBeginTime();
 
     bool isTimeoutReached() const { return m_isTimeoutReached; }
 
@@ -34,10 +40,15 @@ private:
     static bool setCheckerWeakPtr(
         CheckerRawPtr checkerRawPtr, const CheckerWeakPtr& checkerWeakPtr
     );
+    static void eraseCheckerWeakPtr(CheckerRawPtr checkerRawPtr);
 
 private:
+    /* shared by all streamers of the process; interrupt callbacks of different
+     * output contexts may look it up concurrently */
+    static inline std::mutex s_checkerMutex;
     static inline std::unordered_map<CheckerRawPtr, CheckerWeakPtr> s_checkerWeakPtrs;
 
+    std::int64_t m_timeout = s_defaultTimeout;
     std::int64_t m_beginTime = 0;
     bool m_isTimeoutReached = false;
 };
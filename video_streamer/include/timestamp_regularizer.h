@@ -0,0 +1,82 @@
+#ifndef TIMESTAMP_REGULARIZER_H
+#define TIMESTAMP_REGULARIZER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/* Maps the timestamps of the camera to the slots of a steady output clock
+ * of one tick per nominal frame interval. A delay locked loop (second
+ * order, as in a PLL) recovers the period and phase of the camera from
+ * its jittery timestamps; the filtered time of every frame is put into
+ * the nearest slot. A camera that runs slower than nominal or drops
+ * frames leaves slots empty, which are filled when the gap is short; a
+ * camera that runs faster hands in two frames for one slot, and the second
+ * one is skipped. Slots are only given up after the phase has wandered
+ * by more than half a frame plus a hysteresis, so jitter around the
+ * boundary of two slots does NOT cause pairs of fills and skips.
+ *
+ * The slots stay tied to the capture time (wall clock), which is what
+ * the audio is placed by: when the camera clock steps against it, the
+ * step is taken out of the camera timestamps. Used by the capture thread
+ * only; the loop state is read from Python. */
+class TimestampRegularizer {
+public:
+    struct Settings {
+        /* microseconds, may be fractional, e.g. for 30000/1001 */
+        double frameDuration = 0.0;
+        /* empty slots of longer gaps stay empty */
+        std::size_t maxFillFrames = 0;
+        double loopBandwidth = 0.0; // in hertz
+    };
+
+    struct Result {
+        /* index of the slot, i.e. the pts in units of the nominal frame interval */
+        std::int64_t slot = 0;
+        /* empty slots right before the slot that have to be filled */
+        std::size_t nFillFrames = 0;
+        /* empty slots that are left as a gap */
+        std::size_t nGapFrames = 0;
+        bool isClockStep = false;
+    };
+
+    TimestampRegularizer() = default;
+    TimestampRegularizer(const TimestampRegularizer& other) = delete;
+    TimestampRegularizer& operator=(const TimestampRegularizer& other) = delete;
+    ~TimestampRegularizer() = default;
+    TimestampRegularizer(TimestampRegularizer&& other) = delete;
+    TimestampRegularizer& operator=(TimestampRegularizer&& other) = delete;
+
+    bool setup(const Settings& settings);
+    bool isSet() const { return (m_settings.frameDuration > 0.0); }
+
+    /* microseconds; NULL option when the frame is skipped */
+    std::optional<Result> regularize(std::int64_t cameraTime, std::int64_t captureTime);
+
+    /* microseconds, zero until the loop is running */
+    double getFramePeriod() const { return m_framePeriod.load(std::memory_order_relaxed); }
+    double getJitter() const { return m_jitter.load(std::memory_order_relaxed); }
+
+private:
+    Settings m_settings;
+    double m_loopGain = 0.0;
+    double m_periodGain = 0.0;
+
+    bool m_isLocked = false;
+    /* camera time of the first frame and the removed clock steps */
+    std::int64_t m_originTime = 0;
+    std::int64_t m_clockOffset = 0;
+    double m_originSlot = 0.0;
+    std::int64_t m_lastCameraTime = 0;
+    std::int64_t m_lastCaptureTime = 0;
+    /* relative to the origin */
+    double m_predictedTime = 0.0;
+    double m_period = 0.0;
+    std::int64_t m_lastSlot = 0;
+
+    std::atomic<double> m_framePeriod{ 0.0 };
+    std::atomic<double> m_jitter{ 0.0 };
+};
+
+#endif /* TIMESTAMP_REGULARIZER_H */
@@ -0,0 +1,134 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/* Process-wide recorder of pipeline events (read, decode, filter, encode,
+ * mux, ...) for all streamers. Every thread writes into a ring of its own
+ * without locking; the ring is taken on the first event of the thread and
+ * keeps the latest s_eventsPerThread events. When the thread exits, its
+ * ring is dumped until another thread takes it over, so there are never
+ * more rings than threads that recorded at the same time. The dump is
+ * Chrome trace event JSON, which chrome://tracing and the Perfetto UI both
+ * open; events of one frame are linked by a flow on the stream id and the
+ * frame pts. */
+class TraceRecorder {
+public:
+    static constexpr std::size_t s_eventsPerThread = 1 << 16;
+
+    static TraceRecorder& getInstance() {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    /* events that ended before the start are NOT dumped */
+    bool start();
+    void stop();
+    bool isRecording() const { return m_isRecording.load(std::memory_order_relaxed); }
+    /* may be called while recording */
+    bool dump(const std::string& fileName) const;
+
+    std::uint32_t allocateStreamId() { return m_nextStreamId.fetch_add(1, std::memory_order_relaxed); }
+    /* the name is shown for the events of the calling thread */
+    static void setThreadName(const std::string& threadName);
+
+    /* 'name' must be a string literal */
+    void record(
+        const char* name, std::uint32_t streamId, std::optional<std::int64_t> flowId,
+        std::int64_t beginTime, std::int64_t endTime
+    );
+
+private:
+    struct Event {
+        const char* name = nullptr;
+        std::uint32_t streamId = 0;
+        std::optional<std::int64_t> flowId{ std::nullopt };
+        std::int64_t beginTime = 0;
+        std::int64_t endTime = 0;
+    };
+
+    /* a seqlock: the sequence is odd while the owner writes the slot and
+     * 2 * (index of the event + 1) once the event is complete */
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{ 0 };
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<std::uint32_t> streamId{ 0 };
+        std::atomic<bool> hasFlowId{ false };
+        std::atomic<std::int64_t> flowId{ 0 };
+        std::atomic<std::int64_t> beginTime{ 0 };
+        std::atomic<std::int64_t> endTime{ 0 };
+    };
+
+    struct ThreadBuffer {
+        /* the owner and its name are guarded by the mutex of the recorder */
+        long threadId = 0;
+        std::string threadName;
+        bool isOwned = false;
+        /* events of the previous owner are NOT dumped */
+        std::uint64_t firstEvent = 0;
+        std::unique_ptr<Slot[]> slots;
+        /* number of events ever written; written by the owner only */
+        std::atomic<std::uint64_t> nWrittenEvents{ 0 };
+    };
+
+    /* hands the buffer back when its thread exits */
+    struct ThreadBufferOwner {
+        ThreadBuffer* buffer = nullptr;
+        ~ThreadBufferOwner();
+    };
+
+    TraceRecorder() = default;
+    TraceRecorder(const TraceRecorder& other) = delete;
+    TraceRecorder& operator=(const TraceRecorder& other) = delete;
+    ~TraceRecorder() = default;
+    TraceRecorder(TraceRecorder&& other) = delete;
+    TraceRecorder& operator=(TraceRecorder&& other) = delete;
+
+    ThreadBuffer* getThreadBuffer();
+    void releaseThreadBuffer(ThreadBuffer* buffer);
+    /* copies the events of the ring from the given one on; slots that are
+     * overwritten while they are copied are dropped */
+    static std::vector<Event> copyEvents(const ThreadBuffer& buffer, std::uint64_t firstEvent);
+
+private:
+    std::atomic<bool> m_isRecording{ false };
+    std::atomic<std::int64_t> m_startTime{ 0 };
+    std::atomic<std::uint32_t> m_nextStreamId{ 0 };
+
+    mutable std::mutex m_mutex;
+    /* buffers outlive their threads, so that events of finished threads are dumped too */
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    /* buffers of finished threads, reused by new ones */
+    std::vector<ThreadBuffer*> m_freeBuffers;
+};
+
+/* Records one event from its construction to its destruction, if the
+ * recorder was recording at construction. */
+class TraceScope {
+public:
+    TraceScope(const char* name, std::uint32_t streamId, std::optional<std::int64_t> flowId = std::nullopt);
+    TraceScope(const TraceScope& other) = delete;
+    TraceScope& operator=(const TraceScope& other) = delete;
+    ~TraceScope();
+    TraceScope(TraceScope&& other) = delete;
+    TraceScope& operator=(TraceScope&& other) = delete;
+
+    void setFlowId(std::optional<std::int64_t> flowId) { m_flowId = flowId; }
+    /* nothing is recorded, e.g. when a call turned out to have nothing to do */
+    void discard() { m_beginTime.reset(); }
+
+private:
+    const char* m_name = nullptr;
+    std::uint32_t m_streamId = 0;
+    std::optional<std::int64_t> m_flowId{ std::nullopt };
+    std::optional<std::int64_t> m_beginTime{ std::nullopt };
+};
+
+#endif /* TRACE_RECORDER_H */
@@ -1,19 +1,57 @@
 #ifndef VIDEO_STREAMER_H
 #define VIDEO_STREAMER_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <optional>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <string>
+#include <vector>
 
+#include "audio_capturer.h"
+#include "capture_clock.h"
+#include "clip_exporter.h"
+#include "encode_scheduler.h"
+#include "encoder_options.h"
+#include "encoder_thread_budget.h"
+#include "filter_graph_rebuilder.h"
+#include "latency_histogram.h"
+#include "ll_hls_packager.h"
+#include "ll_hls_server.h"
+#include "motion_analyzer.h"
+#include "multi_scaler.h"
+#include "output_pacer.h"
+#include "output_protocol.h"
+#include "output_rate_meter.h"
+#include "output_reactor.h"
+#include "overlay_compositor.h"
+#include "packet_ring_buffer.h"
+#include "packet_writer.h"
+#include "pixel_converter.h"
+#include "rendition_encoder.h"
+#include "row_band_pool.h"
+#include "segment_recorder.h"
+#include "segment_store.h"
+#include "socket_output.h"
+#include "stream_metrics.h"
+#include "thread_placement.h"
 #include "timeout_checker.h"
+#include "timestamp_regularizer.h"
+#include "trace_recorder.h"
 
 extern "C" {
+    struct AVBufferPool;
     struct AVCodec;
     struct AVCodecContext;
     struct AVFilterContext;
     struct AVFilterGraph;
     struct AVFormatContext;
     struct AVFrame;
+    struct AVIOContext;
     struct AVPacket;
 }
 
@@ -33,14 +71,39 @@ public:
 
     bool setup(std::string configFileName);
     bool process();
+    bool setWatermark(std::string watermarkLocation);
+    bool setOverlayText(std::string layerName, std::string text);
+    void stop();
+    std::map<std::string, double> getMetrics() const;
+    bool exportClip(double start, double duration, std::string fileName);
+    /* the next frame is encoded as an IDR frame; callable from any thread */
+    void requestKeyframe();
 
 private:
     bool parseConfig(const std::string& configFileName);
     bool encodeWriteFrame(bool readyToFlush, AVFrame* filteredFrame);
     bool filterEncodeWriteFrame(AVFrame* decoderFrame, AVFrame* filteredFrame);
+    bool dispatchRegularizedFrame(AVFrame* decoderFrame, AVFrame* filteredFrame, bool isFlushing);
+    bool dispatchDecodedFrame(AVFrame* decoderFrame, AVFrame* filteredFrame, bool isFillFrame);
+    bool encodeDecodedFrame(AVFrame* decoderFrame, AVFrame* filteredFrame, std::int64_t deadline, bool isFillFrame);
+    bool isStaticFrame(const AVFrame* decoderFrame, std::size_t nChangedBlocks);
+    bool attachRegionsOfInterest(AVFrame* decoderFrame, std::size_t nChangedBlocks);
+    bool waitDispatchedFrames();
+    bool encodeWriteFilteredFrames(AVFilterContext* bufferSinkContext, AVFrame* filteredFrame);
+    bool swapFilterGraph(AVFrame* filteredFrame);
+    /* takes a pending keyframe request unless the previous one was forced just before */
+    bool isKeyframeDue();
+    bool openSocketOutput(const AVIOInterruptCB& interruptCallback);
+    bool setupRenditions(const PacketWriter::Settings& writerSettings);
+    bool encodeRenditions(const AVFrame* filteredFrame);
     bool flushEncoder(AVFrame* filteredFrame);
+    void countSchedulingMiss(StreamMetrics::Metric metric, std::int64_t deadline);
     void deallocateResources();
     std::optional<const AVPixelFormat> getPixelFormat(const AVCodec* encoder) const;
+    bool getFilterParams(
+        const std::optional<std::string>& watermarkLocation, FilterGraphRebuilder::Params& params
+    ) const;
+    bool isWatermarkValid(const std::string& watermarkLocation) const;
 
 private:
     AVFormatContext* m_inputContext = nullptr;
@@ -51,28 +114,211 @@ private:
     AVFilterContext* m_bufferSrcContext = nullptr;
     AVFilterGraph* m_filterGraph = nullptr;
     AVFilterContext* m_bufferSinkContext = nullptr;
+    /* frames added to the current graph and taken out of it; a graph that holds none is NOT drained on a swap */
+    std::uint64_t m_nGraphInputFrames = 0;
+    std::uint64_t m_nGraphOutputFrames = 0;
+    FilterGraphRebuilder::Params m_filterGraphParams;
+    FilterGraphRebuilder m_filterGraphRebuilder;
 
     AVCodecContext* m_encoderContext = nullptr;
+    std::size_t m_nEncoderThreads = 0;
+    /* set by the API and by outputs that dropped packets, taken by the next filtered frame */
+    std::atomic<bool> m_isKeyframeRequested{ false };
+    std::optional<std::int64_t> m_lastForcedKeyframeTime{ std::nullopt };
+
+    /* frames without motion are dropped until the minimum frame rate requires one;
+     * moving regions of the others are passed to the encoder as regions of interest */
+    MotionAnalyzer m_motionAnalyzer;
+    std::optional<std::int64_t> m_lastEncodedFrameTime{ std::nullopt };
+    std::vector<MotionAnalyzer::Region> m_changedRegions;
+
+    /* text, clock and image layers on top of the filter graph output */
+    OverlayCompositor m_overlayCompositor;
+
+    /* camera frames in the pixel format of the encoder; the layers are blended while converting */
+    PixelConverter m_pixelConverter;
+    AVFrame* m_convertedFrame = nullptr;
+    bool m_isScalerComparisonPending = false;
+
+    /* downscaled copies of the filtered frames, each with its own encoder and output */
+    MultiScaler m_multiScaler;
+    std::vector<std::unique_ptr<RenditionEncoder>> m_renditionEncoders;
+    std::vector<AVFrame*> m_renditionFrames;
+
+    std::optional<EncodeScheduler::StreamId> m_encodeSchedulerStreamId{ std::nullopt };
+    AVFrame* m_scheduledFilteredFrame = nullptr;
     AVPacket* m_encoderPacket = nullptr;
 
     AVFormatContext* m_outputContext = nullptr;
+    /* our own TCP connection instead of avio_open2 for "tcp://" outputs */
+    SocketOutput m_socketOutput;
+    AVIOContext* m_socketIoContext = nullptr;
+    PacketWriter m_packetWriter;
+    /* the audio stream of the output, captured and encoded on its own thread */
+    std::shared_ptr<CaptureClock> m_captureClock{ nullptr };
+    AudioCapturer m_audioCapturer;
+    /* releases the bytes of the muxer at the pacing rate */
+    OutputPacer m_outputPacer;
+    LatencyHistogram m_pacingErrorHistogram;
+    /* burstiness of the main output, see the intra refresh mode of the encoder */
+    OutputRateMeter m_outputRateMeter;
+    SegmentRecorder m_segmentRecorder;
+    PacketRingBuffer m_packetRingBuffer;
+    ClipExporter m_clipExporter;
+    /* LL-HLS parts in memory, served by the embedded HTTP server; read by getMetrics() */
+    std::atomic<std::shared_ptr<SegmentStore>> m_segmentStore{ nullptr };
+    LlHlsPackager m_llHlsPackager;
+    LlHlsServer m_llHlsServer;
+
+    /* duration of one frame in microseconds */
+    std::int64_t m_frameDuration = 0;
+    /* steady time in microseconds at which the last packet of the camera arrived */
+    std::int64_t m_lastArrivalTime = 0;
+    /* maps the camera timestamps to the ticks of the encoder time base */
+    TimestampRegularizer m_timestampRegularizer;
+    StreamMetrics m_metrics;
+
+    /* capture time and pts of every packet read from the camera, carried to the muxer */
+    AVBufferPool* m_captureTimestampPool = nullptr;
+    LatencyHistogram m_latencyHistogram;
+    /* distinguishes the frames of this streamer in traces */
+    std::uint32_t m_traceStreamId = 0;
 
     std::shared_ptr<TimeoutChecker> m_timeoutChecker{ nullptr };
+    std::optional<int> m_registeredLogLevel{ std::nullopt };
+    std::atomic<bool> m_isStopRequested{ false };
 
     struct ConfigParams {
         std::string inputStreamName;
+        /* mode the camera has to deliver */
+        int frameWidth = 0;
+        int frameHeight = 0;
+        int frameRate = 0;
         std::optional<std::string> watermarkLocation{ std::nullopt };
         std::string rtmpUrl;
+        OutputProtocol::Type outputProtocol = OutputProtocol::Type::Rtmp;
+        /* settings of every protocol, so renditions may use other protocols than the main output */
+        std::map<OutputProtocol::Type, OutputProtocol::Settings> protocolSettings;
         int ffmpegLogLevel = 0;
+        std::size_t nEncoderThreads = 0;
+        bool isEncodeSchedulerEnabled = false;
+        EncoderOptions::Settings encoderOptions;
+        /* slice threads of the filter graph; zero lets libavfilter decide */
+        std::optional<int> nFilterThreads{ std::nullopt };
+        std::size_t nRowBandWorkers = 0;
+        std::optional<ThreadPlacement::Settings> capturePlacement{ std::nullopt };
+        std::optional<ThreadPlacement::Settings> encodePlacement{ std::nullopt };
+        std::optional<ThreadPlacement::Settings> outputPlacement{ std::nullopt };
+        bool isOutputThreadEnabled = false;
+        std::optional<SocketOutput::Settings> socketSettings{ std::nullopt };
+        std::optional<OutputPacer::Settings> pacingSettings{ std::nullopt };
+        /* the frame duration is known once the camera is opened */
+        std::optional<TimestampRegularizer::Settings> timestampSettings{ std::nullopt };
+        std::optional<AudioCapturer::Settings> audioSettings{ std::nullopt };
+        bool isMemoryLockEnabled = false;
+        std::optional<SegmentRecorder::Settings> recordingSettings{ std::nullopt };
+        bool isDvrEnabled = false;
+        std::size_t dvrMaxBytes = 0;
+        std::int64_t dvrMaxDuration = 0;
+        bool isStaticSceneDetectionEnabled = false;
+        unsigned int staticSceneThreshold = 0;
+        std::int64_t staticSceneMaxInterval = 0;
+        bool isRoiEnabled = false;
+        /* quantizer offset of moving regions in hundredths, the background gets the opposite */
+        int roiQualityOffset = 0;
+        std::size_t roiMinRegionBlocks = 0;
+        std::vector<OverlayCompositor::LayerSettings> overlayLayers;
+        bool isConversionEnabled = false;
+        bool isScalerComparisonEnabled = false;
+        bool isLatencyMeasurementEnabled = false;
+        struct RenditionParams {
+            RenditionEncoder::Settings settings;
+            /* divides the frame size when it is NOT zero; width and height are ignored then */
+            int divisor = 0;
+        };
+        std::vector<RenditionParams> renditions;
+        struct LlHlsParams {
+            LlHlsPackager::Settings packagerSettings;
+            LlHlsServer::Settings serverSettings;
+            /* complete segments listed in the playlist */
+            std::size_t nSegments = 0;
+        };
+        std::optional<LlHlsParams> llHlsParams{ std::nullopt };
     };
     ConfigParams m_configParams;
 };
 
 PYBIND11_MODULE(video_streamer, streaming_module) {
+    streaming_module.def(
+        "set_encoder_thread_budget",
+        [] (std::size_t nThreads, std::size_t nExpectedEncoders) {
+            return EncoderThreadBudget::getInstance().setTotalThreads(nThreads, nExpectedEncoders);
+        },
+        pybind11::arg("threads"), pybind11::arg("encoders") = 0
+    );
+    streaming_module.def(
+        "start_encode_scheduler",
+        [] (std::size_t nWorkers, std::vector<int> cpus) {
+            ThreadPlacement::Settings placement;
+            placement.cpus = cpus;
+            return EncodeScheduler::getInstance().start(nWorkers, placement);
+        },
+        pybind11::arg("workers"), pybind11::arg("cpus") = std::vector<int>()
+    );
+    streaming_module.def(
+        "start_row_band_pool",
+        [] (std::size_t nWorkers, std::vector<int> cpus) {
+            ThreadPlacement::Settings placement;
+            placement.cpus = cpus;
+            return RowBandPool::getInstance().start(nWorkers, placement);
+        },
+        pybind11::arg("workers"), pybind11::arg("cpus") = std::vector<int>()
+    );
+    streaming_module.def(
+        "start_output_reactor",
+        [] (std::size_t nRings, std::vector<int> cpus) {
+            ThreadPlacement::Settings placement;
+            placement.cpus = cpus;
+            return OutputReactor::getInstance().start(nRings, placement);
+        },
+        pybind11::arg("rings") = 1, pybind11::arg("cpus") = std::vector<int>()
+    );
+    streaming_module.def(
+        "start_trace",
+        [] () {
+            return TraceRecorder::getInstance().start();
+        }
+    );
+    streaming_module.def(
+        "stop_trace",
+        [] () {
+            TraceRecorder::getInstance().stop();
+        }
+    );
+    streaming_module.def(
+        "dump_trace",
+        [] (std::string fileName) {
+            return TraceRecorder::getInstance().dump(fileName);
+        },
+        pybind11::arg("path"),
+        pybind11::call_guard<pybind11::gil_scoped_release>()
+    );
     pybind11::class_<VideoStreamer>(streaming_module, "VideoStreamer")
         .def(pybind11::init<>())
         .def("setup", &VideoStreamer::setup)
-        .def("process", &VideoStreamer::process);
+        .def("process", &VideoStreamer::process, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("set_watermark", &VideoStreamer::setWatermark, pybind11::arg("watermark_location"))
+        .def(
+            "set_overlay_text", &VideoStreamer::setOverlayText,
+            pybind11::arg("layer"), pybind11::arg("text")
+        )
+        .def("stop", &VideoStreamer::stop)
+        .def("get_metrics", &VideoStreamer::getMetrics)
+        .def(
+            "export_clip", &VideoStreamer::exportClip,
+            pybind11::arg("start"), pybind11::arg("duration"), pybind11::arg("path")
+        )
+        .def("request_keyframe", &VideoStreamer::requestKeyframe);
 }
 
 #endif /* VIDEO_STREAMER_H */
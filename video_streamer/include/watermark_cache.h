@@ -0,0 +1,58 @@
+#ifndef WATERMARK_CACHE_H
+#define WATERMARK_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+extern "C" {
+    struct AVFrame;
+}
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+/* Decoded watermark images, shared by all streamers of the process. An
+ * image is decoded once, converted to the pixel format the overlay blends
+ * in and handed out as a reference to the same frame; it is decoded again
+ * only when the file changes. Frames that are handed out are read-only. */
+class WatermarkCache {
+public:
+    static WatermarkCache& getInstance() {
+        static WatermarkCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<AVFrame> getFrame(const std::string& fileName, AVPixelFormat pixelFormat);
+    void clear();
+
+private:
+    WatermarkCache() = default;
+    WatermarkCache(const WatermarkCache& other) = delete;
+    WatermarkCache& operator=(const WatermarkCache& other) = delete;
+    ~WatermarkCache() = default;
+    WatermarkCache(WatermarkCache&& other) = delete;
+    WatermarkCache& operator=(WatermarkCache&& other) = delete;
+
+    static std::shared_ptr<AVFrame> allocateFrame(int width, int height, AVPixelFormat pixelFormat);
+    static std::shared_ptr<AVFrame> decodeFrame(const std::string& fileName, AVPixelFormat pixelFormat);
+    void evict();
+
+private:
+    struct Entry {
+        std::int64_t modificationTime = 0;
+        std::uintmax_t fileSize = 0;
+        std::uint64_t lastUse = 0;
+        std::shared_ptr<AVFrame> frame{ nullptr };
+    };
+
+    std::mutex m_mutex;
+    std::map<std::pair<std::string, AVPixelFormat>, Entry> m_entries;
+    std::uint64_t m_useCounter = 0;
+};
+
+#endif /* WATERMARK_CACHE_H */
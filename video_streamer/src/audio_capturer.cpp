@@ -0,0 +1,469 @@
+#include "audio_capturer.h"
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavdevice/avdevice.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/audio_fifo.h>
+    #include <libavutil/channel_layout.h>
+    #include <libavutil/dict.h>
+    #include <libavutil/error.h>
+    #include <libavutil/frame.h>
+    #include <libavutil/mathematics.h>
+    #include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <iostream>
+
+#include "common_functions.h"
+#include "thread_placement.h"
+
+namespace {
+    constexpr AVCodecID g_encoderId = AVCodecID::AV_CODEC_ID_AAC;
+}
+
+AudioCapturer::~AudioCapturer() {
+    stop();
+    close();
+}
+
+bool AudioCapturer::setup(
+    const Settings& settings, AVFormatContext* outputContext,
+    std::shared_ptr<CaptureClock> captureClock, StreamMetrics* metrics
+) {
+    if (m_inputContext || m_encoderContext) {
+        std::cerr << "{AudioCapturer::setup}; audio capturer is already set" << std::endl;
+        return false;
+    }
+    if ((nullptr == outputContext) || (nullptr == outputContext->oformat)) {
+        std::cerr << "{AudioCapturer::setup}; pointer to output context is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == captureClock) {
+        std::cerr << "{AudioCapturer::setup}; pointer to capture clock is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{AudioCapturer::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if (settings.format.empty() || settings.device.empty()) {
+        std::cerr << "{AudioCapturer::setup}; input format or device is empty" << std::endl;
+        return false;
+    }
+    if ((settings.sampleRate <= 0) || (settings.nChannels <= 0) || (settings.bitRate <= 0)) {
+        std::cerr << "{AudioCapturer::setup}; audio settings are NOT positive" << std::endl;
+        return false;
+    }
+    m_settings = settings;
+    m_captureClock = std::move(captureClock);
+    m_metrics = metrics;
+    m_outputContext = outputContext;
+
+    if (!openInput() || !openEncoder(outputContext)) {
+        close();
+        return false;
+    }
+
+    auto allocationResult = swr_alloc_set_opts2(
+        &m_resamplerContext,
+        &m_encoderContext->ch_layout, m_encoderContext->sample_fmt, m_encoderContext->sample_rate,
+        &m_decoderContext->ch_layout, m_decoderContext->sample_fmt, m_decoderContext->sample_rate,
+        0, nullptr
+    );
+    if (allocationResult < 0) {
+        std::cerr << "{AudioCapturer::setup}; unable to allocate resampler context; "
+            "allocation result: '" << allocationResult << " (" << av_err2str(allocationResult) << ")'" << std::endl;
+        close();
+        return false;
+    }
+    auto initResult = swr_init(m_resamplerContext);
+    if (initResult < 0) {
+        std::cerr << "{AudioCapturer::setup}; unable to initialize resampler context; "
+            "initialize result: '" << initResult << " (" << av_err2str(initResult) << ")'" << std::endl;
+        close();
+        return false;
+    }
+
+    m_fifo = av_audio_fifo_alloc(
+        m_encoderContext->sample_fmt, m_encoderContext->ch_layout.nb_channels, m_encoderContext->frame_size
+    );
+    m_inputPacket = av_packet_alloc();
+    m_encoderPacket = av_packet_alloc();
+    m_decodedFrame = av_frame_alloc();
+    m_resampledFrame = av_frame_alloc();
+    m_encoderFrame = av_frame_alloc();
+    if (
+        (nullptr == m_fifo) || (nullptr == m_inputPacket) || (nullptr == m_encoderPacket) ||
+        (nullptr == m_decodedFrame) || (nullptr == m_resampledFrame) || (nullptr == m_encoderFrame)
+    ) {
+        std::cerr << "{AudioCapturer::setup}; unable to allocate memory for audio buffers" << std::endl;
+        close();
+        return false;
+    }
+    m_nextPts = 0;
+    m_isPlaced = false;
+
+    std::cout << "{AudioCapturer::setup}; audio capturer has been successfully set up; "
+        "input: '" << settings.format << ":" << settings.device << "'; "
+        "input sample rate: '" << m_decoderContext->sample_rate << "'; "
+        "output sample rate: '" << m_encoderContext->sample_rate << "'; "
+        "channels: '" << m_encoderContext->ch_layout.nb_channels << "'; "
+        "bit rate: '" << m_encoderContext->bit_rate << "'" << std::endl;
+    return true;
+}
+
+bool AudioCapturer::start(PacketWriter* packetWriter) {
+    if (m_thread.joinable()) {
+        std::cerr << "{AudioCapturer::start}; audio thread is already running" << std::endl;
+        return false;
+    }
+    if (nullptr == m_encoderContext) {
+        std::cerr << "{AudioCapturer::start}; audio capturer is NOT set up" << std::endl;
+        return false;
+    }
+    if (nullptr == packetWriter) {
+        std::cerr << "{AudioCapturer::start}; pointer to packet writer is NULL" << std::endl;
+        return false;
+    }
+    m_packetWriter = packetWriter;
+    m_isStopRequested = false;
+    m_thread = std::thread(&AudioCapturer::run, this);
+    return true;
+}
+
+void AudioCapturer::stop() {
+    m_isStopRequested = true;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void AudioCapturer::close() {
+    av_frame_free(&m_encoderFrame);
+    av_frame_free(&m_resampledFrame);
+    av_frame_free(&m_decodedFrame);
+    av_packet_free(&m_encoderPacket);
+    av_packet_free(&m_inputPacket);
+    if (m_fifo) {
+        av_audio_fifo_free(m_fifo);
+        m_fifo = nullptr;
+    }
+    swr_free(&m_resamplerContext);
+    avcodec_free_context(&m_encoderContext);
+    avcodec_free_context(&m_decoderContext);
+    if (m_inputContext) {
+        avformat_close_input(&m_inputContext);
+    }
+    m_inputStreamIndex = -1;
+    m_outputStreamIndex = -1;
+    m_outputContext = nullptr;
+    m_packetWriter = nullptr;
+}
+
+int AudioCapturer::onProxyInterrupt(void* capturerPtr) {
+    if (nullptr == capturerPtr) {
+        return 1;
+    }
+    auto capturer = static_cast<AudioCapturer*>(capturerPtr);
+    return capturer->m_isStopRequested ? 1 : 0;
+}
+
+bool AudioCapturer::openInput() {
+    const AVInputFormat* inputFormat = av_find_input_format(m_settings.format.c_str());
+    if (nullptr == inputFormat) {
+        std::cerr << "{AudioCapturer::openInput}; input format is NOT available; "
+            "format: '" << m_settings.format << "'" << std::endl;
+        return false;
+    }
+    m_inputContext = avformat_alloc_context();
+    if (nullptr == m_inputContext) {
+        std::cerr << "{AudioCapturer::openInput}; unable to allocate memory for input context" << std::endl;
+        return false;
+    }
+    /* a blocked read returns once stop was requested */
+    m_inputContext->interrupt_callback.callback = &AudioCapturer::onProxyInterrupt;
+    m_inputContext->interrupt_callback.opaque = static_cast<void*>(this);
+
+    AVDictionary* options = nullptr;
+    av_dict_set_int(&options, "sample_rate", m_settings.sampleRate, 0);
+    av_dict_set_int(&options, "channels", m_settings.nChannels, 0);
+    auto openResult = avformat_open_input(&m_inputContext, m_settings.device.c_str(), inputFormat, &options);
+    av_dict_free(&options);
+    if (openResult < 0) {
+        std::cerr << "{AudioCapturer::openInput}; unable to open audio device; "
+            "device: '" << m_settings.device << "'; "
+            "open result: '" << openResult << " (" << av_err2str(openResult) << ")'" << std::endl;
+        return false;
+    }
+
+    const AVCodec* decoder = nullptr;
+    m_inputStreamIndex = av_find_best_stream(m_inputContext, AVMEDIA_TYPE_AUDIO, -1, -1, &decoder, 0);
+    if ((m_inputStreamIndex < 0) || (nullptr == decoder)) {
+        std::cerr << "{AudioCapturer::openInput}; unable to find audio stream of device" << std::endl;
+        return false;
+    }
+    const AVStream* inputStream = m_inputContext->streams[ m_inputStreamIndex ];
+    m_decoderContext = avcodec_alloc_context3(decoder);
+    if (nullptr == m_decoderContext) {
+        std::cerr << "{AudioCapturer::openInput}; unable to allocate memory for decoder context" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_to_context(m_decoderContext, inputStream->codecpar);
+    if (copyResult < 0) {
+        std::cerr << "{AudioCapturer::openInput}; unable to fill decoder context; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        return false;
+    }
+    m_decoderContext->pkt_timebase = inputStream->time_base;
+    auto decoderInitResult = avcodec_open2(m_decoderContext, decoder, nullptr);
+    if (decoderInitResult < 0) {
+        std::cerr << "{AudioCapturer::openInput}; unable to initialize decoder context; "
+            "initialize result: '" << decoderInitResult << " (" << av_err2str(decoderInitResult) << ")'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AudioCapturer::openEncoder(const AVFormatContext* outputContext) {
+    const AVCodec* encoder = avcodec_find_encoder(g_encoderId);
+    if (nullptr == encoder) {
+        std::cerr << "{AudioCapturer::openEncoder}; unable to find registered encoder; "
+            "encoder id: '" << static_cast<int>(g_encoderId) << "'" << std::endl;
+        return false;
+    }
+    m_encoderContext = avcodec_alloc_context3(encoder);
+    if (nullptr == m_encoderContext) {
+        std::cerr << "{AudioCapturer::openEncoder}; unable to allocate memory for encoder context" << std::endl;
+        return false;
+    }
+
+    /* take first format from list of supported formats */
+    const AVSampleFormat* sampleFormatArray = nullptr;
+    int nSampleFormats = 0;
+    auto getResult = avcodec_get_supported_config(
+        nullptr, encoder, AV_CODEC_CONFIG_SAMPLE_FORMAT,
+        0, reinterpret_cast<const void**>(&sampleFormatArray), std::addressof(nSampleFormats)
+    );
+    if ((getResult < 0) || (nullptr == sampleFormatArray) || (nSampleFormats <= 0)) {
+        std::cerr << "{AudioCapturer::openEncoder}; unable to get supported sample formats" << std::endl;
+        return false;
+    }
+    m_encoderContext->sample_fmt = sampleFormatArray[ 0 ];
+    m_encoderContext->sample_rate = m_settings.sampleRate;
+    av_channel_layout_default(&m_encoderContext->ch_layout, m_settings.nChannels);
+    m_encoderContext->bit_rate = m_settings.bitRate;
+    m_encoderContext->time_base = AVRational{ 1, m_settings.sampleRate };
+    if (AVFMT_GLOBALHEADER & outputContext->oformat->flags) {
+        m_encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    auto encoderInitResult = avcodec_open2(m_encoderContext, encoder, nullptr);
+    if (encoderInitResult < 0) {
+        std::cerr << "{AudioCapturer::openEncoder}; unable to initialize encoder context to use the given encoder; "
+            "initialize result: '" << encoderInitResult << " (" << av_err2str(encoderInitResult) << ")'" << std::endl;
+        return false;
+    }
+
+    AVStream* outputStream = avformat_new_stream(m_outputContext, nullptr);
+    if (nullptr == outputStream) {
+        std::cerr << "{AudioCapturer::openEncoder}; unable to add new stream" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_from_context(outputStream->codecpar, m_encoderContext);
+    if (copyResult < 0) {
+        std::cerr << "{AudioCapturer::openEncoder}; unable to fill codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        return false;
+    }
+    outputStream->time_base = m_encoderContext->time_base;
+    m_outputStreamIndex = outputStream->index;
+    return true;
+}
+
+bool AudioCapturer::receiveFrames() {
+    while (true) {
+        auto receiveResult = avcodec_receive_frame(m_decoderContext, m_decodedFrame);
+        if ((AVERROR(EAGAIN) == receiveResult) || (AVERROR_EOF == receiveResult)) {
+            return true;
+        } else if (receiveResult < 0) {
+            std::cerr << "{AudioCapturer::receiveFrames}; unable to receive decoded frame; "
+                "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
+            return false;
+        }
+        bool wasPushed = pushFrame(m_decodedFrame);
+        av_frame_unref(m_decodedFrame);
+        if (!wasPushed || !encodeFifo(false)) {
+            return false;
+        }
+    }
+}
+
+bool AudioCapturer::pushFrame(const AVFrame* frame) {
+    /* audio devices stamp their packets with the wall clock, like the camera frames */
+    auto captureTime = (AV_NOPTS_VALUE != frame->pts) ?
+        av_rescale_q(frame->pts, m_decoderContext->pkt_timebase, AV_TIME_BASE_Q) :
+        CommonFunctions::getCurTimeSinceEpoch();
+    auto pts = m_captureClock->getPts(captureTime);
+    if (!pts.has_value()) {
+        /* the video has NOT started yet */
+        m_metrics->add(StreamMetrics::Metric::AudioDroppedFrames);
+        return true;
+    }
+
+    auto sampleRate = m_encoderContext->sample_rate;
+    auto capturedPts = av_rescale(pts.value(), sampleRate, AV_TIME_BASE);
+    std::int64_t nFifoSamples = av_audio_fifo_size(m_fifo);
+    if (!m_isPlaced) {
+        m_nextPts = capturedPts;
+        m_isPlaced = true;
+    } else {
+        auto drift = capturedPts - (m_nextPts + nFifoSamples);
+        if (drift < -m_encoderContext->frame_size) {
+            /* samples of this time were already encoded; output timestamps must NOT go back */
+            m_metrics->add(StreamMetrics::Metric::AudioDroppedFrames);
+            return true;
+        }
+        if (drift > m_encoderContext->frame_size) {
+            /* samples were lost, e.g. in an overrun of the device; the gap stays silent */
+            av_audio_fifo_drain(m_fifo, static_cast<int>(nFifoSamples));
+            m_nextPts = capturedPts;
+            m_metrics->add(StreamMetrics::Metric::AudioResyncs);
+        }
+    }
+
+    av_frame_unref(m_resampledFrame);
+    auto copyResult = av_channel_layout_copy(&m_resampledFrame->ch_layout, &m_encoderContext->ch_layout);
+    if (copyResult < 0) {
+        std::cerr << "{AudioCapturer::pushFrame}; unable to copy channel layout; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        return false;
+    }
+    m_resampledFrame->sample_rate = sampleRate;
+    m_resampledFrame->format = m_encoderContext->sample_fmt;
+    auto convertResult = swr_convert_frame(m_resamplerContext, m_resampledFrame, frame);
+    if (convertResult < 0) {
+        std::cerr << "{AudioCapturer::pushFrame}; unable to resample frame; "
+            "convert result: '" << convertResult << " (" << av_err2str(convertResult) << ")'" << std::endl;
+        return false;
+    }
+    if (m_resampledFrame->nb_samples <= 0) {
+        return true;
+    }
+    auto writeResult = av_audio_fifo_write(
+        m_fifo, reinterpret_cast<void**>(m_resampledFrame->extended_data), m_resampledFrame->nb_samples
+    );
+    if (writeResult < m_resampledFrame->nb_samples) {
+        std::cerr << "{AudioCapturer::pushFrame}; unable to write samples to FIFO; "
+            "write result: '" << writeResult << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AudioCapturer::encodeFifo(bool isFlushing) {
+    while (true) {
+        auto nFifoSamples = av_audio_fifo_size(m_fifo);
+        if ((nFifoSamples <= 0) || (!isFlushing && (nFifoSamples < m_encoderContext->frame_size))) {
+            return true;
+        }
+        auto nFrameSamples = std::min(nFifoSamples, m_encoderContext->frame_size);
+
+        av_frame_unref(m_encoderFrame);
+        m_encoderFrame->nb_samples = nFrameSamples;
+        m_encoderFrame->format = m_encoderContext->sample_fmt;
+        m_encoderFrame->sample_rate = m_encoderContext->sample_rate;
+        auto copyResult = av_channel_layout_copy(&m_encoderFrame->ch_layout, &m_encoderContext->ch_layout);
+        if (copyResult < 0) {
+            std::cerr << "{AudioCapturer::encodeFifo}; unable to copy channel layout; "
+                "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+            return false;
+        }
+        auto bufferResult = av_frame_get_buffer(m_encoderFrame, 0);
+        if (bufferResult < 0) {
+            std::cerr << "{AudioCapturer::encodeFifo}; unable to allocate buffer of encoder frame; "
+                "allocation result: '" << bufferResult << " (" << av_err2str(bufferResult) << ")'" << std::endl;
+            return false;
+        }
+        auto readResult = av_audio_fifo_read(m_fifo, reinterpret_cast<void**>(m_encoderFrame->data), nFrameSamples);
+        if (readResult < nFrameSamples) {
+            std::cerr << "{AudioCapturer::encodeFifo}; unable to read samples from FIFO; "
+                "read result: '" << readResult << "'" << std::endl;
+            return false;
+        }
+        m_encoderFrame->pts = m_nextPts;
+        m_nextPts += nFrameSamples;
+        if (!encode(m_encoderFrame)) {
+            return false;
+        }
+    }
+}
+
+bool AudioCapturer::encode(AVFrame* frame) {
+    auto sendResult = avcodec_send_frame(m_encoderContext, frame);
+    if (sendResult < 0) {
+        std::cerr << "{AudioCapturer::encode}; unable to send frame to encoder context; "
+            "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
+        return false;
+    }
+
+    while (true) {
+        av_packet_unref(m_encoderPacket);
+        auto receiveResult = avcodec_receive_packet(m_encoderContext, m_encoderPacket);
+        if ((AVERROR(EAGAIN) == receiveResult) || (AVERROR_EOF == receiveResult)) {
+            return true;
+        } else if (receiveResult < 0) {
+            std::cerr << "{AudioCapturer::encode}; unable to receive packet from encoder context; "
+                "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
+            return false;
+        }
+        m_encoderPacket->stream_index = m_outputStreamIndex;
+        /* the muxer may have changed the time base of the stream while writing the header */
+        av_packet_rescale_ts(
+            m_encoderPacket, m_encoderContext->time_base,
+            m_outputContext->streams[ m_outputStreamIndex ]->time_base
+        );
+        m_metrics->add(StreamMetrics::Metric::AudioPackets);
+        if (!m_packetWriter->write(m_encoderPacket)) {
+            return false;
+        }
+    }
+}
+
+void AudioCapturer::run() {
+    ThreadPlacement::report("audio");
+
+    while (!m_isStopRequested) {
+        auto readResult = av_read_frame(m_inputContext, m_inputPacket);
+        if (AVERROR(EAGAIN) == readResult) {
+            continue;
+        }
+        if (readResult < 0) {
+            if (!m_isStopRequested) {
+                std::cerr << "{AudioCapturer::run}; unable to read packet from audio device; "
+                    "read result: '" << readResult << " (" << av_err2str(readResult) << ")'" << std::endl;
+            }
+            break;
+        }
+        if (m_inputStreamIndex != m_inputPacket->stream_index) {
+            av_packet_unref(m_inputPacket);
+            continue;
+        }
+        auto sendResult = avcodec_send_packet(m_decoderContext, m_inputPacket);
+        av_packet_unref(m_inputPacket);
+        if (sendResult < 0) {
+            std::cerr << "{AudioCapturer::run}; unable to send packet to decoder context; "
+                "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
+            break;
+        }
+        if (!receiveFrames()) {
+            break;
+        }
+    }
+
+    /* the last samples end the audio stream before the trailer is written */
+    if (m_isPlaced && encodeFifo(true)) {
+        encode(nullptr);
+    }
+    std::cout << "{AudioCapturer::run}; audio thread has finished" << std::endl;
+}
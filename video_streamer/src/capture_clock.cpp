@@ -0,0 +1,25 @@
+#include "capture_clock.h"
+
+void CaptureClock::setOrigin(std::int64_t captureTime, std::int64_t pts) {
+    if (m_isSetting.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    m_originCaptureTime = captureTime;
+    m_originPts = pts;
+    /* publishes the origin to the readers */
+    m_isSet.store(true, std::memory_order_release);
+}
+
+void CaptureClock::reset() {
+    m_isSet.store(false, std::memory_order_release);
+    m_isSetting.store(false, std::memory_order_release);
+    m_originCaptureTime = 0;
+    m_originPts = 0;
+}
+
+std::optional<std::int64_t> CaptureClock::getPts(std::int64_t captureTime) const {
+    if (!isSet()) {
+        return std::nullopt;
+    }
+    return std::make_optional<std::int64_t>(captureTime - m_originCaptureTime + m_originPts);
+}
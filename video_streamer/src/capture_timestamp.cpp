@@ -0,0 +1,85 @@
+#include "capture_timestamp.h"
+
+extern "C" {
+    #include <libavcodec/packet.h>
+    #include <libavutil/avutil.h>
+    #include <libavutil/buffer.h>
+    #include <libavutil/frame.h>
+}
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+    struct Data {
+        std::int64_t captureTime = 0;
+        std::int64_t pts = AV_NOPTS_VALUE;
+    };
+
+    std::optional<Data> readData(const AVBufferRef* buffer) {
+        if ((nullptr == buffer) || (buffer->size < sizeof(Data))) {
+            return std::nullopt;
+        }
+        Data data;
+        std::memcpy(&data, buffer->data, sizeof(data));
+        return std::make_optional<Data>(data);
+    }
+
+    std::optional<std::int64_t> readTime(const AVBufferRef* buffer) {
+        auto data = readData(buffer);
+        return data.has_value() ? std::make_optional<std::int64_t>(data->captureTime) : std::nullopt;
+    }
+
+    std::optional<std::int64_t> readPts(const AVBufferRef* buffer) {
+        auto data = readData(buffer);
+        if (!data.has_value() || (AV_NOPTS_VALUE == data->pts)) {
+            return std::nullopt;
+        }
+        return std::make_optional<std::int64_t>(data->pts);
+    }
+}
+
+AVBufferPool* CaptureTimestamp::createBufferPool() {
+    auto* bufferPool = av_buffer_pool_init(sizeof(Data), nullptr);
+    if (nullptr == bufferPool) {
+        std::cerr << "{CaptureTimestamp::createBufferPool}; unable to allocate buffer pool" << std::endl;
+    }
+    return bufferPool;
+}
+
+bool CaptureTimestamp::attach(AVBufferPool* bufferPool, AVPacket* packet, std::int64_t captureTime) {
+    if (nullptr == bufferPool) {
+        std::cerr << "{CaptureTimestamp::attach}; pointer to buffer pool is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == packet) {
+        std::cerr << "{CaptureTimestamp::attach}; pointer to packet is NULL" << std::endl;
+        return false;
+    }
+    auto* buffer = av_buffer_pool_get(bufferPool);
+    if (nullptr == buffer) {
+        std::cerr << "{CaptureTimestamp::attach}; unable to get buffer from pool" << std::endl;
+        return false;
+    }
+    Data data{ .captureTime = captureTime, .pts = packet->pts };
+    std::memcpy(buffer->data, &data, sizeof(data));
+    av_buffer_unref(&packet->opaque_ref);
+    packet->opaque_ref = buffer;
+    return true;
+}
+
+std::optional<std::int64_t> CaptureTimestamp::get(const AVFrame* frame) {
+    return frame ? readTime(frame->opaque_ref) : std::nullopt;
+}
+
+std::optional<std::int64_t> CaptureTimestamp::get(const AVPacket* packet) {
+    return packet ? readTime(packet->opaque_ref) : std::nullopt;
+}
+
+std::optional<std::int64_t> CaptureTimestamp::getPts(const AVFrame* frame) {
+    return frame ? readPts(frame->opaque_ref) : std::nullopt;
+}
+
+std::optional<std::int64_t> CaptureTimestamp::getPts(const AVPacket* packet) {
+    return packet ? readPts(packet->opaque_ref) : std::nullopt;
+}
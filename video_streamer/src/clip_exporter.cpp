@@ -0,0 +1,237 @@
+#include "clip_exporter.h"
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavcodec/packet.h>
+    #include <libavformat/avformat.h>
+    #include <libavformat/avio.h>
+    #include <libavutil/error.h>
+}
+
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+#include "simple_wrapper.h"
+
+ClipExporter::~ClipExporter() {
+    stop();
+}
+
+bool ClipExporter::setup(const AVCodecParameters* codecParameters, AVRational timeBase, StreamMetrics* metrics) {
+    if (m_thread.joinable()) {
+        std::cerr << "{ClipExporter::setup}; export thread is already running" << std::endl;
+        return false;
+    }
+    if (nullptr == codecParameters) {
+        std::cerr << "{ClipExporter::setup}; pointer to codec parameters is NULL" << std::endl;
+        return false;
+    }
+    if (codecParameters->extradata_size <= 0) {
+        std::cerr << "{ClipExporter::setup}; codec parameters have NO extradata" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{ClipExporter::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if ((timeBase.num <= 0) || (timeBase.den <= 0)) {
+        std::cerr << "{ClipExporter::setup}; time base is NOT valid" << std::endl;
+        return false;
+    }
+
+    m_codecParameters = avcodec_parameters_alloc();
+    if (nullptr == m_codecParameters) {
+        std::cerr << "{ClipExporter::setup}; unable to allocate memory for codec parameters" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_copy(m_codecParameters, codecParameters);
+    if (copyResult < 0) {
+        std::cerr << "{ClipExporter::setup}; unable to copy codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+    m_timeBase = timeBase;
+    m_metrics = metrics;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = false;
+    }
+
+    try {
+        m_thread = std::thread(&ClipExporter::run, this);
+    } catch (const std::system_error& exception) {
+        std::cerr << "{ClipExporter::setup}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting export thread; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    } catch (...) {
+        std::cerr << "{ClipExporter::setup}; "
+            "unknown exception was caught while "
+            "starting export thread" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+    return true;
+}
+
+void ClipExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = true;
+    }
+    m_condition.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& job : m_jobs) {
+        freePackets(job.packets);
+    }
+    m_jobs.clear();
+    if (m_codecParameters) {
+        avcodec_parameters_free(&m_codecParameters);
+        m_codecParameters = nullptr;
+    }
+    m_metrics = nullptr;
+}
+
+bool ClipExporter::exportClip(std::vector<AVPacket*>& packets, const std::string& fileName) {
+    if (fileName.empty()) {
+        std::cerr << "{ClipExporter::exportClip}; file name is empty" << std::endl;
+        freePackets(packets);
+        return false;
+    }
+    if (packets.empty()) {
+        std::cerr << "{ClipExporter::exportClip}; packet list is empty" << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable() || m_isStopRequested) {
+            std::cerr << "{ClipExporter::exportClip}; export thread is NOT running" << std::endl;
+            freePackets(packets);
+            return false;
+        }
+        m_jobs.push_back(Job{ .packets = std::exchange(packets, {}), .fileName = fileName });
+    }
+    m_condition.notify_one();
+    return true;
+}
+
+bool ClipExporter::writeClip(Job& job) const {
+    using namespace SimpleWrapperSpace;
+
+    AVFormatContext* clipContext = nullptr;
+    auto allocationResult = avformat_alloc_output_context2(&clipContext, nullptr, "mp4", job.fileName.c_str());
+    if ((allocationResult < 0) || (nullptr == clipContext)) {
+        std::cerr << "{ClipExporter::writeClip}; unable to allocate clip context; "
+            "allocation result: '" << allocationResult << " (" << av_err2str(allocationResult) << ")'" << std::endl;
+        return false;
+    }
+    auto contextDeallocator = [&clipContext] () {
+        if (clipContext->pb) {
+            avio_closep(&clipContext->pb);
+        }
+        avformat_free_context(clipContext);
+    };
+    SimpleWrapper simpleWrapper(nullptr, contextDeallocator);
+
+    AVStream* clipStream = avformat_new_stream(clipContext, nullptr);
+    if (nullptr == clipStream) {
+        std::cerr << "{ClipExporter::writeClip}; unable to add new stream" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_copy(clipStream->codecpar, m_codecParameters);
+    if (copyResult < 0) {
+        std::cerr << "{ClipExporter::writeClip}; unable to copy codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        return false;
+    }
+    clipStream->codecpar->codec_tag = 0;
+    clipStream->time_base = m_timeBase;
+
+    auto openResult = avio_open(&clipContext->pb, job.fileName.c_str(), AVIO_FLAG_WRITE);
+    if (openResult < 0) {
+        std::cerr << "{ClipExporter::writeClip}; unable to open file '" << job.fileName << "'; "
+            "open result: '" << openResult << " (" << av_err2str(openResult) << ")'" << std::endl;
+        return false;
+    }
+
+    auto writeResult = avformat_write_header(clipContext, nullptr);
+    if (writeResult < 0) {
+        std::cerr << "{ClipExporter::writeClip}; unable to write header; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        return false;
+    }
+
+    /* the clip starts at zero, whatever the stream time of its first keyframe */
+    auto firstPacket = job.packets.front();
+    auto offset = (AV_NOPTS_VALUE != firstPacket->dts) ? firstPacket->dts : firstPacket->pts;
+    for (auto packet : job.packets) {
+        if (AV_NOPTS_VALUE != packet->pts) {
+            packet->pts -= offset;
+        }
+        if (AV_NOPTS_VALUE != packet->dts) {
+            packet->dts -= offset;
+        }
+        packet->stream_index = 0;
+        packet->pos = -1;
+        av_packet_rescale_ts(packet, m_timeBase, clipStream->time_base);
+        writeResult = av_write_frame(clipContext, packet);
+        if (writeResult < 0) {
+            std::cerr << "{ClipExporter::writeClip}; unable to write packet to clip; "
+                "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+            return false;
+        }
+    }
+
+    writeResult = av_write_trailer(clipContext);
+    if (writeResult < 0) {
+        std::cerr << "{ClipExporter::writeClip}; unable to write trailer; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ClipExporter::freePackets(std::vector<AVPacket*>& packets) {
+    for (auto& packet : packets) {
+        av_packet_free(&packet);
+    }
+    packets.clear();
+}
+
+void ClipExporter::run() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () {
+                return m_isStopRequested || !m_jobs.empty();
+            });
+            if (m_jobs.empty()) {
+                break;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        auto nPackets = job.packets.size();
+        if (writeClip(job)) {
+            m_metrics->add(StreamMetrics::Metric::ExportedClips);
+            std::cout << "{ClipExporter::run}; clip has been successfully exported; "
+                "number of packets: '" << nPackets << "'; "
+                "file name: '" << job.fileName << "'" << std::endl;
+        } else {
+            std::cerr << "{ClipExporter::run}; unable to export clip; "
+                "file name: '" << job.fileName << "'" << std::endl;
+        }
+        freePackets(job.packets);
+    }
+}
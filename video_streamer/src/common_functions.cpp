@@ -1,6 +1,13 @@
 #include "common_functions.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -15,6 +22,12 @@
 #include <Poco/URI.h>
 
 #include "lodepng.h"
+#include "simple_wrapper.h"
+
+namespace {
+    /* PNG signature plus the IHDR chunk */
+    constexpr std::size_t g_pngHeaderSize = 33;
+}
 
 bool CommonFunctions::fileExists(const std::string& fileName) {
     if (fileName.empty()) {
@@ -52,6 +65,18 @@ bool CommonFunctions::isCharacterFile(const std::string& fileName) {
     return true;
 }
 
+bool CommonFunctions::isDirectory(const std::string& directoryName) {
+    if (directoryName.empty()) {
+        std::cerr << "{CommonFunctions::isDirectory}; directory name is empty" << std::endl;
+        return false;
+    }
+    if (!std::filesystem::is_directory(directoryName)) {
+        std::cerr << "{CommonFunctions::isDirectory}; file '" << directoryName << "' is NOT a directory" << std::endl;
+        return false;
+    }
+    return true;
+}
+
 bool CommonFunctions::getFileContents(const std::string& fileName, std::string& fileContents) {
     fileContents.clear();
     if (fileName.empty()) {
@@ -76,6 +101,12 @@ std::int64_t CommonFunctions::getCurTimeSinceEpoch() {
     ).count();
 }
 
+std::int64_t CommonFunctions::getSteadyTime() {
+    return std::chrono::duration_cast< std::chrono::microseconds >(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
 std::optional<std::int64_t> CommonFunctions::getDiffTime(std::int64_t beginTime, std::int64_t endTime) {
     if (beginTime < 0) {
         std::cerr << "{CommonFunctions::getDiffTime}; begin time is less than zero" << std::endl;
@@ -206,6 +237,8 @@ bool CommonFunctions::isHostNameValid(const std::string& hostName) {
 }
 
 bool CommonFunctions::getPngSize(const std::string& fileName, unsigned int& width, unsigned int& height) {
+    using namespace SimpleWrapperSpace;
+
     width = 0;
     height = 0;
     if (fileName.empty()) {
@@ -213,32 +246,49 @@ bool CommonFunctions::getPngSize(const std::string& fileName, unsigned int& widt
         return false;
     }
 
-    try {
-        std::vector<unsigned char> imageBuffer;
-        unsigned int errorCode = lodepng::decode(imageBuffer, width, height, fileName);
-        if (0 != errorCode) {
-            std::cerr << "{CommonFunctions::getPngSize}; unable to get PNG image width and/or height; "
-                "error code: '" << errorCode << " (" << lodepng_error_text(errorCode) << ")'; "
-                "file name: '" << fileName << "'" << std::endl;
-            return false;
-        }
-    } catch (const std::length_error& exception) {
-        std::cerr << "{CommonFunctions::getPngSize}; "
-            "exception 'std::length_error' was successfully caught; "
-            "exception description: '" << exception.what() << "'; "
+    int fileDescriptor = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (-1 == fileDescriptor) {
+        std::cerr << "{CommonFunctions::getPngSize}; unable to open file '" << fileName << "'; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    SimpleWrapper fileWrapper(nullptr, [fileDescriptor] () { ::close(fileDescriptor); });
+
+    struct stat fileStatus{};
+    if (-1 == ::fstat(fileDescriptor, &fileStatus)) {
+        std::cerr << "{CommonFunctions::getPngSize}; unable to get file status; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
             "file name: '" << fileName << "'" << std::endl;
         return false;
-    } catch (const std::bad_alloc& exception) {
-        std::cerr << "{CommonFunctions::getPngSize}; "
-            "exception 'std::bad_alloc' was successfully caught; "
-            "exception description: '" << exception.what() << "'; "
+    }
+    if (fileStatus.st_size < static_cast<off_t>(g_pngHeaderSize)) {
+        std::cerr << "{CommonFunctions::getPngSize}; file is too small to be a PNG image; "
             "file name: '" << fileName << "'" << std::endl;
         return false;
-    } catch (...) {
-        std::cerr << "{CommonFunctions::getPngSize}; "
-            "unknown exception was caught while "
-            "decoding PNG image; "
+    }
+
+    /* signature and IHDR chunk only; the image data is never read */
+    void* header = ::mmap(nullptr, g_pngHeaderSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (MAP_FAILED == header) {
+        std::cerr << "{CommonFunctions::getPngSize}; unable to map file header; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return false;
+    }
+    SimpleWrapper headerWrapper(nullptr, [header] () { ::munmap(header, g_pngHeaderSize); });
+
+    LodePNGState state;
+    lodepng_state_init(&state);
+    unsigned int errorCode = lodepng_inspect(
+        &width, &height, &state, static_cast<const unsigned char*>(header), g_pngHeaderSize
+    );
+    lodepng_state_cleanup(&state);
+    if (0 != errorCode) {
+        std::cerr << "{CommonFunctions::getPngSize}; unable to get PNG image width and/or height; "
+            "error code: '" << errorCode << " (" << lodepng_error_text(errorCode) << ")'; "
             "file name: '" << fileName << "'" << std::endl;
+        width = 0;
+        height = 0;
         return false;
     }
     return true;
@@ -0,0 +1,386 @@
+#include "encode_scheduler.h"
+
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "common_functions.h"
+
+EncodeScheduler::~EncodeScheduler() {
+    stop();
+}
+
+bool EncodeScheduler::start(std::size_t nWorkers, const ThreadPlacement::Settings& placement) {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (m_isRunning.load(std::memory_order_acquire)) {
+        std::cout << "{EncodeScheduler::start}; encode scheduler is already running" << std::endl;
+        return true;
+    }
+    if (0 == nWorkers) {
+        std::cerr << "{EncodeScheduler::start}; number of workers is equal to zero" << std::endl;
+        return false;
+    }
+
+    m_isStopRequested.store(false, std::memory_order_release);
+    m_nQueuedEntries.store(0, std::memory_order_release);
+    bool isStarted = false;
+    {
+        std::unique_lock<std::shared_mutex> workersLock(m_workersMutex);
+        try {
+            m_workers.reserve(nWorkers);
+            for (std::size_t i = 0; i < nWorkers; ++i) {
+                m_workers.push_back(std::make_unique<Worker>());
+            }
+            for (std::size_t i = 0; i < nWorkers; ++i) {
+                auto workerPlacement = placement;
+                if (!placement.cpus.empty()) {
+                    workerPlacement.cpus = { placement.cpus[i % placement.cpus.size()] };
+                }
+                m_workers[i]->thread = std::thread(&EncodeScheduler::runWorker, this, i, workerPlacement);
+            }
+            isStarted = true;
+        } catch (const std::system_error& exception) {
+            std::cerr << "{EncodeScheduler::start}; "
+                "exception 'std::system_error' was successfully caught while "
+                "starting workers; "
+                "exception description: '" << exception.what() << "'" << std::endl;
+        } catch (const std::bad_alloc& exception) {
+            std::cerr << "{EncodeScheduler::start}; "
+                "exception 'std::bad_alloc' was successfully caught while "
+                "starting workers; "
+                "exception description: '" << exception.what() << "'" << std::endl;
+        } catch (...) {
+            std::cerr << "{EncodeScheduler::start}; "
+                "unknown exception was caught while "
+                "starting workers" << std::endl;
+        }
+    }
+
+    if (!isStarted) {
+        m_isStopRequested.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> idleLock(m_idleMutex);
+        }
+        m_idleCondition.notify_all();
+        for (auto& worker : m_workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        std::unique_lock<std::shared_mutex> workersLock(m_workersMutex);
+        m_workers.clear();
+        return false;
+    }
+
+    m_isRunning.store(true, std::memory_order_release);
+    std::cout << "{EncodeScheduler::start}; encode scheduler has been successfully started; "
+        "number of workers: '" << nWorkers << "'" << std::endl;
+    return true;
+}
+
+void EncodeScheduler::stop() {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (!m_isRunning.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    m_isStopRequested.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> idleLock(m_idleMutex);
+    }
+    m_idleCondition.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    {
+        std::unique_lock<std::shared_mutex> workersLock(m_workersMutex);
+        m_workers.clear();
+    }
+
+    /* wake up producers and waiters; their jobs will never run */
+    std::lock_guard<std::mutex> streamsLock(m_streamsMutex);
+    for (auto& [streamId, stream] : m_streams) {
+        {
+            std::lock_guard<std::mutex> streamLock(stream->mutex);
+            stream->isScheduled = false;
+            stream->pendingJobs.clear();
+        }
+        stream->condition.notify_all();
+    }
+    std::cout << "{EncodeScheduler::stop}; encode scheduler has been stopped; "
+        "deadline misses: '" << m_nDeadlineMisses.load(std::memory_order_relaxed) << "'" << std::endl;
+}
+
+std::optional<EncodeScheduler::StreamId> EncodeScheduler::registerStream(std::size_t queueCapacity) {
+    if (!isRunning()) {
+        std::cerr << "{EncodeScheduler::registerStream}; encode scheduler is NOT running" << std::endl;
+        return std::nullopt;
+    }
+    if (0 == queueCapacity) {
+        std::cerr << "{EncodeScheduler::registerStream}; queue capacity is equal to zero" << std::endl;
+        return std::nullopt;
+    }
+
+    std::shared_ptr<Stream> stream{ nullptr };
+    try {
+        stream = std::make_shared<Stream>();
+    } catch (const std::bad_alloc& exception) {
+        std::cerr << "{EncodeScheduler::registerStream}; "
+            "exception 'std::bad_alloc' was successfully caught while "
+            "allocating stream state; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        return std::nullopt;
+    }
+
+    std::size_t nWorkers = 0;
+    {
+        std::shared_lock<std::shared_mutex> workersLock(m_workersMutex);
+        nWorkers = m_workers.size();
+    }
+    if (0 == nWorkers) {
+        std::cerr << "{EncodeScheduler::registerStream}; number of workers is equal to zero" << std::endl;
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> streamsLock(m_streamsMutex);
+    stream->id = m_nextStreamId++;
+    /* spreads streams round-robin; this is only a hint, idle workers steal */
+    stream->preferredWorker = stream->id % nWorkers;
+    stream->queueCapacity = queueCapacity;
+    m_streams.insert({stream->id, stream});
+    std::cout << "{EncodeScheduler::registerStream}; stream '" << stream->id << "' has been registered; "
+        "preferred worker: '" << stream->preferredWorker << "'" << std::endl;
+    return std::make_optional<StreamId>(stream->id);
+}
+
+void EncodeScheduler::unregisterStream(StreamId streamId) {
+    std::shared_ptr<Stream> stream{ nullptr };
+    {
+        std::lock_guard<std::mutex> streamsLock(m_streamsMutex);
+        auto it = m_streams.find(streamId);
+        if (m_streams.end() == it) {
+            return;
+        }
+        stream = it->second;
+        m_streams.erase(it);
+    }
+
+    std::deque<Stream::PendingJob> droppedJobs;
+    {
+        std::unique_lock<std::mutex> streamLock(stream->mutex);
+        stream->isUnregistered = true;
+        std::swap(droppedJobs, stream->pendingJobs);
+        /* the job that is being executed still uses the streamer */
+        stream->condition.wait(streamLock, [&stream] () { return !stream->isRunning; });
+    }
+    stream->condition.notify_all();
+    std::cout << "{EncodeScheduler::unregisterStream}; stream '" << streamId << "' has been unregistered; "
+        "number of dropped jobs: '" << droppedJobs.size() << "'" << std::endl;
+}
+
+bool EncodeScheduler::submit(StreamId streamId, std::int64_t deadline, Job job) {
+    if (!job) {
+        std::cerr << "{EncodeScheduler::submit}; job is empty" << std::endl;
+        return false;
+    }
+    auto stream = findStream(streamId);
+    if (nullptr == stream) {
+        std::cerr << "{EncodeScheduler::submit}; stream '" << streamId << "' was NOT found" << std::endl;
+        return false;
+    }
+
+    std::optional<Entry> entry{ std::nullopt };
+    {
+        std::unique_lock<std::mutex> streamLock(stream->mutex);
+        stream->condition.wait(streamLock, [this, &stream] () {
+            return (stream->pendingJobs.size() < stream->queueCapacity) ||
+                stream->isFailed || stream->isUnregistered || !isRunning();
+        });
+        if (stream->isFailed || stream->isUnregistered || !isRunning()) {
+            return false;
+        }
+        stream->pendingJobs.push_back({ .deadline = deadline, .job = std::move(job) });
+        if (!stream->isScheduled && !stream->isRunning) {
+            stream->isScheduled = true;
+            entry = std::make_optional<Entry>(Entry{
+                .deadline = stream->pendingJobs.front().deadline, .stream = stream
+            });
+        }
+    }
+    if (entry.has_value()) {
+        enqueue(stream->preferredWorker, std::move(entry.value()));
+    }
+    return true;
+}
+
+bool EncodeScheduler::waitIdle(StreamId streamId) {
+    auto stream = findStream(streamId);
+    if (nullptr == stream) {
+        std::cerr << "{EncodeScheduler::waitIdle}; stream '" << streamId << "' was NOT found" << std::endl;
+        return false;
+    }
+    std::unique_lock<std::mutex> streamLock(stream->mutex);
+    stream->condition.wait(streamLock, [this, &stream] () {
+        return stream->isFailed || !isRunning() || (
+            stream->pendingJobs.empty() && !stream->isScheduled && !stream->isRunning
+        );
+    });
+    return !stream->isFailed && stream->pendingJobs.empty();
+}
+
+bool EncodeScheduler::isStreamFailed(StreamId streamId) {
+    auto stream = findStream(streamId);
+    if (nullptr == stream) {
+        return true;
+    }
+    std::lock_guard<std::mutex> streamLock(stream->mutex);
+    return stream->isFailed;
+}
+
+std::shared_ptr<EncodeScheduler::Stream> EncodeScheduler::findStream(StreamId streamId) {
+    std::lock_guard<std::mutex> streamsLock(m_streamsMutex);
+    auto it = m_streams.find(streamId);
+    if (m_streams.end() == it) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void EncodeScheduler::enqueue(std::size_t workerIndex, Entry entry) {
+    {
+        std::shared_lock<std::shared_mutex> workersLock(m_workersMutex);
+        if (m_workers.empty() || m_isStopRequested.load(std::memory_order_acquire)) {
+            return;
+        }
+        auto& worker = *m_workers[workerIndex % m_workers.size()];
+        std::lock_guard<std::mutex> workerLock(worker.mutex);
+        worker.runQueue.push(std::move(entry));
+        m_nQueuedEntries.fetch_add(1, std::memory_order_release);
+    }
+    {
+        /* pairs with the predicate check of sleeping workers; prevents a lost wakeup */
+        std::lock_guard<std::mutex> idleLock(m_idleMutex);
+    }
+    m_idleCondition.notify_one();
+}
+
+bool EncodeScheduler::dequeue(std::size_t workerIndex, Entry& entry) {
+    if (0 == m_nQueuedEntries.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> workersLock(m_workersMutex);
+    const auto nWorkers = m_workers.size();
+    if (workerIndex >= nWorkers) {
+        return false;
+    }
+    {
+        auto& worker = *m_workers[workerIndex];
+        std::lock_guard<std::mutex> workerLock(worker.mutex);
+        if (!worker.runQueue.empty()) {
+            entry = worker.runQueue.top();
+            worker.runQueue.pop();
+            m_nQueuedEntries.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    /* steal the most urgent entry among other workers */
+    std::optional<std::size_t> victimIndex{ std::nullopt };
+    std::int64_t victimDeadline = 0;
+    for (std::size_t i = 1; i < nWorkers; ++i) {
+        auto index = (workerIndex + i) % nWorkers;
+        auto& worker = *m_workers[index];
+        std::lock_guard<std::mutex> workerLock(worker.mutex);
+        if (worker.runQueue.empty()) {
+            continue;
+        }
+        auto deadline = worker.runQueue.top().deadline;
+        if (!victimIndex.has_value() || (deadline < victimDeadline)) {
+            victimIndex = std::make_optional<std::size_t>(index);
+            victimDeadline = deadline;
+        }
+    }
+    if (!victimIndex.has_value()) {
+        return false;
+    }
+    auto& victim = *m_workers[victimIndex.value()];
+    std::lock_guard<std::mutex> victimLock(victim.mutex);
+    if (victim.runQueue.empty()) {
+        return false;
+    }
+    entry = victim.runQueue.top();
+    victim.runQueue.pop();
+    m_nQueuedEntries.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void EncodeScheduler::runWorker(std::size_t workerIndex, ThreadPlacement::Settings placement) {
+    auto threadName = "encode worker " + std::to_string(workerIndex);
+    if (!ThreadPlacement::isEmpty(placement)) {
+        ThreadPlacement::apply(threadName, placement);
+    }
+    ThreadPlacement::report(threadName);
+
+    while (!m_isStopRequested.load(std::memory_order_acquire)) {
+        Entry entry;
+        if (dequeue(workerIndex, entry)) {
+            runEntry(entry);
+            continue;
+        }
+        std::unique_lock<std::mutex> idleLock(m_idleMutex);
+        m_idleCondition.wait(idleLock, [this] () {
+            return m_isStopRequested.load(std::memory_order_acquire) ||
+                (m_nQueuedEntries.load(std::memory_order_acquire) > 0);
+        });
+    }
+}
+
+void EncodeScheduler::runEntry(const Entry& entry) {
+    auto& stream = entry.stream;
+    if (nullptr == stream) {
+        return;
+    }
+
+    Stream::PendingJob pendingJob;
+    {
+        std::lock_guard<std::mutex> streamLock(stream->mutex);
+        stream->isScheduled = false;
+        if (stream->pendingJobs.empty() || stream->isUnregistered || stream->isFailed) {
+            stream->condition.notify_all();
+            return;
+        }
+        /* one job per dispatch; the stream then competes again by its next deadline */
+        pendingJob = std::move(stream->pendingJobs.front());
+        stream->pendingJobs.pop_front();
+        stream->isRunning = true;
+    }
+    stream->condition.notify_all();
+
+    if (CommonFunctions::getSteadyTime() > pendingJob.deadline) {
+        m_nDeadlineMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+    bool isDone = pendingJob.job();
+    pendingJob.job = nullptr;
+
+    std::optional<Entry> nextEntry{ std::nullopt };
+    {
+        std::lock_guard<std::mutex> streamLock(stream->mutex);
+        stream->isRunning = false;
+        if (!isDone) {
+            stream->isFailed = true;
+            stream->pendingJobs.clear();
+        }
+        if (!stream->pendingJobs.empty() && !stream->isUnregistered && !stream->isFailed) {
+            stream->isScheduled = true;
+            nextEntry = std::make_optional<Entry>(Entry{
+                .deadline = stream->pendingJobs.front().deadline, .stream = stream
+            });
+        }
+    }
+    stream->condition.notify_all();
+    if (nextEntry.has_value()) {
+        enqueue(stream->preferredWorker, std::move(nextEntry.value()));
+    }
+}
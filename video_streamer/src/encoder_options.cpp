@@ -0,0 +1,105 @@
+#include "encoder_options.h"
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/error.h>
+    #include <libavutil/mathematics.h>
+    #include <libavutil/opt.h>
+}
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    constexpr std::int64_t g_defaultVbvBufferDuration = 1000000; // in microseconds
+    constexpr AVRational g_microsecondTimeBase{ 1, 1000000 };
+
+    /* false only when the option exists but rejected the value */
+    bool setPrivateOption(AVCodecContext* encoderContext, const char* key, std::int64_t value) {
+        if (nullptr == encoderContext->priv_data) {
+            std::cout << "{EncoderOptions::apply}; encoder has NO private options; "
+                "option '" << key << "' is ignored" << std::endl;
+            return true;
+        }
+        auto setResult = av_opt_set_int(encoderContext->priv_data, key, value, 0);
+        if (AVERROR_OPTION_NOT_FOUND == setResult) {
+            std::cout << "{EncoderOptions::apply}; option is NOT supported by encoder '" <<
+                encoderContext->codec->name << "'; option '" << key << "' is ignored" << std::endl;
+            return true;
+        }
+        if (setResult < 0) {
+            std::cerr << "{EncoderOptions::apply}; unable to set option; "
+                "key: '" << key << "'; value: '" << value << "'; "
+                "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+bool EncoderOptions::apply(const Settings& settings, AVCodecContext* encoderContext) {
+    if ((nullptr == encoderContext) || (nullptr == encoderContext->codec)) {
+        std::cerr << "{EncoderOptions::apply}; pointer to encoder context is NULL" << std::endl;
+        return false;
+    }
+    if ((settings.gopDuration < 0) || (settings.bitRate < 0) || (settings.maxRate < 0) || (settings.vbvBufferDuration < 0)) {
+        std::cerr << "{EncoderOptions::apply}; settings are negative" << std::endl;
+        return false;
+    }
+    if ((encoderContext->time_base.num <= 0) || (encoderContext->time_base.den <= 0)) {
+        std::cerr << "{EncoderOptions::apply}; time base of encoder is NOT set" << std::endl;
+        return false;
+    }
+
+    if (settings.gopDuration > 0) {
+        auto gopSize = av_rescale_q(settings.gopDuration, g_microsecondTimeBase, encoderContext->time_base);
+        encoderContext->gop_size = static_cast<int>(std::max<std::int64_t>(gopSize, 1));
+        /* without scene cuts the keyframes keep a fixed cadence, e.g. aligned across renditions */
+        if (settings.sceneCutThreshold.has_value() && (0 == settings.sceneCutThreshold.value())) {
+            encoderContext->keyint_min = encoderContext->gop_size;
+        }
+    }
+    if (settings.bitRate > 0) {
+        encoderContext->bit_rate = settings.bitRate;
+    }
+    if (settings.maxRate > 0) {
+        auto vbvBufferDuration = settings.vbvBufferDuration;
+        if (0 == vbvBufferDuration) {
+            vbvBufferDuration = settings.isIntraRefreshEnabled ?
+                av_rescale_q(1, encoderContext->time_base, g_microsecondTimeBase) :
+                g_defaultVbvBufferDuration;
+        }
+        encoderContext->rc_max_rate = settings.maxRate;
+        encoderContext->rc_buffer_size = static_cast<int>(std::max<std::int64_t>(
+            av_rescale(settings.maxRate, vbvBufferDuration, 1000000), 1
+        ));
+    } else if (settings.isIntraRefreshEnabled) {
+        std::cout << "{EncoderOptions::apply}; maximum rate is NOT set; "
+            "frame sizes of intra refresh are NOT capped" << std::endl;
+    }
+    if (settings.sceneCutThreshold.has_value() &&
+        !setPrivateOption(encoderContext, "sc_threshold", settings.sceneCutThreshold.value())
+    ) {
+        return false;
+    }
+    if (settings.isIntraRefreshEnabled && !setPrivateOption(encoderContext, "intra-refresh", 1)) {
+        return false;
+    }
+    /* with open GOP or intra refresh libx264 would otherwise make a forced I frame a mere recovery point */
+    if (!setPrivateOption(encoderContext, "forced-idr", 1)) {
+        return false;
+    }
+
+    std::cout << "{EncoderOptions::apply}; GOP size: '" << encoderContext->gop_size << " frames'; "
+        "scene cut threshold: '";
+    if (settings.sceneCutThreshold.has_value()) {
+        std::cout << settings.sceneCutThreshold.value();
+    } else {
+        std::cout << "default";
+    }
+    std::cout << "'; intra refresh: '" << (settings.isIntraRefreshEnabled ? "enabled" : "disabled") << "'; "
+        "bit rate: '" << encoderContext->bit_rate << "'; "
+        "maximum rate: '" << encoderContext->rc_max_rate << "'; "
+        "VBV buffer size: '" << encoderContext->rc_buffer_size << " bits'" << std::endl;
+    return true;
+}
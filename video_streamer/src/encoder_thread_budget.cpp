@@ -0,0 +1,61 @@
+#include "encoder_thread_budget.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+EncoderThreadBudget::EncoderThreadBudget() {
+    m_nTotalThreads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+bool EncoderThreadBudget::setTotalThreads(std::size_t nTotalThreads, std::size_t nExpectedEncoders) {
+    if (0 == nTotalThreads) {
+        std::cerr << "{EncoderThreadBudget::setTotalThreads}; number of threads is equal to zero" << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_nTotalThreads = nTotalThreads;
+    m_nExpectedEncoders = nExpectedEncoders;
+    std::cout << "{EncoderThreadBudget::setTotalThreads}; encoder thread budget: '" << m_nTotalThreads << "'; "
+        "expected encoders: '" << m_nExpectedEncoders << "'" << std::endl;
+    return true;
+}
+
+std::size_t EncoderThreadBudget::getTotalThreads() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nTotalThreads;
+}
+
+std::size_t EncoderThreadBudget::acquire(std::size_t nRequestedThreads) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::size_t nRemainingThreads = (m_nTotalThreads > m_nAcquiredThreads) ? (m_nTotalThreads - m_nAcquiredThreads) : 0;
+
+    /* zero means 'a fair share of the budget'; an encoder always gets at least one thread */
+    std::size_t nFairThreads = (m_nExpectedEncoders > m_nEncoders) ?
+        (nRemainingThreads / (m_nExpectedEncoders - m_nEncoders)) :
+        std::min(nRemainingThreads, m_nTotalThreads / (m_nEncoders + 1));
+    std::size_t nGrantedThreads = (0 == nRequestedThreads) ?
+        nFairThreads :
+        std::min(nRequestedThreads, nRemainingThreads);
+    if (0 == nGrantedThreads) {
+        nGrantedThreads = 1;
+        std::cout << "{EncoderThreadBudget::acquire}; encoder thread budget '" << m_nTotalThreads << "' is exhausted; "
+            "granting '1' thread" << std::endl;
+    }
+    m_nAcquiredThreads += nGrantedThreads;
+    ++m_nEncoders;
+    return nGrantedThreads;
+}
+
+void EncoderThreadBudget::release(std::size_t nThreads) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_nEncoders > 0) {
+        --m_nEncoders;
+    }
+    if (nThreads > m_nAcquiredThreads) {
+        std::cerr << "{EncoderThreadBudget::release}; number of released threads is greater than number of acquired ones" << std::endl;
+        m_nAcquiredThreads = 0;
+        return;
+    }
+    m_nAcquiredThreads -= nThreads;
+}
@@ -0,0 +1,389 @@
+#include "filter_graph_rebuilder.h"
+
+extern "C" {
+    #include <libavfilter/avfilter.h>
+    #include <libavfilter/buffersink.h>
+    #include <libavfilter/buffersrc.h>
+    #include <libavutil/error.h>
+    #include <libavutil/opt.h>
+}
+
+#include <iostream>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+#include "ptr_wrapper.h"
+#include "simple_wrapper.h"
+
+FilterGraphRebuilder::~FilterGraphRebuilder() {
+    stop();
+}
+
+bool FilterGraphRebuilder::buildGraph(const Params& params, Graph& graph) {
+    using namespace PtrWrapperSpace;
+    using namespace SimpleWrapperSpace;
+
+    if (graph.filterGraph || graph.bufferSrcContext || graph.bufferSinkContext) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; filter graph is already set" << std::endl;
+        return false;
+    }
+    if (params.bufferSrcArgs.empty()) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; buffer src argument list is empty" << std::endl;
+        return false;
+    }
+    if (params.filterDescription.empty()) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; filter description is empty" << std::endl;
+        return false;
+    }
+    if (AV_PIX_FMT_NONE == params.sinkPixelFormat) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; sink pixel format is NOT set" << std::endl;
+        return false;
+    }
+
+    bool isBuilt = false;
+    auto graphDeallocator = [&graph, &isBuilt] () {
+        if (!isBuilt) {
+            FilterGraphRebuilder::freeGraph(graph);
+        }
+    };
+    SimpleWrapper simpleWrapper(nullptr, graphDeallocator);
+
+    PtrWrapper<AVFilterInOut> outputsWrapper(
+        avfilter_inout_alloc, avfilter_inout_free
+    );
+    if (nullptr == outputsWrapper.get()) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to allocate memory for linked-list element" << std::endl;
+        return false;
+    }
+
+    PtrWrapper<AVFilterInOut> inputsWrapper(
+        avfilter_inout_alloc, avfilter_inout_free
+    );
+    if (nullptr == inputsWrapper.get()) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to allocate memory for linked-list element" << std::endl;
+        return false;
+    }
+
+    graph.filterGraph = avfilter_graph_alloc();
+    if (nullptr == graph.filterGraph) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to allocate memory for filter graph" << std::endl;
+        return false;
+    }
+    /* zero lets libavfilter pick the number of threads; filters that support
+     * it (e.g. overlay and scale) split every frame into slices */
+    graph.filterGraph->thread_type = AVFILTER_THREAD_SLICE;
+    graph.filterGraph->nb_threads = params.nThreads;
+
+    const AVFilter* bufferSrc = avfilter_get_by_name("buffer");
+    if (nullptr == bufferSrc) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to buffer src filter definition is NULL" << std::endl;
+        return false;
+    }
+
+    const AVFilter* bufferSink = avfilter_get_by_name("buffersink");
+    if (nullptr == bufferSink) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to buffer sink filter definition is NULL" << std::endl;
+        return false;
+    }
+
+    auto createResult = avfilter_graph_create_filter(
+        &graph.bufferSrcContext, bufferSrc, "in", params.bufferSrcArgs.c_str(), nullptr, graph.filterGraph
+    );
+    if (createResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to create or add input filter instance into existing graph; "
+            "create result: '" << createResult << " (" << av_err2str(createResult) << ")'" << std::endl;
+        return false;
+    }
+    if (nullptr == graph.bufferSrcContext) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to buffer src context is NULL" << std::endl;
+        return false;
+    }
+
+    createResult = avfilter_graph_create_filter(
+        &graph.bufferSinkContext, bufferSink, "out", nullptr, nullptr, graph.filterGraph
+    );
+    if (createResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to create or add output filter instance into existing graph; "
+            "create result: '" << createResult << " (" << av_err2str(createResult) << ")'" << std::endl;
+        return false;
+    }
+    if (nullptr == graph.bufferSinkContext) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to buffer sink context is NULL" << std::endl;
+        return false;
+    }
+
+    const auto& pixelFormat = params.sinkPixelFormat;
+    auto castedPtrToPixelFormat = reinterpret_cast<const uint8_t*>(
+        std::addressof(pixelFormat)
+    );
+    auto setResult = av_opt_set_bin(
+        static_cast<void*>(graph.bufferSinkContext), "pix_fmts", castedPtrToPixelFormat,
+        static_cast<int>(
+            sizeof(params.sinkPixelFormat)
+        ),
+        static_cast<int>(AV_OPT_SEARCH_CHILDREN)
+    );
+    if (setResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to set pixel format; "
+            "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+        return false;
+    }
+
+    /* Endpoints for the filter graph. */
+    outputsWrapper->name       = av_strdup("in");
+    outputsWrapper->filter_ctx = graph.bufferSrcContext;
+    outputsWrapper->pad_idx    = 0;
+    outputsWrapper->next       = nullptr;
+
+    inputsWrapper->name       = av_strdup("out");
+    inputsWrapper->filter_ctx = graph.bufferSinkContext;
+    inputsWrapper->pad_idx    = 0;
+    inputsWrapper->next       = nullptr;
+
+    if (nullptr == outputsWrapper->name) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to outputs name is NULL" << std::endl;
+        return false;
+    }
+
+    if (nullptr == inputsWrapper->name) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to inputs name is NULL" << std::endl;
+        return false;
+    }
+
+    /* the second input of the description is the watermark, when there is one */
+    AVFilterContext* overlaySrcContext = nullptr;
+    if (params.overlayFrame) {
+        if (!addOverlaySource(graph.filterGraph, params.overlayFrame.get(), overlaySrcContext)) {
+            return false;
+        }
+        outputsWrapper->next = avfilter_inout_alloc();
+        if (nullptr == outputsWrapper->next) {
+            std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to allocate memory for linked-list element" << std::endl;
+            return false;
+        }
+        outputsWrapper->next->name       = av_strdup("wm");
+        outputsWrapper->next->filter_ctx = overlaySrcContext;
+        outputsWrapper->next->pad_idx    = 0;
+        outputsWrapper->next->next       = nullptr;
+        if (nullptr == outputsWrapper->next->name) {
+            std::cerr << "{FilterGraphRebuilder::buildGraph}; pointer to overlay outputs name is NULL" << std::endl;
+            return false;
+        }
+    }
+
+    auto parseResult = avfilter_graph_parse_ptr(
+        graph.filterGraph, params.filterDescription.c_str(),
+        inputsWrapper.getAddress(), outputsWrapper.getAddress(), nullptr
+    );
+    if (parseResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; unable to parse filter description; "
+            "parse result: '" << parseResult << " (" << av_err2str(parseResult) << ")'" << std::endl;
+        return false;
+    }
+
+    auto checkResult = avfilter_graph_config(graph.filterGraph, nullptr);
+    if (checkResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::buildGraph}; filter graph is NOT valid; "
+            "check result: '" << checkResult << " (" << av_err2str(checkResult) << ")'" << std::endl;
+        return false;
+    }
+    if (overlaySrcContext && !feedOverlaySource(overlaySrcContext, params.overlayFrame.get())) {
+        return false;
+    }
+    graph.hasWatermark = (nullptr != overlaySrcContext);
+    isBuilt = true;
+    return true;
+}
+
+void FilterGraphRebuilder::freeGraph(Graph& graph) {
+    if (graph.filterGraph) {
+        avfilter_graph_free(&graph.filterGraph);
+        graph.filterGraph = nullptr;
+    }
+    graph.bufferSinkContext = nullptr;
+    graph.bufferSrcContext = nullptr;
+}
+
+bool FilterGraphRebuilder::addOverlaySource(
+    AVFilterGraph* filterGraph, const AVFrame* overlayFrame, AVFilterContext*& overlaySrcContext
+) {
+    const AVFilter* bufferSrc = avfilter_get_by_name("buffer");
+    if (nullptr == bufferSrc) {
+        std::cerr << "{FilterGraphRebuilder::addOverlaySource}; pointer to buffer src filter definition is NULL" << std::endl;
+        return false;
+    }
+
+    char overlayArgs[ 256 ] = { 0 };
+    auto printResult = snprintf(
+        overlayArgs, sizeof(overlayArgs),
+        "video_size=%dx%d:pix_fmt=%d:time_base=1/1:pixel_aspect=1/1",
+        overlayFrame->width, overlayFrame->height, overlayFrame->format
+    );
+    if (printResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::addOverlaySource}; unable to construct overlay argument list" << std::endl;
+        return false;
+    }
+
+    auto createResult = avfilter_graph_create_filter(
+        &overlaySrcContext, bufferSrc, "wm", overlayArgs, nullptr, filterGraph
+    );
+    if (createResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::addOverlaySource}; unable to create or add overlay filter instance into existing graph; "
+            "create result: '" << createResult << " (" << av_err2str(createResult) << ")'" << std::endl;
+        return false;
+    }
+    if (nullptr == overlaySrcContext) {
+        std::cerr << "{FilterGraphRebuilder::addOverlaySource}; pointer to overlay src context is NULL" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FilterGraphRebuilder::feedOverlaySource(AVFilterContext* overlaySrcContext, AVFrame* overlayFrame) {
+    /* the cached frame is shared; the graph only takes a reference to its buffers */
+    auto addResult = av_buffersrc_add_frame_flags(overlaySrcContext, overlayFrame, AV_BUFFERSRC_FLAG_KEEP_REF);
+    if (addResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::feedOverlaySource}; unable to add overlay frame; "
+            "add result: '" << addResult << " (" << av_err2str(addResult) << ")'" << std::endl;
+        return false;
+    }
+    /* overlay repeats the last frame of an input that has ended, like it did for the 'movie' source */
+    auto closeResult = av_buffersrc_close(overlaySrcContext, 0, 0);
+    if (closeResult < 0) {
+        std::cerr << "{FilterGraphRebuilder::feedOverlaySource}; unable to close overlay source; "
+            "close result: '" << closeResult << " (" << av_err2str(closeResult) << ")'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FilterGraphRebuilder::setup() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_thread.joinable()) {
+        std::cout << "{FilterGraphRebuilder::setup}; rebuild thread is already running" << std::endl;
+        return true;
+    }
+    m_isStopRequested = false;
+    try {
+        m_thread = std::thread(&FilterGraphRebuilder::run, this);
+    } catch (const std::system_error& exception) {
+        std::cerr << "{FilterGraphRebuilder::setup}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting rebuild thread; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        return false;
+    } catch (...) {
+        std::cerr << "{FilterGraphRebuilder::setup}; "
+            "unknown exception was caught while "
+            "starting rebuild thread" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FilterGraphRebuilder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = true;
+    }
+    m_condition.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pendingParams.reset();
+    for (auto& retiredGraph : m_retiredGraphs) {
+        FilterGraphRebuilder::freeGraph(retiredGraph);
+    }
+    m_retiredGraphs.clear();
+    FilterGraphRebuilder::freeGraph(m_readyGraph);
+    m_isGraphReady.store(false, std::memory_order_release);
+}
+
+bool FilterGraphRebuilder::requestRebuild(const Params& params) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable() || m_isStopRequested) {
+            std::cerr << "{FilterGraphRebuilder::requestRebuild}; rebuild thread is NOT running" << std::endl;
+            return false;
+        }
+        /* only the latest request matters; an older one that has not been started yet is dropped */
+        m_pendingParams = params;
+    }
+    m_condition.notify_one();
+    return true;
+}
+
+bool FilterGraphRebuilder::takeReadyGraph(Graph& graph) {
+    /* checked on every frame, so the common case must not touch the mutex */
+    if (!m_isGraphReady.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    graph = std::exchange(m_readyGraph, Graph{});
+    m_isGraphReady.store(false, std::memory_order_release);
+    return (nullptr != graph.filterGraph);
+}
+
+void FilterGraphRebuilder::retireGraph(Graph& graph) {
+    if (nullptr == graph.filterGraph) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_thread.joinable() && !m_isStopRequested) {
+            m_retiredGraphs.push_back(std::exchange(graph, Graph{}));
+        }
+    }
+    if (graph.filterGraph) {
+        /* rebuild thread is NOT running */
+        FilterGraphRebuilder::freeGraph(graph);
+        return;
+    }
+    m_condition.notify_one();
+}
+
+void FilterGraphRebuilder::run() {
+    while (true) {
+        std::optional<Params> params{ std::nullopt };
+        std::vector<Graph> retiredGraphs;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () {
+                return m_isStopRequested || m_pendingParams.has_value() || !m_retiredGraphs.empty();
+            });
+            if (m_isStopRequested) {
+                break;
+            }
+            std::swap(params, m_pendingParams);
+            std::swap(retiredGraphs, m_retiredGraphs);
+        }
+
+        for (auto& retiredGraph : retiredGraphs) {
+            FilterGraphRebuilder::freeGraph(retiredGraph);
+        }
+        if (!params.has_value()) {
+            continue;
+        }
+
+        Graph graph;
+        if (!FilterGraphRebuilder::buildGraph(params.value(), graph)) {
+            std::cerr << "{FilterGraphRebuilder::run}; unable to build filter graph; "
+                "filter description: '" << params.value().filterDescription << "'" << std::endl;
+            continue;
+        }
+
+        Graph replacedGraph;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            /* a graph that was built but never taken is replaced by the newer one */
+            replacedGraph = std::exchange(m_readyGraph, graph);
+            m_isGraphReady.store(true, std::memory_order_release);
+        }
+        FilterGraphRebuilder::freeGraph(replacedGraph);
+        std::cout << "{FilterGraphRebuilder::run}; filter graph has been successfully built; "
+            "filter description: '" << params.value().filterDescription << "'" << std::endl;
+    }
+}
@@ -0,0 +1,61 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+void LatencyHistogram::record(std::int64_t latency) {
+    auto value = static_cast<std::uint64_t>(std::max<std::int64_t>(latency, 0));
+    m_buckets[ getBucketIndex(value) ].fetch_add(1, std::memory_order_relaxed);
+    auto max = m_max.load(std::memory_order_relaxed);
+    while ((value > max) && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+    /* counted last, so a reader never sees more samples than the buckets hold */
+    m_count.fetch_add(1, std::memory_order_release);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::getPercentile(double fraction) const {
+    auto count = m_count.load(std::memory_order_acquire);
+    if (0 == count) {
+        return 0;
+    }
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(count)));
+    rank = std::clamp<std::uint64_t>(rank, 1, count);
+
+    std::uint64_t cumulativeCount = 0;
+    for (std::size_t i = 0; i < s_nBuckets; ++i) {
+        cumulativeCount += m_buckets[ i ].load(std::memory_order_relaxed);
+        if (cumulativeCount >= rank) {
+            /* the last bucket also holds the clamped latencies */
+            return (i + 1 < s_nBuckets) ? std::min(getBucketLowerBound(i + 1) - 1, getMax()) : getMax();
+        }
+    }
+    return getMax();
+}
+
+std::size_t LatencyHistogram::getBucketIndex(std::uint64_t value) {
+    if (value < s_nSubBuckets) {
+        return static_cast<std::size_t>(value);
+    }
+    value = std::min(value, (std::uint64_t{ 2 } << s_maxExponent) - 1);
+    auto exponent = static_cast<int>(std::bit_width(value)) - 1;
+    auto subBucket = (value >> (exponent - s_subBucketBits)) & (s_nSubBuckets - 1);
+    return static_cast<std::size_t>((exponent - s_subBucketBits + 1) * s_nSubBuckets) + static_cast<std::size_t>(subBucket);
+}
+
+std::uint64_t LatencyHistogram::getBucketLowerBound(std::size_t index) {
+    if (index < s_nSubBuckets) {
+        return static_cast<std::uint64_t>(index);
+    }
+    auto exponent = static_cast<int>(index / s_nSubBuckets) + s_subBucketBits - 1;
+    auto subBucket = static_cast<std::uint64_t>(index % s_nSubBuckets);
+    return (s_nSubBuckets + subBucket) << (exponent - s_subBucketBits);
+}
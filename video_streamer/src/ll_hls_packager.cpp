@@ -0,0 +1,386 @@
+#include "ll_hls_packager.h"
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavcodec/packet.h>
+    #include <libavformat/avformat.h>
+    #include <libavformat/avio.h>
+    #include <libavutil/dict.h>
+    #include <libavutil/error.h>
+    #include <libavutil/mathematics.h>
+    #include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <new>
+#include <system_error>
+
+namespace {
+    constexpr std::size_t g_ioBufferSize = 64 * 1024;
+    /* a fragment is written only when a part is cut; moov without samples, tfdt in every moof */
+    constexpr const char* g_movFlags = "cmaf+frag_custom+empty_moov+default_base_moof+skip_trailer";
+}
+
+LlHlsPackager::~LlHlsPackager() {
+    stop();
+}
+
+bool LlHlsPackager::setup(
+    const Settings& settings, const AVCodecParameters* codecParameters,
+    AVRational timeBase, std::shared_ptr<SegmentStore> segmentStore, StreamMetrics* metrics
+) {
+    if (m_thread.joinable()) {
+        std::cerr << "{LlHlsPackager::setup}; packager thread is already running" << std::endl;
+        return false;
+    }
+    if (nullptr == codecParameters) {
+        std::cerr << "{LlHlsPackager::setup}; pointer to codec parameters is NULL" << std::endl;
+        return false;
+    }
+    /* the init segment is published right after the header, which needs the parameter sets */
+    if (codecParameters->extradata_size <= 0) {
+        std::cerr << "{LlHlsPackager::setup}; codec parameters have NO extradata" << std::endl;
+        return false;
+    }
+    if (nullptr == segmentStore) {
+        std::cerr << "{LlHlsPackager::setup}; pointer to segment store is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{LlHlsPackager::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if ((timeBase.num <= 0) || (timeBase.den <= 0)) {
+        std::cerr << "{LlHlsPackager::setup}; time base is NOT valid" << std::endl;
+        return false;
+    }
+    if ((settings.segmentDuration <= 0) || (settings.partDuration <= 0)) {
+        std::cerr << "{LlHlsPackager::setup}; segment or part duration is NOT positive" << std::endl;
+        return false;
+    }
+    if (0 == settings.queueCapacity) {
+        std::cerr << "{LlHlsPackager::setup}; queue capacity is equal to zero" << std::endl;
+        return false;
+    }
+
+    m_codecParameters = avcodec_parameters_alloc();
+    if (nullptr == m_codecParameters) {
+        std::cerr << "{LlHlsPackager::setup}; unable to allocate memory for codec parameters" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_copy(m_codecParameters, codecParameters);
+    if (copyResult < 0) {
+        std::cerr << "{LlHlsPackager::setup}; unable to copy codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+
+    m_settings = settings;
+    m_timeBase = timeBase;
+    m_segmentStore = segmentStore;
+    m_metrics = metrics;
+    m_isSegmentOpen = false;
+    m_nPartPackets = 0;
+    m_pendingBytes.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isWaitingForKeyframe = true;
+        m_isStopRequested = false;
+    }
+
+    /* the init segment is published before the first packet arrives */
+    if (!openMuxer()) {
+        closeMuxer();
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+
+    try {
+        m_thread = std::thread(&LlHlsPackager::run, this);
+    } catch (const std::system_error& exception) {
+        std::cerr << "{LlHlsPackager::setup}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting packager thread; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        closeMuxer();
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    } catch (...) {
+        std::cerr << "{LlHlsPackager::setup}; "
+            "unknown exception was caught while "
+            "starting packager thread" << std::endl;
+        closeMuxer();
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+    std::cout << "{LlHlsPackager::setup}; LL-HLS packaging has been successfully started" << std::endl;
+    return true;
+}
+
+void LlHlsPackager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = true;
+    }
+    m_condition.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& queuedPacket : m_queuedPackets) {
+        av_packet_free(&queuedPacket.packet);
+    }
+    m_queuedPackets.clear();
+    if (m_codecParameters) {
+        avcodec_parameters_free(&m_codecParameters);
+        m_codecParameters = nullptr;
+    }
+    m_segmentStore.reset();
+    m_metrics = nullptr;
+}
+
+void LlHlsPackager::push(const AVPacket* packet) {
+    if (nullptr == packet) {
+        return;
+    }
+    bool isKeyframe = (AV_PKT_FLAG_KEY & packet->flags);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable() || m_isStopRequested) {
+        return;
+    }
+    if (m_isWaitingForKeyframe && !isKeyframe) {
+        m_metrics->add(StreamMetrics::Metric::LlHlsDroppedPackets);
+        return;
+    }
+    if (m_queuedPackets.size() >= m_settings.queueCapacity) {
+        /* the rest of the GOP can NOT be decoded without this packet */
+        m_isWaitingForKeyframe = true;
+        m_metrics->add(StreamMetrics::Metric::LlHlsDroppedPackets);
+        return;
+    }
+
+    AVPacket* queuedPacket = av_packet_clone(packet);
+    if (nullptr == queuedPacket) {
+        std::cerr << "{LlHlsPackager::push}; unable to clone packet" << std::endl;
+        m_isWaitingForKeyframe = true;
+        m_metrics->add(StreamMetrics::Metric::LlHlsDroppedPackets);
+        return;
+    }
+    m_queuedPackets.push_back(QueuedPacket{
+        .packet = queuedPacket, .isDiscontinuity = m_isWaitingForKeyframe
+    });
+    m_isWaitingForKeyframe = false;
+    lock.unlock();
+    m_condition.notify_one();
+}
+
+int LlHlsPackager::onProxyWrite(void* packagerPtr, const std::uint8_t* buffer, int size) {
+    if ((nullptr == packagerPtr) || (nullptr == buffer) || (size < 0)) {
+        return AVERROR(EINVAL);
+    }
+    auto packager = static_cast<LlHlsPackager*>(packagerPtr);
+    try {
+        packager->m_pendingBytes.append(reinterpret_cast<const char*>(buffer), static_cast<std::size_t>(size));
+    } catch (const std::bad_alloc&) {
+        return AVERROR(ENOMEM);
+    }
+    return size;
+}
+
+bool LlHlsPackager::openMuxer() {
+    auto allocationResult = avformat_alloc_output_context2(&m_muxerContext, nullptr, "mp4", nullptr);
+    if ((allocationResult < 0) || (nullptr == m_muxerContext)) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to allocate muxer context; "
+            "allocation result: '" << allocationResult << " (" << av_err2str(allocationResult) << ")'" << std::endl;
+        return false;
+    }
+
+    AVStream* muxerStream = avformat_new_stream(m_muxerContext, nullptr);
+    if (nullptr == muxerStream) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to add new stream" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_copy(muxerStream->codecpar, m_codecParameters);
+    if (copyResult < 0) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to copy codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        return false;
+    }
+    /* the tag of the live container (FLV) means nothing to MP4 */
+    muxerStream->codecpar->codec_tag = 0;
+    muxerStream->time_base = m_timeBase;
+
+    auto ioBuffer = static_cast<unsigned char*>(av_malloc(g_ioBufferSize));
+    if (nullptr == ioBuffer) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to allocate memory for I/O buffer" << std::endl;
+        return false;
+    }
+    /* NOT seekable, so the muxer writes strictly sequentially */
+    m_muxerIoContext = avio_alloc_context(
+        ioBuffer, static_cast<int>(g_ioBufferSize), 1,
+        static_cast<void*>(this), nullptr, &LlHlsPackager::onProxyWrite, nullptr
+    );
+    if (nullptr == m_muxerIoContext) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to allocate I/O context" << std::endl;
+        av_free(ioBuffer);
+        return false;
+    }
+    m_muxerContext->pb = m_muxerIoContext;
+    m_muxerContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    AVDictionary* options = nullptr;
+    auto setResult = av_dict_set(&options, "movflags", g_movFlags, 0);
+    if (setResult < 0) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to set key-value pair; "
+            "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+        return false;
+    }
+    auto writeResult = avformat_write_header(m_muxerContext, &options);
+    av_dict_free(&options);
+    if (writeResult < 0) {
+        std::cerr << "{LlHlsPackager::openMuxer}; unable to write header; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        return false;
+    }
+    avio_flush(m_muxerIoContext);
+    m_segmentStore->setInitSegment(std::move(m_pendingBytes));
+    m_pendingBytes.clear();
+    return true;
+}
+
+void LlHlsPackager::closeMuxer() {
+    if (m_muxerContext) {
+        avformat_free_context(m_muxerContext);
+        m_muxerContext = nullptr;
+    }
+    if (m_muxerIoContext) {
+        av_freep(&m_muxerIoContext->buffer);
+        avio_context_free(&m_muxerIoContext);
+        m_muxerIoContext = nullptr;
+    }
+    m_pendingBytes.clear();
+}
+
+bool LlHlsPackager::writePacket(AVPacket* packet, bool isDiscontinuity) {
+    auto timestamp = (AV_NOPTS_VALUE != packet->dts) ? packet->dts : packet->pts;
+    if (AV_NOPTS_VALUE == timestamp) {
+        std::cerr << "{LlHlsPackager::writePacket}; packet has no timestamp" << std::endl;
+        return true;
+    }
+    bool isKeyframe = (AV_PKT_FLAG_KEY & packet->flags);
+    auto packetEndTimestamp = timestamp + std::max<std::int64_t>(packet->duration, 0);
+
+    if (m_isSegmentOpen) {
+        auto segmentDuration = av_rescale_q(timestamp - m_segmentStartTimestamp, m_timeBase, AV_TIME_BASE_Q);
+        auto partDuration = av_rescale_q(packetEndTimestamp - m_partStartTimestamp, m_timeBase, AV_TIME_BASE_Q);
+        if (isDiscontinuity || (isKeyframe && (segmentDuration >= m_settings.segmentDuration))) {
+            if (!flushPart()) {
+                return false;
+            }
+            endSegment();
+        } else if ((m_nPartPackets > 0) && (partDuration > m_settings.partDuration)) {
+            /* a part must NOT be longer than the part target of the playlist */
+            if (!flushPart()) {
+                return false;
+            }
+        }
+    }
+    if (!m_isSegmentOpen) {
+        if (!isKeyframe) {
+            return true;
+        }
+        m_segmentStore->beginSegment(isDiscontinuity);
+        m_isSegmentOpen = true;
+        m_segmentStartTimestamp = timestamp;
+    }
+    if (0 == m_nPartPackets) {
+        m_partStartTimestamp = timestamp;
+        m_partEndTimestamp = timestamp;
+        m_isPartIndependent = isKeyframe;
+    }
+    m_partEndTimestamp = std::max(m_partEndTimestamp, packetEndTimestamp);
+
+    packet->stream_index = 0;
+    packet->pos = -1;
+    av_packet_rescale_ts(packet, m_timeBase, m_muxerContext->streams[0]->time_base);
+    auto writeResult = av_write_frame(m_muxerContext, packet);
+    if (writeResult < 0) {
+        std::cerr << "{LlHlsPackager::writePacket}; unable to write packet to muxer; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        return false;
+    }
+    ++m_nPartPackets;
+    return true;
+}
+
+bool LlHlsPackager::flushPart() {
+    if (0 == m_nPartPackets) {
+        return true;
+    }
+    /* NULL makes the muxer write the fragment of the packets so far */
+    auto flushResult = av_write_frame(m_muxerContext, nullptr);
+    if (flushResult < 0) {
+        std::cerr << "{LlHlsPackager::flushPart}; unable to flush fragment; "
+            "flush result: '" << flushResult << " (" << av_err2str(flushResult) << ")'" << std::endl;
+        return false;
+    }
+    avio_flush(m_muxerIoContext);
+
+    auto partDuration = av_rescale_q(m_partEndTimestamp - m_partStartTimestamp, m_timeBase, AV_TIME_BASE_Q);
+    m_segmentStore->addPart(std::move(m_pendingBytes), partDuration, m_isPartIndependent);
+    m_pendingBytes.clear();
+    m_nPartPackets = 0;
+    m_metrics->add(StreamMetrics::Metric::LlHlsParts);
+    return true;
+}
+
+void LlHlsPackager::endSegment() {
+    if (!m_isSegmentOpen) {
+        return;
+    }
+    m_segmentStore->endSegment();
+    m_isSegmentOpen = false;
+    m_metrics->add(StreamMetrics::Metric::LlHlsSegments);
+}
+
+void LlHlsPackager::run() {
+    bool isFailed = false;
+    while (true) {
+        QueuedPacket queuedPacket;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () {
+                return m_isStopRequested || !m_queuedPackets.empty();
+            });
+            if (m_queuedPackets.empty()) {
+                break;
+            }
+            queuedPacket = m_queuedPackets.front();
+            m_queuedPackets.pop_front();
+        }
+
+        isFailed = !writePacket(queuedPacket.packet, queuedPacket.isDiscontinuity);
+        av_packet_free(&queuedPacket.packet);
+        if (isFailed) {
+            /* the muxer state is unknown; viewers get the end of the playlist, the live stream is NOT affected */
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopRequested = true;
+            break;
+        }
+    }
+
+    if (!isFailed && flushPart()) {
+        endSegment();
+    }
+    if (m_muxerContext) {
+        av_write_trailer(m_muxerContext);
+    }
+    closeMuxer();
+    m_segmentStore->close();
+    std::cout << "{LlHlsPackager::run}; LL-HLS packaging has been stopped" << std::endl;
+}
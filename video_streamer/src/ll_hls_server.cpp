@@ -0,0 +1,232 @@
+#include "ll_hls_server.h"
+
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+#include <Poco/Exception.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPResponse.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/URI.h>
+
+namespace {
+    constexpr int g_minThreads = 2;
+    constexpr int g_maxQueuedConnections = 64;
+    constexpr const char* g_playlistContentType = "application/vnd.apple.mpegurl";
+    constexpr const char* g_mediaContentType = "video/mp4";
+    /* parts and segments never change once they are published */
+    constexpr const char* g_mediaCacheControl = "max-age=60";
+
+    Poco::Net::HTTPResponse::HTTPStatus getHttpStatus(SegmentStore::Status status) {
+        switch (status) {
+            case SegmentStore::Status::Ok: return Poco::Net::HTTPResponse::HTTP_OK;
+            case SegmentStore::Status::NotFound: return Poco::Net::HTTPResponse::HTTP_NOT_FOUND;
+            case SegmentStore::Status::BadRequest: return Poco::Net::HTTPResponse::HTTP_BAD_REQUEST;
+            case SegmentStore::Status::Unavailable: return Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE;
+        }
+        return Poco::Net::HTTPResponse::HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    bool parseUnsigned(const std::string& value, std::uint64_t& number) {
+        if (value.empty() || (std::string::npos != value.find_first_not_of("0123456789"))) {
+            return false;
+        }
+        try {
+            number = std::stoull(value);
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+        return true;
+    }
+
+    class RequestHandler : public Poco::Net::HTTPRequestHandler {
+    public:
+        RequestHandler(std::shared_ptr<SegmentStore> segmentStore, StreamMetrics* metrics):
+            m_segmentStore(std::move(segmentStore)), m_metrics(metrics) {}
+
+        void handleRequest(Poco::Net::HTTPServerRequest& request, Poco::Net::HTTPServerResponse& response) override {
+            m_metrics->add(StreamMetrics::Metric::LlHlsRequests);
+            /* players of web pages fetch from another origin */
+            response.set("Access-Control-Allow-Origin", "*");
+
+            bool isHead = (Poco::Net::HTTPRequest::HTTP_HEAD == request.getMethod());
+            if (!isHead && (Poco::Net::HTTPRequest::HTTP_GET != request.getMethod())) {
+                sendStatus(response, Poco::Net::HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+                return;
+            }
+
+            std::string path;
+            Poco::URI::QueryParameters queryParameters;
+            try {
+                Poco::URI uri(request.getURI());
+                path = uri.getPath();
+                queryParameters = uri.getQueryParameters();
+            } catch (const Poco::SyntaxException&) {
+                sendStatus(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+                return;
+            }
+            /* all files of the stream are at the root, the playlist refers to them by name */
+            if (path.empty() || ('/' != path.front()) || (std::string::npos != path.find('/', 1))) {
+                sendStatus(response, Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
+                return;
+            }
+            auto name = path.substr(1);
+
+            if (SegmentStore::s_playlistName == name) {
+                std::optional<std::uint64_t> sequence{ std::nullopt };
+                std::optional<std::size_t> partIndex{ std::nullopt };
+                for (const auto& [key, value] : queryParameters) {
+                    std::uint64_t number = 0;
+                    if (("_HLS_msn" == key) || ("_HLS_part" == key)) {
+                        if (!parseUnsigned(value, number)) {
+                            sendStatus(response, Poco::Net::HTTPResponse::HTTP_BAD_REQUEST);
+                            return;
+                        }
+                        if ("_HLS_msn" == key) {
+                            sequence = number;
+                        } else {
+                            partIndex = static_cast<std::size_t>(number);
+                        }
+                    }
+                }
+                std::string playlist;
+                auto status = m_segmentStore->getPlaylist(sequence, partIndex, playlist);
+                if (SegmentStore::Status::Ok != status) {
+                    sendStatus(response, getHttpStatus(status));
+                    return;
+                }
+                response.set("Cache-Control", "no-cache");
+                sendData(response, g_playlistContentType, playlist.data(), playlist.size(), isHead);
+                return;
+            }
+
+            SegmentStore::Data data;
+            auto status = m_segmentStore->getFile(name, data);
+            if (SegmentStore::Status::Ok != status) {
+                sendStatus(response, getHttpStatus(status));
+                return;
+            }
+            response.set("Cache-Control", g_mediaCacheControl);
+            sendData(response, g_mediaContentType, data->data(), data->size(), isHead);
+        }
+
+    private:
+        static void sendStatus(Poco::Net::HTTPServerResponse& response, Poco::Net::HTTPResponse::HTTPStatus status) {
+            response.setStatusAndReason(status);
+            response.setContentLength(0);
+            response.send();
+        }
+
+        static void sendData(
+            Poco::Net::HTTPServerResponse& response, const char* contentType,
+            const char* data, std::size_t size, bool isHead
+        ) {
+            response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_OK);
+            response.setContentType(contentType);
+            response.setContentLength(static_cast<std::streamsize>(size));
+            if (isHead) {
+                response.send();
+                return;
+            }
+            response.sendBuffer(data, size);
+        }
+
+    private:
+        std::shared_ptr<SegmentStore> m_segmentStore{ nullptr };
+        StreamMetrics* m_metrics = nullptr;
+    };
+
+    class RequestHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+    public:
+        RequestHandlerFactory(std::shared_ptr<SegmentStore> segmentStore, StreamMetrics* metrics):
+            m_segmentStore(std::move(segmentStore)), m_metrics(metrics) {}
+
+        Poco::Net::HTTPRequestHandler* createRequestHandler(const Poco::Net::HTTPServerRequest&) override {
+            return new RequestHandler(m_segmentStore, m_metrics);
+        }
+
+    private:
+        std::shared_ptr<SegmentStore> m_segmentStore{ nullptr };
+        StreamMetrics* m_metrics = nullptr;
+    };
+}
+
+LlHlsServer::LlHlsServer() = default;
+
+LlHlsServer::~LlHlsServer() {
+    stop();
+}
+
+bool LlHlsServer::start(const Settings& settings, std::shared_ptr<SegmentStore> segmentStore, StreamMetrics* metrics) {
+    if (m_server) {
+        std::cerr << "{LlHlsServer::start}; server is already running" << std::endl;
+        return false;
+    }
+    if (nullptr == segmentStore) {
+        std::cerr << "{LlHlsServer::start}; pointer to segment store is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{LlHlsServer::start}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if (static_cast<int>(settings.maxThreads) < g_minThreads) {
+        std::cerr << "{LlHlsServer::start}; maximum number of threads is less than " << g_minThreads << std::endl;
+        return false;
+    }
+
+    try {
+        Poco::Net::ServerSocket serverSocket(Poco::Net::SocketAddress(settings.address, settings.port));
+        Poco::Net::HTTPServerParams::Ptr serverParams(new Poco::Net::HTTPServerParams());
+        serverParams->setMaxThreads(static_cast<int>(settings.maxThreads));
+        serverParams->setMaxQueued(g_maxQueuedConnections);
+        serverParams->setKeepAlive(true);
+
+        m_threadPool = std::make_unique<Poco::ThreadPool>(g_minThreads, static_cast<int>(settings.maxThreads));
+        m_server = std::make_unique<Poco::Net::HTTPServer>(
+            Poco::Net::HTTPRequestHandlerFactory::Ptr(new RequestHandlerFactory(segmentStore, metrics)),
+            *m_threadPool, serverSocket, serverParams
+        );
+        m_server->start();
+    } catch (const Poco::Exception& exception) {
+        std::cerr << "{LlHlsServer::start}; "
+            "exception 'Poco::Exception' was successfully caught while "
+            "starting server; "
+            "exception code: '" << exception.code() << "'; "
+            "exception description: '" << exception.displayText() << "'" << std::endl;
+        m_server.reset();
+        m_threadPool.reset();
+        return false;
+    } catch (...) {
+        std::cerr << "{LlHlsServer::start}; "
+            "unknown exception was caught while "
+            "starting server" << std::endl;
+        m_server.reset();
+        m_threadPool.reset();
+        return false;
+    }
+    std::cout << "{LlHlsServer::start}; LL-HLS server has been successfully started; "
+        "address: '" << settings.address << ":" << settings.port << "'; "
+        "playlist: '/" << SegmentStore::s_playlistName << "'" << std::endl;
+    return true;
+}
+
+void LlHlsServer::stop() {
+    if (m_server) {
+        /* connections that are still sending are closed */
+        m_server->stopAll(true);
+        m_server.reset();
+    }
+    if (m_threadPool) {
+        m_threadPool->joinAll();
+        m_threadPool.reset();
+    }
+}
@@ -39,6 +39,12 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdlib.h> /* allocations */
 #endif /* LODEPNG_COMPILE_ALLOCATORS */
 
+#if defined(__SSE2__)
+#include <emmintrin.h> /* vectorized unfilters */
+#include <string.h> /* unaligned pixel loads */
+#define LODEPNG_UNFILTER_SSE2
+#endif /* __SSE2__ */
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -402,6 +408,16 @@ unsigned lodepng_save_file(const unsigned char* buffer, size_t buffersize, const
 
 #endif /*LODEPNG_COMPILE_DISK*/
 
+#ifdef LODEPNG_COMPILE_DECODER
+/*Receives the inflated data while the inflater is still running, so that scanlines are unfiltered while they
+are in the cache. consume is called once the inflated data has reached next_size bytes, with all of it, and once
+more when inflating is done. It must NOT change the data: the inflater copies its back references from there.*/
+typedef struct ScanlineSink {
+  unsigned (*consume)(struct ScanlineSink* sink, const unsigned char* data, size_t size);
+  size_t next_size;
+} ScanlineSink;
+#endif /*LODEPNG_COMPILE_DECODER*/
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
 /* // End of common code and tools. Begin of Zlib related code.            // */
@@ -1234,16 +1250,29 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
+/*output size at which the loop of inflateHuffmanBlock has to grow the buffer, fails on the maximum output size
+or calls the sink*/
+static size_t getInflateCheckSize(const ucvector* out, size_t reserved_size, size_t max_output_size,
+                                  const ScanlineSink* sink) {
+  size_t check_size = out->allocsize - reserved_size + 1u;
+  if(max_output_size && max_output_size + 1u < check_size) check_size = max_output_size + 1u;
+  if(sink && sink->next_size < check_size) check_size = sink->next_size;
+  return check_size;
+}
+
 /*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
 static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
-                                    unsigned btype, size_t max_output_size) {
+                                    unsigned btype, size_t max_output_size, ScanlineSink* sink) {
   unsigned error = 0;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
   const size_t reserved_size = 260; /* must be at least 258 for max length, and a few extra for adding a few extra literals */
   int done = 0;
+  size_t check_size;
 
   if(!ucvector_reserve(out, out->size + reserved_size)) return 83; /*alloc fail*/
+  /*the loop compares the output size against this one value per symbol*/
+  check_size = getInflateCheckSize(out, reserved_size, max_output_size, sink);
 
   HuffmanTree_init(&tree_ll);
   HuffmanTree_init(&tree_d);
@@ -1322,8 +1351,18 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
     } else /*if(code_ll == INVALIDSYMBOL)*/ {
       ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
     }
-    if(out->allocsize - out->size < reserved_size) {
-      if(!ucvector_reserve(out, out->size + reserved_size)) ERROR_BREAK(83); /*alloc fail*/
+    if(out->size >= check_size) {
+      if(out->allocsize - out->size < reserved_size) {
+        if(!ucvector_reserve(out, out->size + reserved_size)) ERROR_BREAK(83); /*alloc fail*/
+      }
+      if(max_output_size && out->size > max_output_size) {
+        ERROR_BREAK(109); /*error, larger than max size*/
+      }
+      if(sink && out->size >= sink->next_size) {
+        error = sink->consume(sink, out->data, out->size);
+        if(error) break;
+      }
+      check_size = getInflateCheckSize(out, reserved_size, max_output_size, sink);
     }
     /*check if any of the ensureBits above went out of bounds*/
     if(reader->bp > reader->bitsize) {
@@ -1332,9 +1371,6 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
       /* TODO: revise error codes 10,11,50: the above comment is no longer valid */
       ERROR_BREAK(51); /*error, bit pointer jumps past memory*/
     }
-    if(max_output_size && out->size > max_output_size) {
-      ERROR_BREAK(109); /*error, larger than max size*/
-    }
   }
 
   HuffmanTree_cleanup(&tree_ll);
@@ -1380,7 +1416,7 @@ static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader,
 
 static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
-                                 const LodePNGDecompressSettings* settings) {
+                                 const LodePNGDecompressSettings* settings, ScanlineSink* sink) {
   unsigned BFINAL = 0;
   LodePNGBitReader reader;
   unsigned error = LodePNGBitReader_init(&reader, in, insize);
@@ -1396,8 +1432,10 @@ static unsigned lodepng_inflatev(ucvector* out,
 
     if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
     else if(BTYPE == 0) error = inflateNoCompression(out, &reader, settings); /*no compression*/
-    else error = inflateHuffmanBlock(out, &reader, BTYPE, settings->max_output_size); /*compression, BTYPE 01 or 10*/
+    else error = inflateHuffmanBlock(out, &reader, BTYPE, settings->max_output_size, sink); /*compression, BTYPE 01 or 10*/
     if(!error && settings->max_output_size && out->size > settings->max_output_size) error = 109;
+    /*a stored block is handed on as a whole*/
+    if(!error && sink && out->size >= sink->next_size) error = sink->consume(sink, out->data, out->size);
     if(error) break;
   }
 
@@ -1408,14 +1446,15 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGDecompressSettings* settings) {
   ucvector v = ucvector_init(*out, *outsize);
-  unsigned error = lodepng_inflatev(&v, in, insize, settings);
+  unsigned error = lodepng_inflatev(&v, in, insize, settings, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
 }
 
+/*a custom inflate gets no sink, its output is handed on when it is done*/
 static unsigned inflatev(ucvector* out, const unsigned char* in, size_t insize,
-                        const LodePNGDecompressSettings* settings) {
+                        const LodePNGDecompressSettings* settings, ScanlineSink* sink) {
   if(settings->custom_inflate) {
     unsigned error = settings->custom_inflate(&out->data, &out->size, in, insize, settings);
     out->allocsize = out->size;
@@ -1427,7 +1466,7 @@ static unsigned inflatev(ucvector* out, const unsigned char* in, size_t insize,
     }
     return error;
   } else {
-    return lodepng_inflatev(out, in, insize, settings);
+    return lodepng_inflatev(out, in, insize, settings, sink);
   }
 }
 
@@ -2167,7 +2206,7 @@ static unsigned adler32(const unsigned char* data, unsigned len) {
 
 static unsigned lodepng_zlib_decompressv(ucvector* out,
                                          const unsigned char* in, size_t insize,
-                                         const LodePNGDecompressSettings* settings) {
+                                         const LodePNGDecompressSettings* settings, ScanlineSink* sink) {
   unsigned error = 0;
   unsigned CM, CINFO, FDICT;
 
@@ -2194,7 +2233,7 @@ static unsigned lodepng_zlib_decompressv(ucvector* out,
     return 26;
   }
 
-  error = inflatev(out, in + 2, insize - 2, settings);
+  error = inflatev(out, in + 2, insize - 2, settings, sink);
   if(error) return error;
 
   if(!settings->ignore_adler32) {
@@ -2210,15 +2249,17 @@ static unsigned lodepng_zlib_decompressv(ucvector* out,
 unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
                                  size_t insize, const LodePNGDecompressSettings* settings) {
   ucvector v = ucvector_init(*out, *outsize);
-  unsigned error = lodepng_zlib_decompressv(&v, in, insize, settings);
+  unsigned error = lodepng_zlib_decompressv(&v, in, insize, settings, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
 }
 
-/*expected_size is expected output size, to avoid intermediate allocations. Set to 0 if not known. */
+/*expected_size is expected output size, to avoid intermediate allocations. Set to 0 if not known.
+sink may be NULL; it gets the remaining data once more at the end. */
 static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t expected_size,
-                                const unsigned char* in, size_t insize, const LodePNGDecompressSettings* settings) {
+                                const unsigned char* in, size_t insize, const LodePNGDecompressSettings* settings,
+                                ScanlineSink* sink) {
   unsigned error;
   if(settings->custom_zlib) {
     error = settings->custom_zlib(out, outsize, in, insize, settings);
@@ -2235,10 +2276,11 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t exp
       ucvector_resize(&v, *outsize + expected_size);
       v.size = *outsize;
     }
-    error = lodepng_zlib_decompressv(&v, in, insize, settings);
+    error = lodepng_zlib_decompressv(&v, in, insize, settings, sink);
     *out = v.data;
     *outsize = v.size;
   }
+  if(!error && sink) error = sink->consume(sink, *out, *outsize);
   return error;
 }
 
@@ -2301,10 +2343,14 @@ static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsign
 
 #ifdef LODEPNG_COMPILE_DECODER
 static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t expected_size,
-                                const unsigned char* in, size_t insize, const LodePNGDecompressSettings* settings) {
+                                const unsigned char* in, size_t insize, const LodePNGDecompressSettings* settings,
+                                ScanlineSink* sink) {
+  unsigned error;
   if(!settings->custom_zlib) return 87; /*no custom zlib function provided */
   (void)expected_size;
-  return settings->custom_zlib(out, outsize, in, insize, settings);
+  error = settings->custom_zlib(out, outsize, in, insize, settings);
+  if(!error && sink) error = sink->consume(sink, *out, *outsize);
+  return error;
 }
 #endif /*LODEPNG_COMPILE_DECODER*/
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -4377,6 +4423,94 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_UNFILTER_SSE2
+/*
+SSE2 versions of the Sub, Avg and Paeth filters for 4 bytes per pixel (8-bit RGBA, the usual overlay format),
+and of Up for any pixel size. Each pixel depends on its left neighbour, so Sub, Avg and Paeth work on one pixel
+per step with all channels in one register, the way libpng does it. With 3 bytes per pixel the partial loads
+and stores cost more than they save, so RGB keeps the scalar filters.
+*/
+static inline __m128i loadPixelSSE2(const unsigned char* p) {
+  int value;
+  memcpy(&value, p, 4);
+  return _mm_cvtsi32_si128(value);
+}
+
+static inline void storePixelSSE2(unsigned char* p, __m128i v) {
+  int value = _mm_cvtsi128_si32(v);
+  memcpy(p, &value, 4);
+}
+
+static size_t unfilterUpSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                             size_t length) {
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(scanline + i));
+    __m128i p = _mm_loadu_si128((const __m128i*)(precon + i));
+    _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(s, p));
+  }
+  return i;
+}
+
+static inline void unfilterSubSSE2(unsigned char* recon, const unsigned char* scanline, size_t length) {
+  size_t i;
+  __m128i a = _mm_setzero_si128();
+  for(i = 0; i != length; i += 4) {
+    a = _mm_add_epi8(a, loadPixelSSE2(scanline + i));
+    storePixelSSE2(recon + i, a);
+  }
+}
+
+static inline void unfilterAvgSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                   size_t length) {
+  size_t i;
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128();
+  for(i = 0; i != length; i += 4) {
+    __m128i b = loadPixelSSE2(precon + i);
+    /*_mm_avg_epu8 rounds up, the filter rounds down*/
+    __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+    a = _mm_add_epi8(loadPixelSSE2(scanline + i), average);
+    storePixelSSE2(recon + i, a);
+  }
+}
+
+static inline __m128i absSSE2(__m128i x) {
+  return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static inline __m128i selectSSE2(__m128i mask, __m128i ifTrue, __m128i ifFalse) {
+  return _mm_or_si128(_mm_and_si128(mask, ifTrue), _mm_andnot_si128(mask, ifFalse));
+}
+
+static inline void unfilterPaethSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                     size_t length) {
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  /*channels are widened to 16 bits, the predictor needs the sign*/
+  __m128i a = zero, c = zero;
+  for(i = 0; i != length; i += 4) {
+    __m128i b = _mm_unpacklo_epi8(loadPixelSSE2(precon + i), zero);
+    __m128i d = _mm_unpacklo_epi8(loadPixelSSE2(scanline + i), zero);
+    __m128i pa = _mm_sub_epi16(b, c);
+    __m128i pb = _mm_sub_epi16(a, c);
+    __m128i pc = absSSE2(_mm_add_epi16(pa, pb));
+    __m128i smallest;
+    __m128i nearest;
+    pa = absSSE2(pa);
+    pb = absSSE2(pb);
+    smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    /*same priority as paethPredictor: a, then b, then c*/
+    nearest = selectSSE2(_mm_cmpeq_epi16(pb, smallest), b, c);
+    nearest = selectSSE2(_mm_cmpeq_epi16(pa, smallest), a, nearest);
+    d = _mm_and_si128(_mm_add_epi16(d, nearest), _mm_set1_epi16(0xFF));
+    storePixelSSE2(recon + i, _mm_packus_epi16(d, d));
+    c = b;
+    a = d;
+  }
+}
+#endif /*LODEPNG_UNFILTER_SSE2*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length) {
   /*
@@ -4389,6 +4523,20 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_UNFILTER_SSE2
+  if(bytewidth == 4 && length % 4 == 0) {
+    if(filterType == 1) {
+      unfilterSubSSE2(recon, scanline, length);
+      return 0;
+    } else if(filterType == 3 && precon) {
+      unfilterAvgSSE2(recon, scanline, precon, length);
+      return 0;
+    } else if(filterType == 4 && precon) {
+      unfilterPaethSSE2(recon, scanline, precon, length);
+      return 0;
+    }
+  }
+#endif /*LODEPNG_UNFILTER_SSE2*/
   switch(filterType) {
     case 0:
       for(i = 0; i != length; ++i) recon[i] = scanline[i];
@@ -4401,7 +4549,11 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
     }
     case 2:
       if(precon) {
-        for(i = 0; i != length; ++i) recon[i] = scanline[i] + precon[i];
+        i = 0;
+#ifdef LODEPNG_UNFILTER_SSE2
+        i = unfilterUpSSE2(recon, scanline, precon, length);
+#endif /*LODEPNG_UNFILTER_SSE2*/
+        for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
       } else {
         for(i = 0; i != length; ++i) recon[i] = scanline[i];
       }
@@ -4873,7 +5025,7 @@ static unsigned readChunk_zTXt(LodePNGInfo* info, const LodePNGDecoderSettings*
     zlibsettings.max_output_size = decoder->max_text_size;
     /*will fail if zlib error, e.g. if length is too small*/
     error = zlib_decompress(&str, &size, 0, &data[string2_begin],
-                            length, &zlibsettings);
+                            length, &zlibsettings, 0);
     /*error: compressed text larger than  decoder->max_text_size*/
     if(error && size > zlibsettings.max_output_size) error = 112;
     if(error) break;
@@ -4955,7 +5107,7 @@ static unsigned readChunk_iTXt(LodePNGInfo* info, const LodePNGDecoderSettings*
       zlibsettings.max_output_size = decoder->max_text_size;
       /*will fail if zlib error, e.g. if length is too small*/
       error = zlib_decompress(&str, &size, 0, &data[begin],
-                              length, &zlibsettings);
+                              length, &zlibsettings, 0);
       /*error: compressed text larger than  decoder->max_text_size*/
       if(error && size > zlibsettings.max_output_size) error = 112;
       if(!error) error = lodepng_add_itext_sized(info, key, langtag, transkey, (char*)str, size);
@@ -5065,7 +5217,7 @@ static unsigned readChunk_iCCP(LodePNGInfo* info, const LodePNGDecoderSettings*
   zlibsettings.max_output_size = decoder->max_icc_size;
   error = zlib_decompress(&info->iccp_profile, &size, 0,
                           &data[string2_begin],
-                          length, &zlibsettings);
+                          length, &zlibsettings, 0);
   /*error: ICC profile larger than  decoder->max_icc_size*/
   if(error && size > zlibsettings.max_output_size) error = 113;
   info->iccp_profile_size = (unsigned)size;
@@ -5170,16 +5322,17 @@ unsigned lodepng_inspect_chunk(LodePNGState* state, size_t pos,
 }
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize) {
+/*reads the chunks and inflates the IDAT data: the result are the filtered scanlines, with filter type bytes
+and possible padding bits. scanlines must be freed by the caller, also on error*/
+/*sink may be NULL; otherwise it gets the scanlines while they are inflated*/
+static void decodeScanlines(unsigned char** scanlines, unsigned* w, unsigned* h,
+                            LodePNGState* state,
+                            const unsigned char* in, size_t insize, ScanlineSink* sink) {
   unsigned char IEND = 0;
   const unsigned char* chunk; /*points to beginning of next chunk*/
   unsigned char* idat; /*the data from idat chunks, zlib compressed*/
   size_t idatsize = 0;
-  unsigned char* scanlines = 0;
   size_t scanlines_size = 0, expected_size = 0;
-  size_t outsize = 0;
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
@@ -5189,7 +5342,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 
 
   /* safe output values in case error happens */
-  *out = 0;
+  *scanlines = 0;
   *w = *h = 0;
 
   state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
@@ -5351,10 +5504,21 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
       expected_size += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, bpp);
     }
 
-    state->error = zlib_decompress(&scanlines, &scanlines_size, expected_size, idat, idatsize, &state->decoder.zlibsettings);
+    state->error = zlib_decompress(scanlines, &scanlines_size, expected_size, idat, idatsize,
+                                   &state->decoder.zlibsettings, sink);
   }
   if(!state->error && scanlines_size != expected_size) state->error = 91; /*decompressed size doesn't match prediction*/
   lodepng_free(idat);
+}
+
+static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
+                          LodePNGState* state,
+                          const unsigned char* in, size_t insize) {
+  unsigned char* scanlines = 0;
+  size_t outsize = 0;
+
+  *out = 0;
+  decodeScanlines(&scanlines, w, h, state, in, insize, 0);
 
   if(!state->error) {
     outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
@@ -5405,6 +5569,112 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
   return state->error;
 }
 
+/*unfilters and color converts the scanlines of a non-interlaced image into the buffer of the caller*/
+typedef struct DecodeIntoSink {
+  ScanlineSink sink; /*first member, so that the sink can be cast back*/
+  LodePNGState* state;
+  unsigned char* out;
+  size_t stride;
+  unsigned w, h;
+  unsigned y; /*number of scanlines done*/
+  unsigned is_set_up;
+  unsigned is_converted;
+  size_t bytewidth;
+  size_t linebytes; /*without the filter type byte*/
+  unsigned char* rows; /*two unfiltered scanlines, when they are converted*/
+  const unsigned char* prevline;
+} DecodeIntoSink;
+
+static unsigned decodeIntoConsume(ScanlineSink* sink, const unsigned char* data, size_t size) {
+  DecodeIntoSink* into = (DecodeIntoSink*)sink;
+  LodePNGState* state = into->state;
+  unsigned error = 0;
+
+  if(!into->is_set_up) {
+    /*the inflater only starts after all chunks were read, the palette included*/
+    into->is_set_up = 1;
+    if(!state->decoder.color_convert) {
+      error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+      if(error) return error;
+    }
+    if(into->stride < lodepng_get_raw_size(into->w, 1, &state->info_raw)) return 117;
+    /*rows of the buffer are byte aligned, so the output has whole bytes per pixel*/
+    if(lodepng_get_bpp(&state->info_raw) % 8u != 0) return 56;
+    into->is_converted = !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+    if(into->is_converted && !((state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+                               || state->info_raw.bitdepth == 8)) {
+      return 56; /*unsupported color mode conversion*/
+    }
+    if(into->is_converted) {
+      into->rows = (unsigned char*)lodepng_malloc(into->linebytes * 2u);
+      if(!into->rows) return 83; /*alloc fail*/
+    }
+  }
+
+  while(into->y < into->h && size >= (1u + into->linebytes) * (into->y + 1u)) {
+    const unsigned char* scanline = &data[(1u + into->linebytes) * into->y];
+    unsigned char* recon = into->is_converted ? &into->rows[into->linebytes * (into->y & 1u)]
+                                              : &into->out[into->stride * into->y];
+    error = unfilterScanline(recon, scanline + 1, into->prevline, into->bytewidth, scanline[0], into->linebytes);
+    if(!error && into->is_converted) {
+      error = lodepng_convert(&into->out[into->stride * into->y], recon, &state->info_raw, &state->info_png.color,
+                              into->w, 1);
+    }
+    if(error) return error;
+    into->prevline = recon;
+    ++into->y;
+  }
+  /*called again once the next scanline is complete*/
+  into->sink.next_size = (into->y < into->h) ? (1u + into->linebytes) * (into->y + 1u) : (size_t)(-1);
+  return 0;
+}
+
+unsigned lodepng_decode_into(unsigned char* out, size_t stride, unsigned w, unsigned h,
+                             LodePNGState* state,
+                             const unsigned char* in, size_t insize) {
+  unsigned pngw, pngh;
+
+  state->error = lodepng_inspect(&pngw, &pngh, state, in, insize);
+  if(!state->error && (pngw != w || pngh != h)) state->error = 116; /*buffer does not match the image*/
+  if(state->error) return state->error;
+
+  if(state->info_png.interlace_method == 0) {
+    /*every scanline is unfiltered and converted as soon as the inflater has completed it, while it is still in
+    the cache, and written straight into the buffer instead of into an intermediate image*/
+    unsigned char* scanlines = 0;
+    unsigned bpp = lodepng_get_bpp(&state->info_png.color);
+    DecodeIntoSink into;
+    lodepng_memset(&into, 0, sizeof(into));
+    into.sink.consume = decodeIntoConsume;
+    into.state = state;
+    into.out = out;
+    into.stride = stride;
+    into.w = w;
+    into.h = h;
+    into.bytewidth = (bpp + 7u) / 8u;
+    into.linebytes = lodepng_get_raw_size_idat(w, 1, bpp) - 1u;
+    into.sink.next_size = 1u + into.linebytes;
+    decodeScanlines(&scanlines, &pngw, &pngh, state, in, insize, &into.sink);
+    if(!state->error && into.y != h) state->error = 91; /*decompressed size doesn't match prediction*/
+    lodepng_free(into.rows);
+    lodepng_free(scanlines);
+  } else {
+    /*Adam7 passes are spread over the whole image, so it is decoded as a whole and copied row by row*/
+    unsigned y;
+    unsigned char* image = 0;
+    size_t rowsize;
+    state->error = lodepng_decode(&image, &pngw, &pngh, state, in, insize);
+    rowsize = lodepng_get_raw_size(w, 1, &state->info_raw);
+    if(!state->error && stride < rowsize) state->error = 117;
+    if(!state->error && lodepng_get_bpp(&state->info_raw) % 8u != 0) state->error = 56;
+    for(y = 0; y < h && !state->error; ++y) {
+      lodepng_memcpy(&out[stride * y], &image[rowsize * y], rowsize);
+    }
+    lodepng_free(image);
+  }
+  return state->error;
+}
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth) {
   unsigned error;
@@ -6803,6 +7073,8 @@ const char* lodepng_error_text(unsigned code) {
     case 113: return "ICC profile unreasonably large";
     case 114: return "sBIT chunk has wrong size for the color type of the image";
     case 115: return "sBIT value out of range";
+    case 116: return "size of the decode buffer does not match the size of the image";
+    case 117: return "row stride of the decode buffer is smaller than one row of the image";
   }
   return "unknown error code";
 }
@@ -6837,7 +7109,7 @@ unsigned decompress(std::vector<unsigned char>& out, const unsigned char* in, si
                     const LodePNGDecompressSettings& settings) {
   unsigned char* buffer = 0;
   size_t buffersize = 0;
-  unsigned error = zlib_decompress(&buffer, &buffersize, 0, in, insize, &settings);
+  unsigned error = zlib_decompress(&buffer, &buffersize, 0, in, insize, &settings, 0);
   if(buffer) {
     out.insert(out.end(), buffer, &buffer[buffersize]);
     lodepng_free(buffer);
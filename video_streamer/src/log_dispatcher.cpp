@@ -0,0 +1,62 @@
+#include "log_dispatcher.h"
+
+extern "C" {
+    #include <libavutil/log.h>
+}
+
+#include <cstdio>
+#include <iostream>
+
+bool LogDispatcher::registerLogLevel(int logLevel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_logLevels[logLevel];
+    if (!applyLogLevel()) {
+        return false;
+    }
+    if (!m_isCallbackSet) {
+        av_log_set_callback(&LogDispatcher::log);
+        m_isCallbackSet = true;
+    }
+    return true;
+}
+
+void LogDispatcher::unregisterLogLevel(int logLevel) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_logLevels.find(logLevel);
+    if (m_logLevels.end() == it) {
+        std::cerr << "{LogDispatcher::unregisterLogLevel}; log level '" << logLevel << "' was NOT registered" << std::endl;
+        return;
+    }
+    if (0 == --it->second) {
+        m_logLevels.erase(it);
+    }
+    if (!m_logLevels.empty()) {
+        applyLogLevel();
+    }
+}
+
+bool LogDispatcher::applyLogLevel() {
+    if (m_logLevels.empty()) {
+        std::cerr << "{LogDispatcher::applyLogLevel}; no log levels are registered" << std::endl;
+        return false;
+    }
+    auto logLevel = m_logLevels.rbegin()->first;
+    av_log_set_level(logLevel);
+    if (av_log_get_level() != logLevel) {
+        std::cerr << "{LogDispatcher::applyLogLevel}; FFmpeg log level was NOT set" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void LogDispatcher::log(
+    [[maybe_unused]] void* ptr, int level,
+    const char* format, va_list args
+) {
+    if (level > av_log_get_level()) {
+        return;
+    }
+    /* keeps lines coming from different streamers and codec threads apart */
+    std::lock_guard<std::mutex> lock(s_outputMutex);
+    vprintf(format, args);
+}
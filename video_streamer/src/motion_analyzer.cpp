@@ -0,0 +1,321 @@
+#include "motion_analyzer.h"
+
+extern "C" {
+    #include <libavutil/frame.h>
+}
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#include "row_band_pool.h"
+
+namespace {
+    /* downsampled pixels per block side */
+    constexpr int g_lumaBlockSize = MotionAnalyzer::s_blockSize / 2;
+    /* in rows of the downsampled luma; smaller bands cost more to hand out than to compute */
+    constexpr int g_minRowsPerBand = 32;
+    constexpr std::size_t g_simdWidth = 16;
+
+    int getLumaOffset(AVPixelFormat pixelFormat) {
+        return (AV_PIX_FMT_UYVY422 == pixelFormat) ? 1 : 0;
+    }
+
+    bool isPacked(AVPixelFormat pixelFormat) {
+        return (AV_PIX_FMT_YUYV422 == pixelFormat) ||
+            (AV_PIX_FMT_YVYU422 == pixelFormat) ||
+            (AV_PIX_FMT_UYVY422 == pixelFormat);
+    }
+
+    /* every second byte, starting at 'offset' */
+    void extractLuma(const std::uint8_t* source, int width, int offset, std::uint8_t* destination) {
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+        for (; x + 16 <= width; x += 16) {
+            auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x));
+            auto second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x + 16));
+            if (0 == offset) {
+                first = _mm_and_si128(first, lowByteMask);
+                second = _mm_and_si128(second, lowByteMask);
+            } else {
+                first = _mm_srli_epi16(first, 8);
+                second = _mm_srli_epi16(second, 8);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(first, second));
+        }
+#endif
+        for (; x < width; ++x) {
+            destination[x] = source[2 * x + offset];
+        }
+    }
+
+    /* 2x2 box average of two full resolution rows */
+    void downsampleRows(const std::uint8_t* first, const std::uint8_t* second, int width, std::uint8_t* destination) {
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+        for (; x + 16 <= width; x += 16) {
+            auto low = _mm_avg_epu8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 2 * x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + 2 * x))
+            );
+            auto high = _mm_avg_epu8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + 2 * x + 16)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + 2 * x + 16))
+            );
+            low = _mm_avg_epu16(_mm_and_si128(low, lowByteMask), _mm_srli_epi16(low, 8));
+            high = _mm_avg_epu16(_mm_and_si128(high, lowByteMask), _mm_srli_epi16(high, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(low, high));
+        }
+#endif
+        for (; x < width; ++x) {
+            auto sum =
+                static_cast<unsigned int>(first[2 * x]) + first[2 * x + 1] +
+                second[2 * x] + second[2 * x + 1];
+            destination[x] = static_cast<std::uint8_t>((sum + 2) >> 2);
+        }
+    }
+}
+
+bool MotionAnalyzer::isPixelFormatSupported(AVPixelFormat pixelFormat) {
+    switch (pixelFormat) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+        case AV_PIX_FMT_GRAY8:
+        case AV_PIX_FMT_NV12:
+        case AV_PIX_FMT_NV21:
+        case AV_PIX_FMT_NV16:
+        case AV_PIX_FMT_YUYV422:
+        case AV_PIX_FMT_YVYU422:
+        case AV_PIX_FMT_UYVY422:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool MotionAnalyzer::setup(int width, int height, AVPixelFormat pixelFormat, unsigned int threshold) {
+    if ((width < 2) || (height < 2)) {
+        std::cerr << "{MotionAnalyzer::setup}; frame size is too small" << std::endl;
+        return false;
+    }
+    if (!isPixelFormatSupported(pixelFormat)) {
+        std::cerr << "{MotionAnalyzer::setup}; pixel format '" << static_cast<int>(pixelFormat) << "' is NOT supported" << std::endl;
+        return false;
+    }
+
+    clear();
+    m_width = width;
+    m_height = height;
+    m_pixelFormat = pixelFormat;
+    m_blockSadThreshold = static_cast<std::uint32_t>(threshold) * g_lumaBlockSize * g_lumaBlockSize;
+
+    m_lumaWidth = width / 2;
+    m_lumaHeight = height / 2;
+    m_lumaStride = ((static_cast<std::size_t>(m_lumaWidth) + g_simdWidth - 1) / g_simdWidth) * g_simdWidth;
+    m_currentLuma.assign(m_lumaStride * static_cast<std::size_t>(m_lumaHeight), 0);
+    m_referenceLuma.assign(m_currentLuma.size(), 0);
+    m_hasReference = false;
+    m_rowBuffers.assign(RowBandPool::s_maxBands * 2 * static_cast<std::size_t>(width), 0);
+
+    m_blocksWide = (m_lumaWidth + g_lumaBlockSize - 1) / g_lumaBlockSize;
+    m_blocksHigh = (m_lumaHeight + g_lumaBlockSize - 1) / g_lumaBlockSize;
+    m_blockPitch = m_lumaStride / g_lumaBlockSize;
+    m_blockSads.assign(m_blockPitch * static_cast<std::size_t>(m_blocksHigh), 0);
+    return true;
+}
+
+void MotionAnalyzer::clear() {
+    m_currentLuma.clear();
+    m_referenceLuma.clear();
+    m_rowBuffers.clear();
+    m_blockSads.clear();
+    m_blockStack.clear();
+    m_visitedBlocks.clear();
+    m_hasReference = false;
+    m_blocksWide = 0;
+    m_blocksHigh = 0;
+}
+
+std::size_t MotionAnalyzer::analyze(const AVFrame* frame) {
+    auto nBlocks = static_cast<std::size_t>(m_blocksWide) * static_cast<std::size_t>(m_blocksHigh);
+    if (!downsampleLuma(frame)) {
+        m_hasReference = false;
+        return nBlocks;
+    }
+    if (!m_hasReference) {
+        std::fill(m_blockSads.begin(), m_blockSads.end(), UINT32_MAX);
+        return nBlocks;
+    }
+
+    computeBlockSads();
+    std::size_t nChangedBlocks = 0;
+    for (int blockY = 0; blockY < m_blocksHigh; ++blockY) {
+        for (int blockX = 0; blockX < m_blocksWide; ++blockX) {
+            if (isBlockChanged(blockX, blockY)) {
+                ++nChangedBlocks;
+            }
+        }
+    }
+    return nChangedBlocks;
+}
+
+void MotionAnalyzer::commitReference() {
+    std::swap(m_currentLuma, m_referenceLuma);
+    m_hasReference = true;
+}
+
+bool MotionAnalyzer::isBlockChanged(int blockX, int blockY) const {
+    if ((blockX < 0) || (blockX >= m_blocksWide) || (blockY < 0) || (blockY >= m_blocksHigh)) {
+        return false;
+    }
+    auto index = static_cast<std::size_t>(blockY) * m_blockPitch + static_cast<std::size_t>(blockX);
+    return (m_blockSads[index] > m_blockSadThreshold);
+}
+
+void MotionAnalyzer::getChangedRegions(std::size_t minBlocks, std::size_t maxRegions, std::vector<Region>& regions) {
+    regions.clear();
+    auto nBlocks = static_cast<std::size_t>(m_blocksWide) * static_cast<std::size_t>(m_blocksHigh);
+    m_visitedBlocks.assign(nBlocks, 0);
+
+    /* 8-connected components of changed blocks */
+    for (int startY = 0; startY < m_blocksHigh; ++startY) {
+        for (int startX = 0; startX < m_blocksWide; ++startX) {
+            auto startIndex = startY * m_blocksWide + startX;
+            if (m_visitedBlocks[static_cast<std::size_t>(startIndex)] || !isBlockChanged(startX, startY)) {
+                continue;
+            }
+
+            Region region{ .left = startX, .top = startY, .right = startX, .bottom = startY, .nBlocks = 0 };
+            m_visitedBlocks[static_cast<std::size_t>(startIndex)] = 1;
+            m_blockStack.clear();
+            m_blockStack.push_back(startIndex);
+            while (!m_blockStack.empty()) {
+                auto index = m_blockStack.back();
+                m_blockStack.pop_back();
+                auto blockX = index % m_blocksWide;
+                auto blockY = index / m_blocksWide;
+                ++region.nBlocks;
+                region.left = std::min(region.left, blockX);
+                region.top = std::min(region.top, blockY);
+                region.right = std::max(region.right, blockX);
+                region.bottom = std::max(region.bottom, blockY);
+
+                for (int y = std::max(blockY - 1, 0); y <= std::min(blockY + 1, m_blocksHigh - 1); ++y) {
+                    for (int x = std::max(blockX - 1, 0); x <= std::min(blockX + 1, m_blocksWide - 1); ++x) {
+                        auto neighbourIndex = y * m_blocksWide + x;
+                        if (!m_visitedBlocks[static_cast<std::size_t>(neighbourIndex)] && isBlockChanged(x, y)) {
+                            m_visitedBlocks[static_cast<std::size_t>(neighbourIndex)] = 1;
+                            m_blockStack.push_back(neighbourIndex);
+                        }
+                    }
+                }
+            }
+            if (region.nBlocks < minBlocks) {
+                continue;
+            }
+
+            /* the last block of a row or column may be cut by the frame border */
+            region.left *= s_blockSize;
+            region.top *= s_blockSize;
+            region.right = std::min((region.right + 1) * s_blockSize, m_width);
+            region.bottom = std::min((region.bottom + 1) * s_blockSize, m_height);
+            regions.push_back(region);
+        }
+    }
+
+    if (regions.size() > maxRegions) {
+        std::partial_sort(
+            regions.begin(), regions.begin() + static_cast<std::ptrdiff_t>(maxRegions), regions.end(),
+            [] (const Region& first, const Region& second) { return (first.nBlocks > second.nBlocks); }
+        );
+        regions.resize(maxRegions);
+    }
+}
+
+bool MotionAnalyzer::downsampleLuma(const AVFrame* frame) {
+    if (!isSet()) {
+        return false;
+    }
+    if (nullptr == frame) {
+        std::cerr << "{MotionAnalyzer::downsampleLuma}; pointer to frame is NULL" << std::endl;
+        return false;
+    }
+    if ((frame->width != m_width) || (frame->height != m_height) || (frame->format != m_pixelFormat)) {
+        std::cerr << "{MotionAnalyzer::downsampleLuma}; frame does NOT match analyzer settings" << std::endl;
+        return false;
+    }
+    if (nullptr == frame->data[0]) {
+        std::cerr << "{MotionAnalyzer::downsampleLuma}; pointer to luma plane is NULL" << std::endl;
+        return false;
+    }
+
+    auto downsampleBand = [this, frame] (std::size_t band, int firstLumaRow, int lastLumaRow) {
+        auto firstRowBuffer = m_rowBuffers.data() + band * 2 * static_cast<std::size_t>(m_width);
+        auto secondRowBuffer = firstRowBuffer + m_width;
+        for (int y = firstLumaRow; y < lastLumaRow; ++y) {
+            auto firstRow = getLumaRow(frame, 2 * y, firstRowBuffer);
+            auto secondRow = getLumaRow(frame, 2 * y + 1, secondRowBuffer);
+            downsampleRows(firstRow, secondRow, m_lumaWidth, m_currentLuma.data() + static_cast<std::size_t>(y) * m_lumaStride);
+        }
+    };
+    RowBandPool::getInstance().run(m_lumaHeight, g_minRowsPerBand, downsampleBand);
+    return true;
+}
+
+const std::uint8_t* MotionAnalyzer::getLumaRow(const AVFrame* frame, int y, std::uint8_t* rowBuffer) const {
+    auto row = frame->data[0] + static_cast<std::ptrdiff_t>(y) * frame->linesize[0];
+    if (!isPacked(m_pixelFormat)) {
+        return row;
+    }
+    extractLuma(row, m_width, getLumaOffset(m_pixelFormat), rowBuffer);
+    return rowBuffer;
+}
+
+void MotionAnalyzer::computeBlockSads() {
+    /* bands are whole rows of blocks, so no two bands add to the same sum */
+    auto computeBand = [this] (std::size_t, int firstBlockRow, int lastBlockRow) {
+        computeBlockSads(firstBlockRow * g_lumaBlockSize, std::min(lastBlockRow * g_lumaBlockSize, m_lumaHeight));
+    };
+    RowBandPool::getInstance().run(m_blocksHigh, g_minRowsPerBand / g_lumaBlockSize, computeBand);
+}
+
+void MotionAnalyzer::computeBlockSads(int firstRow, int lastRow) {
+    auto firstSad = m_blockSads.begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(firstRow / g_lumaBlockSize) * m_blockPitch);
+    auto lastSad = m_blockSads.begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>((lastRow + g_lumaBlockSize - 1) / g_lumaBlockSize) * m_blockPitch);
+    std::fill(firstSad, lastSad, 0);
+    for (int y = firstRow; y < lastRow; ++y) {
+        auto offset = static_cast<std::size_t>(y) * m_lumaStride;
+        auto currentRow = m_currentLuma.data() + offset;
+        auto referenceRow = m_referenceLuma.data() + offset;
+        auto blockSads = m_blockSads.data() + static_cast<std::size_t>(y / g_lumaBlockSize) * m_blockPitch;
+
+        /* one 16 byte SAD yields the sums of two horizontally adjacent blocks */
+        for (std::size_t x = 0; x < m_lumaStride; x += g_simdWidth) {
+            auto blockIndex = x / g_lumaBlockSize;
+#if defined(__SSE2__)
+            auto sad = _mm_sad_epu8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(currentRow + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(referenceRow + x))
+            );
+            blockSads[blockIndex] += static_cast<std::uint32_t>(_mm_cvtsi128_si32(sad));
+            blockSads[blockIndex + 1] += static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+#else
+            for (std::size_t i = 0; i < g_simdWidth; ++i) {
+                auto difference = static_cast<int>(currentRow[x + i]) - static_cast<int>(referenceRow[x + i]);
+                blockSads[blockIndex + i / g_lumaBlockSize] += static_cast<std::uint32_t>(std::abs(difference));
+            }
+#endif
+        }
+    }
+}
@@ -0,0 +1,439 @@
+#include "multi_scaler.h"
+
+extern "C" {
+    #include <libavutil/buffer.h>
+    #include <libavutil/error.h>
+    #include <libavutil/frame.h>
+    #include <libavutil/imgutils.h>
+}
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace {
+    constexpr int g_weightBits = 12;
+    constexpr int g_weightOne = 1 << g_weightBits;
+    /* 32 rows of a 4K source and their chroma are about 180 KiB, i.e. they stay in L2 */
+    constexpr int g_blockRows = 32;
+    constexpr int g_minBlocksPerBand = 2;
+    constexpr int g_bufferAlignment = 32;
+    /* the quotient by multiplication with the reciprocal is exact for every sum of up to 255 * area
+     * while 256 * area^2 < 2^32; larger boxes use the weights */
+    constexpr int g_maxBoxArea = 4095;
+
+    /* two taps of the vertical filter at once; the sums are assigned by the first pair of a row */
+    void accumulateRows(
+        const std::uint8_t* first, std::uint16_t firstWeight,
+        const std::uint8_t* second, std::uint16_t secondWeight,
+        int width, bool isFirstPair, std::uint32_t* sums
+    ) {
+        int x = 0;
+#if defined(__SSE2__)
+        /* weights and pixels are below 2^15, so the signed multiply-add is exact */
+        const __m128i weights = _mm_set1_epi32(static_cast<int>(firstWeight | (static_cast<std::uint32_t>(secondWeight) << 16)));
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            auto firstPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + x));
+            auto secondPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + x));
+            auto lowPairs = _mm_unpacklo_epi8(firstPixels, secondPixels);
+            auto highPairs = _mm_unpackhi_epi8(firstPixels, secondPixels);
+            __m128i products[ 4 ] = {
+                _mm_madd_epi16(_mm_unpacklo_epi8(lowPairs, zero), weights),
+                _mm_madd_epi16(_mm_unpackhi_epi8(lowPairs, zero), weights),
+                _mm_madd_epi16(_mm_unpacklo_epi8(highPairs, zero), weights),
+                _mm_madd_epi16(_mm_unpackhi_epi8(highPairs, zero), weights)
+            };
+            for (int i = 0; i < 4; ++i) {
+                auto* destination = reinterpret_cast<__m128i*>(sums + x + 4 * i);
+                if (!isFirstPair) {
+                    products[ i ] = _mm_add_epi32(products[ i ], _mm_loadu_si128(destination));
+                }
+                _mm_storeu_si128(destination, products[ i ]);
+            }
+        }
+#endif
+        for (; x < width; ++x) {
+            std::uint32_t sum = firstWeight * first[ x ] + secondWeight * second[ x ];
+            sums[ x ] = isFirstPair ? sum : (sums[ x ] + sum);
+        }
+    }
+}
+
+MultiScaler::~MultiScaler() {
+    clear();
+}
+
+bool MultiScaler::isPixelFormatSupported(AVPixelFormat pixelFormat) {
+    return (AV_PIX_FMT_YUV420P == pixelFormat) || (AV_PIX_FMT_YUVJ420P == pixelFormat);
+}
+
+bool MultiScaler::computeFilter(int sourceSize, int size, Filter& filter) {
+    if ((size <= 0) || (size > sourceSize)) {
+        std::cerr << "{MultiScaler::computeFilter}; size is NOT valid; "
+            "source size: '" << sourceSize << "'; size: '" << size << "'" << std::endl;
+        return false;
+    }
+
+    /* positions are measured in 1/size of a source sample, so footprints are integral */
+    std::vector<int> firstSamples(static_cast<std::size_t>(size));
+    std::vector<std::vector<std::uint16_t>> sampleWeights(static_cast<std::size_t>(size));
+    int nTaps = 0;
+    for (int i = 0; i < size; ++i) {
+        auto begin = static_cast<std::int64_t>(i) * sourceSize;
+        auto end = begin + sourceSize;
+        auto firstSample = static_cast<int>(begin / size);
+        auto lastSample = static_cast<int>((end + size - 1) / size);
+
+        auto& weights = sampleWeights[ static_cast<std::size_t>(i) ];
+        int sum = 0;
+        std::size_t largest = 0;
+        for (int j = firstSample; j < lastSample; ++j) {
+            auto overlap =
+                std::min(end, static_cast<std::int64_t>(j + 1) * size) -
+                std::max(begin, static_cast<std::int64_t>(j) * size);
+            auto weight = static_cast<int>((overlap * g_weightOne + sourceSize / 2) / sourceSize);
+            weights.push_back(static_cast<std::uint16_t>(weight));
+            sum += weight;
+            if (weights[ largest ] < weights.back()) {
+                largest = weights.size() - 1;
+            }
+        }
+        /* rounding errors go to the largest weight, so every sample sums to one */
+        weights[ largest ] = static_cast<std::uint16_t>(weights[ largest ] + g_weightOne - sum);
+        firstSamples[ static_cast<std::size_t>(i) ] = firstSample;
+        nTaps = std::max(nTaps, lastSample - firstSample);
+    }
+
+    /* every sample gets the same number of taps; the footprint is moved
+     * to the right end of the padding unless the source ends there */
+    filter.nTaps = nTaps;
+    filter.first.assign(static_cast<std::size_t>(size), 0);
+    filter.weights.assign(static_cast<std::size_t>(size) * static_cast<std::size_t>(nTaps), 0);
+    for (int i = 0; i < size; ++i) {
+        auto firstSample = firstSamples[ static_cast<std::size_t>(i) ];
+        auto first = std::min(firstSample, sourceSize - nTaps);
+        filter.first[ static_cast<std::size_t>(i) ] = first;
+        const auto& weights = sampleWeights[ static_cast<std::size_t>(i) ];
+        std::copy(
+            weights.begin(), weights.end(),
+            filter.weights.begin() + static_cast<std::ptrdiff_t>(i) * nTaps + (firstSample - first)
+        );
+    }
+    return true;
+}
+
+void MultiScaler::computeBoxFilter(int factor, int size, Filter& filter) {
+    filter.nTaps = factor;
+    filter.first.resize(static_cast<std::size_t>(size));
+    for (int i = 0; i < size; ++i) {
+        filter.first[ static_cast<std::size_t>(i) ] = i * factor;
+    }
+    filter.weights.assign(static_cast<std::size_t>(size) * static_cast<std::size_t>(factor), 1);
+}
+
+bool MultiScaler::setup(int width, int height, AVPixelFormat pixelFormat, const std::vector<Size>& outputs) {
+    clear();
+    if (!isPixelFormatSupported(pixelFormat)) {
+        std::cerr << "{MultiScaler::setup}; pixel format is NOT supported; "
+            "pixel format: '" << static_cast<int>(pixelFormat) << "'" << std::endl;
+        return false;
+    }
+    if ((width <= 0) || (height <= 0) || (0 != (width % 2)) || (0 != (height % 2))) {
+        std::cerr << "{MultiScaler::setup}; frame size is NOT supported; "
+            "frame size: '" << width << "x" << height << "'" << std::endl;
+        return false;
+    }
+    if (outputs.empty()) {
+        std::cerr << "{MultiScaler::setup}; output list is empty" << std::endl;
+        return false;
+    }
+
+    std::vector<Output> setupOutputs(outputs.size());
+    auto freeBufferPools = [&setupOutputs] () {
+        for (auto& output : setupOutputs) {
+            if (output.bufferPool) {
+                av_buffer_pool_uninit(&output.bufferPool);
+            }
+        }
+    };
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        const auto& size = outputs[ i ];
+        if (
+            (size.width <= 0) || (size.height <= 0) ||
+            (0 != (size.width % 2)) || (0 != (size.height % 2)) ||
+            (size.width > width) || (size.height > height)
+        ) {
+            std::cerr << "{MultiScaler::setup}; output size is NOT supported; "
+                "output size: '" << size.width << "x" << size.height << "'" << std::endl;
+            freeBufferPools();
+            return false;
+        }
+
+        auto& output = setupOutputs[ i ];
+        output.size = size;
+        for (int planeIndex = 0; planeIndex < 3; ++planeIndex) {
+            auto shift = (0 == planeIndex) ? 0 : 1;
+            auto& plane = output.planes[ planeIndex ];
+            plane.sourceWidth = width >> shift;
+            plane.width = size.width >> shift;
+            plane.height = size.height >> shift;
+            auto sourceHeight = height >> shift;
+            if (
+                !computeFilter(plane.sourceWidth, plane.width, plane.horizontal) ||
+                !computeFilter(sourceHeight, plane.height, plane.vertical)
+            ) {
+                freeBufferPools();
+                return false;
+            }
+            /* rounded 12-bit weights are NOT exact for factors like 3, so the box is summed and divided */
+            auto horizontalFactor = plane.sourceWidth / plane.width;
+            auto verticalFactor = sourceHeight / plane.height;
+            if (
+                (0 == (plane.sourceWidth % plane.width)) && (0 == (sourceHeight % plane.height)) &&
+                (horizontalFactor * verticalFactor <= g_maxBoxArea)
+            ) {
+                computeBoxFilter(horizontalFactor, plane.width, plane.horizontal);
+                computeBoxFilter(verticalFactor, plane.height, plane.vertical);
+                plane.boxArea = static_cast<std::uint32_t>(horizontalFactor * verticalFactor);
+                plane.boxReciprocal = ((std::uint64_t{ 1 } << 32) + plane.boxArea - 1) / plane.boxArea;
+            }
+        }
+
+        auto bufferSize = av_image_get_buffer_size(pixelFormat, size.width, size.height, g_bufferAlignment);
+        if (bufferSize < 0) {
+            std::cerr << "{MultiScaler::setup}; unable to get buffer size; "
+                "size result: '" << bufferSize << " (" << av_err2str(bufferSize) << ")'" << std::endl;
+            freeBufferPools();
+            return false;
+        }
+        /* the encoders keep scaled frames for a while; the pools recycle them */
+        output.bufferPool = av_buffer_pool_init(static_cast<std::size_t>(bufferSize), nullptr);
+        if (nullptr == output.bufferPool) {
+            std::cerr << "{MultiScaler::setup}; unable to allocate buffer pool" << std::endl;
+            freeBufferPools();
+            return false;
+        }
+    }
+
+    m_rowBuffers.assign(RowBandPool::s_maxBands * static_cast<std::size_t>(width), 0);
+    m_width = width;
+    m_height = height;
+    m_pixelFormat = pixelFormat;
+    m_outputs = std::move(setupOutputs);
+    std::cout << "{MultiScaler::setup}; multi scaler has been successfully set up; "
+        "number of outputs: '" << m_outputs.size() << "'" << std::endl;
+    return true;
+}
+
+void MultiScaler::clear() {
+    /* buffers that are still referenced outlive their pool */
+    for (auto& output : m_outputs) {
+        if (output.bufferPool) {
+            av_buffer_pool_uninit(&output.bufferPool);
+        }
+    }
+    m_outputs.clear();
+    m_rowBuffers.clear();
+    m_width = 0;
+    m_height = 0;
+    m_pixelFormat = AV_PIX_FMT_NONE;
+}
+
+bool MultiScaler::allocateBuffer(Output& output, AVFrame* targetFrame) const {
+    auto* buffer = av_buffer_pool_get(output.bufferPool);
+    if (nullptr == buffer) {
+        std::cerr << "{MultiScaler::allocateBuffer}; unable to get buffer from pool" << std::endl;
+        return false;
+    }
+    targetFrame->buf[ 0 ] = buffer;
+    targetFrame->format = m_pixelFormat;
+    targetFrame->width = output.size.width;
+    targetFrame->height = output.size.height;
+    auto fillResult = av_image_fill_arrays(
+        targetFrame->data, targetFrame->linesize, buffer->data,
+        m_pixelFormat, output.size.width, output.size.height, g_bufferAlignment
+    );
+    if (fillResult < 0) {
+        std::cerr << "{MultiScaler::allocateBuffer}; unable to fill frame planes; "
+            "fill result: '" << fillResult << " (" << av_err2str(fillResult) << ")'" << std::endl;
+        av_frame_unref(targetFrame);
+        return false;
+    }
+    return true;
+}
+
+bool MultiScaler::scale(const AVFrame* sourceFrame, const std::vector<AVFrame*>& targetFrames) {
+    if (!isSet()) {
+        std::cerr << "{MultiScaler::scale}; multi scaler is NOT set up" << std::endl;
+        return false;
+    }
+    if (nullptr == sourceFrame) {
+        std::cerr << "{MultiScaler::scale}; pointer to source frame is NULL" << std::endl;
+        return false;
+    }
+    if (
+        (sourceFrame->format != m_pixelFormat) ||
+        (sourceFrame->width != m_width) || (sourceFrame->height != m_height)
+    ) {
+        std::cerr << "{MultiScaler::scale}; frame does NOT match scaler setup; "
+            "frame size: '" << sourceFrame->width << "x" << sourceFrame->height << "'; "
+            "pixel format: '" << sourceFrame->format << "'" << std::endl;
+        return false;
+    }
+    if (targetFrames.size() != m_outputs.size()) {
+        std::cerr << "{MultiScaler::scale}; number of target frames does NOT match number of outputs" << std::endl;
+        return false;
+    }
+
+    for (std::size_t i = 0; i < m_outputs.size(); ++i) {
+        auto* targetFrame = targetFrames[ i ];
+        if (nullptr == targetFrame) {
+            std::cerr << "{MultiScaler::scale}; pointer to target frame is NULL" << std::endl;
+            return false;
+        }
+        av_frame_unref(targetFrame);
+        if (!allocateBuffer(m_outputs[ i ], targetFrame)) {
+            return false;
+        }
+        auto copyResult = av_frame_copy_props(targetFrame, sourceFrame);
+        if (copyResult < 0) {
+            std::cerr << "{MultiScaler::scale}; unable to copy frame properties; "
+                "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+            return false;
+        }
+        /* regions of interest are given in pixels of the source */
+        av_frame_remove_side_data(targetFrame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+    }
+
+    auto scaleBand = [this, sourceFrame, &targetFrames] (std::size_t band, int firstBlock, int lastBlock) {
+        scaleRows(
+            sourceFrame, targetFrames,
+            firstBlock * g_blockRows, std::min(lastBlock * g_blockRows, m_height),
+            &m_rowBuffers[ band * static_cast<std::size_t>(m_width) ]
+        );
+    };
+    RowBandPool::getInstance().run((m_height + g_blockRows - 1) / g_blockRows, g_minBlocksPerBand, scaleBand);
+    return true;
+}
+
+template<int nTaps>
+void MultiScaler::filterColumns(const std::uint32_t* rowBuffer, const Filter& filter, int width, std::uint8_t* targetRow) {
+    /* common factors get a fixed number of taps, which the compiler unrolls */
+    auto nFilterTaps = (0 == nTaps) ? filter.nTaps : nTaps;
+    const auto* weights = filter.weights.data();
+    for (int x = 0; x < width; ++x, weights += nFilterTaps) {
+        const auto* sums = rowBuffer + filter.first[ static_cast<std::size_t>(x) ];
+        /* at most 255 * 2^24 plus rounding, which still fits */
+        std::uint32_t sum = 1u << (2 * g_weightBits - 1);
+        for (int tap = 0; tap < nFilterTaps; ++tap) {
+            sum += weights[ tap ] * sums[ tap ];
+        }
+        targetRow[ x ] = static_cast<std::uint8_t>(sum >> (2 * g_weightBits));
+    }
+}
+
+template<int nTaps>
+void MultiScaler::averageColumns(const std::uint32_t* rowBuffer, const Plane& plane, std::uint8_t* targetRow) {
+    const auto& filter = plane.horizontal;
+    auto nFilterTaps = (0 == nTaps) ? filter.nTaps : nTaps;
+    /* the sum is at most 255 * boxArea plus rounding; see g_maxBoxArea */
+    auto rounding = plane.boxArea / 2;
+    const auto* sums = rowBuffer;
+    for (int x = 0; x < plane.width; ++x, sums += nFilterTaps) {
+        std::uint32_t sum = rounding;
+        for (int tap = 0; tap < nFilterTaps; ++tap) {
+            sum += sums[ tap ];
+        }
+        targetRow[ x ] = static_cast<std::uint8_t>((sum * plane.boxReciprocal) >> 32);
+    }
+}
+
+void MultiScaler::scaleRows(
+    const AVFrame* sourceFrame, const std::vector<AVFrame*>& targetFrames,
+    int firstRow, int lastRow, std::uint32_t* rowBuffer
+) const {
+    for (int blockRow = firstRow; blockRow < lastRow; blockRow += g_blockRows) {
+        auto blockEnd = std::min(blockRow + g_blockRows, lastRow);
+        for (int planeIndex = 0; planeIndex < 3; ++planeIndex) {
+            auto shift = (0 == planeIndex) ? 0 : 1;
+            auto planeFirstRow = blockRow >> shift;
+            auto planeLastRow = blockEnd >> shift;
+            const auto* source = sourceFrame->data[ planeIndex ];
+            auto sourceStride = static_cast<std::ptrdiff_t>(sourceFrame->linesize[ planeIndex ]);
+
+            for (std::size_t outputIndex = 0; outputIndex < m_outputs.size(); ++outputIndex) {
+                const auto& plane = m_outputs[ outputIndex ].planes[ planeIndex ];
+                const auto& vertical = plane.vertical;
+                const auto& horizontal = plane.horizontal;
+                auto* target = targetFrames[ outputIndex ]->data[ planeIndex ];
+                auto targetStride = static_cast<std::ptrdiff_t>(targetFrames[ outputIndex ]->linesize[ planeIndex ]);
+
+                /* footprints start in ascending order, so the rows of the block are contiguous */
+                auto beginRow = std::lower_bound(vertical.first.begin(), vertical.first.end(), planeFirstRow) - vertical.first.begin();
+                auto endRow = std::lower_bound(vertical.first.begin(), vertical.first.end(), planeLastRow) - vertical.first.begin();
+                for (auto row = beginRow; row < endRow; ++row) {
+                    const auto* rowWeights = &vertical.weights[ static_cast<std::size_t>(row) * static_cast<std::size_t>(vertical.nTaps) ];
+                    const auto* sourceRow = source + vertical.first[ static_cast<std::size_t>(row) ] * sourceStride;
+                    /* taps outside the footprint are zero; the others are summed in pairs */
+                    const std::uint8_t* pendingRow = nullptr;
+                    std::uint16_t pendingWeight = 0;
+                    bool isFirstPair = true;
+                    for (int tap = 0; tap < vertical.nTaps; ++tap, sourceRow += sourceStride) {
+                        if (0 == rowWeights[ tap ]) {
+                            continue;
+                        }
+                        if (nullptr == pendingRow) {
+                            pendingRow = sourceRow;
+                            pendingWeight = rowWeights[ tap ];
+                            continue;
+                        }
+                        accumulateRows(pendingRow, pendingWeight, sourceRow, rowWeights[ tap ], plane.sourceWidth, isFirstPair, rowBuffer);
+                        pendingRow = nullptr;
+                        isFirstPair = false;
+                    }
+                    if (pendingRow) {
+                        accumulateRows(pendingRow, pendingWeight, pendingRow, 0, plane.sourceWidth, isFirstPair, rowBuffer);
+                    }
+
+                    auto* targetRow = target + row * targetStride;
+                    if (plane.boxArea > 0) {
+                        switch (horizontal.nTaps) {
+                            case 2:
+                                averageColumns<2>(rowBuffer, plane, targetRow);
+                                break;
+                            case 3:
+                                averageColumns<3>(rowBuffer, plane, targetRow);
+                                break;
+                            case 4:
+                                averageColumns<4>(rowBuffer, plane, targetRow);
+                                break;
+                            default:
+                                averageColumns<0>(rowBuffer, plane, targetRow);
+                                break;
+                        }
+                        continue;
+                    }
+                    switch (horizontal.nTaps) {
+                        case 2:
+                            filterColumns<2>(rowBuffer, horizontal, plane.width, targetRow);
+                            break;
+                        case 3:
+                            filterColumns<3>(rowBuffer, horizontal, plane.width, targetRow);
+                            break;
+                        case 4:
+                            filterColumns<4>(rowBuffer, horizontal, plane.width, targetRow);
+                            break;
+                        default:
+                            filterColumns<0>(rowBuffer, horizontal, plane.width, targetRow);
+                            break;
+                    }
+                }
+            }
+        }
+    }
+}
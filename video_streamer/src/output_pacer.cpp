@@ -0,0 +1,172 @@
+#include "output_pacer.h"
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavformat/avio.h>
+    #include <libavutil/error.h>
+    #include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <time.h>
+
+namespace {
+    constexpr std::int64_t g_nanosecondsPerSecond = 1000000000;
+    constexpr std::int64_t g_bitsPerByte = 8;
+    /* the last part of a wait is spun; it covers the default timer slack of 50 microseconds */
+    constexpr std::int64_t g_spinDuration = 60000; // in nanoseconds
+
+    std::int64_t getMonotonicTime() {
+        timespec time{};
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<std::int64_t>(time.tv_sec) * g_nanosecondsPerSecond + time.tv_nsec;
+    }
+}
+
+OutputPacer::~OutputPacer() {
+    close();
+}
+
+bool OutputPacer::setup(
+    const Settings& settings, AVFormatContext* outputContext, std::shared_ptr<TimeoutChecker> timeoutChecker,
+    StreamMetrics* metrics, LatencyHistogram* errorHistogram
+) {
+    if (m_ioContext) {
+        std::cerr << "{OutputPacer::setup}; output pacer is already set" << std::endl;
+        return false;
+    }
+    if ((nullptr == outputContext) || (nullptr == outputContext->pb)) {
+        std::cerr << "{OutputPacer::setup}; pointer to bytestream output context is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == timeoutChecker) {
+        std::cerr << "{OutputPacer::setup}; pointer to timeout checker is NULL" << std::endl;
+        return false;
+    }
+    if ((nullptr == metrics) || (nullptr == errorHistogram)) {
+        std::cerr << "{OutputPacer::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if (settings.rate <= 0) {
+        std::cerr << "{OutputPacer::setup}; pacing rate is NOT positive" << std::endl;
+        return false;
+    }
+    if ((0 == settings.chunkSize) || (settings.burstSize < settings.chunkSize)) {
+        std::cerr << "{OutputPacer::setup}; burst size is less than chunk size" << std::endl;
+        return false;
+    }
+
+    auto ioBuffer = static_cast<unsigned char*>(av_malloc(settings.chunkSize));
+    if (nullptr == ioBuffer) {
+        std::cerr << "{OutputPacer::setup}; unable to allocate memory for I/O buffer" << std::endl;
+        return false;
+    }
+    m_ioContext = avio_alloc_context(
+        ioBuffer, static_cast<int>(settings.chunkSize), 1,
+        static_cast<void*>(this), nullptr, &OutputPacer::onProxyWrite, nullptr
+    );
+    if (nullptr == m_ioContext) {
+        std::cerr << "{OutputPacer::setup}; unable to allocate I/O context" << std::endl;
+        av_free(ioBuffer);
+        return false;
+    }
+    m_settings = settings;
+    m_outputContext = outputContext;
+    m_targetContext = outputContext->pb;
+    m_timeoutChecker = std::move(timeoutChecker);
+    m_metrics = metrics;
+    m_errorHistogram = errorHistogram;
+    m_burstDuration = static_cast<std::int64_t>(settings.burstSize) * g_bitsPerByte * g_nanosecondsPerSecond / settings.rate;
+    m_releaseTime = 0;
+
+    m_outputContext->pb = m_ioContext;
+    /* the rest of a packet is released right away instead of with the next packet */
+    m_outputContext->flush_packets = 1;
+    std::cout << "{OutputPacer::setup}; output is paced; "
+        "rate: '" << settings.rate << " bits per second'; "
+        "chunk size: '" << settings.chunkSize << "'; "
+        "burst size: '" << settings.burstSize << "'" << std::endl;
+    return true;
+}
+
+void OutputPacer::close() {
+    if (nullptr == m_ioContext) {
+        return;
+    }
+    m_timeoutChecker->setBeginTime();
+    avio_flush(m_ioContext);
+    m_timeoutChecker->resetBeginTime();
+    if (m_outputContext) {
+        m_outputContext->pb = m_targetContext;
+    }
+    av_freep(&m_ioContext->buffer);
+    avio_context_free(&m_ioContext);
+    m_ioContext = nullptr;
+    m_outputContext = nullptr;
+    m_targetContext = nullptr;
+    m_timeoutChecker.reset();
+}
+
+int OutputPacer::onProxyWrite(void* pacerPtr, const std::uint8_t* data, int size) {
+    if (nullptr == pacerPtr) {
+        std::cerr << "{OutputPacer::onProxyWrite}; pointer to output pacer is NULL" << std::endl;
+        return AVERROR(EINVAL);
+    }
+    if (size < 0) {
+        std::cerr << "{OutputPacer::onProxyWrite}; size is less than zero" << std::endl;
+        return AVERROR(EINVAL);
+    }
+    auto pacer = static_cast<OutputPacer*>(pacerPtr);
+    if (!pacer->write(data, static_cast<std::size_t>(size))) {
+        return AVERROR(EIO);
+    }
+    return size;
+}
+
+bool OutputPacer::write(const std::uint8_t* data, std::size_t size) {
+    for (std::size_t offset = 0; offset < size; offset += m_settings.chunkSize) {
+        auto nChunkBytes = std::min(m_settings.chunkSize, size - offset);
+
+        /* tokens of an idle period are capped at the burst size */
+        auto curTime = getMonotonicTime();
+        m_releaseTime = std::max(m_releaseTime, curTime - m_burstDuration);
+        if (m_releaseTime > curTime) {
+            waitUntil(m_releaseTime);
+            auto wakeTime = getMonotonicTime();
+            m_errorHistogram->record((wakeTime - m_releaseTime) / 1000);
+            m_metrics->add(StreamMetrics::Metric::PacingWaitTime, static_cast<std::uint64_t>((wakeTime - curTime) / 1000));
+            m_timeoutChecker->restartBeginTime();
+        }
+
+        avio_write(m_targetContext, data + offset, static_cast<int>(nChunkBytes));
+        avio_flush(m_targetContext);
+        if (m_targetContext->error < 0) {
+            /* the error is handed to the muxer; the output itself stays usable for a writer that drops */
+            auto writeResult = m_targetContext->error;
+            m_targetContext->error = 0;
+            std::cerr << "{OutputPacer::write}; unable to write chunk to output; "
+                "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+            return false;
+        }
+        m_releaseTime += static_cast<std::int64_t>(nChunkBytes) * g_bitsPerByte * g_nanosecondsPerSecond / m_settings.rate;
+        m_metrics->add(StreamMetrics::Metric::PacedChunks);
+    }
+    return true;
+}
+
+void OutputPacer::waitUntil(std::int64_t time) {
+    auto sleepEndTime = time - g_spinDuration;
+    if (sleepEndTime > getMonotonicTime()) {
+        timespec sleepEnd{
+            .tv_sec = static_cast<time_t>(sleepEndTime / g_nanosecondsPerSecond),
+            .tv_nsec = static_cast<long>(sleepEndTime % g_nanosecondsPerSecond)
+        };
+        /* absolute, so an interrupted sleep is simply resumed */
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &sleepEnd, nullptr)) {
+        }
+    }
+    while (getMonotonicTime() < time) {
+    }
+}
@@ -0,0 +1,227 @@
+#include "output_protocol.h"
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavformat/avio.h>
+    #include <libavutil/dict.h>
+    #include <libavutil/error.h>
+}
+
+#include <cstring>
+#include <iostream>
+
+#include <frozen/string.h>
+#include <frozen/unordered_map.h>
+
+#include <Poco/URI.h>
+
+#include "common_functions.h"
+
+namespace {
+    constexpr frozen::unordered_map<frozen::string, OutputProtocol::Type, 4> g_schemes = {
+        { "rtmp", OutputProtocol::Type::Rtmp },
+        { "tcp", OutputProtocol::Type::Tcp },
+        { "udp", OutputProtocol::Type::Udp },
+        { "srt", OutputProtocol::Type::Srt }
+    };
+    /* 7 TS packets of 188 bytes fit into an Ethernet frame */
+    constexpr int g_tsDatagramSize = 1316;
+    constexpr std::int64_t g_defaultSrtLatency = 120000; // in microseconds
+
+    bool setOption(AVDictionary** options, const char* key, const char* value) {
+        auto setResult = av_dict_set(options, key, value, 0);
+        if (setResult < 0) {
+            std::cerr << "{OutputProtocol::fillOptions}; unable to set key-value pair; "
+                "key: '" << key << "'; "
+                "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool setOption(AVDictionary** options, const char* key, std::int64_t value) {
+        auto setResult = av_dict_set_int(options, key, value, 0);
+        if (setResult < 0) {
+            std::cerr << "{OutputProtocol::fillOptions}; unable to set key-value pair; "
+                "key: '" << key << "'; "
+                "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+std::optional<OutputProtocol::Type> OutputProtocol::getType(const std::string& url) {
+    std::string scheme;
+    try {
+        scheme = Poco::URI(url).getScheme();
+    } catch (...) {
+        std::cerr << "{OutputProtocol::getType}; unable to parse URL; "
+            "URL: '" << url << "'" << std::endl;
+        return std::nullopt;
+    }
+    frozen::string frozenScheme(scheme.c_str(), scheme.size());
+    auto itScheme = g_schemes.find(frozenScheme);
+    if (g_schemes.end() == itScheme) {
+        std::cerr << "{OutputProtocol::getType}; URL scheme is NOT supported; "
+            "scheme: '" << scheme << "'" << std::endl;
+        return std::nullopt;
+    }
+    return std::make_optional<Type>(itScheme->second);
+}
+
+const char* OutputProtocol::getName(Type type) {
+    switch (type) {
+        case Type::Rtmp: return "rtmp";
+        case Type::Tcp: return "tcp";
+        case Type::Udp: return "udp";
+        case Type::Srt: return "srt";
+    }
+    return "";
+}
+
+const char* OutputProtocol::getFormatName(Type type) {
+    switch (type) {
+        case Type::Rtmp:
+        case Type::Tcp:
+            return "flv";
+        case Type::Udp:
+        case Type::Srt:
+            return "mpegts";
+    }
+    return "";
+}
+
+OutputProtocol::Backpressure OutputProtocol::getBackpressure(Type type) {
+    switch (type) {
+        case Type::Rtmp:
+        case Type::Tcp:
+            return Backpressure::Fail;
+        case Type::Udp:
+        case Type::Srt:
+            return Backpressure::Drop;
+    }
+    return Backpressure::Fail;
+}
+
+OutputProtocol::Settings OutputProtocol::getDefaultSettings(Type type) {
+    Settings settings;
+    if ((Type::Udp == type) || (Type::Srt == type)) {
+        settings.packetSize = g_tsDatagramSize;
+    }
+    if (Type::Srt == type) {
+        settings.latency = g_defaultSrtLatency;
+    }
+    return settings;
+}
+
+bool OutputProtocol::fillOptions(Type type, const Settings& settings, AVDictionary** options) {
+    if (nullptr == options) {
+        std::cerr << "{OutputProtocol::fillOptions}; pointer to dictionary is NULL" << std::endl;
+        return false;
+    }
+
+    switch (type) {
+        case Type::Rtmp:
+            return setOption(options, "protocol_whitelist", "tcp,rtmp");
+        case Type::Tcp:
+            return setOption(options, "protocol_whitelist", "tcp");
+        case Type::Udp:
+            if (!setOption(options, "protocol_whitelist", "udp")) {
+                return false;
+            }
+            if ((settings.packetSize > 0) && !setOption(options, "pkt_size", settings.packetSize)) {
+                return false;
+            }
+            if ((settings.ttl > 0) && !setOption(options, "ttl", settings.ttl)) {
+                return false;
+            }
+            if ((settings.sendBufferSize > 0) && !setOption(options, "buffer_size", settings.sendBufferSize)) {
+                return false;
+            }
+            if (!settings.localAddress.empty() && !setOption(options, "localaddr", settings.localAddress.c_str())) {
+                return false;
+            }
+            return true;
+        case Type::Srt:
+            if (!setOption(options, "protocol_whitelist", "srt")) {
+                return false;
+            }
+            if ((settings.packetSize > 0) && !setOption(options, "payload_size", settings.packetSize)) {
+                return false;
+            }
+            if ((settings.latency > 0) && !setOption(options, "latency", settings.latency)) {
+                return false;
+            }
+            if (!settings.passphrase.empty() && !setOption(options, "passphrase", settings.passphrase.c_str())) {
+                return false;
+            }
+            if (!settings.streamId.empty() && !setOption(options, "streamid", settings.streamId.c_str())) {
+                return false;
+            }
+            if ((settings.maxBandwidth > 0) && !setOption(options, "maxbw", settings.maxBandwidth)) {
+                return false;
+            }
+            return true;
+    }
+    return false;
+}
+
+bool OutputProtocol::openOutput(
+    AVFormatContext* outputContext, const std::string& url, Type type, const Settings& settings,
+    const AVIOInterruptCB& interruptCallback,
+    const std::vector<std::pair<const char*, std::string>>& extraOptions
+) {
+    if (nullptr == outputContext) {
+        std::cerr << "{OutputProtocol::openOutput}; pointer to output context is NULL" << std::endl;
+        return false;
+    }
+    if (outputContext->pb) {
+        std::cerr << "{OutputProtocol::openOutput}; pointer to bytestream output context is already set" << std::endl;
+        return false;
+    }
+    auto hostName = CommonFunctions::extractHostNameFromRtmpUrl(url);
+    if (!hostName.has_value()) {
+        return false;
+    }
+    if (!CommonFunctions::isHostNameValid(hostName.value())) {
+        return false;
+    }
+
+    AVDictionary* options = nullptr;
+    if (!fillOptions(type, settings, &options)) {
+        av_dict_free(&options);
+        return false;
+    }
+    for (const auto& [key, value] : extraOptions) {
+        auto setResult = av_dict_set(&options, key, value.c_str(), 0);
+        if (setResult < 0) {
+            std::cerr << "{OutputProtocol::openOutput}; unable to set key-value pair; "
+                "key: '" << key << "'; "
+                "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+            av_dict_free(&options);
+            return false;
+        }
+    }
+
+    /* the interrupt callback is copied by avio_open2 */
+    auto initResult = avio_open2(&outputContext->pb, url.c_str(), AVIO_FLAG_WRITE, &interruptCallback, &options);
+    if (options) {
+        std::cerr << "{OutputProtocol::openOutput}; options of the protocol were NOT consumed" << std::endl;
+        av_dict_free(&options);
+        if (initResult >= 0) {
+            avio_closep(&outputContext->pb);
+        }
+        return false;
+    }
+    if (initResult < 0) {
+        std::cerr << "{OutputProtocol::openOutput}; unable to initialize output context; "
+            "initialize result: '" << initResult << " (" << av_err2str(initResult) << ")'" << std::endl;
+        return false;
+    }
+    if (nullptr == outputContext->pb) {
+        std::cerr << "{OutputProtocol::openOutput}; pointer to bytestream output context is NULL" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+#include "output_rate_meter.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    constexpr std::uint64_t g_bitsPerByte = 8;
+    constexpr std::uint64_t g_microsecondsPerSecond = 1000000;
+}
+
+bool OutputRateMeter::setup(std::int64_t window, std::int64_t period) {
+    if (window <= 0) {
+        std::cerr << "{OutputRateMeter::setup}; window is NOT positive" << std::endl;
+        return false;
+    }
+    if (period < window) {
+        std::cerr << "{OutputRateMeter::setup}; period is shorter than window" << std::endl;
+        return false;
+    }
+    m_window = window;
+    m_nPeriodWindows = static_cast<std::size_t>(period / window);
+    m_windowStartTime.reset();
+    m_windowBytes = 0;
+    m_periodBytes = 0;
+    m_periodPeakBytes = 0;
+    m_nClosedWindows = 0;
+    m_peakRate.store(0, std::memory_order_relaxed);
+    m_averageRate.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void OutputRateMeter::add(std::uint64_t nBytes, std::int64_t time) {
+    if (0 == m_nPeriodWindows) {
+        return;
+    }
+    if (!m_windowStartTime.has_value()) {
+        m_windowStartTime = time;
+    }
+    if (time >= (m_windowStartTime.value() + m_window)) {
+        auto nElapsedWindows = (time - m_windowStartTime.value()) / m_window;
+        /* after a long pause the empty windows of one period are enough to report it */
+        auto nClosingWindows = std::min<std::int64_t>(nElapsedWindows, static_cast<std::int64_t>(m_nPeriodWindows) + 1);
+        for (std::int64_t i = 0; i < nClosingWindows; ++i) {
+            closeWindow();
+        }
+        m_windowStartTime = m_windowStartTime.value() + nElapsedWindows * m_window;
+    }
+    m_windowBytes += nBytes;
+}
+
+double OutputRateMeter::getPeakToAverageRatio() const {
+    auto averageRate = getAverageRate();
+    if (0 == averageRate) {
+        return 0.0;
+    }
+    return static_cast<double>(getPeakRate()) / static_cast<double>(averageRate);
+}
+
+void OutputRateMeter::closeWindow() {
+    m_periodBytes += m_windowBytes;
+    m_periodPeakBytes = std::max(m_periodPeakBytes, m_windowBytes);
+    m_windowBytes = 0;
+    ++m_nClosedWindows;
+    if (m_nClosedWindows < m_nPeriodWindows) {
+        return;
+    }
+
+    auto window = static_cast<std::uint64_t>(m_window);
+    m_peakRate.store(
+        m_periodPeakBytes * g_bitsPerByte * g_microsecondsPerSecond / window, std::memory_order_relaxed
+    );
+    m_averageRate.store(
+        m_periodBytes * g_bitsPerByte * g_microsecondsPerSecond / (window * m_nPeriodWindows), std::memory_order_relaxed
+    );
+    m_periodBytes = 0;
+    m_periodPeakBytes = 0;
+    m_nClosedWindows = 0;
+}
@@ -0,0 +1,1017 @@
+#include "output_reactor.h"
+
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    constexpr unsigned int g_ringEntries = 256;
+    /* buffers are aligned for O_DIRECT */
+    constexpr std::size_t g_bufferAlignment = 4096;
+    constexpr auto g_waitInterval = std::chrono::milliseconds(10);
+    constexpr int g_maxEpollEvents = 64;
+    /* user data of the poll on the event descriptor; targets use their address */
+    constexpr std::uint64_t g_eventUserData = 0;
+    constexpr std::size_t g_noBuffer = static_cast<std::size_t>(-1);
+
+    /* submission and completion queue of io_uring, without liburing;
+     * only the reactor thread of the ring uses it */
+    class UringQueue {
+    public:
+        UringQueue() = default;
+        UringQueue(const UringQueue& other) = delete;
+        UringQueue& operator=(const UringQueue& other) = delete;
+        ~UringQueue() { close(); }
+        UringQueue(UringQueue&& other) = delete;
+        UringQueue& operator=(UringQueue&& other) = delete;
+
+        bool setup(unsigned int nEntries) {
+            io_uring_params params{};
+            m_ringFd = static_cast<int>(syscall(__NR_io_uring_setup, nEntries, &params));
+            if (m_ringFd < 0) {
+                m_ringFd = -1;
+                return false;
+            }
+            /* send, write and poll-driven retries need Linux 5.7 */
+            if (!(IORING_FEAT_FAST_POLL & params.features)) {
+                close();
+                errno = ENOSYS;
+                return false;
+            }
+
+            m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+            m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool isSingleMmap = (IORING_FEAT_SINGLE_MMAP & params.features);
+            if (isSingleMmap) {
+                m_sqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+                m_cqRingSize = m_sqRingSize;
+            }
+            m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+            if (MAP_FAILED == m_sqRing) {
+                m_sqRing = nullptr;
+                close();
+                return false;
+            }
+            if (isSingleMmap) {
+                m_cqRing = m_sqRing;
+            } else {
+                m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+                if (MAP_FAILED == m_cqRing) {
+                    m_cqRing = nullptr;
+                    close();
+                    return false;
+                }
+            }
+            m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            auto sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+            if (MAP_FAILED == sqes) {
+                close();
+                return false;
+            }
+            m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+            auto sqRing = static_cast<char*>(m_sqRing);
+            m_sqHead = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.head);
+            m_sqTail = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.tail);
+            m_sqMask = *reinterpret_cast<unsigned int*>(sqRing + params.sq_off.ring_mask);
+            m_sqArray = reinterpret_cast<unsigned int*>(sqRing + params.sq_off.array);
+            m_nSqEntries = params.sq_entries;
+            m_sqLocalTail = *m_sqTail;
+
+            auto cqRing = static_cast<char*>(m_cqRing);
+            m_cqHead = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.head);
+            m_cqTail = reinterpret_cast<unsigned int*>(cqRing + params.cq_off.tail);
+            m_cqMask = *reinterpret_cast<unsigned int*>(cqRing + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+            return true;
+        }
+
+        void close() {
+            if (m_sqes) {
+                munmap(m_sqes, m_sqesSize);
+                m_sqes = nullptr;
+            }
+            if (m_cqRing && (m_cqRing != m_sqRing)) {
+                munmap(m_cqRing, m_cqRingSize);
+            }
+            m_cqRing = nullptr;
+            if (m_sqRing) {
+                munmap(m_sqRing, m_sqRingSize);
+                m_sqRing = nullptr;
+            }
+            if (-1 != m_ringFd) {
+                ::close(m_ringFd);
+                m_ringFd = -1;
+            }
+        }
+
+        bool registerBuffers(const iovec* vectors, unsigned int nVectors) {
+            return (0 == syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_BUFFERS, vectors, nVectors));
+        }
+
+        /* NULL while the submission queue is full */
+        io_uring_sqe* getSqe() {
+            auto head = std::atomic_ref<unsigned int>(*m_sqHead).load(std::memory_order_acquire);
+            if ((m_sqLocalTail - head) >= m_nSqEntries) {
+                return nullptr;
+            }
+            auto index = m_sqLocalTail & m_sqMask;
+            auto* sqe = &m_sqes[ index ];
+            std::memset(sqe, 0, sizeof(*sqe));
+            m_sqArray[ index ] = index;
+            ++m_sqLocalTail;
+            ++m_nPendingSqes;
+            return sqe;
+        }
+
+        /* submits the prepared entries and waits for 'nMinCompletions' */
+        bool submit(unsigned int nMinCompletions) {
+            std::atomic_ref<unsigned int>(*m_sqTail).store(m_sqLocalTail, std::memory_order_release);
+            auto flags = (nMinCompletions > 0) ? IORING_ENTER_GETEVENTS : 0U;
+            auto enterResult = syscall(__NR_io_uring_enter, m_ringFd, m_nPendingSqes, nMinCompletions, flags, nullptr, 0);
+            if (enterResult < 0) {
+                /* interrupted, or completions have to be reaped first */
+                return ((EINTR == errno) || (EAGAIN == errno) || (EBUSY == errno));
+            }
+            m_nPendingSqes -= std::min(m_nPendingSqes, static_cast<unsigned int>(enterResult));
+            return true;
+        }
+
+        template<typename Handler>
+        void reap(Handler&& handler) {
+            auto head = *m_cqHead;
+            auto tail = std::atomic_ref<unsigned int>(*m_cqTail).load(std::memory_order_acquire);
+            while (head != tail) {
+                const auto& cqe = m_cqes[ head & m_cqMask ];
+                auto userData = cqe.user_data;
+                auto result = cqe.res;
+                ++head;
+                std::atomic_ref<unsigned int>(*m_cqHead).store(head, std::memory_order_release);
+                handler(userData, result);
+            }
+        }
+
+    private:
+        int m_ringFd = -1;
+        void* m_sqRing = nullptr;
+        void* m_cqRing = nullptr;
+        std::size_t m_sqRingSize = 0;
+        std::size_t m_cqRingSize = 0;
+        std::size_t m_sqesSize = 0;
+
+        unsigned int* m_sqHead = nullptr;
+        unsigned int* m_sqTail = nullptr;
+        unsigned int* m_sqArray = nullptr;
+        unsigned int m_sqMask = 0;
+        unsigned int m_nSqEntries = 0;
+        unsigned int m_sqLocalTail = 0;
+        unsigned int m_nPendingSqes = 0;
+        io_uring_sqe* m_sqes = nullptr;
+
+        unsigned int* m_cqHead = nullptr;
+        unsigned int* m_cqTail = nullptr;
+        unsigned int m_cqMask = 0;
+        io_uring_cqe* m_cqes = nullptr;
+    };
+}
+
+class OutputReactor::Target : public std::enable_shared_from_this<OutputReactor::Target> {
+public:
+    enum class Operation {
+        None,
+        Write,
+        Poll,
+        Sync
+    };
+
+    struct Buffer {
+        /* 'g_noBuffer' for a synchronization without data */
+        std::size_t index = g_noBuffer;
+        std::size_t size = 0;
+        std::size_t nWrittenBytes = 0;
+        std::uint64_t offset = 0;
+        bool isSync = false;
+    };
+
+    int fileDescriptor = -1;
+    bool isSocket = false;
+    std::shared_ptr<Ring> ring{ nullptr };
+
+    /* guarded by the mutex of the ring */
+    std::optional<std::size_t> currentBuffer{ std::nullopt };
+    std::size_t currentSize = 0;
+    bool isCopying = false;
+    /* the front buffer is the one the reactor works on */
+    std::deque<Buffer> buffers;
+    std::uint64_t nextOffset = 0;
+    bool isScheduled = false;
+    bool isBusy = false;
+    bool isFailed = false;
+    int error = 0;
+    bool isUnregistered = false;
+
+    /* reactor thread only */
+    Operation operation = Operation::None;
+
+    std::atomic<std::uint64_t> nQueuedBytes{ 0 };
+    std::atomic<std::uint64_t> nSubmissions{ 0 };
+    std::atomic<std::uint64_t> nWrittenBytes{ 0 };
+};
+
+struct OutputReactor::Ring {
+    Ring() = default;
+    Ring(const Ring& other) = delete;
+    Ring& operator=(const Ring& other) = delete;
+    ~Ring();
+    Ring(Ring&& other) = delete;
+    Ring& operator=(Ring&& other) = delete;
+
+    bool setup(bool isUringPreferred);
+    std::uint8_t* getBuffer(std::size_t index) const { return bufferMemory + index * s_bufferSize; }
+    void wakeUp() const;
+
+    /* the caller holds the mutex */
+    void queueCurrentBuffer(Target& target, bool isSync);
+    void scheduleTarget(Target& target);
+    void completeBuffer(Target& target);
+    void failTarget(Target& target, int error);
+    void releaseBuffers(Target& target, bool isFrontKept);
+
+    /* reactor thread */
+    std::vector<std::shared_ptr<Target>> takeReadyTargets();
+    void runUring();
+    void startUringOperation(const std::shared_ptr<Target>& target, bool isContinuation);
+    void onUringCompletion(Target& target, int result);
+    void runEpoll();
+    void processEpollTarget(const std::shared_ptr<Target>& target, bool isContinuation);
+    /* returns false and clears the busy flag when there is nothing to write */
+    bool beginOperation(const std::shared_ptr<Target>& target, bool isContinuation, Target::Buffer& buffer);
+
+    Backend backend = Backend::Epoll;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::uint8_t* bufferMemory = nullptr;
+    std::vector<std::size_t> freeBuffers;
+    std::vector<std::shared_ptr<Target>> readyTargets;
+    std::size_t nTargets = 0;
+    bool isStopped = false;
+    int eventFd = -1;
+    std::thread thread;
+
+    /* reactor thread only; keeps targets alive while the kernel uses their buffers */
+    std::unordered_map<Target*, std::shared_ptr<Target>> busyTargets;
+    UringQueue uring;
+    bool isFixedBuffers = false;
+    int epollFd = -1;
+};
+
+OutputReactor::Ring::~Ring() {
+    /* the kernel lets go of the buffers with the ring */
+    uring.close();
+    if (-1 != epollFd) {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+    if (-1 != eventFd) {
+        ::close(eventFd);
+        eventFd = -1;
+    }
+    if (bufferMemory) {
+        std::free(bufferMemory);
+        bufferMemory = nullptr;
+    }
+}
+
+bool OutputReactor::Ring::setup(bool isUringPreferred) {
+    bufferMemory = static_cast<std::uint8_t*>(std::aligned_alloc(g_bufferAlignment, s_bufferSize * s_buffersPerRing));
+    if (nullptr == bufferMemory) {
+        std::cerr << "{OutputReactor::Ring::setup}; unable to allocate memory for buffers" << std::endl;
+        return false;
+    }
+    freeBuffers.clear();
+    for (std::size_t i = s_buffersPerRing; i > 0; --i) {
+        freeBuffers.push_back(i - 1);
+    }
+
+    eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (-1 == eventFd) {
+        std::cerr << "{OutputReactor::Ring::setup}; unable to create event descriptor; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+
+    if (isUringPreferred && uring.setup(g_ringEntries)) {
+        backend = Backend::IoUring;
+        std::vector<iovec> vectors(s_buffersPerRing);
+        for (std::size_t i = 0; i < s_buffersPerRing; ++i) {
+            vectors[ i ] = iovec{ .iov_base = getBuffer(i), .iov_len = s_bufferSize };
+        }
+        /* pinned memory counts against RLIMIT_MEMLOCK on older kernels */
+        isFixedBuffers = uring.registerBuffers(vectors.data(), static_cast<unsigned int>(vectors.size()));
+        if (!isFixedBuffers) {
+            std::cout << "{OutputReactor::Ring::setup}; unable to register buffers, "
+                "files are written from unregistered buffers; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        }
+        return true;
+    }
+
+    backend = Backend::Epoll;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == epollFd) {
+        std::cerr << "{OutputReactor::Ring::setup}; unable to create epoll descriptor; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (0 != epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &event)) {
+        std::cerr << "{OutputReactor::Ring::setup}; unable to add event descriptor to epoll; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OutputReactor::Ring::wakeUp() const {
+    std::uint64_t value = 1;
+    /* EAGAIN means that the counter is full, i.e. a wake-up is pending anyway */
+    [[maybe_unused]] auto writeResult = ::write(eventFd, &value, sizeof(value));
+}
+
+void OutputReactor::Ring::queueCurrentBuffer(Target& target, bool isSync) {
+    if (target.currentBuffer.has_value()) {
+        if (target.currentSize > 0) {
+            target.buffers.push_back(Target::Buffer{
+                .index = target.currentBuffer.value(), .size = target.currentSize,
+                .nWrittenBytes = 0, .offset = target.nextOffset, .isSync = isSync
+            });
+            target.nextOffset += target.currentSize;
+        } else {
+            freeBuffers.push_back(target.currentBuffer.value());
+            condition.notify_all();
+        }
+        target.currentBuffer.reset();
+        target.currentSize = 0;
+        if (!target.buffers.empty() && isSync) {
+            target.buffers.back().isSync = true;
+        }
+        return;
+    }
+    if (isSync) {
+        if (target.buffers.empty()) {
+            target.buffers.push_back(Target::Buffer{ .offset = target.nextOffset, .isSync = true });
+        } else {
+            target.buffers.back().isSync = true;
+        }
+    }
+}
+
+void OutputReactor::Ring::scheduleTarget(Target& target) {
+    if (target.isBusy || target.isScheduled || target.buffers.empty()) {
+        return;
+    }
+    target.isScheduled = true;
+    readyTargets.push_back(target.shared_from_this());
+    wakeUp();
+}
+
+void OutputReactor::Ring::completeBuffer(Target& target) {
+    if (target.buffers.empty()) {
+        return;
+    }
+    auto index = target.buffers.front().index;
+    target.buffers.pop_front();
+    if (g_noBuffer != index) {
+        freeBuffers.push_back(index);
+    }
+    /* data that was written while the socket was busy goes out right away */
+    if (
+        target.isSocket && target.buffers.empty() && !target.isUnregistered &&
+        (target.currentSize > 0) && !target.isCopying
+    ) {
+        queueCurrentBuffer(target, false);
+    }
+    condition.notify_all();
+}
+
+void OutputReactor::Ring::failTarget(Target& target, int error) {
+    /* a socket that is shut down for unregistering fails as expected */
+    if (!target.isFailed && !target.isUnregistered) {
+        std::cerr << "{OutputReactor::Ring::failTarget}; unable to write to descriptor '" << target.fileDescriptor << "'; "
+            "errno: '" << error << " (" << std::strerror(error) << ")'" << std::endl;
+    }
+    target.isFailed = true;
+    target.error = error;
+    releaseBuffers(target, false);
+    condition.notify_all();
+}
+
+void OutputReactor::Ring::releaseBuffers(Target& target, bool isFrontKept) {
+    std::deque<Target::Buffer> keptBuffers;
+    if (isFrontKept && !target.buffers.empty()) {
+        keptBuffers.push_back(target.buffers.front());
+        target.buffers.pop_front();
+    }
+    for (const auto& buffer : target.buffers) {
+        if (g_noBuffer != buffer.index) {
+            freeBuffers.push_back(buffer.index);
+        }
+    }
+    target.buffers.swap(keptBuffers);
+    if (target.currentBuffer.has_value() && !target.isCopying) {
+        freeBuffers.push_back(target.currentBuffer.value());
+        target.currentBuffer.reset();
+        target.currentSize = 0;
+    }
+    std::uint64_t nQueuedBytes = target.currentSize;
+    for (const auto& buffer : target.buffers) {
+        nQueuedBytes += buffer.size - buffer.nWrittenBytes;
+    }
+    target.nQueuedBytes.store(nQueuedBytes, std::memory_order_relaxed);
+}
+
+std::vector<std::shared_ptr<OutputReactor::Target>> OutputReactor::Ring::takeReadyTargets() {
+    std::vector<std::shared_ptr<Target>> targets;
+    std::lock_guard<std::mutex> lock(mutex);
+    targets.swap(readyTargets);
+    for (auto& target : targets) {
+        target->isScheduled = false;
+    }
+    return targets;
+}
+
+bool OutputReactor::Ring::beginOperation(const std::shared_ptr<Target>& target, bool isContinuation, Target::Buffer& buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!isContinuation && target->isBusy) {
+        /* scheduled again while the reactor was already working on it */
+        return false;
+    }
+    if (target->buffers.empty() || target->isFailed || isStopped) {
+        target->isBusy = false;
+        busyTargets.erase(target.get());
+        condition.notify_all();
+        return false;
+    }
+    target->isBusy = true;
+    busyTargets.emplace(target.get(), target);
+    buffer = target->buffers.front();
+    return true;
+}
+
+void OutputReactor::Ring::runUring() {
+    auto armEventPoll = [this] () {
+        auto* sqe = uring.getSqe();
+        if (nullptr == sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = eventFd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = g_eventUserData;
+        return true;
+    };
+    bool isEventPollArmed = armEventPoll();
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (isStopped) {
+                break;
+            }
+        }
+        for (const auto& target : takeReadyTargets()) {
+            startUringOperation(target, false);
+        }
+        if (!isEventPollArmed) {
+            isEventPollArmed = armEventPoll();
+        }
+        if (!uring.submit(1)) {
+            std::cerr << "{OutputReactor::Ring::runUring}; unable to submit to ring; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+            std::this_thread::sleep_for(g_waitInterval);
+        }
+        uring.reap([this, &isEventPollArmed] (std::uint64_t userData, int result) {
+            if (g_eventUserData == userData) {
+                std::uint64_t value = 0;
+                [[maybe_unused]] auto readResult = ::read(eventFd, &value, sizeof(value));
+                isEventPollArmed = false;
+                return;
+            }
+            auto it = busyTargets.find(reinterpret_cast<Target*>(userData));
+            if (busyTargets.end() != it) {
+                /* the completion may release the last reference */
+                auto target = it->second;
+                onUringCompletion(*target, result);
+            }
+        });
+    }
+}
+
+void OutputReactor::Ring::startUringOperation(const std::shared_ptr<Target>& target, bool isContinuation) {
+    Target::Buffer buffer;
+    if (!beginOperation(target, isContinuation, buffer)) {
+        return;
+    }
+    auto* sqe = uring.getSqe();
+    while (nullptr == sqe) {
+        uring.submit(0);
+        sqe = uring.getSqe();
+    }
+    sqe->fd = target->fileDescriptor;
+    sqe->user_data = reinterpret_cast<std::uint64_t>(target.get());
+
+    if (buffer.nWrittenBytes == buffer.size) {
+        /* only a sync buffer gets here with all of its data written */
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        target->operation = Target::Operation::Sync;
+        return;
+    }
+    auto* data = getBuffer(buffer.index) + buffer.nWrittenBytes;
+    auto size = buffer.size - buffer.nWrittenBytes;
+    if (target->isSocket) {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+    } else {
+        sqe->opcode = isFixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->buf_index = static_cast<std::uint16_t>(buffer.index);
+        sqe->off = buffer.offset + buffer.nWrittenBytes;
+    }
+    sqe->addr = reinterpret_cast<std::uint64_t>(data);
+    sqe->len = static_cast<std::uint32_t>(size);
+    target->operation = Target::Operation::Write;
+    target->nSubmissions.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OutputReactor::Ring::onUringCompletion(Target& target, int result) {
+    auto operation = target.operation;
+    target.operation = Target::Operation::None;
+    auto targetPtr = target.shared_from_this();
+
+    if (Target::Operation::Poll == operation) {
+        startUringOperation(targetPtr, true);
+        return;
+    }
+    if ((-EAGAIN == result) && target.isSocket) {
+        /* the socket buffer is full; send again once it has room */
+        auto* sqe = uring.getSqe();
+        while (nullptr == sqe) {
+            uring.submit(0);
+            sqe = uring.getSqe();
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = target.fileDescriptor;
+        sqe->poll32_events = POLLOUT;
+        sqe->user_data = reinterpret_cast<std::uint64_t>(&target);
+        target.operation = Target::Operation::Poll;
+        return;
+    }
+    if ((-EINTR == result) || (-EAGAIN == result)) {
+        startUringOperation(targetPtr, true);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result < 0) {
+            failTarget(target, -result);
+        } else if ((0 == result) && (Target::Operation::Write == operation)) {
+            failTarget(target, EIO);
+        } else if (!target.buffers.empty()) {
+            auto& buffer = target.buffers.front();
+            if (Target::Operation::Write == operation) {
+                auto nBytes = static_cast<std::size_t>(result);
+                buffer.nWrittenBytes += nBytes;
+                target.nWrittenBytes.fetch_add(nBytes, std::memory_order_relaxed);
+                target.nQueuedBytes.fetch_sub(nBytes, std::memory_order_relaxed);
+            }
+            bool isDone = (buffer.nWrittenBytes == buffer.size) &&
+                (!buffer.isSync || (Target::Operation::Sync == operation));
+            if (isDone) {
+                completeBuffer(target);
+            }
+        }
+    }
+    startUringOperation(targetPtr, true);
+}
+
+void OutputReactor::Ring::runEpoll() {
+    epoll_event events[ g_maxEpollEvents ];
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (isStopped) {
+                break;
+            }
+        }
+        for (const auto& target : takeReadyTargets()) {
+            processEpollTarget(target, false);
+        }
+        auto nEvents = epoll_wait(epollFd, events, g_maxEpollEvents, -1);
+        if ((nEvents < 0) && (EINTR != errno)) {
+            std::cerr << "{OutputReactor::Ring::runEpoll}; unable to wait for events; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+            std::this_thread::sleep_for(g_waitInterval);
+        }
+        for (int i = 0; i < nEvents; ++i) {
+            if (nullptr == events[ i ].data.ptr) {
+                std::uint64_t value = 0;
+                [[maybe_unused]] auto readResult = ::read(eventFd, &value, sizeof(value));
+                continue;
+            }
+            auto it = busyTargets.find(static_cast<Target*>(events[ i ].data.ptr));
+            if (busyTargets.end() != it) {
+                auto target = it->second;
+                processEpollTarget(target, true);
+            }
+        }
+    }
+}
+
+void OutputReactor::Ring::processEpollTarget(const std::shared_ptr<Target>& target, bool isContinuation) {
+    Target::Buffer buffer;
+    while (beginOperation(target, isContinuation, buffer)) {
+        isContinuation = true;
+        int error = 0;
+        std::size_t nBytes = 0;
+        bool isWritable = true;
+        if (buffer.nWrittenBytes < buffer.size) {
+            auto* data = getBuffer(buffer.index) + buffer.nWrittenBytes;
+            auto size = buffer.size - buffer.nWrittenBytes;
+            target->nSubmissions.fetch_add(1, std::memory_order_relaxed);
+            ssize_t writeResult = -1;
+            do {
+                writeResult = target->isSocket ?
+                    ::send(target->fileDescriptor, data, size, MSG_NOSIGNAL | MSG_DONTWAIT) :
+                    ::pwrite(target->fileDescriptor, data, size, static_cast<off_t>(buffer.offset + buffer.nWrittenBytes));
+            } while ((writeResult < 0) && (EINTR == errno));
+            if (writeResult > 0) {
+                nBytes = static_cast<std::size_t>(writeResult);
+            } else if ((writeResult < 0) && target->isSocket && ((EAGAIN == errno) || (EWOULDBLOCK == errno))) {
+                isWritable = false;
+            } else {
+                error = (writeResult < 0) ? errno : EIO;
+            }
+        } else if (buffer.isSync && (0 != fdatasync(target->fileDescriptor))) {
+            error = errno;
+        }
+
+        if (!isWritable) {
+            /* one-shot, so the socket is NOT reported again until it is armed again */
+            epoll_event event{};
+            event.events = EPOLLOUT | EPOLLONESHOT;
+            event.data.ptr = target.get();
+            if (0 != epoll_ctl(epollFd, EPOLL_CTL_MOD, target->fileDescriptor, &event)) {
+                if ((ENOENT != errno) || (0 != epoll_ctl(epollFd, EPOLL_CTL_ADD, target->fileDescriptor, &event))) {
+                    error = errno;
+                }
+            }
+            if (0 == error) {
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (0 != error) {
+            failTarget(*target, error);
+            continue;
+        }
+        if (target->buffers.empty()) {
+            continue;
+        }
+        auto& frontBuffer = target->buffers.front();
+        frontBuffer.nWrittenBytes += nBytes;
+        target->nWrittenBytes.fetch_add(nBytes, std::memory_order_relaxed);
+        target->nQueuedBytes.fetch_sub(nBytes, std::memory_order_relaxed);
+        /* the sync of a buffer follows in the next round */
+        if ((frontBuffer.nWrittenBytes == frontBuffer.size) && (!frontBuffer.isSync || (0 == nBytes))) {
+            completeBuffer(*target);
+        }
+    }
+}
+
+OutputReactor::~OutputReactor() {
+    stop();
+}
+
+bool OutputReactor::start(std::size_t nRings, const ThreadPlacement::Settings& placement) {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (m_isRunning.load(std::memory_order_acquire)) {
+        std::cout << "{OutputReactor::start}; output reactor is already running" << std::endl;
+        return true;
+    }
+    if (0 == nRings) {
+        std::cerr << "{OutputReactor::start}; number of rings is equal to zero" << std::endl;
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Ring>> rings;
+    bool isStarted = false;
+    try {
+        /* all rings use the backend of the first one */
+        bool isUringPreferred = true;
+        for (std::size_t i = 0; i < nRings; ++i) {
+            rings.push_back(std::make_shared<Ring>());
+            if (!rings.back()->setup(isUringPreferred)) {
+                break;
+            }
+            isUringPreferred = (Backend::IoUring == rings.back()->backend);
+        }
+        if (rings.size() == nRings) {
+            for (std::size_t i = 0; i < nRings; ++i) {
+                auto ringPlacement = placement;
+                if (!placement.cpus.empty()) {
+                    ringPlacement.cpus = { placement.cpus[i % placement.cpus.size()] };
+                }
+                rings[ i ]->thread = std::thread(&OutputReactor::runRing, rings[ i ], i, ringPlacement);
+            }
+            isStarted = true;
+        }
+    } catch (const std::system_error& exception) {
+        std::cerr << "{OutputReactor::start}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting rings; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+    } catch (const std::bad_alloc& exception) {
+        std::cerr << "{OutputReactor::start}; "
+            "exception 'std::bad_alloc' was successfully caught while "
+            "starting rings; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+    } catch (...) {
+        std::cerr << "{OutputReactor::start}; "
+            "unknown exception was caught while "
+            "starting rings" << std::endl;
+    }
+
+    if (!isStarted) {
+        for (auto& ring : rings) {
+            {
+                std::lock_guard<std::mutex> lock(ring->mutex);
+                ring->isStopped = true;
+            }
+            if (ring->thread.joinable()) {
+                ring->wakeUp();
+                ring->thread.join();
+            }
+        }
+        return false;
+    }
+
+    m_rings = std::move(rings);
+    m_isRunning.store(true, std::memory_order_release);
+    std::cout << "{OutputReactor::start}; output reactor has been successfully started; "
+        "number of rings: '" << nRings << "'; "
+        "backend: '" << ((Backend::IoUring == m_rings.front()->backend) ? "io_uring" : "epoll") << "'" << std::endl;
+    return true;
+}
+
+void OutputReactor::stop() {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (!m_isRunning.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    for (auto& ring : m_rings) {
+        {
+            std::lock_guard<std::mutex> lock(ring->mutex);
+            ring->isStopped = true;
+        }
+        ring->wakeUp();
+        if (ring->thread.joinable()) {
+            ring->thread.join();
+        }
+
+        /* writes in flight never complete now; targets keep the ring until they are unregistered */
+        std::lock_guard<std::mutex> lock(ring->mutex);
+        for (auto& [targetPtr, target] : ring->busyTargets) {
+            target->isBusy = false;
+            ring->failTarget(*target, ECANCELED);
+        }
+        ring->busyTargets.clear();
+        ring->readyTargets.clear();
+        ring->condition.notify_all();
+    }
+    m_rings.clear();
+    std::cout << "{OutputReactor::stop}; output reactor has been stopped" << std::endl;
+}
+
+std::optional<OutputReactor::Backend> OutputReactor::getBackend() const {
+    if (!isRunning() || m_rings.empty()) {
+        return std::nullopt;
+    }
+    return std::make_optional<Backend>(m_rings.front()->backend);
+}
+
+std::shared_ptr<OutputReactor::Target> OutputReactor::registerTarget(int fileDescriptor, bool isSocket) {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (!m_isRunning.load(std::memory_order_acquire)) {
+        std::cerr << "{OutputReactor::registerTarget}; output reactor is NOT running" << std::endl;
+        return nullptr;
+    }
+    if (fileDescriptor < 0) {
+        std::cerr << "{OutputReactor::registerTarget}; file descriptor is NOT valid" << std::endl;
+        return nullptr;
+    }
+
+    /* the ring with the fewest targets */
+    std::shared_ptr<Ring> selectedRing{ nullptr };
+    std::size_t nSelectedTargets = 0;
+    for (const auto& ring : m_rings) {
+        std::lock_guard<std::mutex> lock(ring->mutex);
+        if ((nullptr == selectedRing) || (ring->nTargets < nSelectedTargets)) {
+            selectedRing = ring;
+            nSelectedTargets = ring->nTargets;
+        }
+    }
+
+    std::shared_ptr<Target> target{ nullptr };
+    try {
+        target = std::make_shared<Target>();
+    } catch (const std::bad_alloc& exception) {
+        std::cerr << "{OutputReactor::registerTarget}; "
+            "exception 'std::bad_alloc' was successfully caught while "
+            "allocating target state; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        return nullptr;
+    }
+    target->fileDescriptor = fileDescriptor;
+    target->isSocket = isSocket;
+    target->ring = selectedRing;
+    std::lock_guard<std::mutex> lock(selectedRing->mutex);
+    ++selectedRing->nTargets;
+    return target;
+}
+
+void OutputReactor::unregisterTarget(const std::shared_ptr<Target>& target) {
+    if (nullptr == target) {
+        return;
+    }
+    auto& ring = *target->ring;
+    std::unique_lock<std::mutex> lock(ring.mutex);
+    if (target->isUnregistered) {
+        return;
+    }
+    target->isUnregistered = true;
+    ring.releaseBuffers(*target, target->isBusy);
+    ring.condition.notify_all();
+    ring.condition.wait(lock, [&ring, &target] () {
+        return ring.isStopped || !target->isBusy;
+    });
+    if (!target->buffers.empty()) {
+        ring.releaseBuffers(*target, false);
+    }
+    --ring.nTargets;
+}
+
+bool OutputReactor::write(Target& target, const std::uint8_t* data, std::size_t size, const AVIOInterruptCB* interruptCallback) {
+    if ((nullptr == data) && (size > 0)) {
+        std::cerr << "{OutputReactor::write}; pointer to data is NULL" << std::endl;
+        return false;
+    }
+    auto& ring = *target.ring;
+    while (size > 0) {
+        std::uint8_t* destination = nullptr;
+        std::size_t nCopiedBytes = 0;
+        {
+            std::unique_lock<std::mutex> lock(ring.mutex);
+            while (true) {
+                if (ring.isStopped || target.isUnregistered) {
+                    std::cerr << "{OutputReactor::write}; output reactor is NOT running" << std::endl;
+                    return false;
+                }
+                if (target.isFailed) {
+                    return false;
+                }
+                if (target.currentBuffer.has_value()) {
+                    break;
+                }
+                if (!ring.freeBuffers.empty() && (target.buffers.size() < s_maxBuffersPerTarget)) {
+                    target.currentBuffer = ring.freeBuffers.back();
+                    target.currentSize = 0;
+                    ring.freeBuffers.pop_back();
+                    break;
+                }
+                if (isInterrupted(interruptCallback)) {
+                    std::cerr << "{OutputReactor::write}; waiting for buffer was interrupted; "
+                        "number of queued bytes: '" << target.nQueuedBytes.load(std::memory_order_relaxed) << "'" << std::endl;
+                    return false;
+                }
+                ring.condition.wait_for(lock, g_waitInterval);
+            }
+            target.isCopying = true;
+            destination = ring.getBuffer(target.currentBuffer.value()) + target.currentSize;
+            nCopiedBytes = std::min(size, s_bufferSize - target.currentSize);
+        }
+
+        std::memcpy(destination, data, nCopiedBytes);
+
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        target.isCopying = false;
+        target.currentSize += nCopiedBytes;
+        target.nQueuedBytes.fetch_add(nCopiedBytes, std::memory_order_relaxed);
+        if (target.isFailed || target.isUnregistered) {
+            /* the buffer was kept only because it was being filled */
+            ring.releaseBuffers(target, target.isBusy);
+            return false;
+        }
+        if (s_bufferSize == target.currentSize) {
+            ring.queueCurrentBuffer(target, false);
+            ring.scheduleTarget(target);
+        }
+        data += nCopiedBytes;
+        size -= nCopiedBytes;
+    }
+
+    /* a socket that is idle gets the data at once, a busy one with its next write */
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    if (target.isSocket && !target.isBusy && target.buffers.empty() && (target.currentSize > 0)) {
+        ring.queueCurrentBuffer(target, false);
+        ring.scheduleTarget(target);
+    }
+    return true;
+}
+
+bool OutputReactor::flush(Target& target, bool isSync) {
+    auto& ring = *target.ring;
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    if (ring.isStopped || target.isUnregistered) {
+        std::cerr << "{OutputReactor::flush}; output reactor is NOT running" << std::endl;
+        return false;
+    }
+    if (target.isFailed) {
+        return false;
+    }
+    ring.queueCurrentBuffer(target, isSync && !target.isSocket);
+    ring.scheduleTarget(target);
+    return true;
+}
+
+bool OutputReactor::drain(Target& target, const AVIOInterruptCB* interruptCallback) {
+    if (!flush(target, false)) {
+        return false;
+    }
+    auto& ring = *target.ring;
+    std::unique_lock<std::mutex> lock(ring.mutex);
+    while (target.isBusy || !target.buffers.empty()) {
+        if (ring.isStopped || target.isFailed) {
+            return false;
+        }
+        if (isInterrupted(interruptCallback)) {
+            std::cerr << "{OutputReactor::drain}; waiting for writes was interrupted; "
+                "number of queued bytes: '" << target.nQueuedBytes.load(std::memory_order_relaxed) << "'" << std::endl;
+            return false;
+        }
+        ring.condition.wait_for(lock, g_waitInterval);
+    }
+    return !target.isFailed;
+}
+
+OutputReactor::Stats OutputReactor::getStats(const Target& target) {
+    return Stats{
+        .nQueuedBytes = target.nQueuedBytes.load(std::memory_order_relaxed),
+        .nSubmissions = target.nSubmissions.load(std::memory_order_relaxed),
+        .nWrittenBytes = target.nWrittenBytes.load(std::memory_order_relaxed)
+    };
+}
+
+bool OutputReactor::isInterrupted(const AVIOInterruptCB* interruptCallback) {
+    return interruptCallback && interruptCallback->callback &&
+        (0 != interruptCallback->callback(interruptCallback->opaque));
+}
+
+void OutputReactor::runRing(std::shared_ptr<Ring> ring, std::size_t ringIndex, ThreadPlacement::Settings placement) {
+    auto threadName = "output reactor " + std::to_string(ringIndex);
+    if (!ThreadPlacement::isEmpty(placement)) {
+        ThreadPlacement::apply(threadName, placement);
+    }
+    ThreadPlacement::report(threadName);
+
+    if (Backend::IoUring == ring->backend) {
+        ring->runUring();
+    } else {
+        ring->runEpoll();
+    }
+}
@@ -0,0 +1,540 @@
+#include "overlay_compositor.h"
+
+extern "C" {
+    #include <libavutil/error.h>
+    #include <libavutil/frame.h>
+}
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <utility>
+
+#include "bitmap_font.h"
+#include "common_functions.h"
+#include "row_band_pool.h"
+#include "watermark_cache.h"
+
+namespace {
+    constexpr std::uint8_t g_neutralChroma = 128;
+    constexpr int g_chromaTileSize = OverlayCompositor::s_tileSize / 2;
+    constexpr int g_maxTextScale = 8;
+    constexpr int g_minTileRowsPerBand = 8;
+    constexpr std::size_t g_defaultTextLength = 32;
+    constexpr std::size_t g_maxTextLength = 256;
+    constexpr const char* g_defaultClockFormat = "%Y-%m-%d %H:%M:%S";
+    constexpr AVPixelFormat g_imagePixelFormat = AV_PIX_FMT_YUVA420P;
+    /* a timestamp is drawn as white, black, white, black marker cells and
+     * 64 bits, most significant first, white for one */
+    constexpr int g_timestampCellSize = 8;
+    constexpr int g_nTimestampMarkerCells = 4;
+    constexpr int g_nTimestampCells = g_nTimestampMarkerCells + 64;
+
+    /* exact rounded division of a product of two 8-bit values */
+    inline std::uint8_t divideBy255(unsigned int value) {
+        value += 128;
+        return static_cast<std::uint8_t>((value + (value >> 8)) >> 8);
+    }
+
+    std::uint8_t getAlpha(double opacity) {
+        return static_cast<std::uint8_t>(std::lround(std::clamp(opacity, 0.0, 1.0) * 255.0));
+    }
+
+    bool isTimestampCellSet(std::uint64_t timestamp, int cell) {
+        if (cell < g_nTimestampMarkerCells) {
+            return (0 == cell % 2);
+        }
+        return (0 != ((timestamp >> (g_nTimestampCells - 1 - cell)) & 1));
+    }
+
+    std::string formatClock(const std::string& format, std::int64_t second) {
+        auto timeValue = static_cast<std::time_t>(second);
+        std::tm localTime{};
+        if (nullptr == localtime_r(&timeValue, &localTime)) {
+            return std::string();
+        }
+        char buffer[ g_maxTextLength + 1 ] = { 0 };
+        auto length = std::strftime(buffer, sizeof(buffer), format.c_str(), &localTime);
+        return std::string(buffer, length);
+    }
+}
+
+bool OverlayCompositor::isPixelFormatSupported(AVPixelFormat pixelFormat) {
+    return (AV_PIX_FMT_YUV420P == pixelFormat) || (AV_PIX_FMT_YUVJ420P == pixelFormat);
+}
+
+bool OverlayCompositor::setup(
+    int width, int height, AVPixelFormat pixelFormat,
+    const std::vector<LayerSettings>& layers, StreamMetrics* metrics
+) {
+    clear();
+    if ((width <= 0) || (height <= 0)) {
+        std::cerr << "{OverlayCompositor::setup}; frame size is NOT valid; "
+            "frame size: '" << width << "x" << height << "'" << std::endl;
+        return false;
+    }
+    if (!isPixelFormatSupported(pixelFormat)) {
+        std::cerr << "{OverlayCompositor::setup}; pixel format is NOT supported; "
+            "pixel format: '" << static_cast<int>(pixelFormat) << "'" << std::endl;
+        return false;
+    }
+    if (layers.empty()) {
+        std::cerr << "{OverlayCompositor::setup}; layer list is empty" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{OverlayCompositor::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_pixelFormat = pixelFormat;
+    bool isFullRange = (AV_PIX_FMT_YUVJ420P == pixelFormat);
+    m_blackLuma = isFullRange ? 0 : 16;
+    m_whiteLuma = isFullRange ? 255 : 235;
+    m_metrics = metrics;
+
+    std::vector<Layer> setupLayers(layers.size());
+    for (std::size_t i = 0; i < layers.size(); ++i) {
+        if (!setupLayer(layers[ i ], setupLayers[ i ])) {
+            return false;
+        }
+    }
+    m_layers = std::move(setupLayers);
+
+    std::lock_guard<std::mutex> lock(m_textMutex);
+    for (const auto& layer : m_layers) {
+        if (LayerType::Text == layer.settings.type) {
+            m_textLayerNames.insert(layer.settings.name);
+        }
+    }
+    std::cout << "{OverlayCompositor::setup}; overlay layers have been successfully set up; "
+        "number of layers: '" << m_layers.size() << "'" << std::endl;
+    return true;
+}
+
+void OverlayCompositor::clear() {
+    m_layers.clear();
+    m_width = 0;
+    m_height = 0;
+    m_pixelFormat = AV_PIX_FMT_NONE;
+    m_metrics = nullptr;
+
+    std::lock_guard<std::mutex> lock(m_textMutex);
+    m_textLayerNames.clear();
+    m_pendingTexts.clear();
+    m_hasPendingTexts.store(false, std::memory_order_relaxed);
+}
+
+bool OverlayCompositor::setText(const std::string& layerName, const std::string& text) {
+    std::lock_guard<std::mutex> lock(m_textMutex);
+    if (!m_textLayerNames.contains(layerName)) {
+        std::cerr << "{OverlayCompositor::setText}; text layer was NOT found; "
+            "layer name: '" << layerName << "'" << std::endl;
+        return false;
+    }
+    m_pendingTexts[ layerName ] = text;
+    m_hasPendingTexts.store(true, std::memory_order_release);
+    return true;
+}
+
+bool OverlayCompositor::blend(AVFrame* frame, std::int64_t time) {
+    if (!prepare(frame, time)) {
+        return false;
+    }
+
+    /* the frame may share its buffer with the decoder or the filter graph */
+    auto writableResult = av_frame_make_writable(frame);
+    if (writableResult < 0) {
+        std::cerr << "{OverlayCompositor::blend}; unable to make frame writable; "
+            "writable result: '" << writableResult << " (" << av_err2str(writableResult) << ")'" << std::endl;
+        return false;
+    }
+
+    auto blendBand = [this, frame] (std::size_t, int firstTileRow, int lastTileRow) {
+        blendRows(frame, firstTileRow * s_tileSize, lastTileRow * s_tileSize);
+    };
+    RowBandPool::getInstance().run((m_height + s_tileSize - 1) / s_tileSize, g_minTileRowsPerBand, blendBand);
+    return true;
+}
+
+bool OverlayCompositor::prepare(const AVFrame* frame, std::int64_t time) {
+    if (nullptr == frame) {
+        std::cerr << "{OverlayCompositor::prepare}; pointer to frame is NULL" << std::endl;
+        return false;
+    }
+    if (
+        (frame->format != m_pixelFormat) ||
+        (frame->width != m_width) || (frame->height != m_height)
+    ) {
+        std::cerr << "{OverlayCompositor::prepare}; frame does NOT match overlay setup; "
+            "frame size: '" << frame->width << "x" << frame->height << "'; "
+            "pixel format: '" << frame->format << "'" << std::endl;
+        return false;
+    }
+
+    if (m_hasPendingTexts.exchange(false, std::memory_order_acquire)) {
+        std::map<std::string, std::string> pendingTexts;
+        {
+            std::lock_guard<std::mutex> lock(m_textMutex);
+            pendingTexts.swap(m_pendingTexts);
+        }
+        for (auto& layer : m_layers) {
+            if (LayerType::Text != layer.settings.type) {
+                continue;
+            }
+            auto it = pendingTexts.find(layer.settings.name);
+            if (pendingTexts.end() != it) {
+                drawText(layer, it->second);
+            }
+        }
+    }
+
+    for (auto& layer : m_layers) {
+        updateLayer(layer, time);
+        if (layer.hasDirtyTiles) {
+            m_metrics->add(StreamMetrics::Metric::OverlayTilesRasterized, rasterizeDirtyTiles(layer));
+        }
+    }
+    return true;
+}
+
+void OverlayCompositor::blendRows(AVFrame* frame, int firstRow, int lastRow) const {
+    /* all layers are blended in order, so overlapping layers stack the same way in every band */
+    for (const auto& layer : m_layers) {
+        blendLayer(layer, frame, firstRow, lastRow);
+    }
+}
+
+bool OverlayCompositor::setupLayer(const LayerSettings& settings, Layer& layer) {
+    layer.settings = settings;
+    layer.settings.scale = std::clamp(settings.scale, 1, g_maxTextScale);
+
+    int layerWidth = 0;
+    int layerHeight = 0;
+    if (LayerType::Images == settings.type) {
+        if (settings.fileNames.empty()) {
+            std::cerr << "{OverlayCompositor::setupLayer}; image list is empty" << std::endl;
+            return false;
+        }
+        for (const auto& fileName : settings.fileNames) {
+            auto image = WatermarkCache::getInstance().getFrame(fileName, g_imagePixelFormat);
+            if (nullptr == image) {
+                return false;
+            }
+            layerWidth = std::max(layerWidth, image->width);
+            layerHeight = std::max(layerHeight, image->height);
+            layer.images.push_back(image);
+        }
+    } else if (LayerType::Timestamp == settings.type) {
+        auto cellSize = g_timestampCellSize * layer.settings.scale;
+        layerWidth = g_nTimestampCells * cellSize;
+        layerHeight = cellSize;
+    } else {
+        if (LayerType::Clock == settings.type) {
+            if (layer.settings.text.empty()) {
+                layer.settings.text = g_defaultClockFormat;
+            }
+            if (0 == layer.settings.maxLength) {
+                auto sample = formatClock(layer.settings.text, CommonFunctions::getCurTimeSinceEpoch() / 1000000);
+                layer.settings.maxLength = sample.size();
+            }
+        } else if (0 == layer.settings.maxLength) {
+            layer.settings.maxLength = std::max(g_defaultTextLength, settings.text.size());
+        }
+        layer.settings.maxLength = std::clamp<std::size_t>(layer.settings.maxLength, 1, g_maxTextLength);
+
+        auto cellSize = BitmapFont::s_glyphSize * layer.settings.scale;
+        auto margin = 2 * layer.settings.scale;
+        layerWidth = static_cast<int>(layer.settings.maxLength) * cellSize + 2 * margin;
+        layerHeight = cellSize + 2 * margin;
+    }
+    if ((layerWidth > m_width) || (layerHeight > m_height)) {
+        std::cerr << "{OverlayCompositor::setupLayer}; layer does NOT fit into frame; "
+            "layer size: '" << layerWidth << "x" << layerHeight << "'; "
+            "frame size: '" << m_width << "x" << m_height << "'" << std::endl;
+        return false;
+    }
+
+    /* chroma is subsampled, so layers start at even coordinates */
+    layer.x = (settings.x >= 0) ? settings.x : (m_width + settings.x - layerWidth);
+    layer.y = (settings.y >= 0) ? settings.y : (m_height + settings.y - layerHeight);
+    layer.x = std::clamp(layer.x, 0, m_width - layerWidth) & ~1;
+    layer.y = std::clamp(layer.y, 0, m_height - layerHeight) & ~1;
+
+    layer.tilesWide = (layerWidth + s_tileSize - 1) / s_tileSize;
+    layer.tilesHigh = (layerHeight + s_tileSize - 1) / s_tileSize;
+    layer.stride = static_cast<std::size_t>(layer.tilesWide) * s_tileSize;
+    layer.chromaStride = layer.stride / 2;
+    auto lumaSize = layer.stride * static_cast<std::size_t>(layer.tilesHigh) * s_tileSize;
+    auto chromaSize = lumaSize / 4;
+    layer.canvasY.assign(lumaSize, m_blackLuma);
+    layer.canvasA.assign(lumaSize, 0);
+    layer.canvasU.assign(chromaSize, g_neutralChroma);
+    layer.canvasV.assign(chromaSize, g_neutralChroma);
+    layer.premultipliedY.assign(lumaSize, 0);
+    layer.inverseAlpha.assign(lumaSize, 255);
+    layer.premultipliedU.assign(chromaSize, 0);
+    layer.premultipliedV.assign(chromaSize, 0);
+    layer.inverseChromaAlpha.assign(chromaSize, 255);
+    layer.tileCoverage.assign(static_cast<std::size_t>(layer.tilesWide * layer.tilesHigh), Coverage::Transparent);
+    layer.dirtyTiles.assign(layer.tileCoverage.size(), 0);
+
+    if ((LayerType::Text == settings.type) || (LayerType::Clock == settings.type)) {
+        /* the background box covers the whole layer, the glyphs are drawn into it */
+        auto backgroundAlpha = getAlpha(settings.backgroundOpacity);
+        for (int row = 0; row < layerHeight; ++row) {
+            std::memset(&layer.canvasA[ static_cast<std::size_t>(row) * layer.stride ], backgroundAlpha, static_cast<std::size_t>(layerWidth));
+        }
+        markDirty(layer, 0, 0, layerWidth, layerHeight);
+        if (LayerType::Text == settings.type) {
+            drawText(layer, settings.text);
+        }
+    }
+    return true;
+}
+
+void OverlayCompositor::drawText(Layer& layer, const std::string& text) {
+    auto scale = layer.settings.scale;
+    auto cellSize = BitmapFont::s_glyphSize * scale;
+    auto margin = 2 * scale;
+    auto textAlpha = getAlpha(layer.settings.opacity);
+    auto backgroundAlpha = getAlpha(layer.settings.backgroundOpacity);
+    auto newText = text.substr(0, layer.settings.maxLength);
+
+    /* only the cells of characters that changed are drawn again */
+    for (std::size_t column = 0; column < layer.settings.maxLength; ++column) {
+        auto oldCharacter = (column < layer.drawnText.size()) ? layer.drawnText[ column ] : ' ';
+        auto newCharacter = (column < newText.size()) ? newText[ column ] : ' ';
+        if (oldCharacter == newCharacter) {
+            continue;
+        }
+
+        const auto* glyph = BitmapFont::getGlyph(newCharacter);
+        auto left = margin + static_cast<int>(column) * cellSize;
+        for (int row = 0; row < cellSize; ++row) {
+            auto glyphRow = glyph[ row / scale ];
+            auto offset = static_cast<std::size_t>(margin + row) * layer.stride + static_cast<std::size_t>(left);
+            for (int x = 0; x < cellSize; ++x) {
+                bool isSet = (0 != ((glyphRow >> (x / scale)) & 1));
+                layer.canvasY[ offset + static_cast<std::size_t>(x) ] = isSet ? m_whiteLuma : m_blackLuma;
+                layer.canvasA[ offset + static_cast<std::size_t>(x) ] = isSet ? textAlpha : backgroundAlpha;
+            }
+        }
+        markDirty(layer, left, margin, left + cellSize, margin + cellSize);
+    }
+    layer.drawnText = newText;
+}
+
+void OverlayCompositor::drawImage(Layer& layer, const AVFrame* image) {
+    auto chromaWidth = (image->width + 1) / 2;
+    auto chromaHeight = (image->height + 1) / 2;
+
+    /* the canvas is compared while it is overwritten, so that images which
+     * share a background mark only the tiles that differ */
+    for (int tileY = 0; tileY < layer.tilesHigh; ++tileY) {
+        for (int tileX = 0; tileX < layer.tilesWide; ++tileX) {
+            bool isChanged = false;
+            for (int row = tileY * s_tileSize; row < (tileY + 1) * s_tileSize; ++row) {
+                for (int x = tileX * s_tileSize; x < (tileX + 1) * s_tileSize; ++x) {
+                    bool isInside = (x < image->width) && (row < image->height);
+                    auto luma = isInside ? image->data[ 0 ][ row * image->linesize[ 0 ] + x ] : m_blackLuma;
+                    auto alpha = isInside ? image->data[ 3 ][ row * image->linesize[ 3 ] + x ] : std::uint8_t{ 0 };
+                    auto offset = static_cast<std::size_t>(row) * layer.stride + static_cast<std::size_t>(x);
+                    if ((layer.canvasY[ offset ] != luma) || (layer.canvasA[ offset ] != alpha)) {
+                        layer.canvasY[ offset ] = luma;
+                        layer.canvasA[ offset ] = alpha;
+                        isChanged = true;
+                    }
+                }
+            }
+            for (int row = tileY * g_chromaTileSize; row < (tileY + 1) * g_chromaTileSize; ++row) {
+                for (int x = tileX * g_chromaTileSize; x < (tileX + 1) * g_chromaTileSize; ++x) {
+                    bool isInside = (x < chromaWidth) && (row < chromaHeight);
+                    auto u = isInside ? image->data[ 1 ][ row * image->linesize[ 1 ] + x ] : g_neutralChroma;
+                    auto v = isInside ? image->data[ 2 ][ row * image->linesize[ 2 ] + x ] : g_neutralChroma;
+                    auto offset = static_cast<std::size_t>(row) * layer.chromaStride + static_cast<std::size_t>(x);
+                    if ((layer.canvasU[ offset ] != u) || (layer.canvasV[ offset ] != v)) {
+                        layer.canvasU[ offset ] = u;
+                        layer.canvasV[ offset ] = v;
+                        isChanged = true;
+                    }
+                }
+            }
+            if (isChanged) {
+                layer.dirtyTiles[ static_cast<std::size_t>(tileY * layer.tilesWide + tileX) ] = 1;
+                layer.hasDirtyTiles = true;
+            }
+        }
+    }
+}
+
+void OverlayCompositor::drawTimestamp(Layer& layer, std::uint64_t timestamp) {
+    auto cellSize = g_timestampCellSize * layer.settings.scale;
+
+    /* the cells are opaque whatever the opacity of the layer, so that they survive compression */
+    for (int cell = 0; cell < g_nTimestampCells; ++cell) {
+        bool isSet = isTimestampCellSet(timestamp, cell);
+        if (layer.drawnTimestamp.has_value() && (isTimestampCellSet(layer.drawnTimestamp.value(), cell) == isSet)) {
+            continue;
+        }
+        auto left = cell * cellSize;
+        for (int row = 0; row < cellSize; ++row) {
+            auto offset = static_cast<std::size_t>(row) * layer.stride + static_cast<std::size_t>(left);
+            std::memset(&layer.canvasY[ offset ], isSet ? m_whiteLuma : m_blackLuma, static_cast<std::size_t>(cellSize));
+            std::memset(&layer.canvasA[ offset ], 255, static_cast<std::size_t>(cellSize));
+        }
+        markDirty(layer, left, 0, left + cellSize, cellSize);
+    }
+    layer.drawnTimestamp = std::make_optional<std::uint64_t>(timestamp);
+}
+
+void OverlayCompositor::markDirty(Layer& layer, int left, int top, int right, int bottom) {
+    if ((right <= left) || (bottom <= top)) {
+        return;
+    }
+    auto lastTileX = std::min((right - 1) / s_tileSize, layer.tilesWide - 1);
+    auto lastTileY = std::min((bottom - 1) / s_tileSize, layer.tilesHigh - 1);
+    for (int tileY = top / s_tileSize; tileY <= lastTileY; ++tileY) {
+        for (int tileX = left / s_tileSize; tileX <= lastTileX; ++tileX) {
+            layer.dirtyTiles[ static_cast<std::size_t>(tileY * layer.tilesWide + tileX) ] = 1;
+        }
+    }
+    layer.hasDirtyTiles = true;
+}
+
+void OverlayCompositor::updateLayer(Layer& layer, std::int64_t time) {
+    if (LayerType::Clock == layer.settings.type) {
+        auto second = time / 1000000;
+        if (!layer.clockSecond.has_value() || (layer.clockSecond.value() != second)) {
+            layer.clockSecond = std::make_optional<std::int64_t>(second);
+            drawText(layer, formatClock(layer.settings.text, second));
+        }
+    } else if (LayerType::Images == layer.settings.type) {
+        std::size_t imageIndex = 0;
+        if (layer.settings.imageInterval > 0) {
+            imageIndex = static_cast<std::size_t>(std::max<std::int64_t>(time / layer.settings.imageInterval, 0)) % layer.images.size();
+        }
+        if (!layer.imageIndex.has_value() || (layer.imageIndex.value() != imageIndex)) {
+            layer.imageIndex = std::make_optional<std::size_t>(imageIndex);
+            drawImage(layer, layer.images[ imageIndex ].get());
+        }
+    } else if (LayerType::Timestamp == layer.settings.type) {
+        drawTimestamp(layer, static_cast<std::uint64_t>(time));
+    }
+}
+
+std::size_t OverlayCompositor::rasterizeDirtyTiles(Layer& layer) {
+    std::size_t nRasterizedTiles = 0;
+    for (int tileY = 0; tileY < layer.tilesHigh; ++tileY) {
+        for (int tileX = 0; tileX < layer.tilesWide; ++tileX) {
+            auto tileIndex = static_cast<std::size_t>(tileY * layer.tilesWide + tileX);
+            if (0 == layer.dirtyTiles[ tileIndex ]) {
+                continue;
+            }
+            layer.dirtyTiles[ tileIndex ] = 0;
+            ++nRasterizedTiles;
+
+            std::size_t nOpaque = 0;
+            std::size_t nTransparent = 0;
+            for (int row = tileY * s_tileSize; row < (tileY + 1) * s_tileSize; ++row) {
+                auto offset = static_cast<std::size_t>(row) * layer.stride + static_cast<std::size_t>(tileX * s_tileSize);
+                for (std::size_t i = offset; i < offset + s_tileSize; ++i) {
+                    unsigned int alpha = layer.canvasA[ i ];
+                    layer.premultipliedY[ i ] = divideBy255(layer.canvasY[ i ] * alpha);
+                    layer.inverseAlpha[ i ] = static_cast<std::uint8_t>(255 - alpha);
+                    nOpaque += (255 == alpha) ? 1 : 0;
+                    nTransparent += (0 == alpha) ? 1 : 0;
+                }
+            }
+            for (int row = tileY * g_chromaTileSize; row < (tileY + 1) * g_chromaTileSize; ++row) {
+                auto offset = static_cast<std::size_t>(row) * layer.chromaStride + static_cast<std::size_t>(tileX * g_chromaTileSize);
+                const auto* alphaRow = &layer.canvasA[ static_cast<std::size_t>(2 * row) * layer.stride ];
+                for (std::size_t i = offset; i < offset + g_chromaTileSize; ++i) {
+                    auto x = 2 * (i - offset) + static_cast<std::size_t>(tileX * s_tileSize);
+                    unsigned int alpha = (
+                        alphaRow[ x ] + alphaRow[ x + 1 ] +
+                        alphaRow[ layer.stride + x ] + alphaRow[ layer.stride + x + 1 ] + 2
+                    ) / 4;
+                    layer.premultipliedU[ i ] = divideBy255(layer.canvasU[ i ] * alpha);
+                    layer.premultipliedV[ i ] = divideBy255(layer.canvasV[ i ] * alpha);
+                    layer.inverseChromaAlpha[ i ] = static_cast<std::uint8_t>(255 - alpha);
+                }
+            }
+
+            constexpr std::size_t nTilePixels = s_tileSize * s_tileSize;
+            if (nTilePixels == nTransparent) {
+                layer.tileCoverage[ tileIndex ] = Coverage::Transparent;
+            } else if (nTilePixels == nOpaque) {
+                layer.tileCoverage[ tileIndex ] = Coverage::Opaque;
+            } else {
+                layer.tileCoverage[ tileIndex ] = Coverage::Translucent;
+            }
+        }
+    }
+    layer.hasDirtyTiles = false;
+    return nRasterizedTiles;
+}
+
+void OverlayCompositor::blendLayer(const Layer& layer, AVFrame* frame, int firstRow, int lastRow) const {
+    auto chromaFrameWidth = (m_width + 1) / 2;
+    auto chromaFrameHeight = (m_height + 1) / 2;
+    lastRow = std::min(lastRow, m_height);
+    for (int tileY = 0; tileY < layer.tilesHigh; ++tileY) {
+        auto top = layer.y + tileY * s_tileSize;
+        if (top >= lastRow) {
+            break;
+        }
+        /* the band may cut the tile; band borders are even, so chroma rows are cut alike */
+        auto beginRow = std::max(top, firstRow);
+        auto endRow = std::min(top + s_tileSize, lastRow);
+        if (beginRow >= endRow) {
+            continue;
+        }
+        auto chromaTop = top / 2;
+        auto beginChromaRow = beginRow / 2;
+        auto endChromaRow = std::min((endRow + 1) / 2, chromaFrameHeight);
+        for (int tileX = 0; tileX < layer.tilesWide; ++tileX) {
+            auto coverage = layer.tileCoverage[ static_cast<std::size_t>(tileY * layer.tilesWide + tileX) ];
+            if (Coverage::Transparent == coverage) {
+                continue;
+            }
+            auto left = layer.x + tileX * s_tileSize;
+            auto nColumns = std::min(s_tileSize, m_width - left);
+            auto chromaLeft = left / 2;
+            auto nChromaColumns = std::min(g_chromaTileSize, chromaFrameWidth - chromaLeft);
+            if (nColumns <= 0) {
+                break;
+            }
+
+            for (int frameRow = beginRow; frameRow < endRow; ++frameRow) {
+                auto offset = static_cast<std::size_t>(frameRow - layer.y) * layer.stride + static_cast<std::size_t>(tileX * s_tileSize);
+                const auto* premultiplied = &layer.premultipliedY[ offset ];
+                const auto* inverseAlpha = &layer.inverseAlpha[ offset ];
+                auto* destination = frame->data[ 0 ] + static_cast<std::ptrdiff_t>(frameRow) * frame->linesize[ 0 ] + left;
+                if (Coverage::Opaque == coverage) {
+                    std::memcpy(destination, premultiplied, static_cast<std::size_t>(nColumns));
+                    continue;
+                }
+                for (int x = 0; x < nColumns; ++x) {
+                    destination[ x ] = static_cast<std::uint8_t>(premultiplied[ x ] + divideBy255(destination[ x ] * inverseAlpha[ x ]));
+                }
+            }
+            for (int chromaRow = beginChromaRow; chromaRow < endChromaRow; ++chromaRow) {
+                auto offset = static_cast<std::size_t>(tileY * g_chromaTileSize + chromaRow - chromaTop) * layer.chromaStride + static_cast<std::size_t>(tileX * g_chromaTileSize);
+                const auto* premultipliedU = &layer.premultipliedU[ offset ];
+                const auto* premultipliedV = &layer.premultipliedV[ offset ];
+                const auto* inverseAlpha = &layer.inverseChromaAlpha[ offset ];
+                auto* destinationU = frame->data[ 1 ] + static_cast<std::ptrdiff_t>(chromaRow) * frame->linesize[ 1 ] + chromaLeft;
+                auto* destinationV = frame->data[ 2 ] + static_cast<std::ptrdiff_t>(chromaRow) * frame->linesize[ 2 ] + chromaLeft;
+                for (int x = 0; x < nChromaColumns; ++x) {
+                    destinationU[ x ] = static_cast<std::uint8_t>(premultipliedU[ x ] + divideBy255(destinationU[ x ] * inverseAlpha[ x ]));
+                    destinationV[ x ] = static_cast<std::uint8_t>(premultipliedV[ x ] + divideBy255(destinationV[ x ] * inverseAlpha[ x ]));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include "packet_ring_buffer.h"
+
+extern "C" {
+    #include <libavcodec/packet.h>
+    #include <libavutil/avutil.h>
+    #include <libavutil/mathematics.h>
+}
+
+#include <algorithm>
+#include <iostream>
+
+PacketRingBuffer::~PacketRingBuffer() {
+    clear();
+}
+
+bool PacketRingBuffer::setup(std::size_t maxBytes, std::int64_t maxDuration, AVRational timeBase) {
+    if (0 == maxBytes) {
+        std::cerr << "{PacketRingBuffer::setup}; maximum number of bytes is equal to zero" << std::endl;
+        return false;
+    }
+    if (maxDuration < 0) {
+        std::cerr << "{PacketRingBuffer::setup}; maximum duration is less than zero" << std::endl;
+        return false;
+    }
+    if ((timeBase.num <= 0) || (timeBase.den <= 0)) {
+        std::cerr << "{PacketRingBuffer::setup}; time base is NOT valid" << std::endl;
+        return false;
+    }
+
+    clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxBytes = maxBytes;
+    m_maxDuration = maxDuration;
+    m_timeBase = timeBase;
+    return true;
+}
+
+void PacketRingBuffer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_entries) {
+        av_packet_free(&entry.packet);
+    }
+    m_entries.clear();
+    m_keyframes.clear();
+    m_firstSequenceNumber = 0;
+    m_bufferedBytes = 0;
+    m_maxBytes = 0;
+}
+
+bool PacketRingBuffer::isSet() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_maxBytes > 0);
+}
+
+void PacketRingBuffer::push(const AVPacket* packet) {
+    if (nullptr == packet) {
+        return;
+    }
+    /* decode order is monotonic, presentation order is NOT */
+    auto timestamp = (AV_NOPTS_VALUE != packet->dts) ? packet->dts : packet->pts;
+    if (AV_NOPTS_VALUE == timestamp) {
+        return;
+    }
+    bool isKeyframe = (AV_PKT_FLAG_KEY & packet->flags);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (0 == m_maxBytes) {
+        return;
+    }
+    if (m_entries.empty() && !isKeyframe) {
+        return;
+    }
+
+    AVPacket* bufferedPacket = av_packet_clone(packet);
+    if (nullptr == bufferedPacket) {
+        std::cerr << "{PacketRingBuffer::push}; unable to clone packet" << std::endl;
+        return;
+    }
+    Entry entry{
+        .packet = bufferedPacket,
+        .timestamp = av_rescale_q(timestamp, m_timeBase, AV_TIME_BASE_Q)
+    };
+    if (isKeyframe) {
+        m_keyframes.push_back(Keyframe{
+            .timestamp = entry.timestamp,
+            .sequenceNumber = m_firstSequenceNumber + m_entries.size()
+        });
+    }
+    m_bufferedBytes += static_cast<std::size_t>(bufferedPacket->size) + sizeof(AVPacket);
+    m_entries.push_back(entry);
+    evict();
+}
+
+bool PacketRingBuffer::copyRange(std::int64_t start, std::int64_t duration, std::vector<AVPacket*>& packets) const {
+    packets.clear();
+    if (duration <= 0) {
+        std::cerr << "{PacketRingBuffer::copyRange}; duration is NOT positive" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.empty() || m_keyframes.empty()) {
+        std::cerr << "{PacketRingBuffer::copyRange}; packet history is empty" << std::endl;
+        return false;
+    }
+
+    auto startTimestamp = (start < 0) ? (m_entries.back().timestamp + start) : start;
+    auto endTimestamp = startTimestamp + duration;
+    if (startTimestamp > m_entries.back().timestamp) {
+        std::cerr << "{PacketRingBuffer::copyRange}; start of range is beyond the newest packet" << std::endl;
+        return false;
+    }
+
+    /* last keyframe at or before the start; the oldest one if the range starts earlier */
+    auto it = std::upper_bound(
+        m_keyframes.cbegin(), m_keyframes.cend(), startTimestamp,
+        [] (std::int64_t timestamp, const Keyframe& keyframe) { return (timestamp < keyframe.timestamp); }
+    );
+    if (m_keyframes.cbegin() != it) {
+        --it;
+    } else {
+        std::cout << "{PacketRingBuffer::copyRange}; range starts before the oldest packet and is truncated" << std::endl;
+    }
+
+    auto position = static_cast<std::size_t>(it->sequenceNumber - m_firstSequenceNumber);
+    for (; position < m_entries.size(); ++position) {
+        const auto& entry = m_entries[position];
+        if (entry.timestamp >= endTimestamp) {
+            break;
+        }
+        AVPacket* packet = av_packet_clone(entry.packet);
+        if (nullptr == packet) {
+            std::cerr << "{PacketRingBuffer::copyRange}; unable to clone packet" << std::endl;
+            for (auto& copiedPacket : packets) {
+                av_packet_free(&copiedPacket);
+            }
+            packets.clear();
+            return false;
+        }
+        packets.push_back(packet);
+    }
+    return !packets.empty();
+}
+
+std::size_t PacketRingBuffer::getBufferedBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bufferedBytes;
+}
+
+std::int64_t PacketRingBuffer::getBufferedDuration() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.empty()) {
+        return 0;
+    }
+    return (m_entries.back().timestamp - m_entries.front().timestamp);
+}
+
+void PacketRingBuffer::evict() {
+    /* the GOP that is being written is never evicted */
+    while (m_keyframes.size() > 1) {
+        bool isOverBudget =
+            (m_bufferedBytes > m_maxBytes) ||
+            ((m_maxDuration > 0) && ((m_entries.back().timestamp - m_keyframes[1].timestamp) >= m_maxDuration));
+        if (!isOverBudget) {
+            break;
+        }
+
+        auto nEvictedEntries = static_cast<std::size_t>(m_keyframes[1].sequenceNumber - m_firstSequenceNumber);
+        for (std::size_t i = 0; i < nEvictedEntries; ++i) {
+            auto& entry = m_entries.front();
+            m_bufferedBytes -= static_cast<std::size_t>(entry.packet->size) + sizeof(AVPacket);
+            av_packet_free(&entry.packet);
+            m_entries.pop_front();
+        }
+        m_firstSequenceNumber += nEvictedEntries;
+        m_keyframes.pop_front();
+    }
+}
@@ -0,0 +1,243 @@
+#include "packet_writer.h"
+
+extern "C" {
+    #include <libavcodec/packet.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/error.h>
+}
+
+#include <iostream>
+#include <system_error>
+
+#include "capture_timestamp.h"
+#include "common_functions.h"
+#include "trace_recorder.h"
+
+PacketWriter::~PacketWriter() {
+    stop();
+}
+
+bool PacketWriter::setup(
+    AVFormatContext* outputContext, std::shared_ptr<TimeoutChecker> timeoutChecker,
+    StreamMetrics* metrics, const Settings& settings
+) {
+    if (nullptr == outputContext) {
+        std::cerr << "{PacketWriter::setup}; pointer to output context is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == timeoutChecker) {
+        std::cerr << "{PacketWriter::setup}; pointer to timeout checker is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{PacketWriter::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if (settings.isThreaded && (0 == settings.queueCapacity)) {
+        std::cerr << "{PacketWriter::setup}; queue capacity is equal to zero" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_thread.joinable() || m_outputContext) {
+        std::cerr << "{PacketWriter::setup}; packet writer is already set" << std::endl;
+        return false;
+    }
+    m_outputContext = outputContext;
+    m_timeoutChecker = timeoutChecker;
+    m_metrics = metrics;
+    m_settings = settings;
+    m_isWriting = false;
+    m_isFailed = false;
+    m_isStopRequested = false;
+    if (!m_settings.isThreaded) {
+        return true;
+    }
+
+    try {
+        m_thread = std::thread(&PacketWriter::run, this);
+    } catch (const std::system_error& exception) {
+        std::cerr << "{PacketWriter::setup}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting output thread; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        return false;
+    } catch (...) {
+        std::cerr << "{PacketWriter::setup}; "
+            "unknown exception was caught while "
+            "starting output thread" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void PacketWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = true;
+    }
+    m_condition.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& queuedPacket : m_queuedPackets) {
+        av_packet_free(&queuedPacket.packet);
+    }
+    m_queuedPackets.clear();
+    m_outputContext = nullptr;
+    m_timeoutChecker.reset();
+    m_metrics = nullptr;
+}
+
+bool PacketWriter::write(AVPacket* packet) {
+    if (nullptr == packet) {
+        std::cerr << "{PacketWriter::write}; pointer to packet is NULL" << std::endl;
+        return false;
+    }
+    if (!m_settings.isThreaded) {
+        return writePacket(packet, CommonFunctions::getCurTimeSinceEpoch());
+    }
+
+    AVPacket* queuedPacket = av_packet_alloc();
+    if (nullptr == queuedPacket) {
+        std::cerr << "{PacketWriter::write}; unable to allocate memory for queued packet" << std::endl;
+        av_packet_unref(packet);
+        return false;
+    }
+    av_packet_move_ref(queuedPacket, packet);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] () {
+        return m_isFailed || m_isStopRequested || (m_queuedPackets.size() < m_settings.queueCapacity);
+    });
+    if (m_isFailed || m_isStopRequested || !m_thread.joinable()) {
+        av_packet_free(&queuedPacket);
+        return false;
+    }
+    m_queuedPackets.push_back(QueuedPacket{
+        .packet = queuedPacket, .queuedTime = CommonFunctions::getCurTimeSinceEpoch()
+    });
+    m_metrics->set(StreamMetrics::Metric::OutputQueueDepth, m_queuedPackets.size());
+    lock.unlock();
+    m_condition.notify_all();
+    return true;
+}
+
+bool PacketWriter::flush() {
+    if (!m_settings.isThreaded) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] () {
+        return m_isFailed || m_isStopRequested || (m_queuedPackets.empty() && !m_isWriting);
+    });
+    return !m_isFailed;
+}
+
+bool PacketWriter::writePacket(AVPacket* packet, std::int64_t queuedTime) {
+    if (nullptr == m_outputContext) {
+        std::cerr << "{PacketWriter::writePacket}; pointer to output context is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == m_timeoutChecker) {
+        std::cerr << "{PacketWriter::writePacket}; pointer to timeout checker is NULL" << std::endl;
+        return false;
+    }
+
+    /* the muxer takes over the reference, so the size, capture time and pts are read beforehand */
+    auto packetSize = static_cast<std::uint64_t>(packet->size);
+    auto captureTime = m_settings.latencyHistogram ? CaptureTimestamp::get(packet) : std::nullopt;
+    auto capturePts = CaptureTimestamp::getPts(packet);
+
+    /* mux encoded frame */
+    m_timeoutChecker->setBeginTime();
+    int writeResult = 0;
+    {
+        TraceScope muxTrace("mux", m_settings.traceStreamId, capturePts);
+        writeResult = av_interleaved_write_frame(m_outputContext, packet);
+    }
+    m_timeoutChecker->resetBeginTime();
+    if ((writeResult < 0) && m_settings.isDropOnTimeout && m_timeoutChecker->isTimeoutReached()) {
+        /* the interrupted datagrams are lost, the receiver resyncs on the next TS packet */
+        if (m_outputContext->pb) {
+            m_outputContext->pb->error = 0;
+        }
+        m_metrics->add(StreamMetrics::Metric::OutputDroppedPackets);
+        if (m_settings.onPacketDropped) {
+            m_settings.onPacketDropped();
+        }
+        return true;
+    }
+    if (writeResult < 0) {
+        if (AVERROR_EOF == writeResult) {
+            std::cout << "{PacketWriter::writePacket}; unable to write encoder packet to output context; "
+                "write result: 'AVERROR_EOF (" << av_err2str(writeResult) << ")'" << std::endl;
+        } else {
+            if (m_timeoutChecker->isTimeoutReached()) {
+                std::cerr << "{PacketWriter::writePacket}; "
+                    "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+            } else {
+                std::cerr << "{PacketWriter::writePacket}; unable to write encoder packet to output context; "
+                    "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+            }
+        }
+        return false;
+    }
+
+    auto writtenTime = CommonFunctions::getCurTimeSinceEpoch();
+    m_metrics->add(StreamMetrics::Metric::WrittenPackets);
+    m_metrics->add(StreamMetrics::Metric::WrittenBytes, packetSize);
+    if (m_settings.rateMeter) {
+        m_settings.rateMeter->add(packetSize, writtenTime);
+    }
+    if (captureTime.has_value()) {
+        m_settings.latencyHistogram->record(writtenTime - captureTime.value());
+    }
+    if ((m_settings.maxLatency > 0) && ((writtenTime - queuedTime) > m_settings.maxLatency)) {
+        m_metrics->add(StreamMetrics::Metric::OutputSchedulingMisses);
+    }
+    return true;
+}
+
+void PacketWriter::run() {
+    if (m_settings.placement.has_value()) {
+        ThreadPlacement::apply("output", m_settings.placement.value());
+    }
+    ThreadPlacement::report("output");
+
+    while (true) {
+        QueuedPacket queuedPacket;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () {
+                return m_isStopRequested || !m_queuedPackets.empty();
+            });
+            if (m_isStopRequested) {
+                break;
+            }
+            queuedPacket = m_queuedPackets.front();
+            m_queuedPackets.pop_front();
+            m_metrics->set(StreamMetrics::Metric::OutputQueueDepth, m_queuedPackets.size());
+            m_isWriting = true;
+        }
+        m_condition.notify_all();
+
+        bool wasWritten = writePacket(queuedPacket.packet, queuedPacket.queuedTime);
+        av_packet_free(&queuedPacket.packet);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isWriting = false;
+            if (!wasWritten) {
+                /* the encoder finds out on its next write */
+                m_isFailed = true;
+            }
+        }
+        m_condition.notify_all();
+        if (!wasWritten) {
+            break;
+        }
+    }
+}
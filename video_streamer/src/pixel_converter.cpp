@@ -0,0 +1,584 @@
+#include "pixel_converter.h"
+
+extern "C" {
+    #include <libavutil/buffer.h>
+    #include <libavutil/error.h>
+    #include <libavutil/frame.h>
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+    #include <libswscale/swscale.h>
+}
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+/* AVX2 kernels are compiled for their own target and picked at run time */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_CONVERTER_AVX2
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "overlay_compositor.h"
+#include "row_band_pool.h"
+
+namespace {
+    using InstructionSet = PixelConverter::InstructionSet;
+    using RowKernel = void (*)(const AVFrame* source, AVFrame* target, int width, int firstRow, int lastRow);
+
+    /* bands are cut at tile borders of the overlay, so a tile is blended by one band only */
+    constexpr int g_rowsPerUnit = OverlayCompositor::s_tileSize;
+    constexpr int g_minUnitsPerBand = 4;
+    constexpr int g_bufferAlignment = 32;
+    constexpr int g_comparisonRuns = 15;
+    /* the unscaled YUYV/UYVY converter of swscale averages chroma with PAVGB on x86,
+     * which rounds up, and truncates in its C version on other platforms */
+#if defined(__x86_64__) || defined(__i386__)
+    constexpr int g_chromaRounding = 1;
+#else
+    constexpr int g_chromaRounding = 0;
+#endif
+
+    const char* getInstructionSetName(InstructionSet instructionSet) {
+        switch (instructionSet) {
+            case InstructionSet::Avx2:
+                return "AVX2";
+            case InstructionSet::Sse2:
+                return "SSE2";
+            default:
+                return "C";
+        }
+    }
+
+    /* the SIMD helpers process whole vectors from 'x' on and return where the next one starts */
+#if defined(__SSE2__)
+    int extractLumaSse2(const std::uint8_t* source, int width, int offset, std::uint8_t* destination, int x) {
+        const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+        for (; x + 16 <= width; x += 16) {
+            auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x));
+            auto second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x + 16));
+            if (0 == offset) {
+                first = _mm_and_si128(first, lowByteMask);
+                second = _mm_and_si128(second, lowByteMask);
+            } else {
+                first = _mm_srli_epi16(first, 8);
+                second = _mm_srli_epi16(second, 8);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(first, second));
+        }
+        return x;
+    }
+
+    int averageChromaSse2(
+        const std::uint8_t* first, const std::uint8_t* second, int width, int offset,
+        std::uint8_t* destinationU, std::uint8_t* destinationV, int x
+    ) {
+        const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+        const __m128i zero = _mm_setzero_si128();
+        auto extractChroma = [offset, &lowByteMask] (const std::uint8_t* row) {
+            auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+            auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 16));
+            if (0 == offset) {
+                low = _mm_and_si128(low, lowByteMask);
+                high = _mm_and_si128(high, lowByteMask);
+            } else {
+                low = _mm_srli_epi16(low, 8);
+                high = _mm_srli_epi16(high, 8);
+            }
+            /* U V U V ... of 16 pixels */
+            return _mm_packus_epi16(low, high);
+        };
+        for (; x + 16 <= width; x += 16) {
+            auto average = _mm_avg_epu8(extractChroma(first + 2 * x), extractChroma(second + 2 * x));
+            auto u = _mm_packus_epi16(_mm_and_si128(average, lowByteMask), zero);
+            auto v = _mm_packus_epi16(_mm_srli_epi16(average, 8), zero);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(destinationU + x / 2), u);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(destinationV + x / 2), v);
+        }
+        return x;
+    }
+
+    int deinterleaveChromaSse2(const std::uint8_t* source, int chromaWidth, std::uint8_t* first, std::uint8_t* second, int x) {
+        const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+        for (; x + 16 <= chromaWidth; x += 16) {
+            auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x));
+            auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * x + 16));
+            auto even = _mm_packus_epi16(_mm_and_si128(low, lowByteMask), _mm_and_si128(high, lowByteMask));
+            auto odd = _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(first + x), even);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(second + x), odd);
+        }
+        return x;
+    }
+#endif
+
+#if defined(PIXEL_CONVERTER_AVX2)
+    /* packs within the 128-bit lanes, so the quadwords are put back in order afterwards */
+    __attribute__((target("avx2"))) __m256i packInOrder(__m256i low, __m256i high) {
+        return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+    }
+
+    __attribute__((target("avx2"))) __m256i selectBytes(__m256i data, int offset) {
+        return (0 == offset) ? _mm256_and_si256(data, _mm256_set1_epi16(0x00FF)) : _mm256_srli_epi16(data, 8);
+    }
+
+    __attribute__((target("avx2")))
+    int extractLumaAvx2(const std::uint8_t* source, int width, int offset, std::uint8_t* destination, int x) {
+        for (; x + 32 <= width; x += 32) {
+            auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 2 * x));
+            auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 2 * x + 32));
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(destination + x),
+                packInOrder(selectBytes(first, offset), selectBytes(second, offset))
+            );
+        }
+        return x;
+    }
+
+    /* U V U V ... of 32 pixels */
+    __attribute__((target("avx2"))) __m256i extractChromaAvx2(const std::uint8_t* row, int offset) {
+        auto low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row));
+        auto high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 32));
+        return packInOrder(selectBytes(low, offset), selectBytes(high, offset));
+    }
+
+    __attribute__((target("avx2")))
+    int averageChromaAvx2(
+        const std::uint8_t* first, const std::uint8_t* second, int width, int offset,
+        std::uint8_t* destinationU, std::uint8_t* destinationV, int x
+    ) {
+        const __m256i zero = _mm256_setzero_si256();
+        for (; x + 32 <= width; x += 32) {
+            auto average = _mm256_avg_epu8(extractChromaAvx2(first + 2 * x, offset), extractChromaAvx2(second + 2 * x, offset));
+            auto u = packInOrder(selectBytes(average, 0), zero);
+            auto v = packInOrder(selectBytes(average, 1), zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destinationU + x / 2), _mm256_castsi256_si128(u));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destinationV + x / 2), _mm256_castsi256_si128(v));
+        }
+        return x;
+    }
+
+    __attribute__((target("avx2")))
+    int deinterleaveChromaAvx2(const std::uint8_t* source, int chromaWidth, std::uint8_t* first, std::uint8_t* second, int x) {
+        for (; x + 32 <= chromaWidth; x += 32) {
+            auto low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 2 * x));
+            auto high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 2 * x + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(first + x), packInOrder(selectBytes(low, 0), selectBytes(high, 0)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(second + x), packInOrder(selectBytes(low, 1), selectBytes(high, 1)));
+        }
+        return x;
+    }
+#endif
+
+    /* every second byte, starting at 'offset' */
+    template<InstructionSet instructionSet>
+    void extractLuma(const std::uint8_t* source, int width, int offset, std::uint8_t* destination) {
+        int x = 0;
+#if defined(PIXEL_CONVERTER_AVX2)
+        if constexpr (InstructionSet::Avx2 == instructionSet) {
+            x = extractLumaAvx2(source, width, offset, destination, x);
+        }
+#endif
+#if defined(__SSE2__)
+        if constexpr (InstructionSet::C != instructionSet) {
+            x = extractLumaSse2(source, width, offset, destination, x);
+        }
+#endif
+        for (; x < width; ++x) {
+            destination[ x ] = source[ 2 * x + offset ];
+        }
+    }
+
+    /* chroma of two packed rows, averaged like swscale; 'offset' is the byte of the first U */
+    template<InstructionSet instructionSet>
+    void averageChroma(
+        const std::uint8_t* first, const std::uint8_t* second, int width, int offset,
+        std::uint8_t* destinationU, std::uint8_t* destinationV
+    ) {
+        int x = 0;
+#if defined(PIXEL_CONVERTER_AVX2)
+        if constexpr (InstructionSet::Avx2 == instructionSet) {
+            x = averageChromaAvx2(first, second, width, offset, destinationU, destinationV, x);
+        }
+#endif
+#if defined(__SSE2__)
+        if constexpr (InstructionSet::C != instructionSet) {
+            x = averageChromaSse2(first, second, width, offset, destinationU, destinationV, x);
+        }
+#endif
+        for (; x < width; x += 2) {
+            auto index = 2 * x + offset;
+            destinationU[ x / 2 ] = static_cast<std::uint8_t>((first[ index ] + second[ index ] + g_chromaRounding) >> 1);
+            destinationV[ x / 2 ] = static_cast<std::uint8_t>((first[ index + 2 ] + second[ index + 2 ] + g_chromaRounding) >> 1);
+        }
+    }
+
+    /* interleaved chroma of a semi-planar row; 'offset' is the byte of U */
+    template<InstructionSet instructionSet>
+    void deinterleaveChroma(
+        const std::uint8_t* source, int chromaWidth, int offset,
+        std::uint8_t* destinationU, std::uint8_t* destinationV
+    ) {
+        auto* first = (0 == offset) ? destinationU : destinationV;
+        auto* second = (0 == offset) ? destinationV : destinationU;
+        int x = 0;
+#if defined(PIXEL_CONVERTER_AVX2)
+        if constexpr (InstructionSet::Avx2 == instructionSet) {
+            x = deinterleaveChromaAvx2(source, chromaWidth, first, second, x);
+        }
+#endif
+#if defined(__SSE2__)
+        if constexpr (InstructionSet::C != instructionSet) {
+            x = deinterleaveChromaSse2(source, chromaWidth, first, second, x);
+        }
+#endif
+        for (; x < chromaWidth; ++x) {
+            first[ x ] = source[ 2 * x ];
+            second[ x ] = source[ 2 * x + 1 ];
+        }
+    }
+
+    /* YUYV422 (luma at byte 0) and UYVY422 (luma at byte 1) to YUV420P; rows are even */
+    template<int lumaOffset, InstructionSet instructionSet>
+    void convertPackedRows(const AVFrame* source, AVFrame* target, int width, int firstRow, int lastRow) {
+        constexpr int chromaOffset = 1 - lumaOffset;
+        for (int row = firstRow; row < lastRow; row += 2) {
+            const auto* first = source->data[ 0 ] + static_cast<std::ptrdiff_t>(row) * source->linesize[ 0 ];
+            const auto* second = first + source->linesize[ 0 ];
+            auto* luma = target->data[ 0 ] + static_cast<std::ptrdiff_t>(row) * target->linesize[ 0 ];
+            extractLuma<instructionSet>(first, width, lumaOffset, luma);
+            extractLuma<instructionSet>(second, width, lumaOffset, luma + target->linesize[ 0 ]);
+            averageChroma<instructionSet>(
+                first, second, width, chromaOffset,
+                target->data[ 1 ] + static_cast<std::ptrdiff_t>(row / 2) * target->linesize[ 1 ],
+                target->data[ 2 ] + static_cast<std::ptrdiff_t>(row / 2) * target->linesize[ 2 ]
+            );
+        }
+    }
+
+    /* NV12 (U first) and NV21 (V first) to YUV420P; rows are even */
+    template<int chromaOffset, InstructionSet instructionSet>
+    void convertSemiPlanarRows(const AVFrame* source, AVFrame* target, int width, int firstRow, int lastRow) {
+        for (int row = firstRow; row < lastRow; ++row) {
+            std::memcpy(
+                target->data[ 0 ] + static_cast<std::ptrdiff_t>(row) * target->linesize[ 0 ],
+                source->data[ 0 ] + static_cast<std::ptrdiff_t>(row) * source->linesize[ 0 ],
+                static_cast<std::size_t>(width)
+            );
+        }
+        for (int chromaRow = firstRow / 2; chromaRow < lastRow / 2; ++chromaRow) {
+            deinterleaveChroma<instructionSet>(
+                source->data[ 1 ] + static_cast<std::ptrdiff_t>(chromaRow) * source->linesize[ 1 ], width / 2, chromaOffset,
+                target->data[ 1 ] + static_cast<std::ptrdiff_t>(chromaRow) * target->linesize[ 1 ],
+                target->data[ 2 ] + static_cast<std::ptrdiff_t>(chromaRow) * target->linesize[ 2 ]
+            );
+        }
+    }
+
+    template<InstructionSet instructionSet>
+    RowKernel selectKernel(AVPixelFormat sourceFormat) {
+        switch (sourceFormat) {
+            case AV_PIX_FMT_YUYV422:
+                return &convertPackedRows<0, instructionSet>;
+            case AV_PIX_FMT_UYVY422:
+                return &convertPackedRows<1, instructionSet>;
+            case AV_PIX_FMT_NV12:
+                return &convertSemiPlanarRows<0, instructionSet>;
+            case AV_PIX_FMT_NV21:
+                return &convertSemiPlanarRows<1, instructionSet>;
+            default:
+                return nullptr;
+        }
+    }
+
+    std::shared_ptr<AVFrame> allocateFrame() {
+        return std::shared_ptr<AVFrame>(
+            av_frame_alloc(),
+            [] (AVFrame* frame) { av_frame_free(&frame); }
+        );
+    }
+}
+
+PixelConverter::~PixelConverter() {
+    clear();
+}
+
+bool PixelConverter::isConversionSupported(AVPixelFormat sourceFormat, AVPixelFormat targetFormat) {
+    return (AV_PIX_FMT_YUV420P == targetFormat) && (nullptr != getKernel(sourceFormat, InstructionSet::C));
+}
+
+PixelConverter::Kernel PixelConverter::getKernel(AVPixelFormat sourceFormat, InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case InstructionSet::Avx2:
+            return selectKernel<InstructionSet::Avx2>(sourceFormat);
+        case InstructionSet::Sse2:
+            return selectKernel<InstructionSet::Sse2>(sourceFormat);
+        default:
+            return selectKernel<InstructionSet::C>(sourceFormat);
+    }
+}
+
+PixelConverter::InstructionSet PixelConverter::detectInstructionSet() {
+#if defined(PIXEL_CONVERTER_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return InstructionSet::Avx2;
+    }
+#endif
+#if defined(__SSE2__)
+    return InstructionSet::Sse2;
+#else
+    return InstructionSet::C;
+#endif
+}
+
+bool PixelConverter::setup(
+    int width, int height, AVPixelFormat sourceFormat, AVPixelFormat targetFormat,
+    OverlayCompositor* compositor
+) {
+    clear();
+    if (!isConversionSupported(sourceFormat, targetFormat)) {
+        std::cerr << "{PixelConverter::setup}; conversion is NOT supported; "
+            "source pixel format: '" << static_cast<int>(sourceFormat) << "'; "
+            "target pixel format: '" << static_cast<int>(targetFormat) << "'" << std::endl;
+        return false;
+    }
+    /* chroma of 4:2:0 covers 2x2 pixels; odd sizes are left to swscale */
+    if ((width <= 0) || (height <= 0) || (0 != (width % 2)) || (0 != (height % 2))) {
+        std::cerr << "{PixelConverter::setup}; frame size is NOT supported; "
+            "frame size: '" << width << "x" << height << "'" << std::endl;
+        return false;
+    }
+    if (compositor && !compositor->isSet()) {
+        std::cerr << "{PixelConverter::setup}; overlay compositor is NOT set up" << std::endl;
+        return false;
+    }
+
+    auto bufferSize = av_image_get_buffer_size(targetFormat, width, height, g_bufferAlignment);
+    if (bufferSize < 0) {
+        std::cerr << "{PixelConverter::setup}; unable to get buffer size; "
+            "size result: '" << bufferSize << " (" << av_err2str(bufferSize) << ")'" << std::endl;
+        return false;
+    }
+    /* the filter graph and the encoder keep converted frames for a while; the pool recycles them */
+    m_bufferPool = av_buffer_pool_init(static_cast<std::size_t>(bufferSize), nullptr);
+    if (nullptr == m_bufferPool) {
+        std::cerr << "{PixelConverter::setup}; unable to allocate buffer pool" << std::endl;
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_sourceFormat = sourceFormat;
+    m_targetFormat = targetFormat;
+    m_instructionSet = detectInstructionSet();
+    m_kernel = getKernel(sourceFormat, m_instructionSet);
+    m_compositor = compositor;
+    m_isBlendingFused = (nullptr != m_compositor);
+    std::cout << "{PixelConverter::setup}; pixel converter has been successfully set up; "
+        "conversion: '" << av_get_pix_fmt_name(sourceFormat) << " -> " << av_get_pix_fmt_name(targetFormat) << "'; "
+        "instruction set: '" << getInstructionSetName(m_instructionSet) << "'; "
+        "overlay blending is " << (m_compositor ? "fused" : "NOT fused") << std::endl;
+    return true;
+}
+
+void PixelConverter::clear() {
+    /* buffers that are still referenced outlive the pool */
+    if (m_bufferPool) {
+        av_buffer_pool_uninit(&m_bufferPool);
+        m_bufferPool = nullptr;
+    }
+    m_width = 0;
+    m_height = 0;
+    m_sourceFormat = AV_PIX_FMT_NONE;
+    m_targetFormat = AV_PIX_FMT_NONE;
+    m_instructionSet = InstructionSet::C;
+    m_kernel = nullptr;
+    m_compositor = nullptr;
+    m_isBlendingFused = false;
+}
+
+bool PixelConverter::allocateBuffer(AVFrame* targetFrame) {
+    auto* buffer = av_buffer_pool_get(m_bufferPool);
+    if (nullptr == buffer) {
+        std::cerr << "{PixelConverter::allocateBuffer}; unable to get buffer from pool" << std::endl;
+        return false;
+    }
+    targetFrame->buf[ 0 ] = buffer;
+    targetFrame->format = m_targetFormat;
+    targetFrame->width = m_width;
+    targetFrame->height = m_height;
+    auto fillResult = av_image_fill_arrays(
+        targetFrame->data, targetFrame->linesize, buffer->data,
+        m_targetFormat, m_width, m_height, g_bufferAlignment
+    );
+    if (fillResult < 0) {
+        std::cerr << "{PixelConverter::allocateBuffer}; unable to fill frame planes; "
+            "fill result: '" << fillResult << " (" << av_err2str(fillResult) << ")'" << std::endl;
+        av_frame_unref(targetFrame);
+        return false;
+    }
+    return true;
+}
+
+bool PixelConverter::convert(const AVFrame* sourceFrame, AVFrame* targetFrame, std::int64_t time) {
+    if (!isSet()) {
+        std::cerr << "{PixelConverter::convert}; pixel converter is NOT set up" << std::endl;
+        return false;
+    }
+    if ((nullptr == sourceFrame) || (nullptr == targetFrame)) {
+        std::cerr << "{PixelConverter::convert}; pointer to frame is NULL" << std::endl;
+        return false;
+    }
+    if (
+        (sourceFrame->format != m_sourceFormat) ||
+        (sourceFrame->width != m_width) || (sourceFrame->height != m_height)
+    ) {
+        std::cerr << "{PixelConverter::convert}; frame does NOT match converter setup; "
+            "frame size: '" << sourceFrame->width << "x" << sourceFrame->height << "'; "
+            "pixel format: '" << sourceFrame->format << "'" << std::endl;
+        return false;
+    }
+
+    av_frame_unref(targetFrame);
+    if (!allocateBuffer(targetFrame)) {
+        return false;
+    }
+    /* timestamps and side data such as regions of interest go along */
+    auto copyResult = av_frame_copy_props(targetFrame, sourceFrame);
+    if (copyResult < 0) {
+        std::cerr << "{PixelConverter::convert}; unable to copy frame properties; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        av_frame_unref(targetFrame);
+        return false;
+    }
+    /* the average of two rows sits between them, the siting of 4:2:0 that MPEG-2 and H.264 assume */
+    if ((AV_PIX_FMT_YUYV422 == m_sourceFormat) || (AV_PIX_FMT_UYVY422 == m_sourceFormat)) {
+        targetFrame->chroma_location = AVCHROMA_LOC_LEFT;
+    }
+    if (m_isBlendingFused && !m_compositor->prepare(targetFrame, time)) {
+        av_frame_unref(targetFrame);
+        return false;
+    }
+
+    auto convertBand = [this, sourceFrame, targetFrame] (std::size_t, int firstUnit, int lastUnit) {
+        auto firstRow = firstUnit * g_rowsPerUnit;
+        auto lastRow = std::min(lastUnit * g_rowsPerUnit, m_height);
+        m_kernel(sourceFrame, targetFrame, m_width, firstRow, lastRow);
+        if (m_isBlendingFused) {
+            m_compositor->blendRows(targetFrame, firstRow, lastRow);
+        }
+    };
+    RowBandPool::getInstance().run((m_height + g_rowsPerUnit - 1) / g_rowsPerUnit, g_minUnitsPerBand, convertBand);
+    return true;
+}
+
+bool PixelConverter::compareWithScaler(const AVFrame* sourceFrame) {
+    if (!isSet()) {
+        std::cerr << "{PixelConverter::compareWithScaler}; pixel converter is NOT set up" << std::endl;
+        return false;
+    }
+    if (
+        (nullptr == sourceFrame) || (sourceFrame->format != m_sourceFormat) ||
+        (sourceFrame->width != m_width) || (sourceFrame->height != m_height)
+    ) {
+        std::cerr << "{PixelConverter::compareWithScaler}; frame does NOT match converter setup" << std::endl;
+        return false;
+    }
+
+    auto convertedFrame = allocateFrame();
+    auto scaledFrame = allocateFrame();
+    if ((nullptr == convertedFrame) || (nullptr == scaledFrame)) {
+        std::cerr << "{PixelConverter::compareWithScaler}; unable to allocate memory for frames" << std::endl;
+        return false;
+    }
+    if (!allocateBuffer(convertedFrame.get()) || !allocateBuffer(scaledFrame.get())) {
+        return false;
+    }
+
+    /* the scale filter uses bicubic scaling unless told otherwise */
+    SwsContext* scaleContext = sws_getContext(
+        m_width, m_height, m_sourceFormat,
+        m_width, m_height, m_targetFormat,
+        SWS_BICUBIC, nullptr, nullptr, nullptr
+    );
+    if (nullptr == scaleContext) {
+        std::cerr << "{PixelConverter::compareWithScaler}; unable to create conversion context" << std::endl;
+        return false;
+    }
+
+    using Microseconds = std::chrono::duration<double, std::micro>;
+    auto getMedianTime = [] (std::vector<double>& times) {
+        std::sort(times.begin(), times.end());
+        return times[ times.size() / 2 ];
+    };
+
+    std::vector<double> scalerTimes;
+    for (int i = 0; i < g_comparisonRuns; ++i) {
+        auto startTime = std::chrono::steady_clock::now();
+        auto nRows = sws_scale(
+            scaleContext, sourceFrame->data, sourceFrame->linesize, 0, m_height,
+            scaledFrame->data, scaledFrame->linesize
+        );
+        scalerTimes.push_back(Microseconds(std::chrono::steady_clock::now() - startTime).count());
+        if (nRows != m_height) {
+            sws_freeContext(scaleContext);
+            std::cerr << "{PixelConverter::compareWithScaler}; unable to convert frame with swscale" << std::endl;
+            return false;
+        }
+    }
+    sws_freeContext(scaleContext);
+    std::cout << "{PixelConverter::compareWithScaler}; conversion: '" <<
+        av_get_pix_fmt_name(m_sourceFormat) << " -> " << av_get_pix_fmt_name(m_targetFormat) << "'; "
+        "frame size: '" << m_width << "x" << m_height << "'; "
+        "runs: '" << g_comparisonRuns << "'; "
+        "swscale median time: '" << getMedianTime(scalerTimes) << " us'" << std::endl;
+
+    /* every kernel up to the one in use, so the gain of each instruction set shows */
+    for (auto instructionSet : { InstructionSet::C, InstructionSet::Sse2, InstructionSet::Avx2 }) {
+        if (instructionSet > m_instructionSet) {
+            break;
+        }
+        auto kernel = getKernel(m_sourceFormat, instructionSet);
+        auto convertBand = [this, sourceFrame, &convertedFrame, kernel] (std::size_t, int firstUnit, int lastUnit) {
+            kernel(
+                sourceFrame, convertedFrame.get(), m_width,
+                firstUnit * g_rowsPerUnit, std::min(lastUnit * g_rowsPerUnit, m_height)
+            );
+        };
+        std::vector<double> converterTimes;
+        for (int i = 0; i < g_comparisonRuns; ++i) {
+            auto startTime = std::chrono::steady_clock::now();
+            RowBandPool::getInstance().run((m_height + g_rowsPerUnit - 1) / g_rowsPerUnit, g_minUnitsPerBand, convertBand);
+            converterTimes.push_back(Microseconds(std::chrono::steady_clock::now() - startTime).count());
+        }
+
+        std::size_t nDifferentBytes = 0;
+        int maxDifference = 0;
+        for (int plane = 0; plane < 3; ++plane) {
+            auto planeWidth = (0 == plane) ? m_width : m_width / 2;
+            auto planeHeight = (0 == plane) ? m_height : m_height / 2;
+            for (int row = 0; row < planeHeight; ++row) {
+                const auto* converted = convertedFrame->data[ plane ] + static_cast<std::ptrdiff_t>(row) * convertedFrame->linesize[ plane ];
+                const auto* scaled = scaledFrame->data[ plane ] + static_cast<std::ptrdiff_t>(row) * scaledFrame->linesize[ plane ];
+                for (int x = 0; x < planeWidth; ++x) {
+                    auto difference = std::abs(converted[ x ] - scaled[ x ]);
+                    nDifferentBytes += (0 != difference) ? 1 : 0;
+                    maxDifference = std::max(maxDifference, difference);
+                }
+            }
+        }
+        /* a difference of one in chroma only means swscale rounds the other way, i.e. its C converter runs */
+        std::cout << "{PixelConverter::compareWithScaler}; instruction set: '" << getInstructionSetName(instructionSet) << "'; "
+            "converter median time: '" << getMedianTime(converterTimes) << " us'; "
+            "number of different bytes: '" << nDifferentBytes << "'; "
+            "maximum difference: '" << maxDifference << "'" << std::endl;
+    }
+    return true;
+}
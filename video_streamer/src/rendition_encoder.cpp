@@ -0,0 +1,236 @@
+#include "rendition_encoder.h"
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/error.h>
+    #include <libavutil/frame.h>
+}
+
+#include <iostream>
+
+#include "common_functions.h"
+#include "encoder_thread_budget.h"
+
+RenditionEncoder::~RenditionEncoder() {
+    close();
+}
+
+bool RenditionEncoder::setup(
+    const Settings& settings, const AVCodecContext* mainEncoderContext,
+    const OutputProtocol::Settings& protocolSettings, const PacketWriter::Settings& writerSettings,
+    StreamMetrics* metrics
+) {
+    if (m_encoderContext || m_outputContext) {
+        std::cerr << "{RenditionEncoder::setup}; rendition encoder is already set" << std::endl;
+        return false;
+    }
+    if (nullptr == mainEncoderContext) {
+        std::cerr << "{RenditionEncoder::setup}; pointer to main encoder context is NULL" << std::endl;
+        return false;
+    }
+    if (settings.url.empty()) {
+        std::cerr << "{RenditionEncoder::setup}; output URL is empty" << std::endl;
+        return false;
+    }
+    if ((settings.width <= 0) || (settings.height <= 0)) {
+        std::cerr << "{RenditionEncoder::setup}; frame size is NOT valid; "
+            "frame size: '" << settings.width << "x" << settings.height << "'" << std::endl;
+        return false;
+    }
+    m_settings = settings;
+    m_protocolSettings = protocolSettings;
+
+    const AVCodec* encoder = avcodec_find_encoder(mainEncoderContext->codec_id);
+    if (nullptr == encoder) {
+        std::cerr << "{RenditionEncoder::setup}; unable to find registered encoder; "
+            "encoder id: '" << static_cast<int>(mainEncoderContext->codec_id) << "'" << std::endl;
+        return false;
+    }
+    m_encoderContext = avcodec_alloc_context3(encoder);
+    if (nullptr == m_encoderContext) {
+        std::cerr << "{RenditionEncoder::setup}; unable to allocate memory for encoder context" << std::endl;
+        return false;
+    }
+    m_encoderContext->width = settings.width;
+    m_encoderContext->height = settings.height;
+    m_encoderContext->sample_aspect_ratio = mainEncoderContext->sample_aspect_ratio;
+    m_encoderContext->pix_fmt = mainEncoderContext->pix_fmt;
+    m_encoderContext->time_base = mainEncoderContext->time_base;
+    m_encoderContext->framerate = mainEncoderContext->framerate;
+
+    auto allocationResult = avformat_alloc_output_context2(
+        &m_outputContext, nullptr, OutputProtocol::getFormatName(settings.protocol), settings.url.c_str()
+    );
+    if (allocationResult < 0) {
+        std::cerr << "{RenditionEncoder::setup}; unable to allocate output context; "
+            "allocation result: '" << allocationResult << " (" << av_err2str(allocationResult) << ")'" << std::endl;
+        return false;
+    }
+    if ((nullptr == m_outputContext) || (nullptr == m_outputContext->oformat)) {
+        std::cerr << "{RenditionEncoder::setup}; pointer to output context is NULL" << std::endl;
+        return false;
+    }
+    AVStream* outputStream = avformat_new_stream(m_outputContext, nullptr);
+    if (nullptr == outputStream) {
+        std::cerr << "{RenditionEncoder::setup}; unable to add new stream" << std::endl;
+        return false;
+    }
+    if (AVFMT_GLOBALHEADER & m_outputContext->oformat->flags) {
+        m_encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    /* renditions share the thread budget with the main encoders of all streamers */
+    m_nEncoderThreads = EncoderThreadBudget::getInstance().acquire(settings.nThreads);
+    m_encoderContext->thread_count = static_cast<int>(m_nEncoderThreads);
+
+    if (!EncoderOptions::apply(settings.encoderOptions, m_encoderContext)) {
+        return false;
+    }
+    auto encoderInitResult = avcodec_open2(m_encoderContext, encoder, nullptr);
+    if (encoderInitResult < 0) {
+        std::cerr << "{RenditionEncoder::setup}; unable to initialize encoder context to use the given encoder; "
+            "initialize result: '" << encoderInitResult << " (" << av_err2str(encoderInitResult) << ")'" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_from_context(outputStream->codecpar, m_encoderContext);
+    if (copyResult < 0) {
+        std::cerr << "{RenditionEncoder::setup}; unable to fill encoder context; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        return false;
+    }
+    outputStream->time_base = m_encoderContext->time_base;
+
+    m_timeoutChecker = std::make_shared<TimeoutChecker>();
+    if (!m_timeoutChecker->setup(protocolSettings.timeout)) {
+        return false;
+    }
+    if (!openOutput()) {
+        return false;
+    }
+
+    auto writeResult = avformat_write_header(m_outputContext, nullptr);
+    if (writeResult < 0) {
+        std::cerr << "{RenditionEncoder::setup}; unable to write header; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        return false;
+    }
+    auto protocolWriterSettings = writerSettings;
+    protocolWriterSettings.isDropOnTimeout = (
+        OutputProtocol::Backpressure::Drop == OutputProtocol::getBackpressure(settings.protocol)
+    );
+    if (!m_packetWriter.setup(m_outputContext, m_timeoutChecker, metrics, protocolWriterSettings)) {
+        return false;
+    }
+
+    m_packet = av_packet_alloc();
+    if (nullptr == m_packet) {
+        std::cerr << "{RenditionEncoder::setup}; unable to allocate memory for packet" << std::endl;
+        return false;
+    }
+    std::cout << "{RenditionEncoder::setup}; rendition encoder has been successfully set up; "
+        "frame size: '" << settings.width << "x" << settings.height << "'; "
+        "protocol: '" << OutputProtocol::getName(settings.protocol) << "'; "
+        "number of encoder threads: '" << m_nEncoderThreads << "'" << std::endl;
+    return true;
+}
+
+bool RenditionEncoder::openOutput() {
+    if (AVFMT_NOFILE & m_outputContext->oformat->flags) {
+        return true;
+    }
+    int (*timeoutCallback)(void*) = &TimeoutChecker::onProxyReadyToCheckTimeout;
+    const AVIOInterruptCB interruptCallback = {
+        .callback = timeoutCallback, .opaque = static_cast<void*>(m_timeoutChecker.get())
+    };
+    return OutputProtocol::openOutput(
+        m_outputContext, m_settings.url, m_settings.protocol, m_protocolSettings, interruptCallback
+    );
+}
+
+bool RenditionEncoder::encode(AVFrame* frame) {
+    if ((nullptr == m_encoderContext) || (nullptr == m_packet)) {
+        std::cerr << "{RenditionEncoder::encode}; rendition encoder is NOT set up" << std::endl;
+        return false;
+    }
+    if (frame && (AV_NOPTS_VALUE != frame->pts)) {
+        frame->pts = av_rescale_q(frame->pts, frame->time_base, m_encoderContext->time_base);
+    }
+
+    auto sendResult = avcodec_send_frame(m_encoderContext, frame);
+    if (sendResult < 0) {
+        std::cerr << "{RenditionEncoder::encode}; unable to send frame to encoder context; "
+            "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
+        return false;
+    }
+
+    while (true) {
+        auto receiveResult = avcodec_receive_packet(m_encoderContext, m_packet);
+        if ((AVERROR(EAGAIN) == receiveResult) || (AVERROR_EOF == receiveResult)) {
+            break;
+        } else if (receiveResult < 0) {
+            std::cerr << "{RenditionEncoder::encode}; unable to receive packet from encoder context; "
+                "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
+            return false;
+        }
+        m_packet->stream_index = 0;
+        av_packet_rescale_ts(m_packet, m_encoderContext->time_base, m_outputContext->streams[ 0 ]->time_base);
+        if (!m_packetWriter.write(m_packet)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RenditionEncoder::finish() {
+    if (nullptr == m_encoderContext) {
+        std::cerr << "{RenditionEncoder::finish}; rendition encoder is NOT set up" << std::endl;
+        return false;
+    }
+    if ((AV_CODEC_CAP_DELAY & m_encoderContext->codec->capabilities) && !encode(nullptr)) {
+        return false;
+    }
+    if (!m_packetWriter.flush()) {
+        return false;
+    }
+    auto writeTrailerResult = av_write_trailer(m_outputContext);
+    if (writeTrailerResult < 0) {
+        std::cerr << "{RenditionEncoder::finish}; unable to write trailer; "
+            "write result: '" << writeTrailerResult << " (" << av_err2str(writeTrailerResult) << ")'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RenditionEncoder::close() {
+    m_packetWriter.stop();
+    if (
+        m_outputContext && m_outputContext->pb && m_outputContext->oformat &&
+        !(AVFMT_NOFILE & m_outputContext->oformat->flags) && m_timeoutChecker
+    ) {
+        m_timeoutChecker->setBeginTime();
+        auto closeResult = avio_closep(&m_outputContext->pb);
+        m_timeoutChecker->resetBeginTime();
+        if ((closeResult < 0) && (AVERROR_EOF != closeResult)) {
+            std::cerr << "{RenditionEncoder::close}; unable to close output context; "
+                "close result: '" << closeResult << " (" << av_err2str(closeResult) << ")'" << std::endl;
+        }
+    }
+    if (m_outputContext) {
+        avformat_free_context(m_outputContext);
+        m_outputContext = nullptr;
+    }
+    if (m_packet) {
+        av_packet_free(&m_packet);
+        m_packet = nullptr;
+    }
+    if (m_encoderContext) {
+        avcodec_free_context(&m_encoderContext);
+        m_encoderContext = nullptr;
+    }
+    if (m_nEncoderThreads > 0) {
+        EncoderThreadBudget::getInstance().release(m_nEncoderThreads);
+        m_nEncoderThreads = 0;
+    }
+    m_timeoutChecker.reset();
+}
@@ -0,0 +1,185 @@
+#include "row_band_pool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+RowBandPool::~RowBandPool() {
+    stop();
+}
+
+bool RowBandPool::start(std::size_t nWorkers, const ThreadPlacement::Settings& placement) {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (m_isRunning.load(std::memory_order_acquire)) {
+        std::cout << "{RowBandPool::start}; row band pool is already running" << std::endl;
+        return true;
+    }
+    if (0 == nWorkers) {
+        std::cerr << "{RowBandPool::start}; number of workers is equal to zero" << std::endl;
+        return false;
+    }
+    /* the calling thread always takes a band as well */
+    nWorkers = std::min(nWorkers, s_maxBands - 1);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = false;
+    }
+    bool isStarted = false;
+    try {
+        m_workers.reserve(nWorkers);
+        for (std::size_t i = 0; i < nWorkers; ++i) {
+            auto workerPlacement = placement;
+            if (!placement.cpus.empty()) {
+                workerPlacement.cpus = { placement.cpus[i % placement.cpus.size()] };
+            }
+            m_workers.emplace_back(&RowBandPool::runWorker, this, i, workerPlacement);
+        }
+        isStarted = true;
+    } catch (const std::system_error& exception) {
+        std::cerr << "{RowBandPool::start}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting workers; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+    } catch (const std::bad_alloc& exception) {
+        std::cerr << "{RowBandPool::start}; "
+            "exception 'std::bad_alloc' was successfully caught while "
+            "starting workers; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+    } catch (...) {
+        std::cerr << "{RowBandPool::start}; "
+            "unknown exception was caught while "
+            "starting workers" << std::endl;
+    }
+
+    if (!isStarted) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopRequested = true;
+        }
+        m_condition.notify_all();
+        for (auto& worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        m_workers.clear();
+        return false;
+    }
+
+    m_nWorkers.store(nWorkers, std::memory_order_release);
+    m_isRunning.store(true, std::memory_order_release);
+    std::cout << "{RowBandPool::start}; row band pool has been successfully started; "
+        "number of workers: '" << nWorkers << "'" << std::endl;
+    return true;
+}
+
+void RowBandPool::stop() {
+    std::lock_guard<std::mutex> controlLock(m_controlMutex);
+    if (!m_isRunning.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    m_nWorkers.store(0, std::memory_order_release);
+
+    /* callers finish the bands of queued jobs themselves */
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = true;
+    }
+    m_condition.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    m_workers.clear();
+    std::cout << "{RowBandPool::stop}; row band pool has been stopped" << std::endl;
+}
+
+void RowBandPool::run(int nRows, int minRowsPerBand, const Task& task) {
+    if (nRows <= 0) {
+        return;
+    }
+
+    std::size_t nBands = 1;
+    if (isRunning()) {
+        auto maxBands = static_cast<std::size_t>(std::max(nRows / std::max(minRowsPerBand, 1), 1));
+        nBands = std::min({ getWorkers() + 1, s_maxBands, maxBands });
+    }
+    if (nBands <= 1) {
+        task(0, 0, nRows);
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->nRows = nRows;
+    job->nBands = nBands;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_isStopRequested) {
+            m_jobs.push_back(job);
+        }
+    }
+    m_condition.notify_all();
+
+    runBands(*job);
+    {
+        std::unique_lock<std::mutex> jobLock(job->mutex);
+        job->condition.wait(jobLock, [&job] () {
+            return job->nDoneBands.load(std::memory_order_acquire) == job->nBands;
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_jobs.begin(), m_jobs.end(), job);
+    if (m_jobs.end() != it) {
+        m_jobs.erase(it);
+    }
+}
+
+void RowBandPool::runBands(Job& job) {
+    while (true) {
+        auto band = job.nextBand.fetch_add(1, std::memory_order_acq_rel);
+        if (band >= job.nBands) {
+            return;
+        }
+        auto firstRow = static_cast<int>(static_cast<std::size_t>(job.nRows) * band / job.nBands);
+        auto lastRow = static_cast<int>(static_cast<std::size_t>(job.nRows) * (band + 1) / job.nBands);
+        (*job.task)(band, firstRow, lastRow);
+
+        if ((job.nDoneBands.fetch_add(1, std::memory_order_acq_rel) + 1) == job.nBands) {
+            std::lock_guard<std::mutex> jobLock(job.mutex);
+            job.condition.notify_all();
+        }
+    }
+}
+
+void RowBandPool::runWorker(std::size_t workerIndex, ThreadPlacement::Settings placement) {
+    auto threadName = "row band worker " + std::to_string(workerIndex);
+    if (!ThreadPlacement::isEmpty(placement)) {
+        ThreadPlacement::apply(threadName, placement);
+    }
+    ThreadPlacement::report(threadName);
+
+    while (true) {
+        std::shared_ptr<Job> job{ nullptr };
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () {
+                return m_isStopRequested || !m_jobs.empty();
+            });
+            if (m_isStopRequested) {
+                break;
+            }
+            job = m_jobs.front();
+            /* all bands are taken; the owner waits for the running ones */
+            if (job->nextBand.load(std::memory_order_acquire) >= job->nBands) {
+                m_jobs.pop_front();
+                continue;
+            }
+        }
+        runBands(*job);
+    }
+}
@@ -0,0 +1,254 @@
+#include "segment_file.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    /* logical block size of practically every disk; O_DIRECT needs buffer, offset and size aligned to it */
+    constexpr std::size_t g_directAlignment = 4096;
+}
+
+SegmentFile::~SegmentFile() {
+    close();
+}
+
+std::optional<SegmentFile::SyncMode> SegmentFile::getSyncMode(const std::string& syncModeName) {
+    if ("none" == syncModeName) {
+        return std::make_optional<SyncMode>(SyncMode::None);
+    }
+    if ("fdatasync" == syncModeName) {
+        return std::make_optional<SyncMode>(SyncMode::Fdatasync);
+    }
+    if ("direct" == syncModeName) {
+        return std::make_optional<SyncMode>(SyncMode::Direct);
+    }
+    std::cerr << "{SegmentFile::getSyncMode}; sync mode '" << syncModeName << "' is NOT supported" << std::endl;
+    return std::nullopt;
+}
+
+bool SegmentFile::open(const std::string& fileName, SyncMode syncMode, std::size_t batchSize) {
+    if (isOpen()) {
+        std::cerr << "{SegmentFile::open}; file '" << m_fileName << "' is already open" << std::endl;
+        return false;
+    }
+    if (fileName.empty()) {
+        std::cerr << "{SegmentFile::open}; file name is empty" << std::endl;
+        return false;
+    }
+    if (0 == batchSize) {
+        std::cerr << "{SegmentFile::open}; batch size is equal to zero" << std::endl;
+        return false;
+    }
+
+    m_batchSize = ((batchSize + g_directAlignment - 1) / g_directAlignment) * g_directAlignment;
+    m_buffer = static_cast<std::uint8_t*>(std::aligned_alloc(g_directAlignment, m_batchSize));
+    if (nullptr == m_buffer) {
+        std::cerr << "{SegmentFile::open}; unable to allocate memory for batch buffer" << std::endl;
+        return false;
+    }
+    m_bufferedSize = 0;
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    m_isDirect = false;
+    if (SyncMode::Direct == syncMode) {
+        m_fileDescriptor = ::open(fileName.c_str(), flags | O_DIRECT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (-1 != m_fileDescriptor) {
+            m_isDirect = true;
+        } else if (EINVAL == errno) {
+            /* e.g. tmpfs does NOT support O_DIRECT */
+            std::cout << "{SegmentFile::open}; file system does NOT support O_DIRECT; "
+                "file name: '" << fileName << "'" << std::endl;
+        }
+    }
+    if (-1 == m_fileDescriptor) {
+        m_fileDescriptor = ::open(fileName.c_str(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    }
+    if (-1 == m_fileDescriptor) {
+        std::cerr << "{SegmentFile::open}; unable to open file '" << fileName << "'; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        freeBuffer();
+        return false;
+    }
+    auto& reactor = OutputReactor::getInstance();
+    if (reactor.isRunning()) {
+        m_reactorTarget = reactor.registerTarget(m_fileDescriptor, false);
+        if (nullptr == m_reactorTarget) {
+            ::close(m_fileDescriptor);
+            m_fileDescriptor = -1;
+            freeBuffer();
+            return false;
+        }
+    }
+    m_fileName = fileName;
+    m_syncMode = syncMode;
+    return true;
+}
+
+bool SegmentFile::write(const std::uint8_t* data, std::size_t size) {
+    if (!isOpen()) {
+        std::cerr << "{SegmentFile::write}; file is NOT open" << std::endl;
+        return false;
+    }
+    if ((nullptr == data) && (size > 0)) {
+        std::cerr << "{SegmentFile::write}; pointer to data is NULL" << std::endl;
+        return false;
+    }
+
+    while (size > 0) {
+        auto nCopiedBytes = std::min(size, m_batchSize - m_bufferedSize);
+        std::memcpy(m_buffer + m_bufferedSize, data, nCopiedBytes);
+        m_bufferedSize += nCopiedBytes;
+        data += nCopiedBytes;
+        size -= nCopiedBytes;
+
+        if (m_bufferedSize == m_batchSize) {
+            if (!writeBatch(m_bufferedSize)) {
+                return false;
+            }
+            m_bufferedSize = 0;
+        }
+    }
+    return true;
+}
+
+bool SegmentFile::close() {
+    if (!isOpen()) {
+        freeBuffer();
+        return true;
+    }
+
+    bool isClosed = true;
+    if (m_bufferedSize > 0) {
+        auto alignedSize = (m_bufferedSize / g_directAlignment) * g_directAlignment;
+        if (m_isDirect && (alignedSize > 0)) {
+            isClosed = writeBatch(alignedSize);
+            std::memmove(m_buffer, m_buffer + alignedSize, m_bufferedSize - alignedSize);
+            m_bufferedSize -= alignedSize;
+        }
+        if (isClosed && m_isDirect && (m_bufferedSize > 0)) {
+            isClosed = waitForBatches();
+        }
+        if (isClosed && m_isDirect && (m_bufferedSize > 0)) {
+            auto fileFlags = fcntl(m_fileDescriptor, F_GETFL);
+            if ((-1 == fileFlags) || (-1 == fcntl(m_fileDescriptor, F_SETFL, fileFlags & ~O_DIRECT))) {
+                std::cerr << "{SegmentFile::close}; unable to clear O_DIRECT; "
+                    "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+                    "file name: '" << m_fileName << "'" << std::endl;
+                isClosed = false;
+            }
+            m_isDirect = false;
+        }
+        if (isClosed && (m_bufferedSize > 0)) {
+            isClosed = writeBatch(m_bufferedSize);
+        }
+        m_bufferedSize = 0;
+    }
+
+    if (isClosed) {
+        isClosed = waitForBatches();
+    }
+    if (m_reactorTarget) {
+        OutputReactor::getInstance().unregisterTarget(m_reactorTarget);
+        m_reactorTarget.reset();
+    }
+
+    /* O_DIRECT bypasses the page cache, but NOT the disk cache */
+    if (isClosed && (SyncMode::None != m_syncMode) && (0 != fdatasync(m_fileDescriptor))) {
+        std::cerr << "{SegmentFile::close}; unable to synchronize file; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+            "file name: '" << m_fileName << "'" << std::endl;
+        isClosed = false;
+    }
+    if (0 != ::close(m_fileDescriptor)) {
+        std::cerr << "{SegmentFile::close}; unable to close file; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+            "file name: '" << m_fileName << "'" << std::endl;
+        isClosed = false;
+    }
+    m_fileDescriptor = -1;
+    m_isDirect = false;
+    freeBuffer();
+    return isClosed;
+}
+
+int SegmentFile::onProxyWrite(void* filePtr, const std::uint8_t* data, int size) {
+    if (nullptr == filePtr) {
+        std::cerr << "{SegmentFile::onProxyWrite}; pointer to file is NULL" << std::endl;
+        return -1;
+    }
+    if (size < 0) {
+        std::cerr << "{SegmentFile::onProxyWrite}; size is less than zero" << std::endl;
+        return -1;
+    }
+    auto file = static_cast<SegmentFile*>(filePtr);
+    if (!file->write(data, static_cast<std::size_t>(size))) {
+        return -1;
+    }
+    return size;
+}
+
+bool SegmentFile::writeBatch(std::size_t size) {
+    if (m_reactorTarget) {
+        /* the batch is copied, so the buffer can be refilled right away */
+        auto& reactor = OutputReactor::getInstance();
+        if (
+            !reactor.write(*m_reactorTarget, m_buffer, size, nullptr) ||
+            !reactor.flush(*m_reactorTarget, SyncMode::Fdatasync == m_syncMode)
+        ) {
+            std::cerr << "{SegmentFile::writeBatch}; unable to hand batch to output reactor; "
+                "file name: '" << m_fileName << "'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::size_t nWrittenBytes = 0;
+    while (nWrittenBytes < size) {
+        auto writeResult = ::write(m_fileDescriptor, m_buffer + nWrittenBytes, size - nWrittenBytes);
+        if (writeResult < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            std::cerr << "{SegmentFile::writeBatch}; unable to write batch; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+                "file name: '" << m_fileName << "'" << std::endl;
+            return false;
+        }
+        nWrittenBytes += static_cast<std::size_t>(writeResult);
+    }
+
+    if ((SyncMode::Fdatasync == m_syncMode) && (0 != fdatasync(m_fileDescriptor))) {
+        std::cerr << "{SegmentFile::writeBatch}; unable to synchronize file; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+            "file name: '" << m_fileName << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SegmentFile::waitForBatches() {
+    if (nullptr == m_reactorTarget) {
+        return true;
+    }
+    if (!OutputReactor::getInstance().drain(*m_reactorTarget, nullptr)) {
+        std::cerr << "{SegmentFile::waitForBatches}; unable to write batches; "
+            "file name: '" << m_fileName << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SegmentFile::freeBuffer() {
+    if (m_buffer) {
+        std::free(m_buffer);
+        m_buffer = nullptr;
+    }
+    m_bufferedSize = 0;
+}
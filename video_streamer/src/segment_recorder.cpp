@@ -0,0 +1,476 @@
+#include "segment_recorder.h"
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavcodec/packet.h>
+    #include <libavformat/avformat.h>
+    #include <libavformat/avio.h>
+    #include <libavutil/dict.h>
+    #include <libavutil/error.h>
+    #include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#include "common_functions.h"
+
+namespace {
+    constexpr std::size_t g_ioBufferSize = 64 * 1024;
+    constexpr std::size_t g_segmentBatchSize = 1024 * 1024;
+    constexpr std::size_t g_playlistBatchSize = 4096;
+    constexpr const char* g_playlistFileName = "playlist.m3u8";
+}
+
+SegmentRecorder::~SegmentRecorder() {
+    stop();
+}
+
+std::optional<SegmentRecorder::Format> SegmentRecorder::getFormat(const std::string& formatName) {
+    if ("fmp4" == formatName) {
+        return std::make_optional<Format>(Format::Fmp4);
+    }
+    if ("hls" == formatName) {
+        return std::make_optional<Format>(Format::Hls);
+    }
+    std::cerr << "{SegmentRecorder::getFormat}; recording format '" << formatName << "' is NOT supported" << std::endl;
+    return std::nullopt;
+}
+
+bool SegmentRecorder::setup(
+    const Settings& settings, const AVCodecParameters* codecParameters,
+    AVRational timeBase, StreamMetrics* metrics
+) {
+    if (m_thread.joinable()) {
+        std::cerr << "{SegmentRecorder::setup}; recorder thread is already running" << std::endl;
+        return false;
+    }
+    if (nullptr == codecParameters) {
+        std::cerr << "{SegmentRecorder::setup}; pointer to codec parameters is NULL" << std::endl;
+        return false;
+    }
+    if (codecParameters->extradata_size <= 0) {
+        std::cerr << "{SegmentRecorder::setup}; codec parameters have NO extradata" << std::endl;
+        return false;
+    }
+    if (nullptr == metrics) {
+        std::cerr << "{SegmentRecorder::setup}; pointer to metrics is NULL" << std::endl;
+        return false;
+    }
+    if ((timeBase.num <= 0) || (timeBase.den <= 0)) {
+        std::cerr << "{SegmentRecorder::setup}; time base is NOT valid" << std::endl;
+        return false;
+    }
+    if (settings.segmentDuration <= 0) {
+        std::cerr << "{SegmentRecorder::setup}; segment duration is NOT positive" << std::endl;
+        return false;
+    }
+    if (0 == settings.queueCapacity) {
+        std::cerr << "{SegmentRecorder::setup}; queue capacity is equal to zero" << std::endl;
+        return false;
+    }
+    if (!CommonFunctions::isDirectory(settings.directory)) {
+        return false;
+    }
+
+    m_codecParameters = avcodec_parameters_alloc();
+    if (nullptr == m_codecParameters) {
+        std::cerr << "{SegmentRecorder::setup}; unable to allocate memory for codec parameters" << std::endl;
+        return false;
+    }
+    auto copyResult = avcodec_parameters_copy(m_codecParameters, codecParameters);
+    if (copyResult < 0) {
+        std::cerr << "{SegmentRecorder::setup}; unable to copy codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+
+    m_settings = settings;
+    m_timeBase = timeBase;
+    m_metrics = metrics;
+    /* segments of different runs in the same directory do NOT overwrite each other */
+    m_sessionId = CommonFunctions::getCurTimeSinceEpoch() / 1000000;
+    m_segmentIndex = 0;
+    m_recordedSegments.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isWaitingForKeyframe = true;
+        m_isStopRequested = false;
+    }
+
+    try {
+        m_thread = std::thread(&SegmentRecorder::run, this);
+    } catch (const std::system_error& exception) {
+        std::cerr << "{SegmentRecorder::setup}; "
+            "exception 'std::system_error' was successfully caught while "
+            "starting recorder thread; "
+            "exception description: '" << exception.what() << "'" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    } catch (...) {
+        std::cerr << "{SegmentRecorder::setup}; "
+            "unknown exception was caught while "
+            "starting recorder thread" << std::endl;
+        avcodec_parameters_free(&m_codecParameters);
+        return false;
+    }
+    std::cout << "{SegmentRecorder::setup}; recording has been successfully started; "
+        "directory: '" << m_settings.directory << "'" << std::endl;
+    return true;
+}
+
+void SegmentRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopRequested = true;
+    }
+    m_condition.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& queuedPacket : m_queuedPackets) {
+        av_packet_free(&queuedPacket.packet);
+    }
+    m_queuedPackets.clear();
+    if (m_codecParameters) {
+        avcodec_parameters_free(&m_codecParameters);
+        m_codecParameters = nullptr;
+    }
+    m_metrics = nullptr;
+}
+
+void SegmentRecorder::record(const AVPacket* packet) {
+    if (nullptr == packet) {
+        return;
+    }
+    bool isKeyframe = (AV_PKT_FLAG_KEY & packet->flags);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_thread.joinable() || m_isStopRequested) {
+        return;
+    }
+    if (m_isWaitingForKeyframe && !isKeyframe) {
+        m_metrics->add(StreamMetrics::Metric::RecorderDroppedPackets);
+        return;
+    }
+    if (m_queuedPackets.size() >= m_settings.queueCapacity) {
+        /* the rest of the GOP can NOT be decoded without this packet */
+        m_isWaitingForKeyframe = true;
+        m_metrics->add(StreamMetrics::Metric::RecorderDroppedPackets);
+        return;
+    }
+
+    AVPacket* queuedPacket = av_packet_clone(packet);
+    if (nullptr == queuedPacket) {
+        std::cerr << "{SegmentRecorder::record}; unable to clone packet" << std::endl;
+        m_isWaitingForKeyframe = true;
+        m_metrics->add(StreamMetrics::Metric::RecorderDroppedPackets);
+        return;
+    }
+    m_queuedPackets.push_back(QueuedPacket{
+        .packet = queuedPacket, .isDiscontinuity = m_isWaitingForKeyframe
+    });
+    m_isWaitingForKeyframe = false;
+    lock.unlock();
+    m_condition.notify_one();
+}
+
+bool SegmentRecorder::openSegment(std::int64_t startTimestamp) {
+    using namespace std::string_literals;
+
+    if (m_segmentContext) {
+        std::cerr << "{SegmentRecorder::openSegment}; segment is already open" << std::endl;
+        return false;
+    }
+
+    auto fileName = getSegmentFileName(m_segmentIndex);
+    auto fullFileName = (std::filesystem::path(m_settings.directory) / fileName).string();
+    auto formatName = (Format::Hls == m_settings.format) ? "mpegts"s : "mp4"s;
+
+    auto allocationResult = avformat_alloc_output_context2(
+        &m_segmentContext, nullptr, formatName.c_str(), fullFileName.c_str()
+    );
+    if ((allocationResult < 0) || (nullptr == m_segmentContext)) {
+        std::cerr << "{SegmentRecorder::openSegment}; unable to allocate segment context; "
+            "allocation result: '" << allocationResult << " (" << av_err2str(allocationResult) << ")'" << std::endl;
+        freeSegment();
+        return false;
+    }
+
+    AVStream* segmentStream = avformat_new_stream(m_segmentContext, nullptr);
+    if (nullptr == segmentStream) {
+        std::cerr << "{SegmentRecorder::openSegment}; unable to add new stream" << std::endl;
+        freeSegment();
+        return false;
+    }
+    auto copyResult = avcodec_parameters_copy(segmentStream->codecpar, m_codecParameters);
+    if (copyResult < 0) {
+        std::cerr << "{SegmentRecorder::openSegment}; unable to copy codec parameters; "
+            "copy result: '" << copyResult << " (" << av_err2str(copyResult) << ")'" << std::endl;
+        freeSegment();
+        return false;
+    }
+    /* the tag of the live container (FLV) means nothing to MP4 or MPEG-TS */
+    segmentStream->codecpar->codec_tag = 0;
+    segmentStream->time_base = m_timeBase;
+
+    if (!m_segmentFile.open(fullFileName, m_settings.syncMode, g_segmentBatchSize)) {
+        freeSegment();
+        return false;
+    }
+
+    auto ioBuffer = static_cast<unsigned char*>(av_malloc(g_ioBufferSize));
+    if (nullptr == ioBuffer) {
+        std::cerr << "{SegmentRecorder::openSegment}; unable to allocate memory for I/O buffer" << std::endl;
+        freeSegment();
+        return false;
+    }
+    /* NOT seekable; both muxers then write strictly sequentially */
+    m_segmentIoContext = avio_alloc_context(
+        ioBuffer, static_cast<int>(g_ioBufferSize), 1,
+        static_cast<void*>(&m_segmentFile), nullptr, &SegmentFile::onProxyWrite, nullptr
+    );
+    if (nullptr == m_segmentIoContext) {
+        std::cerr << "{SegmentRecorder::openSegment}; unable to allocate I/O context" << std::endl;
+        av_free(ioBuffer);
+        freeSegment();
+        return false;
+    }
+    m_segmentContext->pb = m_segmentIoContext;
+    m_segmentContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    AVDictionary* options = nullptr;
+    if (Format::Fmp4 == m_settings.format) {
+        auto setResult = av_dict_set(&options, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+        if (setResult < 0) {
+            std::cerr << "{SegmentRecorder::openSegment}; unable to set key-value pair; "
+                "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+            freeSegment();
+            return false;
+        }
+    }
+    auto writeResult = avformat_write_header(m_segmentContext, &options);
+    av_dict_free(&options);
+    if (writeResult < 0) {
+        std::cerr << "{SegmentRecorder::openSegment}; unable to write header; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'; "
+            "file name: '" << fullFileName << "'" << std::endl;
+        freeSegment();
+        return false;
+    }
+
+    m_segmentStartTimestamp = startTimestamp;
+    m_segmentEndTimestamp = startTimestamp;
+    return true;
+}
+
+bool SegmentRecorder::closeSegment() {
+    if (nullptr == m_segmentContext) {
+        return true;
+    }
+
+    bool isClosed = true;
+    auto writeResult = av_write_trailer(m_segmentContext);
+    if (writeResult < 0) {
+        std::cerr << "{SegmentRecorder::closeSegment}; unable to write trailer; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        isClosed = false;
+    }
+    if (m_segmentIoContext) {
+        avio_flush(m_segmentIoContext);
+    }
+    if (!m_segmentFile.close()) {
+        isClosed = false;
+    }
+    freeSegment();
+
+    RecordedSegment recordedSegment{
+        .index = m_segmentIndex,
+        .fileName = getSegmentFileName(m_segmentIndex),
+        .duration = av_q2d(m_timeBase) * static_cast<double>(m_segmentEndTimestamp - m_segmentStartTimestamp)
+    };
+    ++m_segmentIndex;
+    if (!isClosed) {
+        return false;
+    }
+
+    m_recordedSegments.push_back(recordedSegment);
+    m_metrics->add(StreamMetrics::Metric::RecordedSegments);
+    removeExpiredSegments();
+    if (Format::Hls == m_settings.format) {
+        return writePlaylist(false);
+    }
+    return true;
+}
+
+void SegmentRecorder::freeSegment() {
+    if (m_segmentContext) {
+        avformat_free_context(m_segmentContext);
+        m_segmentContext = nullptr;
+    }
+    if (m_segmentIoContext) {
+        av_freep(&m_segmentIoContext->buffer);
+        avio_context_free(&m_segmentIoContext);
+        m_segmentIoContext = nullptr;
+    }
+    m_segmentFile.close();
+}
+
+bool SegmentRecorder::writePacket(AVPacket* packet, bool isDiscontinuity) {
+    auto timestamp = (AV_NOPTS_VALUE != packet->pts) ? packet->pts : packet->dts;
+    if (AV_NOPTS_VALUE == timestamp) {
+        std::cerr << "{SegmentRecorder::writePacket}; packet has no timestamp" << std::endl;
+        return true;
+    }
+    bool isKeyframe = (AV_PKT_FLAG_KEY & packet->flags);
+
+    if (m_segmentContext && isKeyframe) {
+        auto segmentDuration = av_rescale_q(timestamp - m_segmentStartTimestamp, m_timeBase, AV_TIME_BASE_Q);
+        if (isDiscontinuity || (segmentDuration >= m_settings.segmentDuration)) {
+            if (!isDiscontinuity) {
+                m_segmentEndTimestamp = timestamp;
+            }
+            if (!closeSegment()) {
+                return false;
+            }
+        }
+    }
+    if (nullptr == m_segmentContext) {
+        if (!isKeyframe) {
+            return true;
+        }
+        if (!openSegment(timestamp)) {
+            return false;
+        }
+    }
+
+    auto packetEndTimestamp = timestamp + std::max<std::int64_t>(packet->duration, 0);
+    m_segmentEndTimestamp = std::max(m_segmentEndTimestamp, packetEndTimestamp);
+
+    packet->stream_index = 0;
+    packet->pos = -1;
+    av_packet_rescale_ts(packet, m_timeBase, m_segmentContext->streams[0]->time_base);
+    auto writeResult = av_write_frame(m_segmentContext, packet);
+    if (writeResult < 0) {
+        std::cerr << "{SegmentRecorder::writePacket}; unable to write packet to segment; "
+            "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
+        return false;
+    }
+    m_metrics->add(StreamMetrics::Metric::RecordedPackets);
+    return true;
+}
+
+bool SegmentRecorder::writePlaylist(bool isEnded) const {
+    double maxDuration = 0.0;
+    for (const auto& recordedSegment : m_recordedSegments) {
+        maxDuration = std::max(maxDuration, recordedSegment.duration);
+    }
+
+    std::string playlist = "#EXTM3U\n#EXT-X-VERSION:3\n";
+    playlist += "#EXT-X-TARGETDURATION:" + std::to_string(static_cast<long long>(std::ceil(maxDuration))) + "\n";
+    playlist += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(
+        m_recordedSegments.empty() ? 0 : m_recordedSegments.front().index
+    ) + "\n";
+    for (const auto& recordedSegment : m_recordedSegments) {
+        char duration[ 32 ] = { 0 };
+        std::snprintf(duration, sizeof(duration), "%.3f", recordedSegment.duration);
+        playlist += "#EXTINF:" + std::string(duration) + ",\n" + recordedSegment.fileName + "\n";
+    }
+    if (isEnded) {
+        playlist += "#EXT-X-ENDLIST\n";
+    }
+
+    /* readers must never see a half-written playlist */
+    auto playlistFileName = (std::filesystem::path(m_settings.directory) / g_playlistFileName).string();
+    auto temporaryFileName = playlistFileName + ".tmp";
+    auto syncMode = (SegmentFile::SyncMode::None == m_settings.syncMode) ?
+        SegmentFile::SyncMode::None : SegmentFile::SyncMode::Fdatasync;
+    SegmentFile playlistFile;
+    if (!playlistFile.open(temporaryFileName, syncMode, g_playlistBatchSize)) {
+        return false;
+    }
+    if (!playlistFile.write(reinterpret_cast<const std::uint8_t*>(playlist.data()), playlist.size())) {
+        return false;
+    }
+    if (!playlistFile.close()) {
+        return false;
+    }
+
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryFileName, playlistFileName, errorCode);
+    if (errorCode) {
+        std::cerr << "{SegmentRecorder::writePlaylist}; unable to rename playlist; "
+            "error: '" << errorCode.message() << "'; "
+            "file name: '" << temporaryFileName << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void SegmentRecorder::removeExpiredSegments() {
+    if (0 == m_settings.nRetainedSegments) {
+        return;
+    }
+    while (m_recordedSegments.size() > m_settings.nRetainedSegments) {
+        auto fullFileName = std::filesystem::path(m_settings.directory) / m_recordedSegments.front().fileName;
+        std::error_code errorCode;
+        if (!std::filesystem::remove(fullFileName, errorCode) && errorCode) {
+            std::cerr << "{SegmentRecorder::removeExpiredSegments}; unable to remove segment; "
+                "error: '" << errorCode.message() << "'; "
+                "file name: '" << fullFileName.string() << "'" << std::endl;
+        }
+        m_recordedSegments.pop_front();
+    }
+}
+
+std::string SegmentRecorder::getSegmentFileName(std::uint64_t segmentIndex) const {
+    char fileName[ 128 ] = { 0 };
+    std::snprintf(
+        fileName, sizeof(fileName), "record_%lld_%06llu.%s",
+        static_cast<long long>(m_sessionId), static_cast<unsigned long long>(segmentIndex),
+        (Format::Hls == m_settings.format) ? "ts" : "mp4"
+    );
+    return std::string(fileName);
+}
+
+void SegmentRecorder::run() {
+    while (true) {
+        QueuedPacket queuedPacket;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () {
+                return m_isStopRequested || !m_queuedPackets.empty();
+            });
+            if (m_queuedPackets.empty()) {
+                break;
+            }
+            queuedPacket = m_queuedPackets.front();
+            m_queuedPackets.pop_front();
+        }
+
+        if (!writePacket(queuedPacket.packet, queuedPacket.isDiscontinuity)) {
+            /* recording restarts with a new segment, the live stream is NOT affected */
+            if (m_segmentContext) {
+                ++m_segmentIndex;
+            }
+            freeSegment();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isWaitingForKeyframe = true;
+        }
+        av_packet_free(&queuedPacket.packet);
+    }
+
+    closeSegment();
+    if (Format::Hls == m_settings.format) {
+        writePlaylist(true);
+    }
+    std::cout << "{SegmentRecorder::run}; recording has been stopped; "
+        "number of segments: '" << m_segmentIndex << "'" << std::endl;
+}
@@ -0,0 +1,351 @@
+#include "segment_store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+    /* parts are listed for the segments within this many target durations of the live edge */
+    constexpr std::int64_t g_partListingTargetDurations = 3;
+    constexpr std::int64_t g_blockingTargetDurations = 3;
+    constexpr std::int64_t g_partHoldBackPartTargets = 3;
+
+    std::string formatSeconds(std::int64_t microseconds) {
+        char seconds[ 32 ] = { 0 };
+        std::snprintf(seconds, sizeof(seconds), "%.5f", static_cast<double>(microseconds) / 1000000.0);
+        return std::string(seconds);
+    }
+}
+
+bool SegmentStore::setup(const Settings& settings) {
+    if ((settings.segmentDuration <= 0) || (settings.partDuration <= 0)) {
+        std::cerr << "{SegmentStore::setup}; segment or part duration is NOT positive" << std::endl;
+        return false;
+    }
+    if (settings.partDuration > settings.segmentDuration) {
+        std::cerr << "{SegmentStore::setup}; part duration is greater than segment duration" << std::endl;
+        return false;
+    }
+    if (0 == settings.nSegments) {
+        std::cerr << "{SegmentStore::setup}; number of segments is equal to zero" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+    m_initSegment.reset();
+    m_segments.clear();
+    m_nextSequence = 0;
+    m_discontinuitySequence = 0;
+    m_storedBytes = 0;
+    m_isClosed = false;
+    return true;
+}
+
+void SegmentStore::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isClosed = true;
+    }
+    m_condition.notify_all();
+}
+
+void SegmentStore::setInitSegment(std::string data) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_initSegment = std::make_shared<const std::string>(std::move(data));
+    }
+    m_condition.notify_all();
+}
+
+void SegmentStore::beginSegment(bool isDiscontinuity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_segments.empty() && !m_segments.back().isComplete) {
+        std::cerr << "{SegmentStore::beginSegment}; previous segment is NOT complete" << std::endl;
+        return;
+    }
+    Segment segment;
+    segment.sequence = m_nextSequence;
+    segment.isDiscontinuity = isDiscontinuity;
+    m_segments.push_back(std::move(segment));
+    ++m_nextSequence;
+}
+
+void SegmentStore::addPart(std::string data, std::int64_t duration, bool isIndependent) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_segments.empty() || m_segments.back().isComplete) {
+            std::cerr << "{SegmentStore::addPart}; no segment was begun" << std::endl;
+            return;
+        }
+        m_storedBytes += data.size();
+        auto& segment = m_segments.back();
+        segment.parts.push_back(Part{
+            .data = std::make_shared<const std::string>(std::move(data)),
+            .duration = duration, .isIndependent = isIndependent
+        });
+        segment.duration += duration;
+    }
+    m_condition.notify_all();
+}
+
+void SegmentStore::endSegment() {
+    std::vector<Data> parts;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_segments.empty() || m_segments.back().isComplete) {
+            return;
+        }
+        for (const auto& part : m_segments.back().parts) {
+            parts.push_back(part.data);
+        }
+    }
+
+    /* the segment is assembled without holding the lock; its parts are immutable */
+    std::string segmentData;
+    std::size_t segmentSize = 0;
+    for (const auto& part : parts) {
+        segmentSize += part->size();
+    }
+    segmentData.reserve(segmentSize);
+    for (const auto& part : parts) {
+        segmentData += *part;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& segment = m_segments.back();
+        segment.data = std::make_shared<const std::string>(std::move(segmentData));
+        segment.isComplete = true;
+        m_storedBytes += segmentSize;
+
+        std::size_t nCompleteSegments = m_segments.size();
+        while (nCompleteSegments > m_settings.nSegments) {
+            const auto& expiredSegment = m_segments.front();
+            if (expiredSegment.isDiscontinuity) {
+                ++m_discontinuitySequence;
+            }
+            m_storedBytes -= expiredSegment.data->size();
+            for (const auto& part : expiredSegment.parts) {
+                m_storedBytes -= part.data->size();
+            }
+            m_segments.pop_front();
+            --nCompleteSegments;
+        }
+    }
+    m_condition.notify_all();
+}
+
+SegmentStore::Status SegmentStore::getPlaylist(
+    std::optional<std::uint64_t> sequence, std::optional<std::size_t> partIndex, std::string& playlist
+) {
+    if (partIndex.has_value() && !sequence.has_value()) {
+        return Status::BadRequest;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (sequence.has_value()) {
+        /* a client can NOT know of segments more than two ahead of the live edge */
+        if (sequence.value() > m_nextSequence + 1) {
+            return Status::BadRequest;
+        }
+        auto isPublished = [this, &sequence, &partIndex] () {
+            if (isSegmentRemoved(sequence.value())) {
+                return true;
+            }
+            if (partIndex.has_value()) {
+                return isSegmentPublished(sequence.value()) || isPartPublished(sequence.value(), partIndex.value());
+            }
+            return isSegmentPublished(sequence.value());
+        };
+        if (!m_condition.wait_until(lock, getWaitDeadline(), [this, &isPublished] () {
+            return m_isClosed || isPublished();
+        })) {
+            return Status::Unavailable;
+        }
+    }
+    if (nullptr == m_initSegment) {
+        return Status::Unavailable;
+    }
+    playlist = buildPlaylist();
+    return Status::Ok;
+}
+
+SegmentStore::Status SegmentStore::getFile(const std::string& name, Data& data) {
+    if (s_initSegmentName == name) {
+        return getInitSegment(data);
+    }
+    unsigned long long sequence = 0;
+    unsigned long long partIndex = 0;
+    char suffix[ 8 ] = { 0 };
+    if (3 == std::sscanf(name.c_str(), "part_%llu_%llu.%4s", &sequence, &partIndex, suffix)) {
+        if ("m4s" != std::string(suffix)) {
+            return Status::NotFound;
+        }
+        return getPart(sequence, static_cast<std::size_t>(partIndex), data);
+    }
+    if (2 == std::sscanf(name.c_str(), "segment_%llu.%4s", &sequence, suffix)) {
+        if ("m4s" != std::string(suffix)) {
+            return Status::NotFound;
+        }
+        return getSegment(sequence, data);
+    }
+    return Status::NotFound;
+}
+
+SegmentStore::Status SegmentStore::getInitSegment(Data& data) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (nullptr == m_initSegment) {
+        return Status::NotFound;
+    }
+    data = m_initSegment;
+    return Status::Ok;
+}
+
+SegmentStore::Status SegmentStore::getPart(std::uint64_t sequence, std::size_t partIndex, Data& data) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!isPartPublished(sequence, partIndex)) {
+        /* the part of the preload hint is answered as soon as it was cut */
+        if (!isNextPart(sequence, partIndex)) {
+            return Status::NotFound;
+        }
+        m_condition.wait_until(lock, getWaitDeadline(), [this, sequence, partIndex] () {
+            return m_isClosed || isPartPublished(sequence, partIndex) || isSegmentPublished(sequence);
+        });
+        if (!isPartPublished(sequence, partIndex)) {
+            return m_isClosed ? Status::NotFound : Status::Unavailable;
+        }
+    }
+    data = findSegment(sequence)->parts[ partIndex ].data;
+    return Status::Ok;
+}
+
+SegmentStore::Status SegmentStore::getSegment(std::uint64_t sequence, Data& data) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!isSegmentPublished(sequence)) {
+        return Status::NotFound;
+    }
+    data = findSegment(sequence)->data;
+    return Status::Ok;
+}
+
+std::size_t SegmentStore::getStoredBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_storedBytes + (m_initSegment ? m_initSegment->size() : 0);
+}
+
+const SegmentStore::Segment* SegmentStore::findSegment(std::uint64_t sequence) const {
+    if (m_segments.empty() || (sequence < m_segments.front().sequence)) {
+        return nullptr;
+    }
+    auto index = static_cast<std::size_t>(sequence - m_segments.front().sequence);
+    if (index >= m_segments.size()) {
+        return nullptr;
+    }
+    return &m_segments[ index ];
+}
+
+bool SegmentStore::isPartPublished(std::uint64_t sequence, std::size_t partIndex) const {
+    auto segment = findSegment(sequence);
+    return segment && (partIndex < segment->parts.size());
+}
+
+bool SegmentStore::isSegmentPublished(std::uint64_t sequence) const {
+    auto segment = findSegment(sequence);
+    return segment && segment->isComplete;
+}
+
+bool SegmentStore::isSegmentRemoved(std::uint64_t sequence) const {
+    return sequence < getFirstSequence();
+}
+
+std::uint64_t SegmentStore::getFirstSequence() const {
+    return m_segments.empty() ? m_nextSequence : m_segments.front().sequence;
+}
+
+bool SegmentStore::isNextPart(std::uint64_t sequence, std::size_t partIndex) const {
+    if (m_isClosed) {
+        return false;
+    }
+    if (!m_segments.empty() && !m_segments.back().isComplete) {
+        const auto& segment = m_segments.back();
+        return ((segment.sequence == sequence) && (segment.parts.size() == partIndex)) ||
+            ((m_nextSequence == sequence) && (0 == partIndex));
+    }
+    return (m_nextSequence == sequence) && (0 == partIndex);
+}
+
+std::chrono::steady_clock::time_point SegmentStore::getWaitDeadline() const {
+    return std::chrono::steady_clock::now() + std::chrono::seconds(g_blockingTargetDurations * getTargetDuration());
+}
+
+std::int64_t SegmentStore::getTargetDuration() const {
+    auto maxDuration = m_settings.segmentDuration;
+    for (const auto& segment : m_segments) {
+        if (segment.isComplete) {
+            maxDuration = std::max(maxDuration, segment.duration);
+        }
+    }
+    /* whole seconds, rounded up */
+    return (maxDuration + 999999) / 1000000;
+}
+
+std::string SegmentStore::buildPlaylist() const {
+    auto targetDuration = getTargetDuration();
+
+    /* segments from this one on are listed with their parts */
+    std::size_t firstPartListedIndex = m_segments.size();
+    std::int64_t listedDuration = 0;
+    while (
+        (firstPartListedIndex > 0) &&
+        (listedDuration < g_partListingTargetDurations * targetDuration * 1000000)
+    ) {
+        --firstPartListedIndex;
+        listedDuration += m_segments[ firstPartListedIndex ].duration;
+    }
+
+    std::string playlist = "#EXTM3U\n#EXT-X-VERSION:6\n";
+    playlist += "#EXT-X-TARGETDURATION:" + std::to_string(targetDuration) + "\n";
+    playlist += "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" +
+        formatSeconds(g_partHoldBackPartTargets * m_settings.partDuration) + "\n";
+    playlist += "#EXT-X-PART-INF:PART-TARGET=" + formatSeconds(m_settings.partDuration) + "\n";
+    playlist += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(getFirstSequence()) + "\n";
+    playlist += "#EXT-X-DISCONTINUITY-SEQUENCE:" + std::to_string(m_discontinuitySequence) + "\n";
+    playlist += "#EXT-X-MAP:URI=\"" + std::string(s_initSegmentName) + "\"\n";
+
+    for (std::size_t i = 0; i < m_segments.size(); ++i) {
+        const auto& segment = m_segments[ i ];
+        if (segment.isDiscontinuity) {
+            playlist += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (i >= firstPartListedIndex) {
+            for (std::size_t partIndex = 0; partIndex < segment.parts.size(); ++partIndex) {
+                const auto& part = segment.parts[ partIndex ];
+                playlist += "#EXT-X-PART:DURATION=" + formatSeconds(part.duration) +
+                    ",URI=\"" + getPartName(segment.sequence, partIndex) + "\"" +
+                    (part.isIndependent ? ",INDEPENDENT=YES" : "") + "\n";
+            }
+        }
+        if (segment.isComplete) {
+            playlist += "#EXTINF:" + formatSeconds(segment.duration) + ",\n" + getSegmentName(segment.sequence) + "\n";
+        }
+    }
+
+    if (m_isClosed) {
+        playlist += "#EXT-X-ENDLIST\n";
+    } else if (!m_segments.empty() && !m_segments.back().isComplete) {
+        playlist += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" +
+            getPartName(m_segments.back().sequence, m_segments.back().parts.size()) + "\"\n";
+    } else {
+        playlist += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" + getPartName(m_nextSequence, 0) + "\"\n";
+    }
+    return playlist;
+}
+
+std::string SegmentStore::getPartName(std::uint64_t sequence, std::size_t partIndex) {
+    return "part_" + std::to_string(sequence) + "_" + std::to_string(partIndex) + ".m4s";
+}
+
+std::string SegmentStore::getSegmentName(std::uint64_t sequence) {
+    return "segment_" + std::to_string(sequence) + ".m4s";
+}
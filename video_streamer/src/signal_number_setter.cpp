@@ -28,5 +28,5 @@ SignalNumberSetter::~SignalNumberSetter() {
 
 void SignalNumberSetter::setSignalNumber(int signalNumber) {
     auto& self = SignalNumberSetter::getInstance();
-    self.m_signalNumber = signalNumber;
+    self.m_signalNumber.store(signalNumber, std::memory_order_relaxed);
 }
@@ -0,0 +1,389 @@
+#include "socket_output.h"
+
+extern "C" {
+    #include <libavutil/error.h>
+}
+
+#include <linux/sockios.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <Poco/Exception.h>
+#include <Poco/URI.h>
+
+#include "common_functions.h"
+
+namespace {
+    constexpr const char* g_urlScheme = "tcp";
+    constexpr std::int64_t g_connectTimeout = 5000000; // timeout in microseconds
+    constexpr int g_pollInterval = 10; // in milliseconds
+    constexpr std::int64_t g_tcpInfoInterval = 100000; // in microseconds
+    /* the backlog holds this many muxer buffers before a write waits for the socket */
+    constexpr std::size_t g_backlogBuffers = 4;
+}
+
+SocketOutput::~SocketOutput() {
+    close();
+}
+
+bool SocketOutput::isUrlSupported(const std::string& url) {
+    try {
+        return (g_urlScheme == Poco::URI(url).getScheme());
+    } catch (...) {
+        return false;
+    }
+}
+
+bool SocketOutput::open(const std::string& url, const Settings& settings, const AVIOInterruptCB& interruptCallback) {
+    if (isOpen()) {
+        std::cerr << "{SocketOutput::open}; socket output is already open" << std::endl;
+        return false;
+    }
+    if (0 == settings.bufferSize) {
+        std::cerr << "{SocketOutput::open}; buffer size is equal to zero" << std::endl;
+        return false;
+    }
+
+    std::string hostName;
+    std::string port;
+    try {
+        Poco::URI uri(url);
+        hostName = uri.getHost();
+        port = std::to_string(uri.getPort());
+    } catch (const Poco::SyntaxException& exception) {
+        std::cerr << "{SocketOutput::open}; "
+            "exception 'Poco::SyntaxException' was successfully caught; "
+            "exception code: '" << exception.code() << "'; "
+            "exception description: '" << exception.displayText() << "'; "
+            "url: '" << url << "'" << std::endl;
+        return false;
+    } catch (...) {
+        std::cerr << "{SocketOutput::open}; "
+            "unknown exception was caught; "
+            "url: '" << url << "'" << std::endl;
+        return false;
+    }
+    if (hostName.empty() || ("0" == port)) {
+        std::cerr << "{SocketOutput::open}; host name or port is missing; url: '" << url << "'" << std::endl;
+        return false;
+    }
+
+    m_settings = settings;
+    m_interruptCallback = interruptCallback;
+    m_backlog.clear();
+    m_backlog.reserve(g_backlogBuffers * settings.bufferSize);
+    m_backlogOffset = 0;
+    m_lastTcpInfoTime = 0;
+    m_rtt.store(0, std::memory_order_relaxed);
+    m_nBacklogBytes.store(0, std::memory_order_relaxed);
+    m_nKernelUnsentBytes.store(0, std::memory_order_relaxed);
+    m_nSendCalls.store(0, std::memory_order_relaxed);
+    m_nSentBytes.store(0, std::memory_order_relaxed);
+
+    if (!connect(hostName, port)) {
+        close();
+        return false;
+    }
+    auto& reactor = OutputReactor::getInstance();
+    if (reactor.isRunning()) {
+        m_reactorTarget = reactor.registerTarget(m_socket, true);
+        if (nullptr == m_reactorTarget) {
+            close();
+            return false;
+        }
+    }
+    std::cout << "{SocketOutput::open}; socket output has been successfully connected; "
+        "url: '" << url << "'; "
+        "output reactor: '" << std::boolalpha << (nullptr != m_reactorTarget) << std::noboolalpha << "'" << std::endl;
+    return true;
+}
+
+bool SocketOutput::connect(const std::string& hostName, const std::string& port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    auto resolveResult = getaddrinfo(hostName.c_str(), port.c_str(), &hints, &addresses);
+    if ((0 != resolveResult) || (nullptr == addresses)) {
+        std::cerr << "{SocketOutput::connect}; unable to resolve host name '" << hostName << "'; "
+            "resolve result: '" << resolveResult << " (" << gai_strerror(resolveResult) << ")'" << std::endl;
+        return false;
+    }
+
+    bool isConnected = false;
+    for (auto* address = addresses; address && !isConnected; address = address->ai_next) {
+        m_socket = ::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (-1 == m_socket) {
+            continue;
+        }
+        /* the send buffer has to be set before connecting, the window scale is negotiated with it */
+        if (!applySocketOptions()) {
+            break;
+        }
+
+        if (0 == ::connect(m_socket, address->ai_addr, address->ai_addrlen)) {
+            isConnected = true;
+        } else if (EINPROGRESS != errno) {
+            std::cerr << "{SocketOutput::connect}; unable to connect to host '" << hostName << "'; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        } else {
+            auto deadline = CommonFunctions::getCurTimeSinceEpoch() + g_connectTimeout;
+            pollfd descriptor{ .fd = m_socket, .events = POLLOUT, .revents = 0 };
+            while ((CommonFunctions::getCurTimeSinceEpoch() < deadline) && (0 == poll(&descriptor, 1, g_pollInterval))) {
+            }
+            int socketError = ETIMEDOUT;
+            socklen_t socketErrorLength = sizeof(socketError);
+            if (POLLOUT & descriptor.revents) {
+                getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &socketError, &socketErrorLength);
+            }
+            isConnected = (0 == socketError);
+            if (!isConnected) {
+                std::cerr << "{SocketOutput::connect}; unable to connect to host '" << hostName << "'; "
+                    "errno: '" << socketError << " (" << std::strerror(socketError) << ")'" << std::endl;
+            }
+        }
+        if (!isConnected) {
+            ::close(m_socket);
+            m_socket = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return isConnected;
+}
+
+bool SocketOutput::applySocketOptions() {
+    int noDelay = m_settings.isNoDelay ? 1 : 0;
+    if (0 != setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay))) {
+        std::cerr << "{SocketOutput::applySocketOptions}; unable to set TCP_NODELAY; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    if (
+        (m_settings.sendBufferSize > 0) &&
+        (0 != setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &m_settings.sendBufferSize, sizeof(m_settings.sendBufferSize)))
+    ) {
+        std::cerr << "{SocketOutput::applySocketOptions}; unable to set SO_SNDBUF; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    if (
+        (m_settings.notSentLowat > 0) &&
+        (0 != setsockopt(m_socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &m_settings.notSentLowat, sizeof(m_settings.notSentLowat)))
+    ) {
+        std::cerr << "{SocketOutput::applySocketOptions}; unable to set TCP_NOTSENT_LOWAT; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    if (m_settings.maxPacingRate > 0) {
+        /* TCP paces by itself since Linux 4.13, the fq qdisc is NOT required */
+        auto pacingRate = static_cast<std::uint64_t>(m_settings.maxPacingRate);
+        if (0 != setsockopt(m_socket, SOL_SOCKET, SO_MAX_PACING_RATE, &pacingRate, sizeof(pacingRate))) {
+            std::cerr << "{SocketOutput::applySocketOptions}; unable to set SO_MAX_PACING_RATE; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SocketOutput::write(const std::uint8_t* data, std::size_t size) {
+    if (!isOpen()) {
+        std::cerr << "{SocketOutput::write}; socket output is NOT open" << std::endl;
+        return false;
+    }
+    if ((nullptr == data) && (size > 0)) {
+        std::cerr << "{SocketOutput::write}; pointer to data is NULL" << std::endl;
+        return false;
+    }
+
+    if (m_reactorTarget) {
+        auto isWritten = OutputReactor::getInstance().write(*m_reactorTarget, data, size, &m_interruptCallback);
+        updateReactorStats();
+        updateTcpInfo();
+        return isWritten;
+    }
+
+    std::size_t nSentDataBytes = 0;
+    if (!send(data, size, nSentDataBytes)) {
+        return false;
+    }
+    m_backlog.insert(m_backlog.end(), data + nSentDataBytes, data + size);
+
+    /* a full backlog means that the connection is slower than the stream */
+    while ((m_backlog.size() - m_backlogOffset) > g_backlogBuffers * m_settings.bufferSize) {
+        if (!waitWritable() || !send(nullptr, 0, nSentDataBytes)) {
+            return false;
+        }
+    }
+    m_nBacklogBytes.store(m_backlog.size() - m_backlogOffset, std::memory_order_relaxed);
+    updateTcpInfo();
+    return true;
+}
+
+bool SocketOutput::flush() {
+    if (!isOpen()) {
+        return true;
+    }
+    if (m_reactorTarget) {
+        auto isDrained = OutputReactor::getInstance().drain(*m_reactorTarget, &m_interruptCallback);
+        updateReactorStats();
+        return isDrained;
+    }
+    std::size_t nSentDataBytes = 0;
+    while (m_backlog.size() > m_backlogOffset) {
+        if (!waitWritable() || !send(nullptr, 0, nSentDataBytes)) {
+            return false;
+        }
+    }
+    m_nBacklogBytes.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void SocketOutput::close() {
+    if (m_reactorTarget) {
+        /* a write in flight to a stalled peer fails at once instead of blocking the unregistering */
+        ::shutdown(m_socket, SHUT_RDWR);
+        OutputReactor::getInstance().unregisterTarget(m_reactorTarget);
+        m_reactorTarget.reset();
+    }
+    if (-1 != m_socket) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    m_backlog.clear();
+    m_backlogOffset = 0;
+    m_nBacklogBytes.store(0, std::memory_order_relaxed);
+    m_nKernelUnsentBytes.store(0, std::memory_order_relaxed);
+}
+
+SocketOutput::Stats SocketOutput::getStats() const {
+    return Stats{
+        .rtt = m_rtt.load(std::memory_order_relaxed),
+        .nUnsentBytes = m_nBacklogBytes.load(std::memory_order_relaxed) + m_nKernelUnsentBytes.load(std::memory_order_relaxed),
+        .nSendCalls = m_nSendCalls.load(std::memory_order_relaxed),
+        .nSentBytes = m_nSentBytes.load(std::memory_order_relaxed)
+    };
+}
+
+int SocketOutput::onProxyWrite(void* outputPtr, const std::uint8_t* data, int size) {
+    if (nullptr == outputPtr) {
+        std::cerr << "{SocketOutput::onProxyWrite}; pointer to socket output is NULL" << std::endl;
+        return AVERROR(EINVAL);
+    }
+    if (size < 0) {
+        std::cerr << "{SocketOutput::onProxyWrite}; size is less than zero" << std::endl;
+        return AVERROR(EINVAL);
+    }
+    auto output = static_cast<SocketOutput*>(outputPtr);
+    if (!output->write(data, static_cast<std::size_t>(size))) {
+        return AVERROR(EIO);
+    }
+    return size;
+}
+
+bool SocketOutput::send(const std::uint8_t* data, std::size_t size, std::size_t& nSentDataBytes) {
+    nSentDataBytes = 0;
+    iovec vectors[ 2 ];
+    std::size_t nVectors = 0;
+    auto nBacklogBytes = m_backlog.size() - m_backlogOffset;
+    if (nBacklogBytes > 0) {
+        vectors[ nVectors++ ] = iovec{ .iov_base = m_backlog.data() + m_backlogOffset, .iov_len = nBacklogBytes };
+    }
+    if (size > 0) {
+        vectors[ nVectors++ ] = iovec{ .iov_base = const_cast<std::uint8_t*>(data), .iov_len = size };
+    }
+    if (0 == nVectors) {
+        return true;
+    }
+
+    msghdr message{};
+    message.msg_iov = vectors;
+    message.msg_iovlen = nVectors;
+    ssize_t sendResult = -1;
+    do {
+        sendResult = sendmsg(m_socket, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while ((sendResult < 0) && (EINTR == errno));
+    if (sendResult < 0) {
+        if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {
+            return true;
+        }
+        std::cerr << "{SocketOutput::send}; unable to send data; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    m_nSendCalls.fetch_add(1, std::memory_order_relaxed);
+    m_nSentBytes.fetch_add(static_cast<std::uint64_t>(sendResult), std::memory_order_relaxed);
+
+    auto nSentBytes = static_cast<std::size_t>(sendResult);
+    auto nSentBacklogBytes = std::min(nSentBytes, nBacklogBytes);
+    m_backlogOffset += nSentBacklogBytes;
+    nSentDataBytes = nSentBytes - nSentBacklogBytes;
+    if (m_backlogOffset == m_backlog.size()) {
+        m_backlog.clear();
+        m_backlogOffset = 0;
+    } else if (m_backlogOffset >= m_backlog.size() / 2) {
+        m_backlog.erase(m_backlog.begin(), m_backlog.begin() + static_cast<std::ptrdiff_t>(m_backlogOffset));
+        m_backlogOffset = 0;
+    }
+    return true;
+}
+
+bool SocketOutput::waitWritable() {
+    pollfd descriptor{ .fd = m_socket, .events = POLLOUT, .revents = 0 };
+    while (true) {
+        if (m_interruptCallback.callback && (0 != m_interruptCallback.callback(m_interruptCallback.opaque))) {
+            std::cerr << "{SocketOutput::waitWritable}; waiting for socket was interrupted; "
+                "number of unsent bytes: '" << (m_backlog.size() - m_backlogOffset) << "'" << std::endl;
+            return false;
+        }
+        auto pollResult = poll(&descriptor, 1, g_pollInterval);
+        if ((pollResult < 0) && (EINTR != errno)) {
+            std::cerr << "{SocketOutput::waitWritable}; unable to poll socket; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+            return false;
+        }
+        if (pollResult > 0) {
+            if ((POLLERR | POLLHUP) & descriptor.revents) {
+                std::cerr << "{SocketOutput::waitWritable}; connection was closed" << std::endl;
+                return false;
+            }
+            return true;
+        }
+    }
+}
+
+void SocketOutput::updateTcpInfo() {
+    auto curTime = CommonFunctions::getCurTimeSinceEpoch();
+    if ((curTime - m_lastTcpInfoTime) < g_tcpInfoInterval) {
+        return;
+    }
+    m_lastTcpInfoTime = curTime;
+
+    tcp_info info{};
+    socklen_t infoLength = sizeof(info);
+    if (0 == getsockopt(m_socket, IPPROTO_TCP, TCP_INFO, &info, &infoLength)) {
+        m_rtt.store(static_cast<std::int64_t>(info.tcpi_rtt), std::memory_order_relaxed);
+    }
+    int nUnsentBytes = 0;
+    if (0 == ioctl(m_socket, SIOCOUTQNSD, &nUnsentBytes)) {
+        m_nKernelUnsentBytes.store(static_cast<std::uint64_t>(std::max(nUnsentBytes, 0)), std::memory_order_relaxed);
+    }
+}
+
+void SocketOutput::updateReactorStats() {
+    auto stats = OutputReactor::getStats(*m_reactorTarget);
+    m_nBacklogBytes.store(stats.nQueuedBytes, std::memory_order_relaxed);
+    m_nSendCalls.store(stats.nSubmissions, std::memory_order_relaxed);
+    m_nSentBytes.store(stats.nWrittenBytes, std::memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#include "stream_metrics.h"
+
+namespace {
+    constexpr std::array<const char*, static_cast<std::size_t>(StreamMetrics::Metric::Count)> g_metricNames = {
+        "captured_frames",
+        "capture_scheduling_misses",
+        "encode_scheduling_misses",
+        "output_scheduling_misses",
+        "written_packets",
+        "written_bytes",
+        "output_queue_depth",
+        "recorded_packets",
+        "recorded_segments",
+        "recorder_dropped_packets",
+        "exported_clips",
+        "encoded_frames",
+        "encode_time_us",
+        "static_frames_dropped",
+        "overlay_tiles_rasterized",
+        "conversion_time_us",
+        "rendition_scale_time_us",
+        "output_dropped_packets",
+        "ll_hls_parts",
+        "ll_hls_segments",
+        "ll_hls_dropped_packets",
+        "ll_hls_requests",
+        "forced_keyframes",
+        "paced_chunks",
+        "pacing_wait_us",
+        "audio_packets",
+        "audio_dropped_frames",
+        "audio_resyncs",
+        "timestamp_filled_frames",
+        "timestamp_skipped_frames",
+        "timestamp_gap_frames",
+        "timestamp_clock_steps",
+        "encoded_delta_packets",
+        "encoded_delta_bytes"
+    };
+}
+
+void StreamMetrics::reset() {
+    for (auto& value : m_values) {
+        value.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::map<std::string, double> StreamMetrics::getSnapshot() const {
+    std::map<std::string, double> snapshot;
+    for (std::size_t i = 0; i < m_values.size(); ++i) {
+        snapshot[g_metricNames[i]] = static_cast<double>(m_values[i].load(std::memory_order_relaxed));
+    }
+    return snapshot;
+}
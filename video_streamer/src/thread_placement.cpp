@@ -0,0 +1,225 @@
+#include "thread_placement.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <frozen/string.h>
+#include <frozen/unordered_map.h>
+
+#include "trace_recorder.h"
+
+namespace {
+    constexpr frozen::unordered_map<frozen::string, int, 5> g_policies = {
+        { "other", SCHED_OTHER },
+        { "batch", SCHED_BATCH },
+        { "idle", SCHED_IDLE },
+        { "fifo", SCHED_FIFO },
+        { "rr", SCHED_RR }
+    };
+
+    pid_t getThreadId() {
+        return static_cast<pid_t>(syscall(SYS_gettid));
+    }
+
+    const char* getPolicyName(int policy) {
+        for (const auto& [name, value] : g_policies) {
+            if (value == policy) {
+                return name.data();
+            }
+        }
+        return "unknown";
+    }
+}
+
+std::optional<int> ThreadPlacement::getPolicy(const std::string& policyName) {
+    frozen::string frozenPolicyName(policyName.c_str(), policyName.size());
+    auto it = g_policies.find(frozenPolicyName);
+    if (g_policies.cend() == it) {
+        std::cerr << "{ThreadPlacement::getPolicy}; scheduling policy '" << policyName << "' is NOT supported" << std::endl;
+        return std::nullopt;
+    }
+    return std::make_optional<int>(it->second);
+}
+
+bool ThreadPlacement::isEmpty(const Settings& settings) {
+    return settings.cpus.empty() && !settings.policy.has_value() && !settings.niceLevel.has_value();
+}
+
+bool ThreadPlacement::save() {
+    Settings settings;
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    auto getResult = pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (0 != getResult) {
+        std::cerr << "{ThreadPlacement::save}; unable to get CPU affinity; "
+            "get result: '" << getResult << " (" << std::strerror(getResult) << ")'" << std::endl;
+        return false;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpuSet)) {
+            settings.cpus.push_back(cpu);
+        }
+    }
+
+    int policy = SCHED_OTHER;
+    sched_param schedulingParam{};
+    getResult = pthread_getschedparam(pthread_self(), &policy, &schedulingParam);
+    if (0 != getResult) {
+        std::cerr << "{ThreadPlacement::save}; unable to get scheduling policy; "
+            "get result: '" << getResult << " (" << std::strerror(getResult) << ")'" << std::endl;
+        return false;
+    }
+    settings.policy = std::make_optional<int>(policy);
+    settings.priority = schedulingParam.sched_priority;
+
+    errno = 0;
+    auto niceLevel = getpriority(PRIO_PROCESS, static_cast<id_t>(getThreadId()));
+    if ((-1 == niceLevel) && (0 != errno)) {
+        std::cerr << "{ThreadPlacement::save}; unable to get nice level; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    settings.niceLevel = std::make_optional<int>(niceLevel);
+
+    m_savedSettings = std::make_optional<Settings>(settings);
+    return true;
+}
+
+bool ThreadPlacement::restore() {
+    if (!m_savedSettings.has_value()) {
+        std::cerr << "{ThreadPlacement::restore}; placement was NOT saved" << std::endl;
+        return false;
+    }
+    auto settings = m_savedSettings.value();
+    m_savedSettings.reset();
+
+    bool isRestored = true;
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : settings.cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    auto setResult = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (0 != setResult) {
+        std::cerr << "{ThreadPlacement::restore}; unable to restore CPU affinity; "
+            "set result: '" << setResult << " (" << std::strerror(setResult) << ")'" << std::endl;
+        isRestored = false;
+    }
+
+    sched_param schedulingParam{};
+    schedulingParam.sched_priority = settings.priority;
+    setResult = pthread_setschedparam(pthread_self(), settings.policy.value_or(SCHED_OTHER), &schedulingParam);
+    if (0 != setResult) {
+        std::cerr << "{ThreadPlacement::restore}; unable to restore scheduling policy; "
+            "set result: '" << setResult << " (" << std::strerror(setResult) << ")'" << std::endl;
+        isRestored = false;
+    }
+
+    if (settings.niceLevel.has_value()) {
+        if (0 != setpriority(PRIO_PROCESS, static_cast<id_t>(getThreadId()), settings.niceLevel.value())) {
+            /* lowering nice level back requires CAP_SYS_NICE */
+            std::cerr << "{ThreadPlacement::restore}; unable to restore nice level; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+            isRestored = false;
+        }
+    }
+    return isRestored;
+}
+
+bool ThreadPlacement::apply(const std::string& threadName, const Settings& settings) {
+    bool isApplied = true;
+    if (!settings.cpus.empty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (auto cpu : settings.cpus) {
+            if ((cpu < 0) || (cpu >= CPU_SETSIZE)) {
+                std::cerr << "{ThreadPlacement::apply}; CPU index '" << cpu << "' is out of range; "
+                    "thread: '" << threadName << "'" << std::endl;
+                return false;
+            }
+            CPU_SET(cpu, &cpuSet);
+        }
+        auto setResult = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (0 != setResult) {
+            std::cerr << "{ThreadPlacement::apply}; unable to set CPU affinity; "
+                "set result: '" << setResult << " (" << std::strerror(setResult) << ")'; "
+                "thread: '" << threadName << "'" << std::endl;
+            isApplied = false;
+        }
+    }
+
+    if (settings.policy.has_value()) {
+        sched_param schedulingParam{};
+        schedulingParam.sched_priority = settings.priority;
+        auto setResult = pthread_setschedparam(pthread_self(), settings.policy.value(), &schedulingParam);
+        if (0 != setResult) {
+            /* real-time policies require CAP_SYS_NICE or RLIMIT_RTPRIO */
+            std::cerr << "{ThreadPlacement::apply}; unable to set scheduling policy '" << getPolicyName(settings.policy.value()) << "' "
+                "with priority '" << settings.priority << "'; "
+                "set result: '" << setResult << " (" << std::strerror(setResult) << ")'; "
+                "thread: '" << threadName << "'" << std::endl;
+            isApplied = false;
+        }
+    }
+
+    if (settings.niceLevel.has_value()) {
+        if (0 != setpriority(PRIO_PROCESS, static_cast<id_t>(getThreadId()), settings.niceLevel.value())) {
+            std::cerr << "{ThreadPlacement::apply}; unable to set nice level '" << settings.niceLevel.value() << "'; "
+                "errno: '" << errno << " (" << std::strerror(errno) << ")'; "
+                "thread: '" << threadName << "'" << std::endl;
+            isApplied = false;
+        }
+    }
+    return isApplied;
+}
+
+void ThreadPlacement::report(const std::string& threadName) {
+    TraceRecorder::setThreadName(threadName);
+
+    std::ostringstream cpuList;
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (0 == pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet)) {
+        bool isFirst = true;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &cpuSet)) {
+                continue;
+            }
+            cpuList << (isFirst ? "" : ",") << cpu;
+            isFirst = false;
+        }
+    }
+
+    int policy = SCHED_OTHER;
+    sched_param schedulingParam{};
+    pthread_getschedparam(pthread_self(), &policy, &schedulingParam);
+    errno = 0;
+    auto niceLevel = getpriority(PRIO_PROCESS, static_cast<id_t>(getThreadId()));
+
+    std::cout << "{ThreadPlacement::report}; thread: '" << threadName << "'; "
+        "thread id: '" << getThreadId() << "'; "
+        "CPUs: '" << cpuList.str() << "'; "
+        "policy: '" << getPolicyName(policy) << "'; "
+        "priority: '" << schedulingParam.sched_priority << "'; "
+        "nice level: '" << niceLevel << "'" << std::endl;
+}
+
+bool ThreadPlacement::lockMemory() {
+    if (0 != mlockall(MCL_CURRENT | MCL_FUTURE)) {
+        std::cerr << "{ThreadPlacement::lockMemory}; unable to lock process memory; "
+            "errno: '" << errno << " (" << std::strerror(errno) << ")'" << std::endl;
+        return false;
+    }
+    std::cout << "{ThreadPlacement::lockMemory}; process memory has been successfully locked" << std::endl;
+    return true;
+}
@@ -5,8 +5,6 @@
 #include "common_functions.h"
 
 namespace {
-    constexpr std::int64_t g_timeout = 50000; // timeout in microseconds
-
     enum OperationState {
         CONTINUE_EXECUTION = 0,
         READY_TO_INTERRUPT,
@@ -17,7 +15,17 @@ namespace {
     using CheckerWeakPtr = TimeoutChecker::CheckerWeakPtr;
 }
 
-bool TimeoutChecker::setup() {
+TimeoutChecker::~TimeoutChecker() {
+    TimeoutChecker::eraseCheckerWeakPtr(this);
+}
+
+bool TimeoutChecker::setup(std::int64_t timeout) {
+    if (timeout <= 0) {
+        std::cerr << "{TimeoutChecker::setup}; timeout is NOT positive; "
+            "timeout: '" << timeout << " microseconds'" << std::endl;
+        return false;
+    }
+    m_timeout = timeout;
     m_isTimeoutReached = false;
     m_beginTime = 0;
 
@@ -63,7 +71,7 @@ auto TimeoutChecker::onReadyToCheckTimeout() {
         return OperationState::CONTINUE_EXECUTION;
     }
     if (m_isTimeoutReached) {
-        std::cout << "{TimeoutChecker::onReadyToCheckTimeout}; timeout '" << g_timeout << " microseconds' is already reached" << std::endl;
+        std::cout << "{TimeoutChecker::onReadyToCheckTimeout}; timeout '" << m_timeout << " microseconds' is already reached" << std::endl;
         return OperationState::READY_TO_INTERRUPT;
     }
     auto curTime = CommonFunctions::getCurTimeSinceEpoch();
@@ -72,13 +80,13 @@ auto TimeoutChecker::onReadyToCheckTimeout() {
         return OperationState::ERROR;
     }
 
-    if (diffTime.value() >= g_timeout) {
+    if (diffTime.value() >= m_timeout) {
         m_isTimeoutReached = true;
-        std::cout << "{TimeoutChecker::onReadyToCheckTimeout}; timeout '" << g_timeout << " microseconds' reached; "
+        std::cout << "{TimeoutChecker::onReadyToCheckTimeout}; timeout '" << m_timeout << " microseconds' reached; "
             "elapsed time: '" << diffTime.value() << " microseconds'" << std::endl;
         return OperationState::READY_TO_INTERRUPT;
     } else {
-        std::cout << "{TimeoutChecker::onReadyToCheckTimeout}; timeout '" << g_timeout << " microseconds' is NOT reached; "
+        std::cout << "{TimeoutChecker::onReadyToCheckTimeout}; timeout '" << m_timeout << " microseconds' is NOT reached; "
             "elapsed time: '" << diffTime.value() << " microseconds'" << std::endl;
     }
     return OperationState::CONTINUE_EXECUTION;
@@ -91,13 +99,12 @@ int TimeoutChecker::onProxyReadyToCheckTimeout(void* checkerPtr) {
         return static_cast<int>(OperationState::ERROR);
     }
     auto checkerRawPtr = static_cast<CheckerRawPtr>(checkerPtr);
-    auto it = s_checkerWeakPtrs.find(checkerRawPtr);
-    if (s_checkerWeakPtrs.cend() == it) {
+    CheckerWeakPtr checkerWeakPtr;
+    if (!TimeoutChecker::getCheckerWeakPtr(checkerRawPtr, checkerWeakPtr)) {
         std::cerr << "{TimeoutChecker::onProxyReadyToCheckTimeout}; "
             "raw pointer to timeout checker was NOT found in map" << std::endl;
         return static_cast<int>(OperationState::ERROR);
     }
-    auto& checkerWeakPtr = it->second;
     auto checkerSharedPtr = checkerWeakPtr.lock();
     if (nullptr == checkerSharedPtr) {
         std::cerr << "{TimeoutChecker::onProxyReadyToCheckTimeout}; "
@@ -118,12 +125,19 @@ void TimeoutChecker::resetBeginTime() {
     m_beginTime = 0;
 }
 
+void TimeoutChecker::restartBeginTime() {
+    if ((0 != m_beginTime) && !m_isTimeoutReached) {
+        setBeginTime();
+    }
+}
+
 bool TimeoutChecker::getCheckerWeakPtr(
     CheckerRawPtr checkerRawPtr, CheckerWeakPtr& checkerWeakPtr
 ) {
     if (nullptr == checkerRawPtr) {
         return false;
     }
+    std::lock_guard<std::mutex> lock(s_checkerMutex);
     auto it = s_checkerWeakPtrs.find(checkerRawPtr);
     if (s_checkerWeakPtrs.cend() == it) {
         return false;
@@ -140,6 +154,7 @@ bool TimeoutChecker::setCheckerWeakPtr(
             "raw pointer to timeout checker is NULL" << std::endl;
         return false;
     }
+    std::lock_guard<std::mutex> lock(s_checkerMutex);
     auto it = s_checkerWeakPtrs.find(checkerRawPtr);
     if (s_checkerWeakPtrs.cend() != it) {
         std::cerr << "{TimeoutChecker::setCheckerWeakPtr}; "
@@ -149,3 +164,11 @@ bool TimeoutChecker::setCheckerWeakPtr(
     s_checkerWeakPtrs.insert({checkerRawPtr, checkerWeakPtr});
     return true;
 }
+
+void TimeoutChecker::eraseCheckerWeakPtr(CheckerRawPtr checkerRawPtr) {
+    if (nullptr == checkerRawPtr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_checkerMutex);
+    s_checkerWeakPtrs.erase(checkerRawPtr);
+}
@@ -0,0 +1,117 @@
+#include "timestamp_regularizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+
+namespace {
+    /* the camera clock runs ahead of the capture time by more than this only when it steps */
+    constexpr std::int64_t g_maxClockStep = 1000000; // in microseconds
+    /* in frames, on top of the half frame at which the nearest slot changes */
+    constexpr double g_slotHysteresis = 0.25;
+    /* camera clocks are off by far less; a camera that is much slower leaves gaps, and the loop
+     * must NOT lock to a fraction of its period with every other frame counted as missed */
+    constexpr double g_minPeriodRatio = 0.9;
+    constexpr double g_maxPeriodRatio = 1.1;
+    /* in periods; a late frame is told from a missed one well above the jitter */
+    constexpr double g_missedFrameThreshold = 0.75;
+    /* smoothing of the jitter estimate, as in RFC 3550 */
+    constexpr double g_jitterGain = 1.0 / 16.0;
+}
+
+bool TimestampRegularizer::setup(const Settings& settings) {
+    if (settings.frameDuration <= 0.0) {
+        std::cerr << "{TimestampRegularizer::setup}; frame duration is less than or equal to zero" << std::endl;
+        return false;
+    }
+    if (settings.loopBandwidth <= 0.0) {
+        std::cerr << "{TimestampRegularizer::setup}; loop bandwidth is less than or equal to zero" << std::endl;
+        return false;
+    }
+    /* the loop is updated once per frame, so its bandwidth is bound by the frame rate */
+    auto omega = 2.0 * std::numbers::pi * settings.loopBandwidth * settings.frameDuration / 1000000.0;
+    if (omega >= 1.0) {
+        std::cerr << "{TimestampRegularizer::setup}; loop bandwidth is too high for the frame rate" << std::endl;
+        return false;
+    }
+    m_settings = settings;
+    /* critically damped second order loop */
+    m_loopGain = std::numbers::sqrt2 * omega;
+    m_periodGain = omega * omega;
+    m_isLocked = false;
+    m_framePeriod.store(0.0, std::memory_order_relaxed);
+    m_jitter.store(0.0, std::memory_order_relaxed);
+    return true;
+}
+
+std::optional<TimestampRegularizer::Result> TimestampRegularizer::regularize(
+    std::int64_t cameraTime, std::int64_t captureTime
+) {
+    Result result;
+    auto frameDuration = m_settings.frameDuration;
+    if (!m_isLocked) {
+        m_isLocked = true;
+        m_originTime = cameraTime;
+        m_clockOffset = 0;
+        m_originSlot = static_cast<double>(cameraTime) / frameDuration;
+        m_lastCameraTime = cameraTime;
+        m_lastCaptureTime = captureTime;
+        m_predictedTime = frameDuration;
+        m_period = frameDuration;
+        m_lastSlot = std::llround(m_originSlot);
+        m_framePeriod.store(m_period, std::memory_order_relaxed);
+        result.slot = m_lastSlot;
+        return std::make_optional<Result>(result);
+    }
+
+    /* a reader that was held up sees a long capture interval but a short camera interval, which is NOT a step */
+    auto cameraDelta = cameraTime - m_lastCameraTime;
+    auto captureDelta = captureTime - m_lastCaptureTime;
+    m_lastCameraTime = cameraTime;
+    m_lastCaptureTime = captureTime;
+    if ((cameraDelta < 0) || ((cameraDelta - captureDelta) > g_maxClockStep)) {
+        m_clockOffset += cameraDelta - captureDelta;
+        result.isClockStep = true;
+    }
+    auto time = static_cast<double>(cameraTime - m_clockOffset - m_originTime);
+
+    auto error = time - m_predictedTime;
+    /* frames the camera did NOT deliver must NOT pull the loop */
+    if (error > g_missedFrameThreshold * m_period) {
+        auto nMissedFrames = std::floor(error / m_period + (1.0 - g_missedFrameThreshold));
+        m_predictedTime += nMissedFrames * m_period;
+        error -= nMissedFrames * m_period;
+    }
+    auto jitter = m_jitter.load(std::memory_order_relaxed);
+    m_jitter.store(jitter + (std::abs(error) - jitter) * g_jitterGain, std::memory_order_relaxed);
+    error = std::clamp(error, -m_period / 2.0, m_period / 2.0);
+
+    /* the prediction is the filtered time of this frame */
+    auto filteredTime = m_predictedTime;
+    m_predictedTime += m_loopGain * error + m_period;
+    m_period = std::clamp(
+        m_period + m_periodGain * error,
+        g_minPeriodRatio * frameDuration, g_maxPeriodRatio * frameDuration
+    );
+    m_framePeriod.store(m_period, std::memory_order_relaxed);
+
+    auto deviation = m_originSlot + filteredTime / frameDuration - static_cast<double>(m_lastSlot + 1);
+    std::int64_t nSlots = 1;
+    if (std::abs(deviation) > (0.5 + g_slotHysteresis)) {
+        nSlots += std::llround(deviation);
+    }
+    if (nSlots <= 0) {
+        /* the slot of this frame was already taken */
+        return std::nullopt;
+    }
+    auto nEmptySlots = static_cast<std::size_t>(nSlots - 1);
+    if (nEmptySlots <= m_settings.maxFillFrames) {
+        result.nFillFrames = nEmptySlots;
+    } else {
+        result.nGapFrames = nEmptySlots;
+    }
+    m_lastSlot += nSlots;
+    result.slot = m_lastSlot;
+    return std::make_optional<Result>(result);
+}
@@ -0,0 +1,236 @@
+#include "trace_recorder.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "common_functions.h"
+
+namespace {
+    thread_local std::string t_threadName;
+
+    std::string escapeJsonString(const std::string& value) {
+        static constexpr char s_hexDigits[] = "0123456789abcdef";
+        std::string escapedValue;
+        escapedValue.reserve(value.size());
+        for (auto character : value) {
+            auto code = static_cast<unsigned char>(character);
+            if (('"' == character) || ('\\' == character)) {
+                escapedValue += '\\';
+                escapedValue += character;
+            } else if (code < 0x20) {
+                escapedValue += "\\u00";
+                escapedValue += s_hexDigits[code >> 4];
+                escapedValue += s_hexDigits[code & 0x0F];
+            } else {
+                escapedValue += character;
+            }
+        }
+        return escapedValue;
+    }
+}
+
+bool TraceRecorder::start() {
+    if (m_isRecording.load(std::memory_order_relaxed)) {
+        std::cerr << "{TraceRecorder::start}; trace recorder is already recording" << std::endl;
+        return false;
+    }
+    m_startTime.store(CommonFunctions::getCurTimeSinceEpoch(), std::memory_order_relaxed);
+    m_isRecording.store(true, std::memory_order_relaxed);
+    std::cout << "{TraceRecorder::start}; trace recording has been started" << std::endl;
+    return true;
+}
+
+void TraceRecorder::stop() {
+    if (m_isRecording.exchange(false, std::memory_order_relaxed)) {
+        std::cout << "{TraceRecorder::stop}; trace recording has been stopped" << std::endl;
+    }
+}
+
+void TraceRecorder::setThreadName(const std::string& threadName) {
+    t_threadName = threadName;
+
+    auto& recorder = getInstance();
+    std::lock_guard<std::mutex> lock(recorder.m_mutex);
+    auto threadId = static_cast<long>(syscall(SYS_gettid));
+    for (auto& buffer : recorder.m_buffers) {
+        if (buffer->isOwned && (threadId == buffer->threadId)) {
+            buffer->threadName = threadName;
+        }
+    }
+}
+
+void TraceRecorder::record(
+    const char* name, std::uint32_t streamId, std::optional<std::int64_t> flowId,
+    std::int64_t beginTime, std::int64_t endTime
+) {
+    auto* buffer = getThreadBuffer();
+    if (nullptr == buffer) {
+        return;
+    }
+    auto nWrittenEvents = buffer->nWrittenEvents.load(std::memory_order_relaxed);
+    auto& slot = buffer->slots[ nWrittenEvents % s_eventsPerThread ];
+    slot.sequence.store(2 * nWrittenEvents + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.streamId.store(streamId, std::memory_order_relaxed);
+    slot.hasFlowId.store(flowId.has_value(), std::memory_order_relaxed);
+    slot.flowId.store(flowId.value_or(0), std::memory_order_relaxed);
+    slot.beginTime.store(beginTime, std::memory_order_relaxed);
+    slot.endTime.store(endTime, std::memory_order_relaxed);
+    slot.sequence.store(2 * nWrittenEvents + 2, std::memory_order_release);
+    buffer->nWrittenEvents.store(nWrittenEvents + 1, std::memory_order_release);
+}
+
+TraceRecorder::ThreadBufferOwner::~ThreadBufferOwner() {
+    if (buffer) {
+        TraceRecorder::getInstance().releaseThreadBuffer(buffer);
+    }
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::getThreadBuffer() {
+    thread_local ThreadBufferOwner t_owner;
+    if (t_owner.buffer) {
+        return t_owner.buffer;
+    }
+
+    ThreadBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeBuffers.empty()) {
+            buffer = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        }
+    }
+    /* the ring is NOT allocated under the lock, which a dump holds for long */
+    std::unique_ptr<ThreadBuffer> newBuffer;
+    if (nullptr == buffer) {
+        newBuffer = std::make_unique<ThreadBuffer>();
+        newBuffer->slots = std::make_unique<Slot[]>(s_eventsPerThread);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (newBuffer) {
+        m_buffers.push_back(std::move(newBuffer));
+        buffer = m_buffers.back().get();
+    }
+    buffer->threadId = static_cast<long>(syscall(SYS_gettid));
+    buffer->threadName = t_threadName;
+    buffer->isOwned = true;
+    buffer->firstEvent = buffer->nWrittenEvents.load(std::memory_order_relaxed);
+    t_owner.buffer = buffer;
+    return buffer;
+}
+
+void TraceRecorder::releaseThreadBuffer(ThreadBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer->isOwned = false;
+    m_freeBuffers.push_back(buffer);
+}
+
+std::vector<TraceRecorder::Event> TraceRecorder::copyEvents(const ThreadBuffer& buffer, std::uint64_t firstEvent) {
+    auto nWrittenEvents = buffer.nWrittenEvents.load(std::memory_order_acquire);
+    if (nWrittenEvents > s_eventsPerThread) {
+        firstEvent = std::max<std::uint64_t>(firstEvent, nWrittenEvents - s_eventsPerThread);
+    }
+    std::vector<Event> events;
+    events.reserve(nWrittenEvents - std::min(firstEvent, nWrittenEvents));
+    for (auto i = firstEvent; i < nWrittenEvents; ++i) {
+        const auto& slot = buffer.slots[ i % s_eventsPerThread ];
+        /* the owner keeps writing while the ring is copied; a slot that holds
+         * a later event or is being written is dropped */
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if ((2 * i + 2) != sequence) {
+            continue;
+        }
+        Event event{
+            .name = slot.name.load(std::memory_order_relaxed),
+            .streamId = slot.streamId.load(std::memory_order_relaxed),
+            .flowId = std::nullopt,
+            .beginTime = slot.beginTime.load(std::memory_order_relaxed),
+            .endTime = slot.endTime.load(std::memory_order_relaxed)
+        };
+        if (slot.hasFlowId.load(std::memory_order_relaxed)) {
+            event.flowId = std::make_optional<std::int64_t>(slot.flowId.load(std::memory_order_relaxed));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        events.push_back(event);
+    }
+    return events;
+}
+
+bool TraceRecorder::dump(const std::string& fileName) const {
+    if (fileName.empty()) {
+        std::cerr << "{TraceRecorder::dump}; file name is empty" << std::endl;
+        return false;
+    }
+    std::ofstream file(fileName, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "{TraceRecorder::dump}; unable to open file '" << fileName << "'" << std::endl;
+        return false;
+    }
+
+    auto processId = static_cast<long>(getpid());
+    auto startTime = m_startTime.load(std::memory_order_relaxed);
+    std::size_t nDumpedEvents = 0;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << processId << ",\"args\":{\"name\":\"video_streamer\"}}";
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& buffer : m_buffers) {
+            auto threadName = buffer->threadName.empty() ? std::to_string(buffer->threadId) : buffer->threadName;
+            file << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << processId << ",\"tid\":" << buffer->threadId <<
+                ",\"args\":{\"name\":\"" << escapeJsonString(threadName) << "\"}}";
+
+            for (const auto& event : copyEvents(*buffer, buffer->firstEvent)) {
+                if (event.endTime < startTime) {
+                    continue;
+                }
+                file << ",\n{\"ph\":\"X\",\"cat\":\"pipeline\",\"name\":\"" << event.name << "\","
+                    "\"pid\":" << processId << ",\"tid\":" << buffer->threadId << ","
+                    "\"ts\":" << event.beginTime << ",\"dur\":" << (event.endTime - event.beginTime) << ",";
+                if (event.flowId.has_value()) {
+                    /* flow events v2: every event of the frame continues the flow of its predecessor */
+                    file << "\"bind_id\":\"" << event.streamId << ":" << event.flowId.value() << "\","
+                        "\"flow_in\":true,\"flow_out\":true,"
+                        "\"args\":{\"stream\":" << event.streamId << ",\"pts\":" << event.flowId.value() << "}}";
+                } else {
+                    file << "\"args\":{\"stream\":" << event.streamId << "}}";
+                }
+                ++nDumpedEvents;
+            }
+        }
+    }
+    file << "\n]}\n";
+    file.close();
+    if (file.fail()) {
+        std::cerr << "{TraceRecorder::dump}; unable to write file '" << fileName << "'" << std::endl;
+        return false;
+    }
+    std::cout << "{TraceRecorder::dump}; trace has been successfully written; "
+        "file name: '" << fileName << "'; "
+        "number of events: '" << nDumpedEvents << "'" << std::endl;
+    return true;
+}
+
+TraceScope::TraceScope(const char* name, std::uint32_t streamId, std::optional<std::int64_t> flowId) :
+    m_name{ name }, m_streamId{ streamId }, m_flowId{ flowId }
+{
+    if (TraceRecorder::getInstance().isRecording()) {
+        m_beginTime = std::make_optional<std::int64_t>(CommonFunctions::getCurTimeSinceEpoch());
+    }
+}
+
+TraceScope::~TraceScope() {
+    if (m_beginTime.has_value()) {
+        TraceRecorder::getInstance().record(
+            m_name, m_streamId, m_flowId, m_beginTime.value(), CommonFunctions::getCurTimeSinceEpoch()
+        );
+    }
+}
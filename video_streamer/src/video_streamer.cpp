@@ -7,7 +7,9 @@ extern "C" {
     #include <libavfilter/buffersink.h>
     #include <libavfilter/buffersrc.h>
     #include <libavformat/avformat.h>
+    #include <libavutil/buffer.h>
     #include <libavutil/error.h>
+    #include <libavutil/frame.h>
     #include <libavutil/imgutils.h>
     #include <libavutil/opt.h>
 }
@@ -16,25 +18,94 @@ extern "C" {
 #include <rapidjson/document.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <frozen/string.h>
 #include <frozen/unordered_map.h>
 #include <iostream>
 #include <span>
+#include <vector>
 
+#include "capture_timestamp.h"
 #include "common_functions.h"
-#include "ptr_wrapper.h"
+#include "encode_scheduler.h"
+#include "log_dispatcher.h"
+#include "packet_writer.h"
+#include "row_band_pool.h"
 #include "signal_number_setter.h"
 #include "simple_wrapper.h"
+#include "thread_placement.h"
+#include "trace_recorder.h"
+#include "watermark_cache.h"
 
 namespace {
-    constexpr int g_frameRate = 30;
-    constexpr int g_frameWidth = 640;
-    constexpr int g_frameHeight = 480;
-    constexpr const char* g_outputStreamFormat = "flv";
+    constexpr unsigned int g_defaultFrameRate = 30;
+    constexpr unsigned int g_defaultFrameWidth = 640;
+    constexpr unsigned int g_defaultFrameHeight = 480;
+    constexpr unsigned int g_maxFrameRate = 240;
+    /* 8K UHD */
+    constexpr unsigned int g_maxFrameWidth = 7680;
+    constexpr unsigned int g_maxFrameHeight = 4320;
     constexpr AVCodecID g_encoderId = AVCodecID::AV_CODEC_ID_H264;
-    constexpr unsigned int g_watermarkWidth = 45;
-    constexpr unsigned int g_watermarkHeight = 45;
+    /* overlay blends in yuv420 and converts its second input to this format */
+    constexpr AVPixelFormat g_watermarkPixelFormat = AV_PIX_FMT_YUVA420P;
+    constexpr std::size_t g_encodeSchedulerQueueCapacity = 4;
+    constexpr std::size_t g_outputQueueCapacity = 64;
+    constexpr std::int64_t g_outputRatePeriod = 2000000; // in microseconds
+    /* container and protocol overhead on top of the maximum rate of the encoder */
+    constexpr std::int64_t g_pacingHeadroomPercent = 10;
+    constexpr std::size_t g_defaultPacingBurstKilobytes = 16;
+    constexpr std::size_t g_defaultPacingChunkSize = 1400;
+    constexpr std::int64_t g_maxInterleaveDelta = 500000; // in microseconds
+    /* longer gaps of the camera stay gaps, filling them would only repeat a stale picture */
+    constexpr std::size_t g_defaultMaxFillFrames = 2;
+    constexpr std::size_t g_maxFillFrames = 30;
+    /* locks within a few seconds and passes on little of the jitter of a USB camera */
+    constexpr double g_defaultLoopBandwidth = 0.5; // in hertz
+    constexpr const char* g_defaultAudioFormat = "alsa";
+    constexpr const char* g_defaultAudioDevice = "default";
+    constexpr unsigned int g_defaultAudioSampleRate = 48000;
+    constexpr unsigned int g_defaultAudioChannels = 2;
+    constexpr unsigned int g_maxAudioChannels = 8;
+    constexpr unsigned int g_defaultAudioKilobitRate = 128;
+    /* requests that come in faster, e.g. from a burst of dropped packets, are merged into one keyframe */
+    constexpr std::int64_t g_minForcedKeyframeInterval = 500000; // in microseconds
+    /* libx264 defaults to 40; at 100 nearly every frame counts as a scene cut */
+    constexpr unsigned int g_maxSceneCutThreshold = 100;
+    constexpr std::size_t g_recordingQueueCapacity = 256;
+    constexpr std::size_t g_llHlsQueueCapacity = 256;
+    constexpr const char* g_defaultLlHlsAddress = "0.0.0.0";
+    constexpr unsigned int g_defaultLlHlsPort = 8080;
+    constexpr unsigned int g_defaultLlHlsSegmentSeconds = 2;
+    constexpr unsigned int g_defaultLlHlsPartMilliseconds = 200;
+    constexpr unsigned int g_minLlHlsPartMilliseconds = 50;
+    constexpr std::size_t g_defaultLlHlsSegments = 6;
+    constexpr std::size_t g_defaultLlHlsMaxThreads = 32;
+    constexpr std::size_t g_defaultDvrMaxMegabytes = 64;
+    constexpr std::int64_t g_defaultDvrMaxSeconds = 60;
+    constexpr unsigned int g_defaultStaticSceneThreshold = 4;
+    constexpr unsigned int g_defaultStaticSceneMinFrameRate = 1;
+    constexpr double g_defaultRoiStrength = 0.5;
+    constexpr std::size_t g_defaultRoiMinRegionBlocks = 4;
+    constexpr std::size_t g_maxRoiRegions = 32;
+    constexpr unsigned int g_defaultOverlayImageSeconds = 10;
+    constexpr std::size_t g_defaultSocketBufferKilobytes = 256;
+    /* buffer sizes in kilobytes must fit into int after conversion to bytes */
+    constexpr unsigned int g_maxSocketKilobytes = 65536;
+    constexpr unsigned int g_maxOutputTimeoutMilliseconds = 60000;
+    constexpr unsigned int g_minDatagramSize = 188;
+    constexpr unsigned int g_maxUdpDatagramSize = 65507;
+    constexpr unsigned int g_maxSrtPayloadSize = 1456;
+    constexpr unsigned int g_maxSrtLatencyMilliseconds = 60000;
+    constexpr std::size_t g_minSrtPassphraseLength = 10;
+    constexpr std::size_t g_maxSrtPassphraseLength = 79;
+
+    constexpr frozen::unordered_map<frozen::string, OverlayCompositor::LayerType, 4> g_overlayLayerTypes = {
+        { "text", OverlayCompositor::LayerType::Text },
+        { "clock", OverlayCompositor::LayerType::Clock },
+        { "images", OverlayCompositor::LayerType::Images },
+        { "timestamp", OverlayCompositor::LayerType::Timestamp }
+    };
 
     constexpr frozen::unordered_map<frozen::string, int, 9> g_logLevels = {
         { "quiet", AV_LOG_QUIET },
@@ -47,6 +118,380 @@ namespace {
         { "debug", AV_LOG_DEBUG },
         { "trace", AV_LOG_TRACE } // default log level
     };
+
+    bool parseThreadPlacement(
+        const rapidjson::Value& section, const char* threadName,
+        ThreadPlacement::Settings& placement
+    ) {
+        if (!section.IsObject()) {
+            std::cerr << "{parseThreadPlacement}; parse error" << std::endl;
+            return false;
+        }
+
+        if (section.HasMember("cpus")) {
+            if (!section["cpus"].IsArray()) {
+                std::cerr << "{parseThreadPlacement}; parse error" << std::endl;
+                return false;
+            }
+            for (const auto* it = section["cpus"].Begin(); it != section["cpus"].End(); ++it) {
+                if (!it->IsUint()) {
+                    std::cerr << "{parseThreadPlacement}; parse error" << std::endl;
+                    return false;
+                }
+                placement.cpus.push_back(static_cast<int>(it->GetUint()));
+            }
+        }
+
+        if (section.HasMember("policy")) {
+            if (!section["policy"].IsString()) {
+                std::cerr << "{parseThreadPlacement}; parse error" << std::endl;
+                return false;
+            }
+            auto policyName = section["policy"].GetString();
+            if (nullptr == policyName) {
+                std::cerr << "{parseThreadPlacement}; pointer to scheduling policy is NULL" << std::endl;
+                return false;
+            }
+            placement.policy = ThreadPlacement::getPolicy(std::string(policyName, std::strlen(policyName)));
+            if (!placement.policy.has_value()) {
+                return false;
+            }
+        }
+
+        if (section.HasMember("priority")) {
+            if (!section["priority"].IsInt()) {
+                std::cerr << "{parseThreadPlacement}; parse error" << std::endl;
+                return false;
+            }
+            placement.priority = section["priority"].GetInt();
+        }
+
+        if (section.HasMember("nice")) {
+            if (!section["nice"].IsInt()) {
+                std::cerr << "{parseThreadPlacement}; parse error" << std::endl;
+                return false;
+            }
+            placement.niceLevel = std::make_optional<int>(section["nice"].GetInt());
+        }
+
+        std::cout << "{parseThreadPlacement}; " << threadName << " thread: "
+            "number of CPUs: '" << placement.cpus.size() << "'; "
+            "priority: '" << placement.priority << "'; "
+            "nice level: '" << (placement.niceLevel.has_value() ? std::to_string(placement.niceLevel.value()) : "default") << "'" << std::endl;
+        return true;
+    }
+
+    bool parseOverlayLayer(const rapidjson::Value& section, OverlayCompositor::LayerSettings& layer) {
+        if (!section.IsObject()) {
+            std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+            return false;
+        }
+
+        if (!section.HasMember("type")) {
+            std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+            return false;
+        }
+        if (!section["type"].IsString()) {
+            std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+            return false;
+        }
+        auto typeName = section["type"].GetString();
+        if (nullptr == typeName) {
+            std::cerr << "{parseOverlayLayer}; pointer to overlay layer type is NULL" << std::endl;
+            return false;
+        }
+        frozen::string frozenTypeName(typeName, std::strlen(typeName));
+        auto itType = g_overlayLayerTypes.find(frozenTypeName);
+        if (g_overlayLayerTypes.cend() == itType) {
+            std::cerr << "{parseOverlayLayer}; unknown overlay layer type '" << typeName << "'" << std::endl;
+            return false;
+        }
+        layer.type = itType->second;
+
+        for (const char* key : { "name", "text", "format" }) {
+            if (!section.HasMember(key)) {
+                continue;
+            }
+            if (!section[key].IsString()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            std::string value(section[key].GetString(), section[key].GetStringLength());
+            if (0 == std::strcmp(key, "name")) {
+                layer.name = value;
+            } else {
+                layer.text = value;
+            }
+        }
+        if ((OverlayCompositor::LayerType::Text == layer.type) && layer.name.empty()) {
+            std::cerr << "{parseOverlayLayer}; name of text overlay layer is empty" << std::endl;
+            return false;
+        }
+
+        if (section.HasMember("x")) {
+            if (!section["x"].IsInt()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            layer.x = section["x"].GetInt();
+        }
+        if (section.HasMember("y")) {
+            if (!section["y"].IsInt()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            layer.y = section["y"].GetInt();
+        }
+        if (section.HasMember("scale")) {
+            if (!section["scale"].IsUint()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            layer.scale = static_cast<int>(section["scale"].GetUint());
+        }
+        if (section.HasMember("maxLength")) {
+            if (!section["maxLength"].IsUint()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            layer.maxLength = section["maxLength"].GetUint();
+        }
+        if (section.HasMember("opacity")) {
+            if (!section["opacity"].IsNumber()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            layer.opacity = section["opacity"].GetDouble();
+        }
+        if (section.HasMember("backgroundOpacity")) {
+            if (!section["backgroundOpacity"].IsNumber()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            layer.backgroundOpacity = section["backgroundOpacity"].GetDouble();
+        }
+        if ((layer.opacity < 0.0) || (layer.opacity > 1.0) || (layer.backgroundOpacity < 0.0) || (layer.backgroundOpacity > 1.0)) {
+            std::cerr << "{parseOverlayLayer}; overlay layer opacity is NOT in range [0, 1]" << std::endl;
+            return false;
+        }
+
+        if (OverlayCompositor::LayerType::Images == layer.type) {
+            if (!section.HasMember("files")) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            if (!section["files"].IsArray()) {
+                std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                return false;
+            }
+            for (const auto* it = section["files"].Begin(); it != section["files"].End(); ++it) {
+                if (!it->IsString()) {
+                    std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                    return false;
+                }
+                layer.fileNames.emplace_back(it->GetString(), it->GetStringLength());
+            }
+            if (layer.fileNames.empty()) {
+                std::cerr << "{parseOverlayLayer}; image list of overlay layer is empty" << std::endl;
+                return false;
+            }
+
+            unsigned int interval = g_defaultOverlayImageSeconds;
+            if (section.HasMember("interval")) {
+                if (!section["interval"].IsUint()) {
+                    std::cerr << "{parseOverlayLayer}; parse error" << std::endl;
+                    return false;
+                }
+                interval = section["interval"].GetUint();
+            }
+            layer.imageInterval = static_cast<std::int64_t>(interval) * AV_TIME_BASE;
+        }
+        return true;
+    }
+
+    /* a rendition is sized either by 'divisor' or by 'width' and 'height' */
+    bool parseRendition(const rapidjson::Value& section, RenditionEncoder::Settings& settings, int& divisor) {
+        if (!section.IsObject()) {
+            std::cerr << "{parseRendition}; parse error" << std::endl;
+            return false;
+        }
+
+        if (!section.HasMember("url")) {
+            std::cerr << "{parseRendition}; parse error" << std::endl;
+            return false;
+        }
+        if (!section["url"].IsString()) {
+            std::cerr << "{parseRendition}; parse error" << std::endl;
+            return false;
+        }
+        settings.url = std::string(section["url"].GetString(), section["url"].GetStringLength());
+        if (settings.url.empty()) {
+            std::cerr << "{parseRendition}; rendition URL is empty" << std::endl;
+            return false;
+        }
+        auto protocol = OutputProtocol::getType(settings.url);
+        if (!protocol.has_value()) {
+            return false;
+        }
+        settings.protocol = protocol.value();
+
+        divisor = 0;
+        if (section.HasMember("divisor")) {
+            if (!section["divisor"].IsUint()) {
+                std::cerr << "{parseRendition}; parse error" << std::endl;
+                return false;
+            }
+            if (section["divisor"].GetUint() < 2) {
+                std::cerr << "{parseRendition}; rendition divisor is less than 2" << std::endl;
+                return false;
+            }
+            divisor = static_cast<int>(section["divisor"].GetUint());
+        } else {
+            if (!section.HasMember("width") || !section.HasMember("height")) {
+                std::cerr << "{parseRendition}; neither divisor nor frame size of rendition was set" << std::endl;
+                return false;
+            }
+            if (!section["width"].IsUint() || !section["height"].IsUint()) {
+                std::cerr << "{parseRendition}; parse error" << std::endl;
+                return false;
+            }
+            settings.width = static_cast<int>(section["width"].GetUint());
+            settings.height = static_cast<int>(section["height"].GetUint());
+        }
+
+        if (section.HasMember("threads")) {
+            if (!section["threads"].IsUint()) {
+                std::cerr << "{parseRendition}; parse error" << std::endl;
+                return false;
+            }
+            settings.nThreads = section["threads"].GetUint();
+        }
+        return true;
+    }
+
+    bool parseOutputProtocol(const rapidjson::Value& section, OutputProtocol::Type type, OutputProtocol::Settings& settings) {
+        if (!section.IsObject()) {
+            std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+            return false;
+        }
+
+        if (section.HasMember("timeoutMs")) {
+            if (!section["timeoutMs"].IsUint()) {
+                std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                return false;
+            }
+            auto timeout = section["timeoutMs"].GetUint();
+            if ((0 == timeout) || (timeout > g_maxOutputTimeoutMilliseconds)) {
+                std::cerr << "{parseOutputProtocol}; output timeout is NOT valid; "
+                    "timeout: '" << timeout << " milliseconds'" << std::endl;
+                return false;
+            }
+            settings.timeout = static_cast<std::int64_t>(timeout) * 1000;
+        }
+
+        if ((OutputProtocol::Type::Udp == type) || (OutputProtocol::Type::Srt == type)) {
+            if (section.HasMember("packetSize")) {
+                if (!section["packetSize"].IsUint()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                auto packetSize = section["packetSize"].GetUint();
+                auto maxPacketSize = (OutputProtocol::Type::Udp == type) ? g_maxUdpDatagramSize : g_maxSrtPayloadSize;
+                if ((packetSize < g_minDatagramSize) || (packetSize > maxPacketSize)) {
+                    std::cerr << "{parseOutputProtocol}; packet size is NOT valid; "
+                        "packet size: '" << packetSize << "'" << std::endl;
+                    return false;
+                }
+                settings.packetSize = static_cast<int>(packetSize);
+            }
+        }
+
+        if (OutputProtocol::Type::Udp == type) {
+            if (section.HasMember("ttl")) {
+                if (!section["ttl"].IsUint()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                if ((0 == section["ttl"].GetUint()) || (section["ttl"].GetUint() > 255)) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                settings.ttl = static_cast<int>(section["ttl"].GetUint());
+            }
+            if (section.HasMember("sendBufferKilobytes")) {
+                if (!section["sendBufferKilobytes"].IsUint()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                auto nKilobytes = section["sendBufferKilobytes"].GetUint();
+                if (nKilobytes > g_maxSocketKilobytes) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                settings.sendBufferSize = static_cast<int>(nKilobytes * 1024);
+            }
+            if (section.HasMember("localAddress")) {
+                if (!section["localAddress"].IsString()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                settings.localAddress = std::string(
+                    section["localAddress"].GetString(), section["localAddress"].GetStringLength()
+                );
+            }
+        }
+
+        if (OutputProtocol::Type::Srt == type) {
+            if (section.HasMember("latencyMs")) {
+                if (!section["latencyMs"].IsUint()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                auto latency = section["latencyMs"].GetUint();
+                if ((0 == latency) || (latency > g_maxSrtLatencyMilliseconds)) {
+                    std::cerr << "{parseOutputProtocol}; SRT latency is NOT valid; "
+                        "latency: '" << latency << " milliseconds'" << std::endl;
+                    return false;
+                }
+                settings.latency = static_cast<std::int64_t>(latency) * 1000;
+            }
+            if (section.HasMember("passphrase")) {
+                if (!section["passphrase"].IsString()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                settings.passphrase = std::string(
+                    section["passphrase"].GetString(), section["passphrase"].GetStringLength()
+                );
+                if (
+                    (settings.passphrase.size() < g_minSrtPassphraseLength) ||
+                    (settings.passphrase.size() > g_maxSrtPassphraseLength)
+                ) {
+                    std::cerr << "{parseOutputProtocol}; SRT passphrase length is NOT valid; "
+                        "length: '" << settings.passphrase.size() << "'" << std::endl;
+                    return false;
+                }
+            }
+            if (section.HasMember("streamId")) {
+                if (!section["streamId"].IsString()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                settings.streamId = std::string(
+                    section["streamId"].GetString(), section["streamId"].GetStringLength()
+                );
+            }
+            if (section.HasMember("maxBandwidthKbps")) {
+                if (!section["maxBandwidthKbps"].IsUint()) {
+                    std::cerr << "{parseOutputProtocol}; parse error" << std::endl;
+                    return false;
+                }
+                /* kilobits to bytes per second */
+                settings.maxBandwidth = static_cast<std::int64_t>(section["maxBandwidthKbps"].GetUint()) * 1000 / 8;
+            }
+        }
+        return true;
+    }
 }
 
 VideoStreamer::VideoStreamer() {
@@ -54,6 +499,7 @@ VideoStreamer::VideoStreamer() {
     avformat_network_init();
 
     m_timeoutChecker = std::make_shared<TimeoutChecker>();
+    m_traceStreamId = TraceRecorder::getInstance().allocateStreamId();
 }
 
 VideoStreamer::~VideoStreamer() {
@@ -63,8 +509,6 @@ VideoStreamer::~VideoStreamer() {
 }
 
 bool VideoStreamer::setup(std::string configFileName) {
-    using namespace PtrWrapperSpace;
-
     if (configFileName.empty()) {
         std::cerr << "{VideoStreamer::setup}; configuration file name is empty" << std::endl;
         return false;
@@ -111,32 +555,53 @@ bool VideoStreamer::setup(std::string configFileName) {
     }
 
     SignalNumberSetter::getInstance();
+    m_isStopRequested.store(false, std::memory_order_relaxed);
+    m_metrics.reset();
+    m_latencyHistogram.reset();
+    m_lastArrivalTime = 0;
 
     if (!parseConfig(configFileName)) {
         return false;
     }
 
-    if (!m_timeoutChecker->setup()) {
+    if (m_configParams.isMemoryLockEnabled) {
+        /* NOT fatal: the stream still works, only page faults are NOT excluded */
+        ThreadPlacement::lockMemory();
+    }
+
+    if (!m_timeoutChecker->setup(m_configParams.protocolSettings.at(m_configParams.outputProtocol).timeout)) {
         return false;
     }
 
-    auto logger = [] (
-        [[maybe_unused]] void* ptr, [[maybe_unused]] int level,
-        const char* format, va_list args
-    ) {
-        vprintf(format, args);
-    };
-    av_log_set_level(m_configParams.ffmpegLogLevel);
-    auto logLevel = av_log_get_level();
-    if (logLevel != m_configParams.ffmpegLogLevel) {
-        std::cerr << "{VideoStreamer::setup}; FFmpeg log level was NOT set" << std::endl;
+    if (!LogDispatcher::getInstance().registerLogLevel(m_configParams.ffmpegLogLevel)) {
         return false;
     }
-    av_log_set_callback(logger);
+    m_registeredLogLevel = std::make_optional<int>(m_configParams.ffmpegLogLevel);
 
+    /* video4linux devices are switched to the configured mode; the mode the driver
+     * actually chose is checked against the stream parameters below */
+    AVDictionary* inputOptions = nullptr;
+    {
+        auto videoSize = std::to_string(m_configParams.frameWidth) + "x" + std::to_string(m_configParams.frameHeight);
+        auto frameRate = std::to_string(m_configParams.frameRate);
+        for (const auto& [key, value] : { std::make_pair("video_size", videoSize), std::make_pair("framerate", frameRate) }) {
+            auto setResult = av_dict_set(&inputOptions, key, value.c_str(), 0);
+            if (setResult < 0) {
+                std::cerr << "{VideoStreamer::setup}; unable to set key-value pair; "
+                    "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
+                av_dict_free(&inputOptions);
+                return false;
+            }
+        }
+    }
     auto openResult = avformat_open_input(
-        &m_inputContext, m_configParams.inputStreamName.c_str(), nullptr, nullptr
+        &m_inputContext, m_configParams.inputStreamName.c_str(), nullptr, &inputOptions
     );
+    if (inputOptions) {
+        std::cout << "{VideoStreamer::setup}; input does NOT take frame size and frame rate options; "
+            "the current mode of the device is used" << std::endl;
+        av_dict_free(&inputOptions);
+    }
     if (openResult < 0) {
         std::cerr << "{VideoStreamer::setup}; unable to open stream '" << m_configParams.inputStreamName << "'; "
             "open result: '" << openResult << " (" << av_err2str(openResult) << ")'" << std::endl;
@@ -179,14 +644,16 @@ bool VideoStreamer::setup(std::string configFileName) {
     auto videoStreamIndex = static_cast<std::size_t>(m_videoStreamIndex);
 
     auto decoderParameters = m_inputContext->streams[videoStreamIndex]->codecpar;
-    if (g_frameWidth != decoderParameters->width) {
-        std::cerr << "{VideoStreamer::setup}; frame width was NOT set to '" << g_frameWidth << "' using "
+    if (m_configParams.frameWidth != decoderParameters->width) {
+        std::cerr << "{VideoStreamer::setup}; frame width is NOT '" << m_configParams.frameWidth << "'; "
+            "the device does NOT support the configured mode or it was NOT set using "
             "qv4l2/guvcview application for video4linux devices; "
             "current frame width: '" << decoderParameters->width << "'" << std::endl;
         return false;
     }
-    if (g_frameHeight != decoderParameters->height) {
-        std::cerr << "{VideoStreamer::setup}; frame height was NOT set to '" << g_frameHeight << "' using "
+    if (m_configParams.frameHeight != decoderParameters->height) {
+        std::cerr << "{VideoStreamer::setup}; frame height is NOT '" << m_configParams.frameHeight << "'; "
+            "the device does NOT support the configured mode or it was NOT set using "
             "qv4l2/guvcview application for video4linux devices; "
             "current frame height: '" << decoderParameters->height << "'" << std::endl;
         return false;
@@ -220,13 +687,44 @@ bool VideoStreamer::setup(std::string configFileName) {
         m_inputContext, m_inputContext->streams[videoStreamIndex], nullptr
     );
 
-    if ((g_frameRate != guessFrameRate.num) || (1 != guessFrameRate.den)) {
-        std::cerr << "{VideoStreamer::setup}; frame rate was NOT set to '" << g_frameRate << "/1' using "
+    if ((m_configParams.frameRate != guessFrameRate.num) || (1 != guessFrameRate.den)) {
+        std::cerr << "{VideoStreamer::setup}; frame rate is NOT '" << m_configParams.frameRate << "/1'; "
+            "the device does NOT support the configured mode or it was NOT set using "
             "qv4l2 or guvcview application for video4linux devices; "
             "estimated frame rate: '" << guessFrameRate.num << "/" << guessFrameRate.den << "'" << std::endl;
         return false;
     }
     m_decoderContext->framerate = guessFrameRate;
+    m_frameDuration = av_rescale_q(1, av_inv_q(m_decoderContext->framerate), AV_TIME_BASE_Q);
+    if (m_configParams.timestampSettings.has_value()) {
+        auto timestampSettings = m_configParams.timestampSettings.value();
+        timestampSettings.frameDuration = AV_TIME_BASE * av_q2d(av_inv_q(m_decoderContext->framerate));
+        if (!m_timestampRegularizer.setup(timestampSettings)) {
+            return false;
+        }
+    }
+
+    m_lastEncodedFrameTime.reset();
+    if (m_configParams.isStaticSceneDetectionEnabled || m_configParams.isRoiEnabled) {
+        if (MotionAnalyzer::isPixelFormatSupported(m_decoderContext->pix_fmt)) {
+            if (!m_motionAnalyzer.setup(
+                m_decoderContext->width, m_decoderContext->height,
+                m_decoderContext->pix_fmt, m_configParams.staticSceneThreshold
+            )) {
+                return false;
+            }
+        } else {
+            std::cout << "{VideoStreamer::setup}; motion analysis is NOT available for pixel format '" <<
+                static_cast<int>(m_decoderContext->pix_fmt) << "'" << std::endl;
+        }
+    }
+
+    /* capture time and pts of the packet are passed on to the decoded frame */
+    m_captureTimestampPool = CaptureTimestamp::createBufferPool();
+    if (nullptr == m_captureTimestampPool) {
+        return false;
+    }
+    m_decoderContext->flags |= AV_CODEC_FLAG_COPY_OPAQUE;
 
     /* Open decoder */
     auto decoderInitResult = avcodec_open2(m_decoderContext, decoder, nullptr);
@@ -237,7 +735,8 @@ bool VideoStreamer::setup(std::string configFileName) {
     }
 
     auto allocationResult = avformat_alloc_output_context2(
-        &m_outputContext, nullptr, g_outputStreamFormat, m_configParams.rtmpUrl.c_str()
+        &m_outputContext, nullptr,
+        OutputProtocol::getFormatName(m_configParams.outputProtocol), m_configParams.rtmpUrl.c_str()
     );
     if (allocationResult < 0) {
         std::cerr << "{VideoStreamer::setup}; unable to allocate output context; "
@@ -281,6 +780,39 @@ bool VideoStreamer::setup(std::string configFileName) {
             encoderPixelFormat.value() :
             m_decoderContext->pix_fmt;
 
+    /* layers are blended into the filtered frames, i.e. in the pixel format of the encoder */
+    if (!m_configParams.overlayLayers.empty()) {
+        if (!m_overlayCompositor.setup(
+            m_encoderContext->width, m_encoderContext->height, m_encoderContext->pix_fmt,
+            m_configParams.overlayLayers, &m_metrics
+        )) {
+            return false;
+        }
+    }
+
+    /* camera frames are converted before the filter graph, which then needs no scale filter */
+    m_isScalerComparisonPending = false;
+    if (m_configParams.isConversionEnabled) {
+        if (PixelConverter::isConversionSupported(m_decoderContext->pix_fmt, m_encoderContext->pix_fmt)) {
+            if (!m_pixelConverter.setup(
+                m_decoderContext->width, m_decoderContext->height,
+                m_decoderContext->pix_fmt, m_encoderContext->pix_fmt,
+                m_overlayCompositor.isSet() ? &m_overlayCompositor : nullptr
+            )) {
+                return false;
+            }
+            m_convertedFrame = av_frame_alloc();
+            if (nullptr == m_convertedFrame) {
+                std::cerr << "{VideoStreamer::setup}; unable to allocate memory for converted frame" << std::endl;
+                return false;
+            }
+            m_isScalerComparisonPending = m_configParams.isScalerComparisonEnabled;
+        } else {
+            std::cout << "{VideoStreamer::setup}; pixel conversion is NOT available for pixel format '" <<
+                static_cast<int>(m_decoderContext->pix_fmt) << "'" << std::endl;
+        }
+    }
+
     /* video time_base can be set to whatever is handy and supported by encoder */
     m_encoderContext->time_base = av_inv_q(m_decoderContext->framerate);
 
@@ -288,12 +820,80 @@ bool VideoStreamer::setup(std::string configFileName) {
         std::cerr << "{VideoStreamer::setup}; pointer to output format of output context is NULL" << std::endl;
         return false;
     }
-    if (AVFMT_GLOBALHEADER & m_outputContext->oformat->flags) {
-        m_encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    /* the MP4 muxers of the recorder, the LL-HLS packager and the clip exporter need the
+     * parameter sets as extradata, also when the output is MPEG-TS, which has no global
+     * header; the MPEG-TS muxer puts the extradata in front of every key frame itself */
+    m_encoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    /* avcodec_open2 fails when the flag is set for an encoder that can NOT reorder opaque data */
+    if (AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE & encoder->capabilities) {
+        m_encoderContext->flags |= AV_CODEC_FLAG_COPY_OPAQUE;
+    } else {
+        std::cout << "{VideoStreamer::setup}; encoder does NOT pass capture time to packets; "
+            "neither latency nor traces of the muxer are available" << std::endl;
+    }
+
+    if (m_configParams.nRowBandWorkers > 0) {
+        auto& pool = RowBandPool::getInstance();
+        if (!pool.isRunning()) {
+            auto placement = m_configParams.encodePlacement.value_or(ThreadPlacement::Settings{});
+            if (!pool.start(m_configParams.nRowBandWorkers, placement)) {
+                return false;
+            }
+        }
+    }
+
+    if (m_configParams.isEncodeSchedulerEnabled) {
+        auto& scheduler = EncodeScheduler::getInstance();
+        if (!scheduler.isRunning()) {
+            auto nWorkers = EncoderThreadBudget::getInstance().getTotalThreads();
+            auto placement = m_configParams.encodePlacement.value_or(ThreadPlacement::Settings{});
+            if (!scheduler.start(nWorkers, placement)) {
+                return false;
+            }
+        }
+        auto streamId = scheduler.registerStream(g_encodeSchedulerQueueCapacity);
+        if (!streamId.has_value()) {
+            return false;
+        }
+        m_encodeSchedulerStreamId = streamId;
+
+        m_scheduledFilteredFrame = av_frame_alloc();
+        if (nullptr == m_scheduledFilteredFrame) {
+            std::cerr << "{VideoStreamer::setup}; unable to allocate memory for scheduled filtered frame" << std::endl;
+            return false;
+        }
+
+        /* the scheduler decides who runs; neither the encoder nor the filter graph spawn threads of their own */
+        m_encoderContext->thread_count = 1;
+        std::cout << "{VideoStreamer::setup}; encoding is run by encode scheduler; "
+            "number of encoder threads: '1'" << std::endl;
+    } else {
+        m_nEncoderThreads = EncoderThreadBudget::getInstance().acquire(m_configParams.nEncoderThreads);
+        m_encoderContext->thread_count = static_cast<int>(m_nEncoderThreads);
+        std::cout << "{VideoStreamer::setup}; number of encoder threads: '" << m_nEncoderThreads << "'" << std::endl;
+    }
+
+    if (!EncoderOptions::apply(m_configParams.encoderOptions, m_encoderContext)) {
+        return false;
+    }
+    m_isKeyframeRequested = false;
+    m_lastForcedKeyframeTime.reset();
+
+    /* encoder threads are created by avcodec_open2 and inherit the placement of this thread */
+    ThreadPlacement setupThreadPlacement;
+    bool isEncodePlacementApplied =
+        m_configParams.encodePlacement.has_value() &&
+        !m_encodeSchedulerStreamId.has_value() &&
+        setupThreadPlacement.save();
+    if (isEncodePlacementApplied) {
+        ThreadPlacement::apply("encode", m_configParams.encodePlacement.value());
+        ThreadPlacement::report("encode");
     }
 
-    /* Third parameter can be used to pass settings to encoder */
     auto encoderInitResult = avcodec_open2(m_encoderContext, encoder, nullptr);
+    if (isEncodePlacementApplied) {
+        setupThreadPlacement.restore();
+    }
     if (encoderInitResult < 0) {
         std::cerr << "{VideoStreamer::setup}; unable to initialize encoder context to use the given encoder; "
             "initialize result: '" << encoderInitResult << " (" << av_err2str(encoderInitResult) << ")'" << std::endl;
@@ -307,8 +907,26 @@ bool VideoStreamer::setup(std::string configFileName) {
     }
     outputStream->time_base = m_encoderContext->time_base;
 
+    /* the audio stream has to be added before the header is written */
+    if (m_configParams.audioSettings.has_value()) {
+        m_captureClock = std::make_shared<CaptureClock>();
+        if (!m_audioCapturer.setup(m_configParams.audioSettings.value(), m_outputContext, m_captureClock, &m_metrics)) {
+            return false;
+        }
+        /* a stalled audio device must NOT hold back the video in the muxer for long */
+        m_outputContext->max_interleave_delta = g_maxInterleaveDelta;
+    }
+
     if (!(AVFMT_NOFILE & m_outputContext->oformat->flags)) {
-        {
+        int (*timeoutCallback)(void*) = &TimeoutChecker::onProxyReadyToCheckTimeout;
+        auto checkerPtr = static_cast<void*>(m_timeoutChecker.get());
+        /* copied by avio_open2; must NOT be static, every streamer has its own checker */
+        const AVIOInterruptCB interruptCallback = {
+            .callback = timeoutCallback, .opaque = checkerPtr
+        };
+
+        const auto& socketSettings = m_configParams.socketSettings;
+        if (socketSettings.has_value() && SocketOutput::isUrlSupported(m_configParams.rtmpUrl)) {
             auto hostName = CommonFunctions::extractHostNameFromRtmpUrl(m_configParams.rtmpUrl);
             if (!hostName.has_value()) {
                 return false;
@@ -316,41 +934,49 @@ bool VideoStreamer::setup(std::string configFileName) {
             if (!CommonFunctions::isHostNameValid(hostName.value())) {
                 return false;
             }
+            if (m_outputContext->pb) {
+                std::cerr << "{VideoStreamer::setup}; pointer to bytestream output context is already set" << std::endl;
+                return false;
+            }
+            if (!openSocketOutput(interruptCallback)) {
+                return false;
+            }
+        } else {
+            const auto protocol = m_configParams.outputProtocol;
+            const bool isCarriedOverTcp = (OutputProtocol::Type::Rtmp == protocol) || (OutputProtocol::Type::Tcp == protocol);
+            /* the rtmp protocol opens its tcp connection itself; only the options
+             * of FFmpeg's tcp protocol are passed down to it */
+            std::vector<std::pair<const char*, std::string>> socketOptions;
+            if (socketSettings.has_value() && !isCarriedOverTcp) {
+                std::cout << "{VideoStreamer::setup}; socket tuning is NOT applied; "
+                    "output protocol: '" << OutputProtocol::getName(protocol) << "'" << std::endl;
+            } else if (socketSettings.has_value()) {
+                if (socketSettings->isNoDelay) {
+                    socketOptions.emplace_back("tcp_nodelay", "1");
+                }
+                if (socketSettings->sendBufferSize > 0) {
+                    socketOptions.emplace_back("send_buffer_size", std::to_string(socketSettings->sendBufferSize));
+                }
+                if ((socketSettings->notSentLowat > 0) || (socketSettings->maxPacingRate > 0)) {
+                    std::cout << "{VideoStreamer::setup}; unsent low watermark and pacing rate are NOT applied; "
+                        "output URL is NOT 'tcp://'" << std::endl;
+                }
+            }
+            if (!OutputProtocol::openOutput(
+                m_outputContext, m_configParams.rtmpUrl, protocol,
+                m_configParams.protocolSettings.at(protocol), interruptCallback, socketOptions
+            )) {
+                return false;
+            }
         }
+    }
 
-        int (*timeoutCallback)(void*) = &TimeoutChecker::onProxyReadyToCheckTimeout;
-        auto checkerPtr = static_cast<void*>(m_timeoutChecker.get());
-        static const AVIOInterruptCB interruptCallback = {
-            .callback = timeoutCallback, .opaque = checkerPtr
-        };
-
-        AVDictionary* options = nullptr;
-        auto setResult = av_dict_set(&options, "protocol_whitelist", "tcp,rtmp", 0);
-        if (setResult < 0) {
-            std::cerr << "{VideoStreamer::setup}; unable to set key-value pair; "
-                "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
-            return false;
-        }
-
-        if (m_outputContext->pb) {
-            std::cerr << "{VideoStreamer::setup}; pointer to bytestream output context is already set" << std::endl;
-            return false;
-        }
-        auto initResult = avio_open2(
-            &m_outputContext->pb, m_configParams.rtmpUrl.c_str(),
-            AVIO_FLAG_WRITE, &interruptCallback, &options
-        );
-        if (initResult < 0) {
-            std::cerr << "{VideoStreamer::setup}; unable to initialize output context; "
-                "initialize result: '" << initResult << " (" << av_err2str(initResult) << ")'" << std::endl;
-            return false;
-        }
-        if (options) {
-            std::cerr << "{VideoStreamer::setup}; pointer to dictionary is NOT NULL" << std::endl;
-            return false;
-        }
-        if (nullptr == m_outputContext->pb) {
-            std::cerr << "{VideoStreamer::setup}; pointer to bytestream output context is NULL" << std::endl;
+    /* the header already goes through the pacer, so the bucket starts with what it took */
+    if (m_configParams.pacingSettings.has_value() && m_outputContext->pb) {
+        if (!m_outputPacer.setup(
+            m_configParams.pacingSettings.value(), m_outputContext, m_timeoutChecker,
+            &m_metrics, &m_pacingErrorHistogram
+        )) {
             return false;
         }
     }
@@ -363,38 +989,80 @@ bool VideoStreamer::setup(std::string configFileName) {
         return false;
     }
 
-    PtrWrapper<AVFilterInOut> outputsWrapper(
-        avfilter_inout_alloc, avfilter_inout_free
-    );
-    if (nullptr == outputsWrapper.get()) {
-        std::cerr << "{VideoStreamer::setup}; unable to allocate memory for linked-list element" << std::endl;
+    /* peaks are measured per frame interval, i.e. the burst of every single frame */
+    if (!m_outputRateMeter.setup(m_frameDuration, g_outputRatePeriod)) {
         return false;
     }
-
-    PtrWrapper<AVFilterInOut> inputsWrapper(
-        avfilter_inout_alloc, avfilter_inout_free
-    );
-    if (nullptr == inputsWrapper.get()) {
-        std::cerr << "{VideoStreamer::setup}; unable to allocate memory for linked-list element" << std::endl;
+    PacketWriter::Settings writerSettings{
+        .isThreaded = m_configParams.isOutputThreadEnabled,
+        .placement = m_configParams.outputPlacement,
+        .queueCapacity = g_outputQueueCapacity,
+        .maxLatency = m_frameDuration,
+        .latencyHistogram = m_configParams.isLatencyMeasurementEnabled ? &m_latencyHistogram : nullptr,
+        .rateMeter = &m_outputRateMeter,
+        .traceStreamId = m_traceStreamId,
+        .isDropOnTimeout = (
+            OutputProtocol::Backpressure::Drop == OutputProtocol::getBackpressure(m_configParams.outputProtocol)
+        ),
+        .onPacketDropped = [this] () {
+            requestKeyframe();
+        }
+    };
+    if (!m_packetWriter.setup(m_outputContext, m_timeoutChecker, &m_metrics, writerSettings)) {
         return false;
     }
+    if (m_configParams.isOutputThreadEnabled) {
+        std::cout << "{VideoStreamer::setup}; packets are written by dedicated output thread" << std::endl;
+    }
 
-    m_filterGraph = avfilter_graph_alloc();
-    if (nullptr == m_filterGraph) {
-        std::cerr << "{VideoStreamer::setup}; unable to allocate memory for filter graph" << std::endl;
+    if (!m_configParams.renditions.empty() && !setupRenditions(writerSettings)) {
         return false;
     }
-
-    const AVFilter* bufferSrc = avfilter_get_by_name("buffer");
-    if (nullptr == bufferSrc) {
-        std::cerr << "{VideoStreamer::setup}; pointer to buffer src filter definition is NULL" << std::endl;
+    if (m_configParams.audioSettings.has_value() && !m_audioCapturer.start(&m_packetWriter)) {
         return false;
     }
 
-    const AVFilter* bufferSink = avfilter_get_by_name("buffersink");
-    if (nullptr == bufferSink) {
-        std::cerr << "{VideoStreamer::setup}; pointer to buffer sink filter definition is NULL" << std::endl;
-        return false;
+    /* the muxer may change the time base of the stream while writing the header */
+    if (m_configParams.recordingSettings.has_value()) {
+        if (!m_segmentRecorder.setup(
+            m_configParams.recordingSettings.value(), outputStream->codecpar,
+            outputStream->time_base, &m_metrics
+        )) {
+            return false;
+        }
+    }
+
+    if (m_configParams.llHlsParams.has_value()) {
+        const auto& llHlsParams = m_configParams.llHlsParams.value();
+        auto segmentStore = std::make_shared<SegmentStore>();
+        m_segmentStore.store(segmentStore);
+        if (!segmentStore->setup(SegmentStore::Settings{
+            .segmentDuration = llHlsParams.packagerSettings.segmentDuration,
+            .partDuration = llHlsParams.packagerSettings.partDuration,
+            .nSegments = llHlsParams.nSegments
+        })) {
+            return false;
+        }
+        if (!m_llHlsPackager.setup(
+            llHlsParams.packagerSettings, outputStream->codecpar,
+            outputStream->time_base, segmentStore, &m_metrics
+        )) {
+            return false;
+        }
+        if (!m_llHlsServer.start(llHlsParams.serverSettings, segmentStore, &m_metrics)) {
+            return false;
+        }
+    }
+
+    if (m_configParams.isDvrEnabled) {
+        if (!m_packetRingBuffer.setup(
+            m_configParams.dvrMaxBytes, m_configParams.dvrMaxDuration, outputStream->time_base
+        )) {
+            return false;
+        }
+        if (!m_clipExporter.setup(outputStream->codecpar, outputStream->time_base, &m_metrics)) {
+            return false;
+        }
     }
 
     char filterArgs[ 512 ] = { 0 };
@@ -402,7 +1070,7 @@ bool VideoStreamer::setup(std::string configFileName) {
         filterArgs, sizeof(filterArgs),
         "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d:frame_rate=%d/%d",
         m_decoderContext->width, m_decoderContext->height,
-        m_decoderContext->pix_fmt,
+        m_pixelConverter.isSet() ? m_pixelConverter.getTargetFormat() : m_decoderContext->pix_fmt,
         m_decoderContext->pkt_timebase.num, m_decoderContext->pkt_timebase.den,
         m_decoderContext->sample_aspect_ratio.num, m_decoderContext->sample_aspect_ratio.den,
         m_decoderContext->framerate.num, m_decoderContext->framerate.den
@@ -411,101 +1079,27 @@ bool VideoStreamer::setup(std::string configFileName) {
         std::cerr << "{VideoStreamer::setup}; unable to construct filter argument list" << std::endl;
         return false;
     }
-
-    auto createResult = avfilter_graph_create_filter(
-        &m_bufferSrcContext, bufferSrc, "in", filterArgs, nullptr, m_filterGraph
-    );
-    if (createResult < 0) {
-        std::cerr << "{VideoStreamer::setup}; unable to create or add input filter instance into existing graph; "
-            "create result: '" << createResult << " (" << av_err2str(createResult) << ")'" << std::endl;
-        return false;
-    }
-    if (nullptr == m_bufferSrcContext) {
-        std::cerr << "{VideoStreamer::setup}; pointer to buffer src context is NULL" << std::endl;
-        return false;
-    }
-
-    createResult = avfilter_graph_create_filter(
-        &m_bufferSinkContext, bufferSink, "out", nullptr, nullptr, m_filterGraph
-    );
-    if (createResult < 0) {
-        std::cerr << "{VideoStreamer::setup}; unable to create or add output filter instance into existing graph; "
-            "create result: '" << createResult << " (" << av_err2str(createResult) << ")'" << std::endl;
-        return false;
-    }
-    if (nullptr == m_bufferSinkContext) {
-        std::cerr << "{VideoStreamer::setup}; pointer to buffer sink context is NULL" << std::endl;
-        return false;
-    }
-
-    auto& pixelFormat = m_encoderContext->pix_fmt;
-    auto castedPtrToPixelFormat = reinterpret_cast<uint8_t*>(
-        std::addressof(pixelFormat)
-    );
-    auto setResult = av_opt_set_bin(
-        static_cast<void*>(m_bufferSinkContext), "pix_fmts", castedPtrToPixelFormat,
-        static_cast<int>(
-            sizeof(m_encoderContext->pix_fmt)
-        ),
-        static_cast<int>(AV_OPT_SEARCH_CHILDREN)
-    );
-    if (setResult < 0) {
-        std::cerr << "{VideoStreamer::setup}; unable to set pixel format; "
-            "set result: '" << setResult << " (" << av_err2str(setResult) << ")'" << std::endl;
-        return false;
-    }
-
-    /* Endpoints for the filter graph. */
-    outputsWrapper->name       = av_strdup("in");
-    outputsWrapper->filter_ctx = m_bufferSrcContext;
-    outputsWrapper->pad_idx    = 0;
-    outputsWrapper->next       = nullptr;
-
-    inputsWrapper->name       = av_strdup("out");
-    inputsWrapper->filter_ctx = m_bufferSinkContext;
-    inputsWrapper->pad_idx    = 0;
-    inputsWrapper->next       = nullptr;
-
-    if (nullptr == outputsWrapper->name) {
-        std::cerr << "{VideoStreamer::setup}; pointer to outputs name is NULL" << std::endl;
-        return false;
-    }
-
-    if (nullptr == inputsWrapper->name) {
-        std::cerr << "{VideoStreamer::setup}; pointer to inputs name is NULL" << std::endl;
-        return false;
-    }
-
-    char filterDescription[ 512 ] = { 0 };
-    if (m_configParams.watermarkLocation) {
-        printResult = snprintf(
-            filterDescription, sizeof(filterDescription),
-            "movie=%s [wm];[in][wm] overlay=10:main_h-overlay_h-10 [out]",
-            m_configParams.watermarkLocation.value().c_str()
-        );
-    } else {
-        printResult = snprintf(
-            filterDescription, sizeof(filterDescription), "null"
-        );
-    }
-    if (printResult < 0) {
-        std::cerr << "{VideoStreamer::setup}; unable to construct filter description" << std::endl;
+    m_filterGraphParams.bufferSrcArgs = filterArgs;
+    m_filterGraphParams.sinkPixelFormat = m_encoderContext->pix_fmt;
+    /* a scheduled stream already runs in parallel with the others, unless told otherwise */
+    m_filterGraphParams.nThreads = m_configParams.nFilterThreads.value_or(m_encodeSchedulerStreamId.has_value() ? 1 : 0);
+    if (!getFilterParams(m_configParams.watermarkLocation, m_filterGraphParams)) {
         return false;
     }
 
-    auto parseResult = avfilter_graph_parse_ptr(
-        m_filterGraph, filterDescription, inputsWrapper.getAddress(), outputsWrapper.getAddress(), nullptr
-    );
-    if (parseResult < 0) {
-        std::cerr << "{VideoStreamer::setup}; unable to parse filter description; "
-            "parse result: '" << parseResult << " (" << av_err2str(parseResult) << ")'" << std::endl;
+    FilterGraphRebuilder::Graph graph;
+    if (!FilterGraphRebuilder::buildGraph(m_filterGraphParams, graph)) {
         return false;
     }
+    m_filterGraph = graph.filterGraph;
+    m_bufferSrcContext = graph.bufferSrcContext;
+    m_bufferSinkContext = graph.bufferSinkContext;
+    m_nGraphInputFrames = 0;
+    m_nGraphOutputFrames = 0;
+    /* overlay layers are drawn over the watermark whether they are fused or NOT */
+    m_pixelConverter.setBlendingFused(!graph.hasWatermark);
 
-    auto checkResult = avfilter_graph_config(m_filterGraph, nullptr);
-    if (checkResult < 0) {
-        std::cerr << "{VideoStreamer::setup}; filter graph is NOT valid; "
-            "check result: '" << checkResult << " (" << av_err2str(checkResult) << ")'" << std::endl;
+    if (!m_filterGraphRebuilder.setup()) {
         return false;
     }
 
@@ -582,9 +1176,21 @@ bool VideoStreamer::process() {
         return false;
     }
 
+    /* the calling thread captures, and without encode scheduler also filters and encodes */
+    if (m_configParams.capturePlacement.has_value()) {
+        ThreadPlacement::apply("capture", m_configParams.capturePlacement.value());
+    }
+    ThreadPlacement::report("capture");
+
     /* read all packets */
     while (true) {
-        auto readResult = av_read_frame(m_inputContext, packet);
+        int readResult = 0;
+        {
+            /* includes the wait for the camera */
+            TraceScope readTrace("read", m_traceStreamId);
+            readResult = av_read_frame(m_inputContext, packet);
+            readTrace.setFlowId((readResult >= 0) ? std::make_optional<std::int64_t>(packet->pts) : std::nullopt);
+        }
         if (readResult < 0) {
             std::cerr << "{VideoStreamer::process}; unable to read packet; "
                 "read result: '" << readResult << " (" << av_err2str(readResult) << ")'" << std::endl;
@@ -599,7 +1205,24 @@ bool VideoStreamer::process() {
             continue;
         }
 
-        auto sendResult = avcodec_send_packet(m_decoderContext, packet);
+        /* a frame that arrives half an interval late means that capture was NOT scheduled in time */
+        auto arrivalTime = CommonFunctions::getSteadyTime();
+        if ((m_lastArrivalTime > 0) && ((arrivalTime - m_lastArrivalTime) * 2 > m_frameDuration * 3)) {
+            m_metrics.add(StreamMetrics::Metric::CaptureSchedulingMisses);
+        }
+        m_lastArrivalTime = arrivalTime;
+        /* the packet carries the wall clock time, which the audio and the overlay layers are placed by */
+        auto captureTime = CommonFunctions::getCurTimeSinceEpoch();
+        m_metrics.add(StreamMetrics::Metric::CapturedFrames);
+        if (!CaptureTimestamp::attach(m_captureTimestampPool, packet, captureTime)) {
+            return false;
+        }
+
+        int sendResult = 0;
+        {
+            TraceScope decodeTrace("decode", m_traceStreamId, CaptureTimestamp::getPts(packet));
+            sendResult = avcodec_send_packet(m_decoderContext, packet);
+        }
         if (sendResult < 0) {
             std::cerr << "{VideoStreamer::process}; unable to send packet to decoder context; "
                 "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
@@ -615,9 +1238,7 @@ bool VideoStreamer::process() {
                     "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
                 return false;
             }
-            decoderFrame->pts = decoderFrame->best_effort_timestamp;
-
-            if (!filterEncodeWriteFrame(decoderFrame, filteredFrame)) {
+            if (!dispatchRegularizedFrame(decoderFrame, filteredFrame, false)) {
                 return false;
             }
         }
@@ -627,6 +1248,15 @@ bool VideoStreamer::process() {
             std::cout << "{VideoStreamer::process}; Ctrl+C" << std::endl;
             break;
         }
+        if (m_isStopRequested.load(std::memory_order_relaxed)) {
+            std::cout << "{VideoStreamer::process}; stop was requested" << std::endl;
+            break;
+        }
+    }
+
+    /* the rest of the pipeline is flushed on this thread */
+    if (!waitDispatchedFrames()) {
+        return false;
     }
 
     /* flush decoder */
@@ -646,9 +1276,7 @@ bool VideoStreamer::process() {
                 "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
             return false;
         }
-        decoderFrame->pts = decoderFrame->best_effort_timestamp;
-
-        if (!filterEncodeWriteFrame(decoderFrame, filteredFrame)) {
+        if (!dispatchRegularizedFrame(decoderFrame, filteredFrame, true)) {
             return false;
         }
     }
@@ -662,6 +1290,19 @@ bool VideoStreamer::process() {
     if (!flushEncoder(filteredFrame)) {
         return false;
     }
+    for (auto& renditionEncoder : m_renditionEncoders) {
+        if (!renditionEncoder->finish()) {
+            return false;
+        }
+    }
+
+    /* the audio thread writes its last packets before the output is flushed */
+    m_audioCapturer.stop();
+
+    /* the trailer is written on this thread once the output thread is idle */
+    if (!m_packetWriter.flush()) {
+        return false;
+    }
 
     auto writeTrailerResult = av_write_trailer(m_outputContext);
     if (writeTrailerResult < 0) {
@@ -735,6 +1376,64 @@ bool VideoStreamer::parseConfig(const std::string& configFileName) {
     m_configParams.inputStreamName = inputStreamName;
     std::cout << "{VideoStreamer::parseConfig}; input stream name: '" << inputStreamName << "'" << std::endl;
 
+    if (
+        settings.HasMember("inputSettings") &&
+        !settings["inputSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+    /* the watermark is checked against the frame size below */
+    m_configParams.frameWidth = static_cast<int>(g_defaultFrameWidth);
+    m_configParams.frameHeight = static_cast<int>(g_defaultFrameHeight);
+    m_configParams.frameRate = static_cast<int>(g_defaultFrameRate);
+    if (settings.HasMember("inputSettings")) {
+        const auto& inputSettings = settings["inputSettings"];
+        if (inputSettings.HasMember("width")) {
+            if (!inputSettings["width"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            auto frameWidth = inputSettings["width"].GetUint();
+            /* the encoder takes yuv420p, whose chroma planes are half the size */
+            if ((0 == frameWidth) || (frameWidth > g_maxFrameWidth) || (0 != frameWidth % 2)) {
+                std::cerr << "{VideoStreamer::parseConfig}; frame width is NOT even or NOT within range (0, " << g_maxFrameWidth << "]; "
+                    "frame width: '" << frameWidth << "'" << std::endl;
+                return false;
+            }
+            m_configParams.frameWidth = static_cast<int>(frameWidth);
+        }
+        if (inputSettings.HasMember("height")) {
+            if (!inputSettings["height"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            auto frameHeight = inputSettings["height"].GetUint();
+            if ((0 == frameHeight) || (frameHeight > g_maxFrameHeight) || (0 != frameHeight % 2)) {
+                std::cerr << "{VideoStreamer::parseConfig}; frame height is NOT even or NOT within range (0, " << g_maxFrameHeight << "]; "
+                    "frame height: '" << frameHeight << "'" << std::endl;
+                return false;
+            }
+            m_configParams.frameHeight = static_cast<int>(frameHeight);
+        }
+        if (inputSettings.HasMember("frameRate")) {
+            if (!inputSettings["frameRate"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            auto frameRate = inputSettings["frameRate"].GetUint();
+            if ((0 == frameRate) || (frameRate > g_maxFrameRate)) {
+                std::cerr << "{VideoStreamer::parseConfig}; frame rate is NOT within range (0, " << g_maxFrameRate << "]; "
+                    "frame rate: '" << frameRate << "'" << std::endl;
+                return false;
+            }
+            m_configParams.frameRate = static_cast<int>(frameRate);
+        }
+    }
+    std::cout << "{VideoStreamer::parseConfig}; input frame size: '" <<
+        m_configParams.frameWidth << "x" << m_configParams.frameHeight << "'; "
+        "input frame rate: '" << m_configParams.frameRate << "'" << std::endl;
+
     if (!settings["programSettings"].HasMember("watermark")) {
         std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
         return false;
@@ -768,32 +1467,7 @@ bool VideoStreamer::parseConfig(const std::string& configFileName) {
             return false;
         }
         std::string watermarkLocation(location, std::strlen(location));
-        if (watermarkLocation.empty()) {
-            std::cerr << "{VideoStreamer::parseConfig}; watermark location is empty" << std::endl;
-            return false;
-        }
-        if (!CommonFunctions::fileExists(watermarkLocation)) {
-            return false;
-        }
-        if (!CommonFunctions::isRegularFile(watermarkLocation)) {
-            return false;
-        }
-
-        unsigned int watermarkWidth = 0;
-        unsigned int watermarkHeight = 0;
-        if (!CommonFunctions::getPngSize(watermarkLocation, watermarkWidth, watermarkHeight)) {
-            return false;
-        }
-        if (g_watermarkWidth != watermarkWidth) {
-            std::cerr << "{VideoStreamer::parseConfig}; watermark width is NOT equal to '" << g_watermarkWidth << "'; "
-                "current watermark width: '" << watermarkWidth << "'; "
-                "watermark location: '" << watermarkLocation << "'" << std::endl;
-            return false;
-        }
-        if (g_watermarkHeight != watermarkHeight) {
-            std::cerr << "{VideoStreamer::parseConfig}; watermark height is NOT equal to '" << g_watermarkHeight << "'; "
-                "current watermark height: '" << watermarkHeight << "'; "
-                "watermark location: '" << watermarkLocation << "'" << std::endl;
+        if (!isWatermarkValid(watermarkLocation)) {
             return false;
         }
 
@@ -821,8 +1495,14 @@ bool VideoStreamer::parseConfig(const std::string& configFileName) {
         std::cerr << "{VideoStreamer::parseConfig}; rtmp url is empty" << std::endl;
         return false;
     }
+    auto outputProtocol = OutputProtocol::getType(rtmpUrl);
+    if (!outputProtocol.has_value()) {
+        return false;
+    }
     m_configParams.rtmpUrl = rtmpUrl;
-    std::cout << "{VideoStreamer::parseConfig}; rtmp url: '" << rtmpUrl << "'" << std::endl;
+    m_configParams.outputProtocol = outputProtocol.value();
+    std::cout << "{VideoStreamer::parseConfig}; rtmp url: '" << rtmpUrl << "'; "
+        "output protocol: '" << OutputProtocol::getName(outputProtocol.value()) << "'" << std::endl;
 
     if (
         settings.HasMember("ffmpegSettings") &&
@@ -864,147 +1544,1742 @@ bool VideoStreamer::parseConfig(const std::string& configFileName) {
         m_configParams.ffmpegLogLevel = AV_LOG_TRACE;
         std::cout << "{VideoStreamer::parseConfig}; default FFmpeg log level: 'trace'" << std::endl;
     }
-    return true;
-}
 
-bool VideoStreamer::encodeWriteFrame(bool readyToFlush, AVFrame* filteredFrame) {
-    if (nullptr == m_encoderPacket) {
-        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to encoder packet is NULL" << std::endl;
-        return false;
-    }
-    if (nullptr == m_encoderContext) {
-        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to encoder context is NULL" << std::endl;
-        return false;
-    }
-    if (-1 == m_videoStreamIndex) {
-        std::cerr << "{VideoStreamer::encodeWriteFrame}; video stream index is NOT set" << std::endl;
-        return false;
-    }
-    if (nullptr == m_outputContext) {
-        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to output context is NULL" << std::endl;
-        return false;
-    }
-    if (nullptr == m_timeoutChecker) {
-        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to timeout checker is NULL" << std::endl;
+    if (
+        settings.HasMember("encoderSettings") &&
+        !settings["encoderSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
         return false;
     }
 
-    AVFrame* frame = readyToFlush ? nullptr : filteredFrame;
-    av_packet_unref(m_encoderPacket);
-    if (frame && (AV_NOPTS_VALUE != frame->pts)) {
-        frame->pts = av_rescale_q(
-            frame->pts, frame->time_base,
-            m_encoderContext->time_base
+    if (
+        settings.HasMember("encoderSettings") &&
+        settings["encoderSettings"].IsObject() &&
+        settings["encoderSettings"].HasMember("threads")
+    ) {
+        if (!settings["encoderSettings"]["threads"].IsUint()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        m_configParams.nEncoderThreads = static_cast<std::size_t>(
+            settings["encoderSettings"]["threads"].GetUint()
         );
+        std::cout << "{VideoStreamer::parseConfig}; number of encoder threads: '" << m_configParams.nEncoderThreads << "'" << std::endl;
+    } else {
+        m_configParams.nEncoderThreads = 0;
+        std::cout << "{VideoStreamer::parseConfig}; default number of encoder threads: 'auto'" << std::endl;
     }
 
-    /* encode filtered frame */
-    auto sendResult = avcodec_send_frame(m_encoderContext, frame);
-    if (sendResult < 0) {
-        if (frame) {
-            std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to send filtered frame to encoder context; "
-                "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
-        } else {
-            std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to flush encoder context; "
-                "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
+    if (
+        settings.HasMember("encoderSettings") &&
+        settings["encoderSettings"].IsObject() &&
+        settings["encoderSettings"].HasMember("scheduler")
+    ) {
+        if (!settings["encoderSettings"]["scheduler"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
         }
-        return false;
+        m_configParams.isEncodeSchedulerEnabled = settings["encoderSettings"]["scheduler"].GetBool();
+    } else {
+        m_configParams.isEncodeSchedulerEnabled = false;
+    }
+    if (m_configParams.isEncodeSchedulerEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; encode scheduler is enabled" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; encode scheduler is NOT enabled" << std::endl;
     }
 
-    while (true) {
-        auto receiveResult = avcodec_receive_packet(m_encoderContext, m_encoderPacket);
-        if ((AVERROR(EAGAIN) == receiveResult) || (AVERROR_EOF == receiveResult)) {
-            break;
-        } else if (receiveResult < 0) {
-            std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to receive encoder packet from encoder context; "
-                "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
+    m_configParams.encoderOptions = EncoderOptions::Settings{};
+    if (settings.HasMember("encoderSettings")) {
+        const auto& encoderSettings = settings["encoderSettings"];
+        if (encoderSettings.HasMember("gopMs")) {
+            if (!encoderSettings["gopMs"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.encoderOptions.gopDuration = static_cast<std::int64_t>(encoderSettings["gopMs"].GetUint()) * 1000;
         }
-
-        /* prepare packet for muxing */
-        m_encoderPacket->stream_index = m_videoStreamIndex;
-        av_packet_rescale_ts(
-            m_encoderPacket, m_encoderContext->time_base,
-            m_outputContext->streams[
-                static_cast<std::size_t>(m_videoStreamIndex)
-            ]->time_base
-        );
-
-        /* mux encoded frame */
-        m_timeoutChecker->setBeginTime();
-        auto writeResult = av_interleaved_write_frame(m_outputContext, m_encoderPacket);
-        m_timeoutChecker->resetBeginTime();
-        if (writeResult < 0) {
-            if (AVERROR_EOF == writeResult) {
-                std::cout << "{VideoStreamer::encodeWriteFrame}; unable to write encoder packet to output context; "
-                    "write result: 'AVERROR_EOF (" << av_err2str(writeResult) << ")'" << std::endl;
-            } else {
-                if (m_timeoutChecker->isTimeoutReached()) {
-                    std::cerr << "{VideoStreamer::encodeWriteFrame}; "
-                        "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
-                } else {
-                    std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to write encoder packet to output context; "
-                        "write result: '" << writeResult << " (" << av_err2str(writeResult) << ")'" << std::endl;
-                }
+        if (encoderSettings.HasMember("sceneCutThreshold")) {
+            if (!encoderSettings["sceneCutThreshold"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
             }
-            return false;
+            if (encoderSettings["sceneCutThreshold"].GetUint() > g_maxSceneCutThreshold) {
+                std::cerr << "{VideoStreamer::parseConfig}; scene cut threshold is greater than " << g_maxSceneCutThreshold << std::endl;
+                return false;
+            }
+            m_configParams.encoderOptions.sceneCutThreshold = std::make_optional<int>(
+                static_cast<int>(encoderSettings["sceneCutThreshold"].GetUint())
+            );
+        }
+        if (encoderSettings.HasMember("intraRefresh")) {
+            if (!encoderSettings["intraRefresh"].IsBool()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.encoderOptions.isIntraRefreshEnabled = encoderSettings["intraRefresh"].GetBool();
+        }
+        if (encoderSettings.HasMember("bitrateKbps")) {
+            if (!encoderSettings["bitrateKbps"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.encoderOptions.bitRate = static_cast<std::int64_t>(encoderSettings["bitrateKbps"].GetUint()) * 1000;
+            /* a live output drains at a constant rate, so by default the VBV caps at the target rate */
+            m_configParams.encoderOptions.maxRate = m_configParams.encoderOptions.bitRate;
+        }
+        if (encoderSettings.HasMember("maxRateKbps")) {
+            if (!encoderSettings["maxRateKbps"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.encoderOptions.maxRate = static_cast<std::int64_t>(encoderSettings["maxRateKbps"].GetUint()) * 1000;
+        }
+        if (encoderSettings.HasMember("vbvBufferMs")) {
+            if (!encoderSettings["vbvBufferMs"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.encoderOptions.vbvBufferDuration = static_cast<std::int64_t>(encoderSettings["vbvBufferMs"].GetUint()) * 1000;
         }
     }
-    return true;
-}
-
-bool VideoStreamer::filterEncodeWriteFrame(AVFrame* decoderFrame, AVFrame* filteredFrame) {
-    if (nullptr == m_bufferSrcContext) {
-        std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; pointer to buffer src context is NULL" << std::endl;
-        return false;
+    if (m_configParams.encoderOptions.gopDuration > 0) {
+        std::cout << "{VideoStreamer::parseConfig}; GOP duration: '" <<
+            (m_configParams.encoderOptions.gopDuration / 1000) << " milliseconds'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; default GOP duration of encoder" << std::endl;
     }
-    if (nullptr == m_bufferSinkContext) {
-        std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; pointer to buffer sink context is NULL" << std::endl;
-        return false;
+    if (m_configParams.encoderOptions.isIntraRefreshEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; intra refresh is enabled" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; intra refresh is NOT enabled" << std::endl;
+    }
+    if (m_configParams.encoderOptions.maxRate > 0) {
+        std::cout << "{VideoStreamer::parseConfig}; VBV is enabled; "
+            "bit rate: '" << (m_configParams.encoderOptions.bitRate / 1000) << " kbps'; "
+            "maximum rate: '" << (m_configParams.encoderOptions.maxRate / 1000) << " kbps'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; VBV is NOT enabled" << std::endl;
     }
 
-    /* push the decoded frame into the filtergraph */
-    auto addResult = av_buffersrc_add_frame_flags(m_bufferSrcContext, decoderFrame, 0);
-    if (addResult < 0) {
-        std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; unable to add flags; "
-            "add result: '" << addResult << " (" << av_err2str(addResult) << ")'" << std::endl;
+    if (
+        settings.HasMember("filterSettings") &&
+        !settings["filterSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
         return false;
     }
 
-    /* pull filtered frames from the filtergraph */
-    bool readyToFlush = false;
-    while (true) {
-        auto getResult = av_buffersink_get_frame(m_bufferSinkContext, filteredFrame);
-        if (getResult < 0) {
-            /* if no more frames for output - returns AVERROR(EAGAIN)
-             * if flushed and no more frames for output - returns AVERROR_EOF
-             * rewrite retcode to 0 to show it as normal procedure completion
-             */
-            if ((AVERROR(EAGAIN) == getResult) || (AVERROR_EOF == getResult)) {
-                break;
+    m_configParams.nFilterThreads.reset();
+    m_configParams.nRowBandWorkers = 0;
+    if (settings.HasMember("filterSettings")) {
+        const auto& filterSettings = settings["filterSettings"];
+        if (filterSettings.HasMember("threads")) {
+            if (!filterSettings["threads"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
             }
-            std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; unable to get filtered frame from buffer sink context; "
-                "get result: '" << getResult << " (" << av_err2str(getResult) << ")'" << std::endl;
-            return false;
+            m_configParams.nFilterThreads = std::make_optional<int>(static_cast<int>(filterSettings["threads"].GetUint()));
+            std::cout << "{VideoStreamer::parseConfig}; number of filter slice threads: '" << m_configParams.nFilterThreads.value() << "'" << std::endl;
         }
-
-        filteredFrame->time_base = av_buffersink_get_time_base(m_bufferSinkContext);
-        filteredFrame->pict_type = AVPictureType::AV_PICTURE_TYPE_NONE;
-        bool wasWritten = encodeWriteFrame(readyToFlush, filteredFrame);
-        av_frame_unref(filteredFrame);
-        if (!wasWritten) {
-            return false;
+        if (filterSettings.HasMember("rowBandWorkers")) {
+            if (!filterSettings["rowBandWorkers"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.nRowBandWorkers = filterSettings["rowBandWorkers"].GetUint();
+            std::cout << "{VideoStreamer::parseConfig}; number of row band workers: '" << m_configParams.nRowBandWorkers << "'" << std::endl;
         }
     }
-    return true;
-}
 
-bool VideoStreamer::flushEncoder(AVFrame* filteredFrame) {
-    if (nullptr == m_encoderContext) {
-        std::cerr << "{VideoStreamer::flushEncoder}; pointer to encoder context is NULL" << std::endl;
+    if (
+        settings.HasMember("threadSettings") &&
+        !settings["threadSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
         return false;
     }
-    if (nullptr == m_encoderContext->codec) {
-        std::cerr << "{VideoStreamer::flushEncoder}; pointer to encoder is NULL" << std::endl;
+
+    m_configParams.isMemoryLockEnabled = false;
+    m_configParams.isOutputThreadEnabled = false;
+    m_configParams.capturePlacement.reset();
+    m_configParams.encodePlacement.reset();
+    m_configParams.outputPlacement.reset();
+    if (settings.HasMember("threadSettings")) {
+        const auto& threadSettings = settings["threadSettings"];
+        if (threadSettings.HasMember("lockMemory")) {
+            if (!threadSettings["lockMemory"].IsBool()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.isMemoryLockEnabled = threadSettings["lockMemory"].GetBool();
+        }
+
+        if (threadSettings.HasMember("capture")) {
+            ThreadPlacement::Settings placement;
+            if (!parseThreadPlacement(threadSettings["capture"], "capture", placement)) {
+                return false;
+            }
+            m_configParams.capturePlacement = std::make_optional<ThreadPlacement::Settings>(placement);
+        }
+
+        if (threadSettings.HasMember("encode")) {
+            ThreadPlacement::Settings placement;
+            if (!parseThreadPlacement(threadSettings["encode"], "encode", placement)) {
+                return false;
+            }
+            m_configParams.encodePlacement = std::make_optional<ThreadPlacement::Settings>(placement);
+        }
+
+        if (threadSettings.HasMember("output")) {
+            ThreadPlacement::Settings placement;
+            if (!parseThreadPlacement(threadSettings["output"], "output", placement)) {
+                return false;
+            }
+            m_configParams.outputPlacement = std::make_optional<ThreadPlacement::Settings>(placement);
+
+            if (threadSettings["output"].HasMember("dedicatedThread")) {
+                if (!threadSettings["output"]["dedicatedThread"].IsBool()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                m_configParams.isOutputThreadEnabled = threadSettings["output"]["dedicatedThread"].GetBool();
+            }
+        }
+    }
+    if (m_configParams.isMemoryLockEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; memory lock is enabled" << std::endl;
+    }
+    if (m_configParams.isOutputThreadEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; dedicated output thread is enabled" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; dedicated output thread is NOT enabled" << std::endl;
+        if (m_configParams.outputPlacement.has_value()) {
+            /* without its own thread, output runs on the encode (or capture) thread */
+            std::cout << "{VideoStreamer::parseConfig}; output thread placement is ignored" << std::endl;
+        }
+    }
+
+    if (
+        settings.HasMember("recordingSettings") &&
+        !settings["recordingSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.recordingSettings.reset();
+    bool isRecordingEnabled = false;
+    if (settings.HasMember("recordingSettings")) {
+        const auto& recordingSettings = settings["recordingSettings"];
+        if (!recordingSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!recordingSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        isRecordingEnabled = recordingSettings["enabled"].GetBool();
+    }
+    if (isRecordingEnabled) {
+        const auto& recordingSettings = settings["recordingSettings"];
+        SegmentRecorder::Settings recorderSettings;
+        recorderSettings.queueCapacity = g_recordingQueueCapacity;
+
+        if (!recordingSettings.HasMember("directory")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!recordingSettings["directory"].IsString()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        auto directory = recordingSettings["directory"].GetString();
+        if (nullptr == directory) {
+            std::cerr << "{VideoStreamer::parseConfig}; pointer to recording directory is NULL" << std::endl;
+            return false;
+        }
+        recorderSettings.directory = std::string(directory, std::strlen(directory));
+        if (!CommonFunctions::isDirectory(recorderSettings.directory)) {
+            return false;
+        }
+
+        if (recordingSettings.HasMember("format")) {
+            if (!recordingSettings["format"].IsString()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            auto formatName = recordingSettings["format"].GetString();
+            if (nullptr == formatName) {
+                std::cerr << "{VideoStreamer::parseConfig}; pointer to recording format is NULL" << std::endl;
+                return false;
+            }
+            auto format = SegmentRecorder::getFormat(std::string(formatName, std::strlen(formatName)));
+            if (!format.has_value()) {
+                return false;
+            }
+            recorderSettings.format = format.value();
+        }
+
+        std::int64_t segmentDuration = 6;
+        if (recordingSettings.HasMember("segmentDuration")) {
+            if (!recordingSettings["segmentDuration"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            segmentDuration = static_cast<std::int64_t>(recordingSettings["segmentDuration"].GetUint());
+        }
+        if (0 == segmentDuration) {
+            std::cerr << "{VideoStreamer::parseConfig}; segment duration is equal to zero" << std::endl;
+            return false;
+        }
+        recorderSettings.segmentDuration = segmentDuration * AV_TIME_BASE;
+
+        if (recordingSettings.HasMember("retention")) {
+            if (!recordingSettings["retention"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            recorderSettings.nRetainedSegments = static_cast<std::size_t>(recordingSettings["retention"].GetUint());
+        }
+
+        if (recordingSettings.HasMember("syncMode")) {
+            if (!recordingSettings["syncMode"].IsString()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            auto syncModeName = recordingSettings["syncMode"].GetString();
+            if (nullptr == syncModeName) {
+                std::cerr << "{VideoStreamer::parseConfig}; pointer to sync mode is NULL" << std::endl;
+                return false;
+            }
+            auto syncMode = SegmentFile::getSyncMode(std::string(syncModeName, std::strlen(syncModeName)));
+            if (!syncMode.has_value()) {
+                return false;
+            }
+            recorderSettings.syncMode = syncMode.value();
+        }
+
+        m_configParams.recordingSettings = std::make_optional<SegmentRecorder::Settings>(recorderSettings);
+        std::cout << "{VideoStreamer::parseConfig}; recording is enabled; "
+            "directory: '" << recorderSettings.directory << "'; "
+            "segment duration: '" << segmentDuration << " s'; "
+            "number of retained segments: '" << recorderSettings.nRetainedSegments << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; recording is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("dvrSettings") &&
+        !settings["dvrSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.isDvrEnabled = false;
+    m_configParams.dvrMaxBytes = g_defaultDvrMaxMegabytes * 1024 * 1024;
+    m_configParams.dvrMaxDuration = g_defaultDvrMaxSeconds * AV_TIME_BASE;
+    if (settings.HasMember("dvrSettings")) {
+        const auto& dvrSettings = settings["dvrSettings"];
+        if (!dvrSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!dvrSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        m_configParams.isDvrEnabled = dvrSettings["enabled"].GetBool();
+
+        if (dvrSettings.HasMember("maxMemory")) {
+            if (!dvrSettings["maxMemory"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            if (0 == dvrSettings["maxMemory"].GetUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; DVR memory limit is equal to zero" << std::endl;
+                return false;
+            }
+            m_configParams.dvrMaxBytes = static_cast<std::size_t>(dvrSettings["maxMemory"].GetUint()) * 1024 * 1024;
+        }
+
+        if (dvrSettings.HasMember("maxDuration")) {
+            if (!dvrSettings["maxDuration"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.dvrMaxDuration = static_cast<std::int64_t>(dvrSettings["maxDuration"].GetUint()) * AV_TIME_BASE;
+        }
+    }
+    if (m_configParams.isDvrEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; DVR is enabled; "
+            "memory limit: '" << m_configParams.dvrMaxBytes / (1024 * 1024) << " MiB'; "
+            "duration limit: '" << m_configParams.dvrMaxDuration / AV_TIME_BASE << " s'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; DVR is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("llHlsSettings") &&
+        !settings["llHlsSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.llHlsParams.reset();
+    if (settings.HasMember("llHlsSettings")) {
+        const auto& llHlsSettings = settings["llHlsSettings"];
+        if (!llHlsSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!llHlsSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (llHlsSettings["enabled"].GetBool()) {
+            ConfigParams::LlHlsParams llHlsParams;
+            llHlsParams.serverSettings.address = g_defaultLlHlsAddress;
+            llHlsParams.serverSettings.port = static_cast<std::uint16_t>(g_defaultLlHlsPort);
+            llHlsParams.serverSettings.maxThreads = g_defaultLlHlsMaxThreads;
+            llHlsParams.nSegments = g_defaultLlHlsSegments;
+            llHlsParams.packagerSettings.queueCapacity = g_llHlsQueueCapacity;
+            unsigned int segmentDuration = g_defaultLlHlsSegmentSeconds;
+            unsigned int partDuration = g_defaultLlHlsPartMilliseconds;
+
+            if (llHlsSettings.HasMember("address")) {
+                if (!llHlsSettings["address"].IsString()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                llHlsParams.serverSettings.address = std::string(
+                    llHlsSettings["address"].GetString(), llHlsSettings["address"].GetStringLength()
+                );
+            }
+            if (llHlsSettings.HasMember("port")) {
+                if (!llHlsSettings["port"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                if ((0 == llHlsSettings["port"].GetUint()) || (llHlsSettings["port"].GetUint() > 65535)) {
+                    std::cerr << "{VideoStreamer::parseConfig}; LL-HLS port is NOT valid" << std::endl;
+                    return false;
+                }
+                llHlsParams.serverSettings.port = static_cast<std::uint16_t>(llHlsSettings["port"].GetUint());
+            }
+            if (llHlsSettings.HasMember("maxThreads")) {
+                if (!llHlsSettings["maxThreads"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                llHlsParams.serverSettings.maxThreads = llHlsSettings["maxThreads"].GetUint();
+            }
+            if (llHlsSettings.HasMember("segmentDuration")) {
+                if (!llHlsSettings["segmentDuration"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                segmentDuration = llHlsSettings["segmentDuration"].GetUint();
+                if (0 == segmentDuration) {
+                    std::cerr << "{VideoStreamer::parseConfig}; LL-HLS segment duration is equal to zero" << std::endl;
+                    return false;
+                }
+            }
+            if (llHlsSettings.HasMember("partDurationMs")) {
+                if (!llHlsSettings["partDurationMs"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                partDuration = llHlsSettings["partDurationMs"].GetUint();
+            }
+            if ((partDuration < g_minLlHlsPartMilliseconds) || (partDuration > segmentDuration * 1000)) {
+                std::cerr << "{VideoStreamer::parseConfig}; LL-HLS part duration is NOT valid; "
+                    "part duration: '" << partDuration << " ms'" << std::endl;
+                return false;
+            }
+            if (llHlsSettings.HasMember("windowSegments")) {
+                if (!llHlsSettings["windowSegments"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                llHlsParams.nSegments = llHlsSettings["windowSegments"].GetUint();
+                if (0 == llHlsParams.nSegments) {
+                    std::cerr << "{VideoStreamer::parseConfig}; number of LL-HLS segments is equal to zero" << std::endl;
+                    return false;
+                }
+            }
+            llHlsParams.packagerSettings.segmentDuration = static_cast<std::int64_t>(segmentDuration) * AV_TIME_BASE;
+            llHlsParams.packagerSettings.partDuration = static_cast<std::int64_t>(partDuration) * 1000;
+            m_configParams.llHlsParams = std::make_optional<ConfigParams::LlHlsParams>(llHlsParams);
+        }
+    }
+    if (m_configParams.llHlsParams.has_value()) {
+        const auto& llHlsParams = m_configParams.llHlsParams.value();
+        std::cout << "{VideoStreamer::parseConfig}; LL-HLS is enabled; "
+            "address: '" << llHlsParams.serverSettings.address << ":" << llHlsParams.serverSettings.port << "'; "
+            "segment duration: '" << llHlsParams.packagerSettings.segmentDuration / AV_TIME_BASE << " s'; "
+            "part duration: '" << llHlsParams.packagerSettings.partDuration / 1000 << " ms'; "
+            "number of segments: '" << llHlsParams.nSegments << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; LL-HLS is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("staticSceneSettings") &&
+        !settings["staticSceneSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.isStaticSceneDetectionEnabled = false;
+    m_configParams.staticSceneThreshold = g_defaultStaticSceneThreshold;
+    unsigned int minFrameRate = g_defaultStaticSceneMinFrameRate;
+    if (settings.HasMember("staticSceneSettings")) {
+        const auto& staticSceneSettings = settings["staticSceneSettings"];
+        if (!staticSceneSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!staticSceneSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        m_configParams.isStaticSceneDetectionEnabled = staticSceneSettings["enabled"].GetBool();
+
+        if (staticSceneSettings.HasMember("threshold")) {
+            if (!staticSceneSettings["threshold"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.staticSceneThreshold = staticSceneSettings["threshold"].GetUint();
+        }
+
+        if (staticSceneSettings.HasMember("minFrameRate")) {
+            if (!staticSceneSettings["minFrameRate"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            minFrameRate = staticSceneSettings["minFrameRate"].GetUint();
+            if (0 == minFrameRate) {
+                std::cerr << "{VideoStreamer::parseConfig}; minimum frame rate of static scene is equal to zero" << std::endl;
+                return false;
+            }
+        }
+    }
+    m_configParams.staticSceneMaxInterval = AV_TIME_BASE / minFrameRate;
+    if (m_configParams.isStaticSceneDetectionEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; static scene detection is enabled; "
+            "threshold: '" << m_configParams.staticSceneThreshold << "'; "
+            "minimum frame rate: '" << minFrameRate << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; static scene detection is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("roiSettings") &&
+        !settings["roiSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.isRoiEnabled = false;
+    double roiStrength = g_defaultRoiStrength;
+    m_configParams.roiMinRegionBlocks = g_defaultRoiMinRegionBlocks;
+    if (settings.HasMember("roiSettings")) {
+        const auto& roiSettings = settings["roiSettings"];
+        if (!roiSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!roiSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        m_configParams.isRoiEnabled = roiSettings["enabled"].GetBool();
+
+        if (roiSettings.HasMember("strength")) {
+            if (!roiSettings["strength"].IsNumber()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            roiStrength = roiSettings["strength"].GetDouble();
+            if ((roiStrength < 0.0) || (roiStrength > 1.0)) {
+                std::cerr << "{VideoStreamer::parseConfig}; ROI strength is NOT in range [0, 1]" << std::endl;
+                return false;
+            }
+        }
+
+        if (roiSettings.HasMember("minRegionSize")) {
+            if (!roiSettings["minRegionSize"].IsUint()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.roiMinRegionBlocks = roiSettings["minRegionSize"].GetUint();
+        }
+    }
+    m_configParams.roiQualityOffset = static_cast<int>(std::lround(roiStrength * 100.0));
+    if (m_configParams.isRoiEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; ROI encoding is enabled; "
+            "strength: '" << roiStrength << "'; "
+            "minimum region size: '" << m_configParams.roiMinRegionBlocks << " blocks'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; ROI encoding is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("overlaySettings") &&
+        !settings["overlaySettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.overlayLayers.clear();
+    if (settings.HasMember("overlaySettings")) {
+        const auto& overlaySettings = settings["overlaySettings"];
+        if (!overlaySettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!overlaySettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (overlaySettings["enabled"].GetBool()) {
+            if (!overlaySettings.HasMember("layers")) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            if (!overlaySettings["layers"].IsArray()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            for (const auto* it = overlaySettings["layers"].Begin(); it != overlaySettings["layers"].End(); ++it) {
+                OverlayCompositor::LayerSettings layer;
+                if (!parseOverlayLayer(*it, layer)) {
+                    return false;
+                }
+                for (const auto& fileName : layer.fileNames) {
+                    if (!isWatermarkValid(fileName)) {
+                        return false;
+                    }
+                }
+                m_configParams.overlayLayers.push_back(layer);
+            }
+        }
+    }
+    if (!m_configParams.overlayLayers.empty()) {
+        std::cout << "{VideoStreamer::parseConfig}; overlay layers are enabled; "
+            "number of layers: '" << m_configParams.overlayLayers.size() << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; overlay layers are NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("conversionSettings") &&
+        !settings["conversionSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.isConversionEnabled = false;
+    m_configParams.isScalerComparisonEnabled = false;
+    if (settings.HasMember("conversionSettings")) {
+        const auto& conversionSettings = settings["conversionSettings"];
+        if (!conversionSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!conversionSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        m_configParams.isConversionEnabled = conversionSettings["enabled"].GetBool();
+
+        if (conversionSettings.HasMember("compareWithScaler")) {
+            if (!conversionSettings["compareWithScaler"].IsBool()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            m_configParams.isScalerComparisonEnabled = conversionSettings["compareWithScaler"].GetBool();
+        }
+    }
+    if (m_configParams.isConversionEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; pixel conversion is enabled" << std::endl;
+        if (m_configParams.isScalerComparisonEnabled) {
+            std::cout << "{VideoStreamer::parseConfig}; first frame is compared with swscale" << std::endl;
+        }
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; pixel conversion is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("renditionSettings") &&
+        !settings["renditionSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.renditions.clear();
+    if (settings.HasMember("renditionSettings")) {
+        const auto& renditionSettings = settings["renditionSettings"];
+        if (!renditionSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!renditionSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (renditionSettings["enabled"].GetBool()) {
+            if (!renditionSettings.HasMember("renditions")) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            if (!renditionSettings["renditions"].IsArray()) {
+                std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                return false;
+            }
+            for (const auto* it = renditionSettings["renditions"].Begin(); it != renditionSettings["renditions"].End(); ++it) {
+                ConfigParams::RenditionParams rendition;
+                if (!parseRendition(*it, rendition.settings, rendition.divisor)) {
+                    return false;
+                }
+                m_configParams.renditions.push_back(rendition);
+            }
+        }
+    }
+    if (!m_configParams.renditions.empty()) {
+        std::cout << "{VideoStreamer::parseConfig}; renditions are enabled; "
+            "number of renditions: '" << m_configParams.renditions.size() << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; renditions are NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("latencySettings") &&
+        !settings["latencySettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.isLatencyMeasurementEnabled = false;
+    if (settings.HasMember("latencySettings")) {
+        const auto& latencySettings = settings["latencySettings"];
+        if (!latencySettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!latencySettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        m_configParams.isLatencyMeasurementEnabled = latencySettings["enabled"].GetBool();
+    }
+    if (m_configParams.isLatencyMeasurementEnabled) {
+        std::cout << "{VideoStreamer::parseConfig}; latency measurement is enabled" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; latency measurement is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("socketSettings") &&
+        !settings["socketSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.socketSettings.reset();
+    if (settings.HasMember("socketSettings")) {
+        const auto& socketSettings = settings["socketSettings"];
+        if (!socketSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!socketSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (socketSettings["enabled"].GetBool()) {
+            SocketOutput::Settings socketOutputSettings{ .bufferSize = g_defaultSocketBufferKilobytes * 1024 };
+            if (socketSettings.HasMember("bufferKilobytes")) {
+                if (!socketSettings["bufferKilobytes"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                auto nKilobytes = socketSettings["bufferKilobytes"].GetUint();
+                if ((nKilobytes < 4) || (nKilobytes > g_maxSocketKilobytes)) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                socketOutputSettings.bufferSize = static_cast<std::size_t>(nKilobytes) * 1024;
+            }
+            if (socketSettings.HasMember("noDelay")) {
+                if (!socketSettings["noDelay"].IsBool()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                socketOutputSettings.isNoDelay = socketSettings["noDelay"].GetBool();
+            }
+            if (socketSettings.HasMember("sendBufferKilobytes")) {
+                if (!socketSettings["sendBufferKilobytes"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                auto nKilobytes = socketSettings["sendBufferKilobytes"].GetUint();
+                if (nKilobytes > g_maxSocketKilobytes) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                socketOutputSettings.sendBufferSize = static_cast<int>(nKilobytes * 1024);
+            }
+            if (socketSettings.HasMember("notSentLowatKilobytes")) {
+                if (!socketSettings["notSentLowatKilobytes"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                auto nKilobytes = socketSettings["notSentLowatKilobytes"].GetUint();
+                if (nKilobytes > g_maxSocketKilobytes) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                socketOutputSettings.notSentLowat = static_cast<int>(nKilobytes * 1024);
+            }
+            if (socketSettings.HasMember("maxPacingKbps")) {
+                if (!socketSettings["maxPacingKbps"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                /* kilobits to bytes per second */
+                socketOutputSettings.maxPacingRate = static_cast<std::uint64_t>(
+                    socketSettings["maxPacingKbps"].GetUint()
+                ) * 1000 / 8;
+            }
+            m_configParams.socketSettings = std::make_optional<SocketOutput::Settings>(socketOutputSettings);
+        }
+    }
+    if (m_configParams.socketSettings.has_value()) {
+        const auto& socketSettings = m_configParams.socketSettings.value();
+        std::cout << "{VideoStreamer::parseConfig}; socket tuning is enabled; "
+            "buffer size: '" << socketSettings.bufferSize << "'; "
+            "TCP_NODELAY: '" << std::boolalpha << socketSettings.isNoDelay << std::noboolalpha << "'; "
+            "send buffer size: '" << socketSettings.sendBufferSize << "'; "
+            "unsent low watermark: '" << socketSettings.notSentLowat << "'; "
+            "max pacing rate: '" << socketSettings.maxPacingRate << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; socket tuning is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("outputSettings") &&
+        !settings["outputSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.protocolSettings.clear();
+    constexpr OutputProtocol::Type protocolTypes[] = {
+        OutputProtocol::Type::Rtmp, OutputProtocol::Type::Tcp, OutputProtocol::Type::Udp, OutputProtocol::Type::Srt
+    };
+    for (auto type : protocolTypes) {
+        auto protocolSettings = OutputProtocol::getDefaultSettings(type);
+        auto protocolName = OutputProtocol::getName(type);
+        if (settings.HasMember("outputSettings") && settings["outputSettings"].HasMember(protocolName)) {
+            if (!parseOutputProtocol(settings["outputSettings"][protocolName], type, protocolSettings)) {
+                return false;
+            }
+        }
+        m_configParams.protocolSettings[ type ] = protocolSettings;
+    }
+    {
+        const auto& protocolSettings = m_configParams.protocolSettings.at(m_configParams.outputProtocol);
+        std::cout << "{VideoStreamer::parseConfig}; "
+            "output protocol: '" << OutputProtocol::getName(m_configParams.outputProtocol) << "'; "
+            "container format: '" << OutputProtocol::getFormatName(m_configParams.outputProtocol) << "'; "
+            "timeout: '" << protocolSettings.timeout << " microseconds'; "
+            "packet size: '" << protocolSettings.packetSize << "'; "
+            "latency: '" << protocolSettings.latency << " microseconds'" << std::endl;
+    }
+
+    if (
+        settings.HasMember("timestampSettings") &&
+        !settings["timestampSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.timestampSettings.reset();
+    if (settings.HasMember("timestampSettings")) {
+        const auto& timestampSettings = settings["timestampSettings"];
+        if (!timestampSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!timestampSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (timestampSettings["enabled"].GetBool()) {
+            TimestampRegularizer::Settings regularizerSettings{
+                .frameDuration = 0.0,
+                .maxFillFrames = g_defaultMaxFillFrames,
+                .loopBandwidth = g_defaultLoopBandwidth
+            };
+            if (timestampSettings.HasMember("maxFillFrames")) {
+                if (!timestampSettings["maxFillFrames"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                regularizerSettings.maxFillFrames = timestampSettings["maxFillFrames"].GetUint();
+                if (regularizerSettings.maxFillFrames > g_maxFillFrames) {
+                    std::cerr << "{VideoStreamer::parseConfig}; maximum number of filled frames is greater than " << g_maxFillFrames << std::endl;
+                    return false;
+                }
+            }
+            if (timestampSettings.HasMember("loopBandwidthHz")) {
+                if (!timestampSettings["loopBandwidthHz"].IsNumber()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                regularizerSettings.loopBandwidth = timestampSettings["loopBandwidthHz"].GetDouble();
+                if (regularizerSettings.loopBandwidth <= 0.0) {
+                    std::cerr << "{VideoStreamer::parseConfig}; loop bandwidth is less than or equal to zero" << std::endl;
+                    return false;
+                }
+            }
+            m_configParams.timestampSettings = std::make_optional<TimestampRegularizer::Settings>(regularizerSettings);
+        }
+    }
+    if (m_configParams.timestampSettings.has_value()) {
+        std::cout << "{VideoStreamer::parseConfig}; timestamp regularization is enabled; "
+            "maximum number of filled frames: '" << m_configParams.timestampSettings->maxFillFrames << "'; "
+            "loop bandwidth: '" << m_configParams.timestampSettings->loopBandwidth << " Hz'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; timestamp regularization is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("audioSettings") &&
+        !settings["audioSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.audioSettings.reset();
+    if (settings.HasMember("audioSettings")) {
+        const auto& audioSettings = settings["audioSettings"];
+        if (!audioSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!audioSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (audioSettings["enabled"].GetBool()) {
+            AudioCapturer::Settings audioCapturerSettings{
+                .format = g_defaultAudioFormat,
+                .device = g_defaultAudioDevice,
+                .sampleRate = static_cast<int>(g_defaultAudioSampleRate),
+                .nChannels = static_cast<int>(g_defaultAudioChannels),
+                .bitRate = static_cast<std::int64_t>(g_defaultAudioKilobitRate) * 1000
+            };
+            if (audioSettings.HasMember("format")) {
+                if (!audioSettings["format"].IsString()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                audioCapturerSettings.format = audioSettings["format"].GetString();
+                if (("alsa" != audioCapturerSettings.format) && ("pulse" != audioCapturerSettings.format)) {
+                    std::cerr << "{VideoStreamer::parseConfig}; audio format '" << audioCapturerSettings.format << "' is NOT supported" << std::endl;
+                    return false;
+                }
+            }
+            if (audioSettings.HasMember("device")) {
+                if (!audioSettings["device"].IsString()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                audioCapturerSettings.device = audioSettings["device"].GetString();
+            }
+            if (audioSettings.HasMember("sampleRate")) {
+                if (!audioSettings["sampleRate"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                /* the usual capture rates, all of them can be signalled by AAC in FLV and MPEG-TS */
+                auto sampleRate = audioSettings["sampleRate"].GetUint();
+                if ((44100 != sampleRate) && (48000 != sampleRate) && (22050 != sampleRate) && (11025 != sampleRate)) {
+                    std::cerr << "{VideoStreamer::parseConfig}; audio sample rate '" << sampleRate << "' is NOT supported" << std::endl;
+                    return false;
+                }
+                audioCapturerSettings.sampleRate = static_cast<int>(sampleRate);
+            }
+            if (audioSettings.HasMember("channels")) {
+                if (!audioSettings["channels"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                auto nChannels = audioSettings["channels"].GetUint();
+                if ((0 == nChannels) || (nChannels > g_maxAudioChannels)) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                audioCapturerSettings.nChannels = static_cast<int>(nChannels);
+            }
+            if (audioSettings.HasMember("bitrateKbps")) {
+                if (!audioSettings["bitrateKbps"].IsUint() || (0 == audioSettings["bitrateKbps"].GetUint())) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                audioCapturerSettings.bitRate = static_cast<std::int64_t>(audioSettings["bitrateKbps"].GetUint()) * 1000;
+            }
+            m_configParams.audioSettings = std::make_optional<AudioCapturer::Settings>(audioCapturerSettings);
+        }
+    }
+    if (m_configParams.audioSettings.has_value()) {
+        const auto& audioSettings = m_configParams.audioSettings.value();
+        std::cout << "{VideoStreamer::parseConfig}; audio is enabled; "
+            "input: '" << audioSettings.format << ":" << audioSettings.device << "'; "
+            "sample rate: '" << audioSettings.sampleRate << "'; "
+            "channels: '" << audioSettings.nChannels << "'; "
+            "bit rate: '" << (audioSettings.bitRate / 1000) << " kbps'" << std::endl;
+        /* packets of the audio thread and of the encoder meet in the queue of the output thread */
+        if (!m_configParams.isOutputThreadEnabled) {
+            m_configParams.isOutputThreadEnabled = true;
+            std::cout << "{VideoStreamer::parseConfig}; dedicated output thread is enabled for audio" << std::endl;
+        }
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; audio is NOT enabled" << std::endl;
+    }
+
+    if (
+        settings.HasMember("pacingSettings") &&
+        !settings["pacingSettings"].IsObject()
+    ) {
+        std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+        return false;
+    }
+
+    m_configParams.pacingSettings.reset();
+    if (settings.HasMember("pacingSettings")) {
+        const auto& pacingSettings = settings["pacingSettings"];
+        if (!pacingSettings.HasMember("enabled")) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (!pacingSettings["enabled"].IsBool()) {
+            std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+            return false;
+        }
+        if (pacingSettings["enabled"].GetBool()) {
+            OutputPacer::Settings pacerSettings{
+                .rate = m_configParams.encoderOptions.maxRate * (100 + g_pacingHeadroomPercent) / 100,
+                .burstSize = g_defaultPacingBurstKilobytes * 1024,
+                /* a datagram of the MPEG-TS outputs or a TCP segment */
+                .chunkSize = (OutputProtocol::Backpressure::Drop == OutputProtocol::getBackpressure(m_configParams.outputProtocol)) ?
+                    static_cast<std::size_t>(m_configParams.protocolSettings.at(m_configParams.outputProtocol).packetSize) :
+                    g_defaultPacingChunkSize
+            };
+            if (pacingSettings.HasMember("rateKbps")) {
+                if (!pacingSettings["rateKbps"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                if (pacingSettings["rateKbps"].GetUint() > 0) {
+                    pacerSettings.rate = static_cast<std::int64_t>(pacingSettings["rateKbps"].GetUint()) * 1000;
+                }
+            }
+            if (pacingSettings.HasMember("burstKilobytes")) {
+                if (!pacingSettings["burstKilobytes"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                pacerSettings.burstSize = static_cast<std::size_t>(pacingSettings["burstKilobytes"].GetUint()) * 1024;
+            }
+            if (pacingSettings.HasMember("chunkBytes")) {
+                if (!pacingSettings["chunkBytes"].IsUint()) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                auto nChunkBytes = pacingSettings["chunkBytes"].GetUint();
+                if ((nChunkBytes < g_minDatagramSize) || (nChunkBytes > g_maxSocketKilobytes * 1024)) {
+                    std::cerr << "{VideoStreamer::parseConfig}; parse error" << std::endl;
+                    return false;
+                }
+                pacerSettings.chunkSize = nChunkBytes;
+            }
+            if (pacerSettings.rate <= 0) {
+                std::cerr << "{VideoStreamer::parseConfig}; pacing rate is NOT set; "
+                    "neither 'pacingSettings.rateKbps' nor 'encoderSettings.maxRateKbps' is given" << std::endl;
+                return false;
+            }
+            if (pacerSettings.burstSize < pacerSettings.chunkSize) {
+                std::cerr << "{VideoStreamer::parseConfig}; pacing burst is smaller than one chunk" << std::endl;
+                return false;
+            }
+            m_configParams.pacingSettings = std::make_optional<OutputPacer::Settings>(pacerSettings);
+        }
+    }
+    if (m_configParams.pacingSettings.has_value()) {
+        const auto& pacingSettings = m_configParams.pacingSettings.value();
+        std::cout << "{VideoStreamer::parseConfig}; output pacing is enabled; "
+            "rate: '" << (pacingSettings.rate / 1000) << " kbps'; "
+            "burst size: '" << pacingSettings.burstSize << "'; "
+            "chunk size: '" << pacingSettings.chunkSize << "'" << std::endl;
+        /* waits of the pacer must NOT hold up the encode (or capture) thread */
+        if (!m_configParams.isOutputThreadEnabled) {
+            m_configParams.isOutputThreadEnabled = true;
+            std::cout << "{VideoStreamer::parseConfig}; dedicated output thread is enabled for pacing" << std::endl;
+        }
+    } else {
+        std::cout << "{VideoStreamer::parseConfig}; output pacing is NOT enabled" << std::endl;
+    }
+    return true;
+}
+
+bool VideoStreamer::encodeWriteFrame(bool readyToFlush, AVFrame* filteredFrame) {
+    if (nullptr == m_encoderPacket) {
+        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to encoder packet is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == m_encoderContext) {
+        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to encoder context is NULL" << std::endl;
+        return false;
+    }
+    if (-1 == m_videoStreamIndex) {
+        std::cerr << "{VideoStreamer::encodeWriteFrame}; video stream index is NOT set" << std::endl;
+        return false;
+    }
+    if (nullptr == m_outputContext) {
+        std::cerr << "{VideoStreamer::encodeWriteFrame}; pointer to output context is NULL" << std::endl;
+        return false;
+    }
+
+    AVFrame* frame = readyToFlush ? nullptr : filteredFrame;
+    av_packet_unref(m_encoderPacket);
+    if (frame && (AV_NOPTS_VALUE != frame->pts)) {
+        frame->pts = av_rescale_q(
+            frame->pts, frame->time_base,
+            m_encoderContext->time_base
+        );
+    }
+
+    /* the first frame ties the capture clock of the audio to the pts of the video */
+    if (m_captureClock && frame && (AV_NOPTS_VALUE != frame->pts) && !m_captureClock->isSet()) {
+        m_captureClock->setOrigin(
+            CaptureTimestamp::get(frame).value_or(CommonFunctions::getCurTimeSinceEpoch()),
+            av_rescale_q(frame->pts, m_encoderContext->time_base, AV_TIME_BASE_Q)
+        );
+    }
+
+    /* encode filtered frame */
+    int sendResult = 0;
+    {
+        TraceScope encodeTrace("encode", m_traceStreamId, CaptureTimestamp::getPts(frame));
+        sendResult = avcodec_send_frame(m_encoderContext, frame);
+    }
+    if (sendResult < 0) {
+        if (frame) {
+            std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to send filtered frame to encoder context; "
+                "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
+        } else {
+            std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to flush encoder context; "
+                "send result: '" << sendResult << " (" << av_err2str(sendResult) << ")'" << std::endl;
+        }
+        return false;
+    }
+
+    while (true) {
+        auto receiveResult = avcodec_receive_packet(m_encoderContext, m_encoderPacket);
+        if ((AVERROR(EAGAIN) == receiveResult) || (AVERROR_EOF == receiveResult)) {
+            break;
+        } else if (receiveResult < 0) {
+            std::cerr << "{VideoStreamer::encodeWriteFrame}; unable to receive encoder packet from encoder context; "
+                "receive result: '" << receiveResult << " (" << av_err2str(receiveResult) << ")'" << std::endl;
+        }
+
+        /* a static frame would have been encoded as a delta frame */
+        if (!(AV_PKT_FLAG_KEY & m_encoderPacket->flags)) {
+            m_metrics.add(StreamMetrics::Metric::EncodedDeltaPackets);
+            m_metrics.add(StreamMetrics::Metric::EncodedDeltaBytes, static_cast<std::uint64_t>(m_encoderPacket->size));
+        }
+
+        /* prepare packet for muxing */
+        m_encoderPacket->stream_index = m_videoStreamIndex;
+        av_packet_rescale_ts(
+            m_encoderPacket, m_encoderContext->time_base,
+            m_outputContext->streams[
+                static_cast<std::size_t>(m_videoStreamIndex)
+            ]->time_base
+        );
+
+        /* the recorder, the LL-HLS packager and the DVR keep their own references; the writer takes over this one */
+        m_segmentRecorder.record(m_encoderPacket);
+        m_llHlsPackager.push(m_encoderPacket);
+        m_packetRingBuffer.push(m_encoderPacket);
+
+        /* mux encoded frame */
+        if (!m_packetWriter.write(m_encoderPacket)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VideoStreamer::filterEncodeWriteFrame(AVFrame* decoderFrame, AVFrame* filteredFrame) {
+    if (decoderFrame && !swapFilterGraph(filteredFrame)) {
+        return false;
+    }
+    if (nullptr == m_bufferSrcContext) {
+        std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; pointer to buffer src context is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == m_bufferSinkContext) {
+        std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; pointer to buffer sink context is NULL" << std::endl;
+        return false;
+    }
+
+    AVFrame* sourceFrame = decoderFrame;
+    if (decoderFrame && m_pixelConverter.isSet()) {
+        if (m_isScalerComparisonPending) {
+            m_isScalerComparisonPending = false;
+            m_pixelConverter.compareWithScaler(decoderFrame);
+        }
+        TraceScope convertTrace("convert", m_traceStreamId, CaptureTimestamp::getPts(decoderFrame));
+        auto beginTime = CommonFunctions::getCurTimeSinceEpoch();
+        /* layers show the capture time of the frame when it is known */
+        auto frameTime = CaptureTimestamp::get(decoderFrame).value_or(beginTime);
+        if (!m_pixelConverter.convert(decoderFrame, m_convertedFrame, frameTime)) {
+            return false;
+        }
+        auto endTime = CommonFunctions::getCurTimeSinceEpoch();
+        m_metrics.add(StreamMetrics::Metric::ConversionTime, static_cast<std::uint64_t>(std::max<std::int64_t>(endTime - beginTime, 0)));
+        sourceFrame = m_convertedFrame;
+    }
+
+    /* push the decoded frame into the filtergraph; the graph takes over the reference */
+    auto addResult = av_buffersrc_add_frame_flags(m_bufferSrcContext, sourceFrame, 0);
+    if (addResult < 0) {
+        std::cerr << "{VideoStreamer::filterEncodeWriteFrame}; unable to add flags; "
+            "add result: '" << addResult << " (" << av_err2str(addResult) << ")'" << std::endl;
+        return false;
+    }
+    if (sourceFrame) {
+        ++m_nGraphInputFrames;
+    }
+    return encodeWriteFilteredFrames(m_bufferSinkContext, filteredFrame);
+}
+
+bool VideoStreamer::dispatchRegularizedFrame(AVFrame* decoderFrame, AVFrame* filteredFrame, bool isFlushing) {
+    if (nullptr == decoderFrame) {
+        std::cerr << "{VideoStreamer::dispatchRegularizedFrame}; pointer to decoder frame is NULL" << std::endl;
+        return false;
+    }
+    /* frames from the flushed decoder are encoded on this thread, after the scheduled jobs */
+    auto dispatch = [this, filteredFrame, isFlushing] (AVFrame* frame, bool isFillFrame) {
+        if (!isFlushing) {
+            return dispatchDecodedFrame(frame, filteredFrame, isFillFrame);
+        }
+        bool wasEncoded = filterEncodeWriteFrame(frame, filteredFrame);
+        if (wasEncoded && isFillFrame) {
+            m_metrics.add(StreamMetrics::Metric::TimestampFilledFrames);
+        }
+        return wasEncoded;
+    };
+
+    decoderFrame->pts = decoderFrame->best_effort_timestamp;
+    if (!m_timestampRegularizer.isSet() || (AV_NOPTS_VALUE == decoderFrame->pts)) {
+        return dispatch(decoderFrame, false);
+    }
+
+    auto cameraTime = av_rescale_q(decoderFrame->pts, m_decoderContext->pkt_timebase, AV_TIME_BASE_Q);
+    auto captureTime = CaptureTimestamp::get(decoderFrame).value_or(CommonFunctions::getCurTimeSinceEpoch());
+    auto result = m_timestampRegularizer.regularize(cameraTime, captureTime);
+    if (!result.has_value()) {
+        m_metrics.add(StreamMetrics::Metric::TimestampSkippedFrames);
+        return true;
+    }
+    if (result->isClockStep) {
+        m_metrics.add(StreamMetrics::Metric::TimestampClockSteps);
+        std::cout << "{VideoStreamer::dispatchRegularizedFrame}; step of camera clock was removed" << std::endl;
+    }
+    if (result->nGapFrames > 0) {
+        m_metrics.add(StreamMetrics::Metric::TimestampGapFrames, result->nGapFrames);
+    }
+
+    /* slots are ticks of the encoder time base, the filter graph runs in the time base of the camera */
+    auto getSlotPts = [this] (std::int64_t slot) {
+        return av_rescale_q(slot, m_encoderContext->time_base, m_decoderContext->pkt_timebase);
+    };
+    /* a copy of the frame that ends the gap is static by definition: with static frames dropped,
+     * the gap is left in the timeline like a run of dropped frames */
+    bool isStaticDropEnabled = m_motionAnalyzer.isSet() && m_configParams.isStaticSceneDetectionEnabled;
+    auto nFillFrames = isStaticDropEnabled ? 0 : result->nFillFrames;
+    for (; nFillFrames > 0; --nFillFrames) {
+        /* empty slots show the frame that ends the gap; the clone shares its buffers */
+        auto fillFrame = av_frame_clone(decoderFrame);
+        if (nullptr == fillFrame) {
+            std::cerr << "{VideoStreamer::dispatchRegularizedFrame}; unable to clone decoder frame" << std::endl;
+            return false;
+        }
+        fillFrame->pts = getSlotPts(result->slot - static_cast<std::int64_t>(nFillFrames));
+        auto isDispatched = dispatch(fillFrame, true);
+        av_frame_free(&fillFrame);
+        if (!isDispatched) {
+            return false;
+        }
+    }
+    decoderFrame->pts = getSlotPts(result->slot);
+    return dispatch(decoderFrame, false);
+}
+
+bool VideoStreamer::dispatchDecodedFrame(AVFrame* decoderFrame, AVFrame* filteredFrame, bool isFillFrame) {
+    if (nullptr == decoderFrame) {
+        std::cerr << "{VideoStreamer::dispatchDecodedFrame}; pointer to decoder frame is NULL" << std::endl;
+        return false;
+    }
+    /* a fill frame repeats its successor, which is compared against the reference instead */
+    if (m_motionAnalyzer.isSet() && !isFillFrame) {
+        auto nChangedBlocks = m_motionAnalyzer.analyze(decoderFrame);
+        if (isStaticFrame(decoderFrame, nChangedBlocks)) {
+            m_metrics.add(StreamMetrics::Metric::StaticFramesDropped);
+            return true;
+        }
+        m_motionAnalyzer.commitReference();
+        if (!attachRegionsOfInterest(decoderFrame, nChangedBlocks)) {
+            return false;
+        }
+    }
+
+    /* a frame has to be encoded before its successor is captured */
+    std::int64_t deadline = CommonFunctions::getSteadyTime() + m_frameDuration;
+    if (!m_encodeSchedulerStreamId.has_value()) {
+        return encodeDecodedFrame(decoderFrame, filteredFrame, deadline, isFillFrame);
+    }
+
+    /* the decoder frame is reused by the caller; the job keeps its own reference */
+    std::shared_ptr<AVFrame> scheduledFrame(
+        av_frame_clone(decoderFrame),
+        [] (AVFrame* frame) { av_frame_free(&frame); }
+    );
+    if (nullptr == scheduledFrame) {
+        std::cerr << "{VideoStreamer::dispatchDecodedFrame}; unable to clone decoder frame" << std::endl;
+        return false;
+    }
+
+    auto job = [this, scheduledFrame, deadline, isFillFrame] () {
+        return encodeDecodedFrame(scheduledFrame.get(), m_scheduledFilteredFrame, deadline, isFillFrame);
+    };
+    if (!EncodeScheduler::getInstance().submit(m_encodeSchedulerStreamId.value(), deadline, job)) {
+        std::cerr << "{VideoStreamer::dispatchDecodedFrame}; unable to submit decoder frame to encode scheduler" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VideoStreamer::encodeDecodedFrame(AVFrame* decoderFrame, AVFrame* filteredFrame, std::int64_t deadline, bool isFillFrame) {
+    auto beginTime = CommonFunctions::getCurTimeSinceEpoch();
+    bool wasEncoded = filterEncodeWriteFrame(decoderFrame, filteredFrame);
+    auto endTime = CommonFunctions::getCurTimeSinceEpoch();
+    m_metrics.add(StreamMetrics::Metric::EncodedFrames);
+    if (wasEncoded && isFillFrame) {
+        m_metrics.add(StreamMetrics::Metric::TimestampFilledFrames);
+    }
+    m_metrics.add(StreamMetrics::Metric::EncodeTime, static_cast<std::uint64_t>(std::max<std::int64_t>(endTime - beginTime, 0)));
+    countSchedulingMiss(StreamMetrics::Metric::EncodeSchedulingMisses, deadline);
+    return wasEncoded;
+}
+
+bool VideoStreamer::isStaticFrame(const AVFrame* decoderFrame, std::size_t nChangedBlocks) {
+    if (!m_configParams.isStaticSceneDetectionEnabled || (AV_NOPTS_VALUE == decoderFrame->pts)) {
+        return false;
+    }
+
+    /* the reference is only replaced by frames that are encoded, so slow drifts are still detected */
+    auto frameTime = av_rescale_q(decoderFrame->pts, m_decoderContext->pkt_timebase, AV_TIME_BASE_Q);
+    bool isIntervalElapsed =
+        !m_lastEncodedFrameTime.has_value() ||
+        ((frameTime - m_lastEncodedFrameTime.value()) >= m_configParams.staticSceneMaxInterval) ||
+        (frameTime < m_lastEncodedFrameTime.value());
+    if ((0 == nChangedBlocks) && !isIntervalElapsed) {
+        return true;
+    }
+    m_lastEncodedFrameTime = frameTime;
+    return false;
+}
+
+bool VideoStreamer::attachRegionsOfInterest(AVFrame* decoderFrame, std::size_t nChangedBlocks) {
+    if (!m_configParams.isRoiEnabled || (0 == m_configParams.roiQualityOffset)) {
+        return true;
+    }
+    /* a frame that is all static or all moving is encoded uniformly */
+    auto nBlocks =
+        static_cast<std::size_t>(m_motionAnalyzer.getBlocksWide()) *
+        static_cast<std::size_t>(m_motionAnalyzer.getBlocksHigh());
+    if ((0 == nChangedBlocks) || (nBlocks == nChangedBlocks)) {
+        return true;
+    }
+
+    m_motionAnalyzer.getChangedRegions(m_configParams.roiMinRegionBlocks, g_maxRoiRegions, m_changedRegions);
+    if (m_changedRegions.empty()) {
+        return true;
+    }
+
+    /* side data survives the filter graph; where regions overlap, the first one takes precedence,
+     * so the moving regions are followed by the whole frame as background */
+    auto nRegions = m_changedRegions.size() + 1;
+    auto* sideData = av_frame_new_side_data(
+        decoderFrame, AV_FRAME_DATA_REGIONS_OF_INTEREST, nRegions * sizeof(AVRegionOfInterest)
+    );
+    if (nullptr == sideData) {
+        std::cerr << "{VideoStreamer::attachRegionsOfInterest}; unable to allocate memory for side data" << std::endl;
+        return false;
+    }
+    std::span<AVRegionOfInterest> regionsOfInterest(reinterpret_cast<AVRegionOfInterest*>(sideData->data), nRegions);
+    for (std::size_t i = 0; i < m_changedRegions.size(); ++i) {
+        const auto& region = m_changedRegions[i];
+        regionsOfInterest[i] = AVRegionOfInterest{
+            .self_size = sizeof(AVRegionOfInterest),
+            .top = region.top, .bottom = region.bottom,
+            .left = region.left, .right = region.right,
+            .qoffset = av_make_q(-m_configParams.roiQualityOffset, 100)
+        };
+    }
+    regionsOfInterest[nRegions - 1] = AVRegionOfInterest{
+        .self_size = sizeof(AVRegionOfInterest),
+        .top = 0, .bottom = decoderFrame->height,
+        .left = 0, .right = decoderFrame->width,
+        .qoffset = av_make_q(m_configParams.roiQualityOffset, 100)
+    };
+    return true;
+}
+
+bool VideoStreamer::waitDispatchedFrames() {
+    if (!m_encodeSchedulerStreamId.has_value()) {
+        return true;
+    }
+    if (!EncodeScheduler::getInstance().waitIdle(m_encodeSchedulerStreamId.value())) {
+        std::cerr << "{VideoStreamer::waitDispatchedFrames}; encode scheduler was unable to process frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VideoStreamer::encodeWriteFilteredFrames(AVFilterContext* bufferSinkContext, AVFrame* filteredFrame) {
+    if (nullptr == bufferSinkContext) {
+        std::cerr << "{VideoStreamer::encodeWriteFilteredFrames}; pointer to buffer sink context is NULL" << std::endl;
+        return false;
+    }
+
+    /* pull filtered frames from the filtergraph */
+    bool readyToFlush = false;
+    while (true) {
+        int getResult = 0;
+        {
+            /* the filters run while the frame is pulled */
+            TraceScope filterTrace("filter", m_traceStreamId);
+            getResult = av_buffersink_get_frame(bufferSinkContext, filteredFrame);
+            if (getResult >= 0) {
+                filterTrace.setFlowId(CaptureTimestamp::getPts(filteredFrame));
+            } else {
+                filterTrace.discard();
+            }
+        }
+        if (getResult < 0) {
+            /* if no more frames for output - returns AVERROR(EAGAIN)
+             * if flushed and no more frames for output - returns AVERROR_EOF
+             * rewrite retcode to 0 to show it as normal procedure completion
+             */
+            if ((AVERROR(EAGAIN) == getResult) || (AVERROR_EOF == getResult)) {
+                break;
+            }
+            std::cerr << "{VideoStreamer::encodeWriteFilteredFrames}; unable to get filtered frame from buffer sink context; "
+                "get result: '" << getResult << " (" << av_err2str(getResult) << ")'" << std::endl;
+            return false;
+        }
+
+        if (bufferSinkContext == m_bufferSinkContext) {
+            ++m_nGraphOutputFrames;
+        }
+        filteredFrame->time_base = av_buffersink_get_time_base(bufferSinkContext);
+        /* the type is copied to the rendition frames, so their keyframes are forced as well */
+        filteredFrame->pict_type = isKeyframeDue() ?
+            AVPictureType::AV_PICTURE_TYPE_I :
+            AVPictureType::AV_PICTURE_TYPE_NONE;
+        if (m_overlayCompositor.isSet() && !m_pixelConverter.isBlendingFused()) {
+            TraceScope overlayTrace("overlay", m_traceStreamId, CaptureTimestamp::getPts(filteredFrame));
+            if (!m_overlayCompositor.blend(
+                filteredFrame, CaptureTimestamp::get(filteredFrame).value_or(CommonFunctions::getCurTimeSinceEpoch())
+            )) {
+                av_frame_unref(filteredFrame);
+                return false;
+            }
+        }
+        /* renditions are scaled before the main encoder rescales the timestamp of the frame */
+        if (m_multiScaler.isSet() && !encodeRenditions(filteredFrame)) {
+            av_frame_unref(filteredFrame);
+            return false;
+        }
+        bool wasWritten = encodeWriteFrame(readyToFlush, filteredFrame);
+        av_frame_unref(filteredFrame);
+        if (!wasWritten) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VideoStreamer::swapFilterGraph(AVFrame* filteredFrame) {
+    FilterGraphRebuilder::Graph readyGraph;
+    if (!m_filterGraphRebuilder.takeReadyGraph(readyGraph)) {
+        return true;
+    }
+
+    FilterGraphRebuilder::Graph retiredGraph{
+        .filterGraph = m_filterGraph,
+        .bufferSrcContext = m_bufferSrcContext,
+        .bufferSinkContext = m_bufferSinkContext
+    };
+    auto nBufferedFrames = m_nGraphInputFrames - m_nGraphOutputFrames;
+    m_filterGraph = readyGraph.filterGraph;
+    m_bufferSrcContext = readyGraph.bufferSrcContext;
+    m_bufferSinkContext = readyGraph.bufferSinkContext;
+    m_nGraphInputFrames = 0;
+    m_nGraphOutputFrames = 0;
+    std::cout << "{VideoStreamer::swapFilterGraph}; filter graph has been successfully swapped" << std::endl;
+
+    /* frames still buffered inside the old graph precede the current one,
+     * so they are encoded before it, on this thread; the graphs of this streamer
+     * pass every frame through at once, so usually there is nothing to drain;
+     * freeing is left to the rebuild thread */
+    bool wasDrained = true;
+    if ((nBufferedFrames > 0) && retiredGraph.bufferSrcContext && retiredGraph.bufferSinkContext) {
+        auto beginTime = CommonFunctions::getSteadyTime();
+        auto addResult = av_buffersrc_add_frame_flags(retiredGraph.bufferSrcContext, nullptr, 0);
+        if (addResult < 0) {
+            std::cerr << "{VideoStreamer::swapFilterGraph}; unable to flush retired filter graph; "
+                "add result: '" << addResult << " (" << av_err2str(addResult) << ")'" << std::endl;
+        } else {
+            wasDrained = encodeWriteFilteredFrames(retiredGraph.bufferSinkContext, filteredFrame);
+        }
+        std::cout << "{VideoStreamer::swapFilterGraph}; retired filter graph has been drained; "
+            "buffered frames: '" << nBufferedFrames << "'; "
+            "drain time: '" << (CommonFunctions::getSteadyTime() - beginTime) << " us'" << std::endl;
+    }
+    m_filterGraphRebuilder.retireGraph(retiredGraph);
+    /* the frames of the old graph were blended as before; from here on the new graph decides */
+    m_pixelConverter.setBlendingFused(!readyGraph.hasWatermark);
+    return wasDrained;
+}
+
+bool VideoStreamer::setWatermark(std::string watermarkLocation) {
+    std::optional<std::string> location{ std::nullopt };
+    if (!watermarkLocation.empty()) {
+        if (!isWatermarkValid(watermarkLocation)) {
+            return false;
+        }
+        location = std::make_optional<std::string>(watermarkLocation);
+    }
+
+    auto params = m_filterGraphParams;
+    if (params.bufferSrcArgs.empty()) {
+        std::cerr << "{VideoStreamer::setWatermark}; filter graph parameters are NOT set" << std::endl;
+        return false;
+    }
+    if (!getFilterParams(location, params)) {
+        return false;
+    }
+    if (!m_filterGraphRebuilder.requestRebuild(params)) {
+        return false;
+    }
+    /* later rebuilds start from the stored parameters and must NOT bring back the old watermark */
+    m_configParams.watermarkLocation = location;
+    m_filterGraphParams = params;
+    if (location.has_value()) {
+        std::cout << "{VideoStreamer::setWatermark}; filter graph rebuild was requested; "
+            "watermark location: '" << location.value() << "'" << std::endl;
+    } else {
+        std::cout << "{VideoStreamer::setWatermark}; filter graph rebuild was requested; "
+            "watermark is NOT enabled" << std::endl;
+    }
+    return true;
+}
+
+bool VideoStreamer::getFilterParams(
+    const std::optional<std::string>& watermarkLocation, FilterGraphRebuilder::Params& params
+) const {
+    params.filterDescription.clear();
+    params.overlayFrame.reset();
+    if (!watermarkLocation.has_value()) {
+        params.filterDescription = "null";
+        return true;
+    }
+
+    /* the decoded watermark is fed to the graph, instead of decoding the file again with 'movie' */
+    params.overlayFrame = WatermarkCache::getInstance().getFrame(watermarkLocation.value(), g_watermarkPixelFormat);
+    if (nullptr == params.overlayFrame) {
+        std::cerr << "{VideoStreamer::getFilterParams}; unable to get decoded watermark; "
+            "watermark location: '" << watermarkLocation.value() << "'" << std::endl;
+        return false;
+    }
+    params.filterDescription = "[in][wm] overlay=10:main_h-overlay_h-10 [out]";
+    return true;
+}
+
+bool VideoStreamer::isWatermarkValid(const std::string& watermarkLocation) const {
+    if (watermarkLocation.empty()) {
+        std::cerr << "{VideoStreamer::isWatermarkValid}; watermark location is empty" << std::endl;
+        return false;
+    }
+    if (!CommonFunctions::fileExists(watermarkLocation)) {
+        return false;
+    }
+    if (!CommonFunctions::isRegularFile(watermarkLocation)) {
+        return false;
+    }
+
+    unsigned int watermarkWidth = 0;
+    unsigned int watermarkHeight = 0;
+    if (!CommonFunctions::getPngSize(watermarkLocation, watermarkWidth, watermarkHeight)) {
+        return false;
+    }
+    if ((0 == watermarkWidth) || (watermarkWidth > static_cast<unsigned int>(m_configParams.frameWidth))) {
+        std::cerr << "{VideoStreamer::isWatermarkValid}; watermark width is NOT within range (0, " << m_configParams.frameWidth << "]; "
+            "current watermark width: '" << watermarkWidth << "'; "
+            "watermark location: '" << watermarkLocation << "'" << std::endl;
+        return false;
+    }
+    if ((0 == watermarkHeight) || (watermarkHeight > static_cast<unsigned int>(m_configParams.frameHeight))) {
+        std::cerr << "{VideoStreamer::isWatermarkValid}; watermark height is NOT within range (0, " << m_configParams.frameHeight << "]; "
+            "current watermark height: '" << watermarkHeight << "'; "
+            "watermark location: '" << watermarkLocation << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VideoStreamer::openSocketOutput(const AVIOInterruptCB& interruptCallback) {
+    const auto& settings = m_configParams.socketSettings.value();
+    if (!m_socketOutput.open(m_configParams.rtmpUrl, settings, interruptCallback)) {
+        return false;
+    }
+
+    auto ioBuffer = static_cast<unsigned char*>(av_malloc(settings.bufferSize));
+    if (nullptr == ioBuffer) {
+        std::cerr << "{VideoStreamer::openSocketOutput}; unable to allocate memory for I/O buffer" << std::endl;
+        return false;
+    }
+    /* NOT seekable; flv is written strictly sequentially */
+    m_socketIoContext = avio_alloc_context(
+        ioBuffer, static_cast<int>(settings.bufferSize), 1,
+        static_cast<void*>(&m_socketOutput), nullptr, &SocketOutput::onProxyWrite, nullptr
+    );
+    if (nullptr == m_socketIoContext) {
+        std::cerr << "{VideoStreamer::openSocketOutput}; unable to allocate I/O context" << std::endl;
+        av_free(ioBuffer);
+        return false;
+    }
+    m_outputContext->pb = m_socketIoContext;
+    m_outputContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+    /* one sendmsg() per packet instead of one per filled buffer */
+    m_outputContext->flush_packets = 1;
+    return true;
+}
+
+bool VideoStreamer::setupRenditions(const PacketWriter::Settings& writerSettings) {
+    if (!MultiScaler::isPixelFormatSupported(m_encoderContext->pix_fmt)) {
+        std::cerr << "{VideoStreamer::setupRenditions}; renditions are NOT supported for pixel format '" <<
+            static_cast<int>(m_encoderContext->pix_fmt) << "'" << std::endl;
+        return false;
+    }
+
+    std::vector<RenditionEncoder::Settings> renditions;
+    std::vector<MultiScaler::Size> sizes;
+    for (const auto& params : m_configParams.renditions) {
+        auto settings = params.settings;
+        if (params.divisor > 0) {
+            /* sizes of 4:2:0 frames are even */
+            settings.width = (m_encoderContext->width / params.divisor) & ~1;
+            settings.height = (m_encoderContext->height / params.divisor) & ~1;
+        }
+        if (m_encodeSchedulerStreamId.has_value()) {
+            settings.nThreads = 1;
+        }
+        settings.encoderOptions = m_configParams.encoderOptions;
+        /* rates of the main output are scaled by the area of the rendition */
+        auto mainArea = static_cast<std::int64_t>(m_encoderContext->width) * m_encoderContext->height;
+        auto area = static_cast<std::int64_t>(settings.width) * settings.height;
+        settings.encoderOptions.bitRate = av_rescale(settings.encoderOptions.bitRate, area, mainArea);
+        settings.encoderOptions.maxRate = av_rescale(settings.encoderOptions.maxRate, area, mainArea);
+        renditions.push_back(settings);
+        sizes.push_back(MultiScaler::Size{ .width = settings.width, .height = settings.height });
+    }
+    /* sizes are checked before any output is opened */
+    if (!m_multiScaler.setup(m_encoderContext->width, m_encoderContext->height, m_encoderContext->pix_fmt, sizes)) {
+        return false;
+    }
+
+    /* latency and output rate are measured on the main output only */
+    auto renditionWriterSettings = writerSettings;
+    renditionWriterSettings.latencyHistogram = nullptr;
+    renditionWriterSettings.rateMeter = nullptr;
+    for (const auto& settings : renditions) {
+        m_renditionEncoders.push_back(std::make_unique<RenditionEncoder>());
+        if (!m_renditionEncoders.back()->setup(
+            settings, m_encoderContext, m_configParams.protocolSettings.at(settings.protocol),
+            renditionWriterSettings, &m_metrics
+        )) {
+            return false;
+        }
+        m_renditionFrames.push_back(av_frame_alloc());
+        if (nullptr == m_renditionFrames.back()) {
+            std::cerr << "{VideoStreamer::setupRenditions}; unable to allocate memory for rendition frame" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VideoStreamer::encodeRenditions(const AVFrame* filteredFrame) {
+    TraceScope renditionsTrace("renditions", m_traceStreamId, CaptureTimestamp::getPts(filteredFrame));
+    auto beginTime = CommonFunctions::getCurTimeSinceEpoch();
+    if (!m_multiScaler.scale(filteredFrame, m_renditionFrames)) {
+        return false;
+    }
+    auto endTime = CommonFunctions::getCurTimeSinceEpoch();
+    m_metrics.add(StreamMetrics::Metric::RenditionScaleTime, static_cast<std::uint64_t>(std::max<std::int64_t>(endTime - beginTime, 0)));
+
+    for (std::size_t i = 0; i < m_renditionEncoders.size(); ++i) {
+        bool wasEncoded = m_renditionEncoders[ i ]->encode(m_renditionFrames[ i ]);
+        av_frame_unref(m_renditionFrames[ i ]);
+        if (!wasEncoded) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VideoStreamer::flushEncoder(AVFrame* filteredFrame) {
+    if (nullptr == m_encoderContext) {
+        std::cerr << "{VideoStreamer::flushEncoder}; pointer to encoder context is NULL" << std::endl;
+        return false;
+    }
+    if (nullptr == m_encoderContext->codec) {
+        std::cerr << "{VideoStreamer::flushEncoder}; pointer to encoder is NULL" << std::endl;
         return false;
     }
 
@@ -1017,7 +3292,66 @@ bool VideoStreamer::flushEncoder(AVFrame* filteredFrame) {
     return encodeWriteFrame(readyToFlush, filteredFrame);
 }
 
+void VideoStreamer::countSchedulingMiss(StreamMetrics::Metric metric, std::int64_t deadline) {
+    if (CommonFunctions::getSteadyTime() > deadline) {
+        m_metrics.add(metric);
+    }
+}
+
 void VideoStreamer::deallocateResources() {
+    /* a job that is running on the scheduler still uses the contexts below */
+    if (m_encodeSchedulerStreamId.has_value()) {
+        EncodeScheduler::getInstance().unregisterStream(m_encodeSchedulerStreamId.value());
+        m_encodeSchedulerStreamId.reset();
+    }
+    if (m_scheduledFilteredFrame) {
+        av_frame_free(&m_scheduledFilteredFrame);
+        m_scheduledFilteredFrame = nullptr;
+    }
+    /* the audio thread writes into the packet writer */
+    m_audioCapturer.stop();
+    m_packetWriter.stop();
+    m_audioCapturer.close();
+    m_captureClock.reset();
+    for (auto& renditionEncoder : m_renditionEncoders) {
+        renditionEncoder->close();
+    }
+    m_renditionEncoders.clear();
+    for (auto*& renditionFrame : m_renditionFrames) {
+        av_frame_free(&renditionFrame);
+    }
+    m_renditionFrames.clear();
+    m_multiScaler.clear();
+    m_segmentRecorder.stop();
+    m_llHlsPackager.stop();
+    /* wakes the requests that wait for the next part */
+    auto segmentStore = m_segmentStore.exchange(nullptr);
+    if (segmentStore) {
+        segmentStore->close();
+    }
+    m_llHlsServer.stop();
+    m_clipExporter.stop();
+    m_packetRingBuffer.clear();
+
+    /* puts the bytestream context of the output back before it is closed */
+    m_outputPacer.close();
+
+    if (m_socketIoContext) {
+        if (m_timeoutChecker) {
+            m_timeoutChecker->setBeginTime();
+            avio_flush(m_socketIoContext);
+            m_socketOutput.flush();
+            m_timeoutChecker->resetBeginTime();
+        }
+        if (m_outputContext) {
+            m_outputContext->pb = nullptr;
+        }
+        av_freep(&m_socketIoContext->buffer);
+        avio_context_free(&m_socketIoContext);
+        m_socketIoContext = nullptr;
+    }
+    m_socketOutput.close();
+
     if (
         m_outputContext && m_outputContext->pb && m_outputContext->oformat && !(
             AVFMT_NOFILE & m_outputContext->oformat->flags
@@ -1054,24 +3388,143 @@ void VideoStreamer::deallocateResources() {
         avcodec_free_context(&m_encoderContext);
         m_encoderContext = nullptr;
     }
+    if (m_nEncoderThreads > 0) {
+        EncoderThreadBudget::getInstance().release(m_nEncoderThreads);
+        m_nEncoderThreads = 0;
+    }
 
+    m_filterGraphRebuilder.stop();
     if (m_filterGraph) {
         avfilter_graph_free(&m_filterGraph);
         m_filterGraph = nullptr;
     }
     m_bufferSinkContext = nullptr;
     m_bufferSrcContext = nullptr;
+    m_nGraphInputFrames = 0;
+    m_nGraphOutputFrames = 0;
+    m_motionAnalyzer.clear();
+    m_pixelConverter.clear();
+    if (m_convertedFrame) {
+        av_frame_free(&m_convertedFrame);
+        m_convertedFrame = nullptr;
+    }
+    m_overlayCompositor.clear();
 
     if (m_decoderContext) {
         avcodec_free_context(&m_decoderContext);
         m_decoderContext = nullptr;
     }
+    /* buffers still referenced by packets or frames keep the pool alive until they are freed */
+    if (m_captureTimestampPool) {
+        av_buffer_pool_uninit(&m_captureTimestampPool);
+        m_captureTimestampPool = nullptr;
+    }
 
     m_videoStreamIndex = -1;
     if (m_inputContext) {
         avformat_close_input(&m_inputContext);
         m_inputContext = nullptr;
     }
+
+    if (m_registeredLogLevel.has_value()) {
+        LogDispatcher::getInstance().unregisterLogLevel(m_registeredLogLevel.value());
+        m_registeredLogLevel.reset();
+    }
+}
+
+void VideoStreamer::stop() {
+    m_isStopRequested.store(true, std::memory_order_relaxed);
+}
+
+bool VideoStreamer::setOverlayText(std::string layerName, std::string text) {
+    if (layerName.empty()) {
+        std::cerr << "{VideoStreamer::setOverlayText}; layer name is empty" << std::endl;
+        return false;
+    }
+    return m_overlayCompositor.setText(layerName, text);
+}
+
+std::map<std::string, double> VideoStreamer::getMetrics() const {
+    auto metrics = m_metrics.getSnapshot();
+    metrics["dvr_buffered_bytes"] = static_cast<double>(m_packetRingBuffer.getBufferedBytes());
+    metrics["dvr_buffered_seconds"] = static_cast<double>(m_packetRingBuffer.getBufferedDuration()) / AV_TIME_BASE;
+    /* the store is released by deallocateResources while process() runs without the GIL */
+    auto segmentStore = m_segmentStore.load();
+    metrics["ll_hls_stored_bytes"] = segmentStore ? static_cast<double>(segmentStore->getStoredBytes()) : 0.0;
+
+    /* frames that were dropped as static would have cost the mean encode time */
+    auto nEncodedFrames = m_metrics.get(StreamMetrics::Metric::EncodedFrames);
+    if (nEncodedFrames > 0) {
+        auto meanEncodeTime = static_cast<double>(m_metrics.get(StreamMetrics::Metric::EncodeTime)) / static_cast<double>(nEncodedFrames);
+        metrics["estimated_saved_encode_us"] =
+            meanEncodeTime * static_cast<double>(m_metrics.get(StreamMetrics::Metric::StaticFramesDropped));
+    } else {
+        metrics["estimated_saved_encode_us"] = 0.0;
+    }
+    /* and would have been sent at the mean size of a delta frame */
+    auto nDeltaPackets = m_metrics.get(StreamMetrics::Metric::EncodedDeltaPackets);
+    if (nDeltaPackets > 0) {
+        auto meanDeltaSize = static_cast<double>(m_metrics.get(StreamMetrics::Metric::EncodedDeltaBytes)) / static_cast<double>(nDeltaPackets);
+        metrics["estimated_saved_bytes"] =
+            meanDeltaSize * static_cast<double>(m_metrics.get(StreamMetrics::Metric::StaticFramesDropped));
+    } else {
+        metrics["estimated_saved_bytes"] = 0.0;
+    }
+
+    metrics["latency_samples"] = static_cast<double>(m_latencyHistogram.getCount());
+    metrics["latency_p50_us"] = static_cast<double>(m_latencyHistogram.getPercentile(0.5));
+    metrics["latency_p90_us"] = static_cast<double>(m_latencyHistogram.getPercentile(0.9));
+    metrics["latency_p99_us"] = static_cast<double>(m_latencyHistogram.getPercentile(0.99));
+    metrics["latency_max_us"] = static_cast<double>(m_latencyHistogram.getMax());
+
+    metrics["output_peak_rate_kbps"] = static_cast<double>(m_outputRateMeter.getPeakRate()) / 1000.0;
+    metrics["output_average_rate_kbps"] = static_cast<double>(m_outputRateMeter.getAverageRate()) / 1000.0;
+    metrics["output_peak_to_average_ratio"] = m_outputRateMeter.getPeakToAverageRatio();
+
+    /* lateness of the chunks released by the pacer against their schedule */
+    metrics["pacing_error_p50_us"] = static_cast<double>(m_pacingErrorHistogram.getPercentile(0.5));
+    metrics["pacing_error_p99_us"] = static_cast<double>(m_pacingErrorHistogram.getPercentile(0.99));
+    metrics["pacing_error_max_us"] = static_cast<double>(m_pacingErrorHistogram.getMax());
+    metrics["capture_frame_period_us"] = m_timestampRegularizer.getFramePeriod();
+    metrics["capture_jitter_us"] = m_timestampRegularizer.getJitter();
+
+    /* zero unless the output goes through our own socket */
+    auto socketStats = m_socketOutput.getStats();
+    metrics["socket_rtt_us"] = static_cast<double>(socketStats.rtt);
+    metrics["socket_unsent_bytes"] = static_cast<double>(socketStats.nUnsentBytes);
+    metrics["socket_send_calls"] = static_cast<double>(socketStats.nSendCalls);
+    metrics["socket_sent_bytes"] = static_cast<double>(socketStats.nSentBytes);
+    return metrics;
+}
+
+bool VideoStreamer::exportClip(double start, double duration, std::string fileName) {
+    if (!m_packetRingBuffer.isSet()) {
+        std::cerr << "{VideoStreamer::exportClip}; DVR is NOT enabled" << std::endl;
+        return false;
+    }
+    if (fileName.empty()) {
+        std::cerr << "{VideoStreamer::exportClip}; file name is empty" << std::endl;
+        return false;
+    }
+    if (!(duration > 0.0)) {
+        std::cerr << "{VideoStreamer::exportClip}; duration is NOT positive" << std::endl;
+        return false;
+    }
+
+    std::vector<AVPacket*> packets;
+    if (!m_packetRingBuffer.copyRange(
+        std::llround(start * AV_TIME_BASE), std::llround(duration * AV_TIME_BASE), packets
+    )) {
+        return false;
+    }
+    auto nPackets = packets.size();
+    if (!m_clipExporter.exportClip(packets, fileName)) {
+        return false;
+    }
+    std::cout << "{VideoStreamer::exportClip}; clip export was requested; "
+        "number of packets: '" << nPackets << "'; "
+        "file name: '" << fileName << "'" << std::endl;
+    return true;
 }
 
 std::optional<const AVPixelFormat> VideoStreamer::getPixelFormat(const AVCodec* encoder) const {
@@ -1122,3 +3575,23 @@ std::optional<const AVPixelFormat> VideoStreamer::getPixelFormat(const AVCodec*
         "encoder name: '" << avcodec_get_name(encoder->id) << "'" << std::endl;
     return std::make_optional<const AVPixelFormat>(pixelFormat);
 }
+
+void VideoStreamer::requestKeyframe() {
+    m_isKeyframeRequested = true;
+}
+
+bool VideoStreamer::isKeyframeDue() {
+    if (!m_isKeyframeRequested) {
+        return false;
+    }
+    auto curTime = CommonFunctions::getCurTimeSinceEpoch();
+    if (m_lastForcedKeyframeTime.has_value() &&
+        ((curTime - m_lastForcedKeyframeTime.value()) < g_minForcedKeyframeInterval)
+    ) {
+        return false;
+    }
+    m_isKeyframeRequested = false;
+    m_lastForcedKeyframeTime = curTime;
+    m_metrics.add(StreamMetrics::Metric::ForcedKeyframes);
+    return true;
+}
@@ -0,0 +1,212 @@
+#include "watermark_cache.h"
+
+extern "C" {
+    #include <libavutil/error.h>
+    #include <libavutil/frame.h>
+    #include <libswscale/swscale.h>
+}
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "lodepng.h"
+#include "simple_wrapper.h"
+
+namespace {
+    constexpr std::size_t g_maxCachedWatermarks = 16;
+}
+
+std::shared_ptr<AVFrame> WatermarkCache::getFrame(const std::string& fileName, AVPixelFormat pixelFormat) {
+    if (fileName.empty()) {
+        std::cerr << "{WatermarkCache::getFrame}; file name is empty" << std::endl;
+        return nullptr;
+    }
+
+    std::error_code errorCode;
+    auto modificationTime = std::filesystem::last_write_time(fileName, errorCode);
+    if (errorCode) {
+        std::cerr << "{WatermarkCache::getFrame}; unable to get modification time; "
+            "error description: '" << errorCode.message() << "'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    }
+    auto fileSize = std::filesystem::file_size(fileName, errorCode);
+    if (errorCode) {
+        std::cerr << "{WatermarkCache::getFrame}; unable to get file size; "
+            "error description: '" << errorCode.message() << "'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    }
+    auto modificationTicks = static_cast<std::int64_t>(modificationTime.time_since_epoch().count());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto key = std::make_pair(fileName, pixelFormat);
+    auto it = m_entries.find(key);
+    if (
+        (m_entries.end() != it) &&
+        (it->second.modificationTime == modificationTicks) &&
+        (it->second.fileSize == fileSize)
+    ) {
+        it->second.lastUse = ++m_useCounter;
+        return it->second.frame;
+    }
+
+    /* decoded under the lock, so that streams set up at the same time decode the image only once */
+    auto frame = decodeFrame(fileName, pixelFormat);
+    if (nullptr == frame) {
+        return nullptr;
+    }
+    m_entries[key] = Entry{
+        .modificationTime = modificationTicks,
+        .fileSize = fileSize,
+        .lastUse = ++m_useCounter,
+        .frame = frame
+    };
+    evict();
+    std::cout << "{WatermarkCache::getFrame}; watermark has been successfully decoded; "
+        "size: '" << frame->width << "x" << frame->height << "'; "
+        "file name: '" << fileName << "'" << std::endl;
+    return frame;
+}
+
+void WatermarkCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+std::shared_ptr<AVFrame> WatermarkCache::allocateFrame(int width, int height, AVPixelFormat pixelFormat) {
+    std::shared_ptr<AVFrame> frame(
+        av_frame_alloc(),
+        [] (AVFrame* frame) { av_frame_free(&frame); }
+    );
+    if (nullptr == frame) {
+        std::cerr << "{WatermarkCache::allocateFrame}; unable to allocate memory for frame" << std::endl;
+        return nullptr;
+    }
+    frame->width = width;
+    frame->height = height;
+    frame->format = pixelFormat;
+    frame->pts = 0;
+    frame->sample_aspect_ratio = AVRational{ 1, 1 };
+    auto bufferResult = av_frame_get_buffer(frame.get(), 0);
+    if (bufferResult < 0) {
+        std::cerr << "{WatermarkCache::allocateFrame}; unable to allocate frame buffer; "
+            "buffer result: '" << bufferResult << " (" << av_err2str(bufferResult) << ")'" << std::endl;
+        return nullptr;
+    }
+    return frame;
+}
+
+std::shared_ptr<AVFrame> WatermarkCache::decodeFrame(const std::string& fileName, AVPixelFormat pixelFormat) {
+    using namespace SimpleWrapperSpace;
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<unsigned char> pngFile;
+    try {
+        unsigned int errorCode = lodepng::load_file(pngFile, fileName);
+        if (0 != errorCode) {
+            std::cerr << "{WatermarkCache::decodeFrame}; unable to load PNG file; "
+                "error code: '" << errorCode << " (" << lodepng_error_text(errorCode) << ")'; "
+                "file name: '" << fileName << "'" << std::endl;
+            return nullptr;
+        }
+    } catch (const std::length_error& exception) {
+        std::cerr << "{WatermarkCache::decodeFrame}; "
+            "exception 'std::length_error' was successfully caught; "
+            "exception description: '" << exception.what() << "'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    } catch (const std::bad_alloc& exception) {
+        std::cerr << "{WatermarkCache::decodeFrame}; "
+            "exception 'std::bad_alloc' was successfully caught; "
+            "exception description: '" << exception.what() << "'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    } catch (...) {
+        std::cerr << "{WatermarkCache::decodeFrame}; "
+            "unknown exception was caught while "
+            "loading PNG file; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    }
+
+    LodePNGState state;
+    lodepng_state_init(&state);
+    SimpleWrapper stateWrapper(nullptr, [&state] () { lodepng_state_cleanup(&state); });
+    state.info_raw.colortype = LCT_RGBA;
+    state.info_raw.bitdepth = 8;
+
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int errorCode = lodepng_inspect(&width, &height, &state, pngFile.data(), pngFile.size());
+    if (0 != errorCode) {
+        std::cerr << "{WatermarkCache::decodeFrame}; unable to read PNG header; "
+            "error code: '" << errorCode << " (" << lodepng_error_text(errorCode) << ")'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    }
+
+    /* the image is unfiltered straight into the RGBA frame, row by row, without an intermediate image */
+    auto rgbaFrame = allocateFrame(static_cast<int>(width), static_cast<int>(height), AV_PIX_FMT_RGBA);
+    if (nullptr == rgbaFrame) {
+        return nullptr;
+    }
+    errorCode = lodepng_decode_into(
+        rgbaFrame->data[ 0 ], static_cast<std::size_t>(rgbaFrame->linesize[ 0 ]), width, height,
+        &state, pngFile.data(), pngFile.size()
+    );
+    if (0 != errorCode) {
+        std::cerr << "{WatermarkCache::decodeFrame}; unable to decode PNG image; "
+            "error code: '" << errorCode << " (" << lodepng_error_text(errorCode) << ")'; "
+            "file name: '" << fileName << "'" << std::endl;
+        return nullptr;
+    }
+    auto decodeTime = std::chrono::steady_clock::now() - startTime;
+
+    auto frame = allocateFrame(rgbaFrame->width, rgbaFrame->height, pixelFormat);
+    if (nullptr == frame) {
+        return nullptr;
+    }
+    SwsContext* scaleContext = sws_getContext(
+        frame->width, frame->height, AV_PIX_FMT_RGBA,
+        frame->width, frame->height, pixelFormat,
+        SWS_BICUBIC | SWS_ACCURATE_RND, nullptr, nullptr, nullptr
+    );
+    if (nullptr == scaleContext) {
+        std::cerr << "{WatermarkCache::decodeFrame}; unable to create conversion context; "
+            "pixel format: '" << static_cast<int>(pixelFormat) << "'" << std::endl;
+        return nullptr;
+    }
+    auto nRows = sws_scale(
+        scaleContext, rgbaFrame->data, rgbaFrame->linesize, 0, frame->height,
+        frame->data, frame->linesize
+    );
+    sws_freeContext(scaleContext);
+    if (nRows != frame->height) {
+        std::cerr << "{WatermarkCache::decodeFrame}; unable to convert watermark; "
+            "number of converted rows: '" << nRows << "'" << std::endl;
+        return nullptr;
+    }
+    std::cout << "{WatermarkCache::decodeFrame}; PNG image has been successfully decoded; "
+        "decode time: '" << std::chrono::duration<double, std::milli>(decodeTime).count() << " ms'; "
+        "file name: '" << fileName << "'" << std::endl;
+    return frame;
+}
+
+void WatermarkCache::evict() {
+    while (m_entries.size() > g_maxCachedWatermarks) {
+        auto oldestIt = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->second.lastUse < oldestIt->second.lastUse) {
+                oldestIt = it;
+            }
+        }
+        /* streams that still use the frame keep their own reference */
+        m_entries.erase(oldestIt);
+    }
+}